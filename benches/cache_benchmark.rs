@@ -0,0 +1,185 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::cache::ShardedCache;
+use simplehash::murmur::MurmurHasher64;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+use std::sync::Mutex;
+use std::thread;
+
+const KEYS: u64 = 100_000;
+const OPS_PER_THREAD: usize = 50_000;
+const NIL: usize = usize::MAX;
+
+// The baseline being replaced: a HashMap plus an intrusive LRU list, behind one mutex.
+// Every hit relinks the entry at the head of the list.
+struct LruCache {
+    index: HashMap<u64, usize, BuildHasherDefault<MurmurHasher64>>,
+    nodes: Vec<(u64, u64, usize, usize)>, // key, value, prev, next
+    head: usize,
+    tail: usize,
+    capacity: usize,
+}
+
+impl LruCache {
+    fn new(capacity: usize) -> Self {
+        Self {
+            index: HashMap::default(),
+            nodes: Vec::with_capacity(capacity),
+            head: NIL,
+            tail: NIL,
+            capacity,
+        }
+    }
+
+    fn unlink(&mut self, i: usize) {
+        let (_, _, prev, next) = self.nodes[i];
+        match prev {
+            NIL => self.head = next,
+            p => self.nodes[p].3 = next,
+        }
+        match next {
+            NIL => self.tail = prev,
+            n => self.nodes[n].2 = prev,
+        }
+    }
+
+    fn push_front(&mut self, i: usize) {
+        self.nodes[i].2 = NIL;
+        self.nodes[i].3 = self.head;
+        match self.head {
+            NIL => self.tail = i,
+            h => self.nodes[h].2 = i,
+        }
+        self.head = i;
+    }
+
+    fn get(&mut self, key: u64) -> Option<u64> {
+        let i = *self.index.get(&key)?;
+        self.unlink(i);
+        self.push_front(i);
+        Some(self.nodes[i].1)
+    }
+
+    fn insert(&mut self, key: u64, value: u64) {
+        if let Some(&i) = self.index.get(&key) {
+            self.nodes[i].1 = value;
+            self.unlink(i);
+            self.push_front(i);
+            return;
+        }
+        let i = if self.nodes.len() < self.capacity {
+            self.nodes.push((key, value, NIL, NIL));
+            self.nodes.len() - 1
+        } else {
+            let i = self.tail;
+            self.unlink(i);
+            self.index.remove(&self.nodes[i].0);
+            self.nodes[i] = (key, value, NIL, NIL);
+            i
+        };
+        self.index.insert(key, i);
+        self.push_front(i);
+    }
+}
+
+trait Cache: Sync {
+    fn get(&self, key: u64) -> Option<u64>;
+}
+
+impl Cache for Mutex<LruCache> {
+    fn get(&self, key: u64) -> Option<u64> {
+        self.lock().unwrap().get(key)
+    }
+}
+
+impl Cache for ShardedCache<[u8; 8], u64> {
+    fn get(&self, key: u64) -> Option<u64> {
+        ShardedCache::get(self, &key.to_le_bytes())
+    }
+}
+
+fn workloads(threads: usize) -> Vec<Vec<u64>> {
+    (0..threads)
+        .map(|t| {
+            let mut rng = StdRng::seed_from_u64(t as u64);
+            (0..OPS_PER_THREAD)
+                .map(|_| rng.gen_range(0..KEYS))
+                .collect()
+        })
+        .collect()
+}
+
+fn run<C: Cache>(cache: &C, workloads: &[Vec<u64>]) -> usize {
+    thread::scope(|s| {
+        let handles: Vec<_> = workloads
+            .iter()
+            .map(|keys| {
+                s.spawn(move || {
+                    keys.iter()
+                        .filter(|&&k| cache.get(black_box(k)).is_some())
+                        .count()
+                })
+            })
+            .collect();
+        handles.into_iter().map(|h| h.join().unwrap()).sum()
+    })
+}
+
+fn bench_hit_scaling(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cache_hits");
+
+    // Every key fits, so each lookup is a hit
+    let lru = Mutex::new(LruCache::new(KEYS as usize));
+    let sharded = ShardedCache::new(KEYS as usize);
+    for key in 0..KEYS {
+        lru.lock().unwrap().insert(key, key);
+        sharded.insert(key.to_le_bytes(), key);
+    }
+
+    for &threads in &[1, 2, 4, 8, 16, 32, 64] {
+        let keys = workloads(threads);
+        group.throughput(criterion::Throughput::Elements(
+            (threads * OPS_PER_THREAD) as u64,
+        ));
+        group.bench_with_input(BenchmarkId::new("mutex_lru", threads), &keys, |b, k| {
+            b.iter(|| run(&lru, k));
+        });
+        group.bench_with_input(BenchmarkId::new("sharded_clock", threads), &keys, |b, k| {
+            b.iter(|| run(&sharded, k));
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_batch(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cache_batch");
+
+    let cache = ShardedCache::new(KEYS as usize);
+    for key in 0..KEYS {
+        cache.insert(key.to_le_bytes(), key);
+    }
+    let mut rng = StdRng::seed_from_u64(42);
+    let keys: Vec<[u8; 8]> = (0..10_000)
+        .map(|_| rng.gen_range(0..2 * KEYS).to_le_bytes())
+        .collect();
+    group.throughput(criterion::Throughput::Elements(keys.len() as u64));
+
+    group.bench_function("get_single", |b| {
+        b.iter(|| {
+            keys.iter()
+                .filter(|k| cache.get(black_box(*k)).is_some())
+                .count()
+        });
+    });
+    group.bench_function("get_batch", |b| {
+        b.iter(|| cache.get_batch(black_box(&keys)).iter().flatten().count());
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_hit_scaling, bench_batch);
+criterion_main!(benches);
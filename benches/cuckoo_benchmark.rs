@@ -0,0 +1,119 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::cuckoo::CuckooMap;
+use simplehash::murmur::MurmurHasher64;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+
+// Both tables hash with MurmurHash3; the cuckoo map keeps all 128 bits, HashMap the low 64
+type MurmurMap<K, V> = HashMap<K, V, BuildHasherDefault<MurmurHasher64>>;
+
+fn bench_lookup_u64(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cuckoo_lookup_u64");
+
+    let mut rng = StdRng::seed_from_u64(42);
+    for &count in &[10_000, 1_000_000, 10_000_000] {
+        let keys: Vec<u64> = (0..count).map(|_| rng.r#gen()).collect();
+        let cuckoo: CuckooMap<u64, u64> = keys.iter().map(|&k| (k, k >> 3)).collect();
+        let map: MurmurMap<u64, u64> = keys.iter().map(|&k| (k, k >> 3)).collect();
+
+        // 90% hits, 10% misses
+        let queries: Vec<u64> = (0..10_000)
+            .map(|i| {
+                if i % 10 == 0 {
+                    rng.r#gen()
+                } else {
+                    keys[rng.gen_range(0..count)]
+                }
+            })
+            .collect();
+        group.throughput(criterion::Throughput::Elements(queries.len() as u64));
+
+        group.bench_with_input(BenchmarkId::new("cuckoo", count), &queries, |b, q| {
+            b.iter(|| {
+                q.iter()
+                    .filter_map(|k| cuckoo.get(black_box(k)))
+                    .sum::<u64>()
+            });
+        });
+        group.bench_with_input(
+            BenchmarkId::new("hashmap_murmur", count),
+            &queries,
+            |b, q| {
+                b.iter(|| q.iter().filter_map(|k| map.get(black_box(k))).sum::<u64>());
+            },
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_lookup_str(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cuckoo_lookup_str");
+
+    let mut rng = StdRng::seed_from_u64(7);
+    let count = 1_000_000;
+    let keys: Vec<String> = (0..count)
+        .map(|i| format!("user:{}:session:{}", i, rng.r#gen::<u32>()))
+        .collect();
+    let cuckoo: CuckooMap<String, usize> = keys.iter().cloned().zip(0..).collect();
+    let map: MurmurMap<String, usize> = keys.iter().cloned().zip(0..).collect();
+    let queries: Vec<&str> = (0..10_000)
+        .map(|_| keys[rng.gen_range(0..count)].as_str())
+        .collect();
+    group.throughput(criterion::Throughput::Elements(queries.len() as u64));
+
+    group.bench_function(BenchmarkId::new("cuckoo", count), |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter_map(|k| cuckoo.get(black_box(*k)))
+                .sum::<usize>()
+        });
+    });
+    group.bench_function(BenchmarkId::new("hashmap_murmur", count), |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter_map(|k| map.get(black_box(*k)))
+                .sum::<usize>()
+        });
+    });
+
+    group.finish();
+}
+
+fn bench_insert(c: &mut Criterion) {
+    let mut group = c.benchmark_group("cuckoo_insert");
+    group.sample_size(10);
+
+    let mut rng = StdRng::seed_from_u64(99);
+    let count = 1_000_000;
+    let keys: Vec<u64> = (0..count).map(|_| rng.r#gen()).collect();
+    group.throughput(criterion::Throughput::Elements(count as u64));
+
+    group.bench_function(BenchmarkId::new("cuckoo", count), |b| {
+        b.iter(|| {
+            let mut map = CuckooMap::new();
+            for &k in &keys {
+                map.insert(k, k);
+            }
+            map.len()
+        });
+    });
+    group.bench_function(BenchmarkId::new("hashmap_murmur", count), |b| {
+        b.iter(|| {
+            let mut map = MurmurMap::default();
+            for &k in &keys {
+                map.insert(k, k);
+            }
+            map.len()
+        });
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_lookup_u64, bench_lookup_str, bench_insert);
+criterion_main!(benches);
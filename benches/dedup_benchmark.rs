@@ -0,0 +1,79 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use simplehash::dedup::DedupBuilder;
+use std::collections::HashSet;
+
+// Set SIMPLEHASH_DEDUP_RECORDS (e.g. to 1000000000) to run the large constrained-memory
+// workload; the in-memory baseline is skipped above 100M records
+const DEFAULT_RECORDS: u64 = 10_000_000;
+const BASELINE_LIMIT: u64 = 100_000_000;
+
+fn records() -> u64 {
+    std::env::var("SIMPLEHASH_DEDUP_RECORDS")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_RECORDS)
+}
+
+// Record `i` of a stream in which every distinct record appears twice on average, spread
+// over the whole stream
+fn record(i: u64, distinct: u64, buf: &mut [u8; 22]) -> &[u8] {
+    let mut z = i.wrapping_add(0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)).wrapping_mul(0x94d049bb133111eb);
+    let id = (z ^ (z >> 31)) % distinct;
+    buf[..6].copy_from_slice(b"event-");
+    for (k, b) in buf[6..].iter_mut().enumerate() {
+        *b = b"0123456789abcdef"[(id >> (60 - 4 * k)) as usize & 0xf];
+    }
+    &buf[..]
+}
+
+fn bench_dedup(c: &mut Criterion) {
+    let mut group = c.benchmark_group("dedup");
+    group.sample_size(10);
+
+    let n = records();
+    let distinct = n / 2;
+    group.throughput(criterion::Throughput::Elements(n));
+
+    if n <= BASELINE_LIMIT {
+        group.bench_function(BenchmarkId::new("hashset_in_memory", n), |b| {
+            b.iter(|| {
+                let mut buf = [0u8; 22];
+                let mut seen = HashSet::new();
+                let mut unique = 0usize;
+                for i in 0..n {
+                    let r = record(i, distinct, &mut buf);
+                    if seen.insert(r.to_vec()) {
+                        unique += r.len();
+                    }
+                }
+                unique
+            });
+        });
+    }
+
+    // Budgets from enough for everything down to a small fraction of the distinct set
+    for &budget_mb in &[4096usize, 256, 32] {
+        let id = format!("{}_records_{}MB", n, budget_mb);
+        group.bench_function(BenchmarkId::new("spilling_dedup", id), |b| {
+            b.iter(|| {
+                let mut buf = [0u8; 22];
+                let mut dedup = DedupBuilder::new(budget_mb << 20).build();
+                for i in 0..n {
+                    dedup.push(record(i, distinct, &mut buf)).unwrap();
+                }
+                dedup
+                    .finish()
+                    .unwrap()
+                    .map(|r| r.unwrap().len())
+                    .sum::<usize>()
+            });
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_dedup);
+criterion_main!(benches);
@@ -0,0 +1,102 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, RngCore, SeedableRng};
+use simplehash::duplicates::DuplicateFinder;
+use simplehash::tree_hash::TreeHasher;
+use std::collections::HashMap;
+use std::fs;
+use std::path::Path;
+
+// Set SIMPLEHASH_DUPES_FILES to resize the generated tree (default 10K files of 4..256 KiB)
+const DEFAULT_FILES: usize = 10_000;
+const FILES_PER_DIR: usize = 500;
+// Few distinct sizes, so most files share their size with others, as photos or build
+// artifacts of one kind often do
+const SIZES: usize = 400;
+
+fn generate(root: &Path, files: usize) {
+    let mut rng = StdRng::seed_from_u64(42);
+    let sizes: Vec<usize> = (0..SIZES)
+        .map(|_| rng.gen_range(4 << 10..256 << 10))
+        .collect();
+    let mut written: Vec<Vec<u8>> = Vec::new();
+    for i in 0..files {
+        let dir = root.join(format!("d{:03}", i / FILES_PER_DIR));
+        if i % FILES_PER_DIR == 0 {
+            fs::create_dir_all(&dir).unwrap();
+        }
+        let data = match rng.gen_range(0..20) {
+            // 10% exact copies of an earlier file
+            0 | 1 if !written.is_empty() => written[rng.gen_range(0..written.len())].clone(),
+            // 5% copies edited in the middle, which only a full read can tell apart
+            2 if !written.is_empty() => {
+                let mut data = written[rng.gen_range(0..written.len())].clone();
+                let middle = data.len() / 2;
+                data[middle] ^= 0xff;
+                data
+            }
+            _ => {
+                let mut data = vec![0u8; sizes[rng.gen_range(0..SIZES)]];
+                rng.fill_bytes(&mut data);
+                data
+            }
+        };
+        fs::write(dir.join(format!("f{}", i)), &data).unwrap();
+        // Keep a bounded pool of originals to copy from
+        if written.len() < 256 {
+            written.push(data);
+        }
+    }
+}
+
+fn bench_dupes(c: &mut Criterion) {
+    let files = std::env::var("SIMPLEHASH_DUPES_FILES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_FILES);
+    let root = std::env::temp_dir().join(format!("simplehash-dupes-bench-{}", std::process::id()));
+    generate(&root, files);
+
+    let report = DuplicateFinder::new().find(&[&root]).unwrap();
+    let stats = report.stats;
+    println!(
+        "{} files, {} bytes; {} duplicate groups; staged search sampled {} files, read {} files \
+         whole, {} bytes in total ({:.1}% of a full read)",
+        stats.files,
+        stats.total_bytes,
+        report.groups.len(),
+        stats.sampled_files,
+        stats.hashed_files,
+        stats.bytes_read,
+        stats.bytes_read as f64 * 100.0 / stats.total_bytes as f64
+    );
+
+    let mut group = c.benchmark_group("dupes");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Elements(files as u64));
+
+    // Baseline: fingerprint every file, then group by fingerprint
+    group.bench_function("full_read_all", |b| {
+        let hasher = TreeHasher::new();
+        b.iter(|| {
+            let manifest = hasher.hash(&root).unwrap();
+            let mut groups: HashMap<u128, usize> = HashMap::new();
+            for entry in &manifest.entries {
+                *groups.entry(entry.hash).or_default() += 1;
+            }
+            groups.values().filter(|&&n| n > 1).count()
+        })
+    });
+    for threads in [1, 4] {
+        let finder = DuplicateFinder::new().threads(threads);
+        group.bench_function(BenchmarkId::new("staged", threads), |b| {
+            b.iter(|| finder.find(&[&root]).unwrap().groups.len())
+        });
+    }
+
+    group.finish();
+    fs::remove_dir_all(&root).unwrap();
+}
+
+criterion_group!(benches, bench_dupes);
+criterion_main!(benches);
@@ -0,0 +1,97 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::feature_hash::{FeatureHash, HashingVectorizer};
+use std::collections::HashMap;
+
+const DOCUMENTS: usize = 20_000;
+const VOCABULARY: usize = 50_000;
+
+// Synthetic corpus: documents of 50-300 words drawn from a Zipf-like vocabulary, with mixed
+// case and punctuation
+fn corpus() -> Vec<String> {
+    let mut rng = StdRng::seed_from_u64(42);
+    let words: Vec<String> = (0..VOCABULARY)
+        .map(|_| {
+            let len = rng.gen_range(2..10);
+            (0..len)
+                .map(|_| rng.gen_range(b'a'..=b'z') as char)
+                .collect()
+        })
+        .collect();
+    (0..DOCUMENTS)
+        .map(|_| {
+            let len = rng.gen_range(50..300);
+            let mut doc = String::new();
+            for _ in 0..len {
+                let rank = (rng.r#gen::<f64>().powi(3) * VOCABULARY as f64) as usize;
+                let word = &words[rank];
+                if rng.gen_range(0..10) == 0 {
+                    doc.push_str(&word.to_uppercase());
+                    doc.push_str(", ");
+                } else {
+                    doc.push_str(word);
+                    doc.push(' ');
+                }
+            }
+            doc
+        })
+        .collect()
+}
+
+fn bench_feature_hash(c: &mut Criterion) {
+    let docs = corpus();
+    let bytes: usize = docs.iter().map(String::len).sum();
+    let mut group = c.benchmark_group("feature_hash");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Bytes(bytes as u64));
+
+    // Baseline: allocate each lowercased token and bigram and count it in a HashMap vocabulary
+    group.bench_function("vocabulary_hashmap", |b| {
+        b.iter(|| {
+            let mut vocabulary: HashMap<String, u32> = HashMap::new();
+            let mut nnz = 0;
+            for doc in &docs {
+                let tokens: Vec<String> = doc
+                    .split(|c: char| !c.is_alphanumeric())
+                    .filter(|t| t.len() >= 2)
+                    .map(str::to_lowercase)
+                    .collect();
+                let mut row: HashMap<u32, f32> = HashMap::new();
+                let bigrams = tokens.windows(2).map(|w| format!("{} {}", w[0], w[1]));
+                for gram in tokens.iter().cloned().chain(bigrams) {
+                    let next = vocabulary.len() as u32;
+                    let id = *vocabulary.entry(gram).or_insert(next);
+                    *row.entry(id).or_default() += 1.0;
+                }
+                nnz += row.len();
+            }
+            nnz
+        })
+    });
+
+    for (name, hash) in [
+        ("murmur3", FeatureHash::Murmur3 { seed: 0 }),
+        ("city64", FeatureHash::City64),
+    ] {
+        for threads in [1, 0] {
+            let vectorizer = HashingVectorizer::new(1 << 20)
+                .ngram_range(1, 2)
+                .hash_function(hash)
+                .threads(threads);
+            let label = if threads == 0 {
+                "all_cores"
+            } else {
+                "1_thread"
+            };
+            group.bench_function(BenchmarkId::new(name, label), |b| {
+                b.iter(|| vectorizer.transform(&docs).nnz())
+            });
+        }
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_feature_hash);
+criterion_main!(benches);
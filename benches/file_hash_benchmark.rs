@@ -0,0 +1,80 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{RngCore, SeedableRng};
+use simplehash::digest::{self, Algorithm};
+use std::fs;
+use std::io::{BufReader, Write};
+
+// Set SIMPLEHASH_FILE_BYTES to change the size of the hashed file (default 512 MiB)
+const DEFAULT_BYTES: usize = 512 << 20;
+
+fn bytes() -> usize {
+    std::env::var("SIMPLEHASH_FILE_BYTES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_BYTES)
+}
+
+fn bench_file_hash(c: &mut Criterion) {
+    let path = std::env::temp_dir().join(format!("simplehash-file-bench-{}", std::process::id()));
+    {
+        let mut rng = StdRng::seed_from_u64(42);
+        let mut file = fs::File::create(&path).unwrap();
+        let mut block = vec![0u8; 1 << 20];
+        let mut left = bytes();
+        while left > 0 {
+            let n = left.min(block.len());
+            rng.fill_bytes(&mut block[..n]);
+            file.write_all(&block[..n]).unwrap();
+            left -= n;
+        }
+    }
+
+    let mut group = c.benchmark_group("file_hash");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Bytes(bytes() as u64));
+
+    for algorithms in [
+        &[Algorithm::Murmur3_128][..],
+        &[Algorithm::FarmFingerprint128][..],
+        &[
+            Algorithm::Fnv1a64,
+            Algorithm::Murmur3_32,
+            Algorithm::Murmur3_128,
+        ][..],
+    ] {
+        let label = algorithms
+            .iter()
+            .map(|a| a.name())
+            .collect::<Vec<_>>()
+            .join("+");
+
+        // Baseline: read the whole file into a Vec, then hash it once per algorithm
+        group.bench_function(BenchmarkId::new("read_to_vec", &label), |b| {
+            b.iter(|| {
+                let data = fs::read(&path).unwrap();
+                algorithms.iter().map(|a| a.hash(&data)).sum::<u128>()
+            })
+        });
+        group.bench_function(BenchmarkId::new("mmap", &label), |b| {
+            b.iter(|| digest::hash_file(&path, algorithms, false).unwrap())
+        });
+        group.bench_function(BenchmarkId::new("mmap_populate", &label), |b| {
+            b.iter(|| digest::hash_file(&path, algorithms, true).unwrap())
+        });
+        if algorithms.iter().all(|a| a.is_streaming()) {
+            group.bench_function(BenchmarkId::new("buffered_1mib", &label), |b| {
+                b.iter(|| {
+                    let file = fs::File::open(&path).unwrap();
+                    digest::hash_reader(BufReader::new(file), algorithms).unwrap()
+                })
+            });
+        }
+    }
+
+    group.finish();
+    fs::remove_file(&path).unwrap();
+}
+
+criterion_group!(benches, bench_file_hash);
+criterion_main!(benches);
@@ -0,0 +1,160 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::city::city_hash64;
+use simplehash::farm::farm_fingerprint64;
+use simplehash::fingerprint_set::FingerprintSet;
+use simplehash::prehashed::NoHashBuildHasher;
+use std::collections::HashSet;
+use std::sync::Mutex;
+use std::thread;
+
+const EVENTS_PER_THREAD: usize = 100_000;
+
+// Per-thread event-ID fingerprints where about half the IDs are also seen by other threads
+fn event_streams(threads: usize) -> Vec<Vec<u64>> {
+    let universe = (threads * EVENTS_PER_THREAD / 2) as u64;
+    (0..threads)
+        .map(|t| {
+            let mut rng = StdRng::seed_from_u64(t as u64);
+            (0..EVENTS_PER_THREAD)
+                .map(|_| {
+                    let id = format!("event-{:016x}", rng.gen_range(0..universe));
+                    city_hash64(id.as_bytes())
+                })
+                .collect()
+        })
+        .collect()
+}
+
+fn run_threads<F: Fn(&[u64]) -> usize + Sync>(streams: &[Vec<u64>], f: F) -> usize {
+    thread::scope(|s| {
+        let handles: Vec<_> = streams
+            .iter()
+            .map(|stream| {
+                let f = &f;
+                s.spawn(move || f(stream))
+            })
+            .collect();
+        handles.into_iter().map(|h| h.join().unwrap()).sum()
+    })
+}
+
+fn bench_concurrent_dedup(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fingerprint_set_dedup");
+
+    for &threads in &[1, 2, 4, 8, 16, 32] {
+        let streams = event_streams(threads);
+        let total = threads * EVENTS_PER_THREAD;
+        group.throughput(criterion::Throughput::Elements(total as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("insert", threads),
+            &streams,
+            |b, streams| {
+                b.iter(|| {
+                    let set = FingerprintSet::with_capacity(total);
+                    run_threads(streams, |stream| {
+                        stream
+                            .iter()
+                            .filter(|&&fp| set.insert(black_box(fp)).unwrap())
+                            .count()
+                    })
+                });
+            },
+        );
+
+        group.bench_with_input(
+            BenchmarkId::new("insert_batch", threads),
+            &streams,
+            |b, streams| {
+                b.iter(|| {
+                    let set = FingerprintSet::with_capacity(total);
+                    run_threads(streams, |stream| {
+                        set.insert_batch(black_box(stream)).unwrap()
+                    })
+                });
+            },
+        );
+
+        group.bench_with_input(
+            BenchmarkId::new("mutex_hashset", threads),
+            &streams,
+            |b, streams| {
+                b.iter(|| {
+                    let set = Mutex::new(HashSet::with_capacity_and_hasher(
+                        total,
+                        NoHashBuildHasher::default(),
+                    ));
+                    run_threads(streams, |stream| {
+                        stream
+                            .iter()
+                            .filter(|&&fp| set.lock().unwrap().insert(black_box(fp)))
+                            .count()
+                    })
+                });
+            },
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_lookup(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fingerprint_set_lookup");
+
+    let mut rng = StdRng::seed_from_u64(42);
+    for &size in &[10_000, 1_000_000, 10_000_000] {
+        let set = FingerprintSet::with_capacity(size);
+        let fps: Vec<u64> = (0..size).map(|_| rng.r#gen::<u64>()).collect();
+        set.insert_batch(&fps).unwrap();
+        let queries: Vec<u64> = (0..10_000)
+            .map(|i| {
+                if i % 2 == 0 {
+                    fps[i * 7 % size]
+                } else {
+                    rng.r#gen()
+                }
+            })
+            .collect();
+        group.throughput(criterion::Throughput::Elements(queries.len() as u64));
+
+        group.bench_with_input(BenchmarkId::new("contains", size), &queries, |b, q| {
+            b.iter(|| q.iter().filter(|&&fp| set.contains(black_box(fp))).count());
+        });
+    }
+
+    group.finish();
+}
+
+// Fingerprint cost for the two hash functions the set is typically fed with
+fn bench_fingerprints(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fingerprint_set_hashing");
+
+    let ids: Vec<String> = (0..10_000).map(|i| format!("event-{:016x}", i)).collect();
+    group.throughput(criterion::Throughput::Elements(ids.len() as u64));
+
+    group.bench_function("city_hash64", |b| {
+        b.iter(|| {
+            ids.iter()
+                .fold(0, |acc, id| acc ^ city_hash64(black_box(id.as_bytes())))
+        });
+    });
+    group.bench_function("farm_fingerprint64", |b| {
+        b.iter(|| {
+            ids.iter().fold(0, |acc, id| {
+                acc ^ farm_fingerprint64(black_box(id.as_bytes()))
+            })
+        });
+    });
+
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_concurrent_dedup,
+    bench_lookup,
+    bench_fingerprints
+);
+criterion_main!(benches);
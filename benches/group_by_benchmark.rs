@@ -0,0 +1,81 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::group_by::{Aggregate, GroupBy};
+use simplehash::murmur::MurmurHasher64;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+
+const ROWS: usize = 100_000_000;
+
+// The baseline being replaced: one HashMap of accumulators, filled row by row
+fn naive_group_by(keys: &[u64], values: &[i64]) -> usize {
+    let mut groups: HashMap<u64, [i64; 4], BuildHasherDefault<MurmurHasher64>> = HashMap::default();
+    for (&k, &v) in keys.iter().zip(values) {
+        let g = groups.entry(k).or_insert([0, 0, i64::MAX, i64::MIN]);
+        g[0] += 1;
+        g[1] = g[1].wrapping_add(v);
+        g[2] = g[2].min(v);
+        g[3] = g[3].max(v);
+    }
+    groups.len()
+}
+
+fn bench_cardinality(c: &mut Criterion) {
+    let mut group = c.benchmark_group("group_by");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Elements(ROWS as u64));
+
+    let mut rng = StdRng::seed_from_u64(42);
+    let values: Vec<i64> = (0..ROWS).map(|_| rng.gen_range(-1_000..1_000)).collect();
+    let aggregates = [
+        Aggregate::Count,
+        Aggregate::Sum(0),
+        Aggregate::Min(0),
+        Aggregate::Max(0),
+    ];
+
+    for &groups in &[100u64, 10_000_000] {
+        let keys: Vec<u64> = (0..ROWS).map(|_| rng.gen_range(0..groups)).collect();
+
+        group.bench_function(BenchmarkId::new("naive_hashmap", groups), |b| {
+            b.iter(|| naive_group_by(black_box(&keys), black_box(&values)));
+        });
+        group.bench_function(BenchmarkId::new("partitioned", groups), |b| {
+            let engine = GroupBy::new(&aggregates);
+            b.iter(|| engine.run(black_box(&keys), &[&values]).len());
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_distinct(c: &mut Criterion) {
+    let mut group = c.benchmark_group("group_by_distinct");
+    group.sample_size(10);
+
+    let rows = 10_000_000;
+    let mut rng = StdRng::seed_from_u64(7);
+    let keys: Vec<u32> = (0..rows).map(|_| rng.gen_range(0..1_000)).collect();
+    let users: Vec<i64> = (0..rows).map(|_| rng.gen_range(0..1_000_000)).collect();
+    group.throughput(criterion::Throughput::Elements(rows as u64));
+
+    group.bench_function("exact_hashset", |b| {
+        b.iter(|| {
+            let mut sets: HashMap<u32, std::collections::HashSet<i64>> = HashMap::new();
+            for (&k, &u) in keys.iter().zip(&users) {
+                sets.entry(k).or_default().insert(u);
+            }
+            sets.len()
+        });
+    });
+    group.bench_function("hll_precision_10", |b| {
+        let engine = GroupBy::new(&[Aggregate::Distinct(0)]).distinct_precision(10);
+        b.iter(|| engine.run(black_box(&keys), &[&users]).len());
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_cardinality, bench_distinct);
+criterion_main!(benches);
@@ -0,0 +1,147 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::city::CityHasher64;
+use simplehash::fnv::Fnv1aHasher64;
+use simplehash::interner::{Interner, SharedInterner};
+use simplehash::murmur::MurmurHasher64;
+use std::collections::HashMap;
+use std::collections::hash_map::RandomState;
+use std::hash::{BuildHasher, BuildHasherDefault};
+
+// Identifier-like tokens drawn from `distinct` names, so most occurrences are repeats
+fn token_stream(len: usize, distinct: usize, rng: &mut StdRng) -> Vec<String> {
+    (0..len)
+        .map(|_| format!("ident_{}_{}", rng.gen_range(0..distinct), distinct))
+        .collect()
+}
+
+// Baseline interner: one heap allocation per distinct string
+fn hashmap_intern<S: BuildHasher + Default>(tokens: &[String]) -> usize {
+    let mut map: HashMap<String, u32, S> = HashMap::default();
+    let mut strings = Vec::new();
+    for token in tokens {
+        let token = black_box(token.as_str());
+        if let Some(&id) = map.get(token) {
+            black_box(id);
+        } else {
+            let id = strings.len() as u32;
+            map.insert(token.to_string(), id);
+            strings.push(token.to_string());
+        }
+    }
+    strings.len()
+}
+
+fn bench_intern(c: &mut Criterion) {
+    let mut group = c.benchmark_group("interner_intern");
+
+    let mut rng = StdRng::seed_from_u64(42);
+    let len = 200_000;
+    for &distinct in &[1_000, 50_000, 200_000] {
+        let tokens = token_stream(len, distinct, &mut rng);
+        group.throughput(criterion::Throughput::Elements(len as u64));
+
+        group.bench_with_input(BenchmarkId::new("arena_farm", distinct), &tokens, |b, t| {
+            b.iter(|| {
+                let mut interner = Interner::new();
+                for token in t {
+                    black_box(interner.intern(black_box(token)));
+                }
+                interner.len()
+            });
+        });
+
+        group.bench_with_input(
+            BenchmarkId::new("hashmap_sip", distinct),
+            &tokens,
+            |b, t| {
+                b.iter(|| hashmap_intern::<RandomState>(t));
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("hashmap_fnv1a", distinct),
+            &tokens,
+            |b, t| {
+                b.iter(|| hashmap_intern::<BuildHasherDefault<Fnv1aHasher64>>(t));
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("hashmap_murmur", distinct),
+            &tokens,
+            |b, t| {
+                b.iter(|| hashmap_intern::<BuildHasherDefault<MurmurHasher64>>(t));
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("hashmap_city", distinct),
+            &tokens,
+            |b, t| {
+                b.iter(|| hashmap_intern::<BuildHasherDefault<CityHasher64>>(t));
+            },
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_lookup(c: &mut Criterion) {
+    let mut group = c.benchmark_group("interner_lookup");
+
+    let mut rng = StdRng::seed_from_u64(7);
+    let distinct = 100_000;
+    let tokens = token_stream(distinct, distinct, &mut rng);
+    let queries = token_stream(100_000, distinct, &mut rng);
+    group.throughput(criterion::Throughput::Elements(queries.len() as u64));
+
+    let mut interner = Interner::new();
+    let mut map: HashMap<String, u32, BuildHasherDefault<Fnv1aHasher64>> = HashMap::default();
+    for token in &tokens {
+        let symbol = interner.intern(token);
+        map.entry(token.clone()).or_insert(symbol.as_u32());
+    }
+    let symbols: Vec<_> = tokens.iter().map(|t| interner.intern(t)).collect();
+
+    group.bench_function("arena_get", |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter(|q| interner.get(black_box(q)).is_some())
+                .count()
+        });
+    });
+    group.bench_function("hashmap_fnv1a_get", |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter(|q| map.contains_key(black_box(q.as_str())))
+                .count()
+        });
+    });
+    group.bench_function("arena_resolve", |b| {
+        b.iter(|| {
+            symbols
+                .iter()
+                .map(|&s| interner.resolve(black_box(s)).len())
+                .sum::<usize>()
+        });
+    });
+
+    let shared = SharedInterner::new();
+    for token in &tokens {
+        shared.intern(token);
+    }
+    group.bench_function("shared_get", |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter(|q| shared.get(black_box(q)).is_some())
+                .count()
+        });
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_intern, bench_lookup);
+criterion_main!(benches);
@@ -0,0 +1,99 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::seq::SliceRandom;
+use rand::{Rng, SeedableRng};
+use simplehash::join::{ColumnKey, HashJoin, JoinIndices, JoinKind};
+use simplehash::murmur::MurmurHasher64;
+use std::collections::HashMap;
+use std::hash::{BuildHasherDefault, Hash};
+
+// The baseline being replaced: build one HashMap over the whole build side, then probe it
+// row by row. Build keys are unique, so each maps straight to its row.
+fn naive_join<K: ColumnKey + Hash>(build: &[K], probe: &[K]) -> JoinIndices {
+    let mut index: HashMap<K, u32, BuildHasherDefault<MurmurHasher64>> = HashMap::default();
+    index.reserve(build.len());
+    for (i, &k) in build.iter().enumerate() {
+        index.insert(k, i as u32);
+    }
+    let mut out = JoinIndices::default();
+    for (j, k) in probe.iter().enumerate() {
+        if let Some(&i) = index.get(k) {
+            out.build.push(i);
+            out.probe.push(j as u32);
+        }
+    }
+    out
+}
+
+// Unique shuffled build keys; probe keys hit half the time (a foreign-key join)
+fn relations(build_rows: usize, probe_rows: usize) -> (Vec<u64>, Vec<u64>) {
+    let mut rng = StdRng::seed_from_u64(42);
+    let mut build: Vec<u64> = (0..build_rows as u64).collect();
+    build.shuffle(&mut rng);
+    let probe = (0..probe_rows)
+        .map(|_| rng.gen_range(0..2 * build_rows as u64))
+        .collect();
+    (build, probe)
+}
+
+fn bench_u64_keys(c: &mut Criterion) {
+    let mut group = c.benchmark_group("join_u64");
+    group.sample_size(10);
+
+    for &(build_rows, probe_rows) in &[(1_000_000, 10_000_000), (10_000_000, 100_000_000)] {
+        let (build, probe) = relations(build_rows, probe_rows);
+        let label = format!("{}x{}", build_rows, probe_rows);
+        group.throughput(criterion::Throughput::Elements(
+            (build_rows + probe_rows) as u64,
+        ));
+
+        group.bench_function(BenchmarkId::new("naive_hashmap", &label), |b| {
+            b.iter(|| naive_join(black_box(&build), black_box(&probe)).len());
+        });
+        for kind in [JoinKind::Inner, JoinKind::Semi, JoinKind::Anti] {
+            let join = HashJoin::new(kind);
+            let name = format!("partitioned_{:?}", kind).to_lowercase();
+            group.bench_function(BenchmarkId::new(name, &label), |b| {
+                b.iter(|| join.join(black_box(&build), black_box(&probe)).len());
+            });
+        }
+    }
+
+    group.finish();
+}
+
+fn bench_string_keys(c: &mut Criterion) {
+    let mut group = c.benchmark_group("join_str");
+    group.sample_size(10);
+
+    let (build_rows, probe_rows) = (1_000_000, 10_000_000);
+    let (build_ids, probe_ids) = relations(build_rows, probe_rows);
+    let owned: Vec<String> = (0..2 * build_rows)
+        .map(|i| format!("customer-{:012}", i))
+        .collect();
+    let build: Vec<&str> = build_ids
+        .iter()
+        .map(|&i| owned[i as usize].as_str())
+        .collect();
+    let probe: Vec<&str> = probe_ids
+        .iter()
+        .map(|&i| owned[i as usize].as_str())
+        .collect();
+    let label = format!("{}x{}", build_rows, probe_rows);
+    group.throughput(criterion::Throughput::Elements(
+        (build_rows + probe_rows) as u64,
+    ));
+
+    group.bench_function(BenchmarkId::new("naive_hashmap", &label), |b| {
+        b.iter(|| naive_join(black_box(&build), black_box(&probe)).len());
+    });
+    group.bench_function(BenchmarkId::new("partitioned_inner", &label), |b| {
+        let join = HashJoin::new(JoinKind::Inner);
+        b.iter(|| join.join(black_box(&build), black_box(&probe)).len());
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_u64_keys, bench_string_keys);
+criterion_main!(benches);
@@ -0,0 +1,106 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::digest::Algorithm;
+use simplehash::lines::{LineHasher, split_lines};
+use std::io::{BufRead, Write};
+
+// Set SIMPLEHASH_LINES_BYTES to change the input size (default 256 MiB)
+const DEFAULT_BYTES: usize = 256 << 20;
+
+fn input() -> Vec<u8> {
+    let bytes = std::env::var("SIMPLEHASH_LINES_BYTES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_BYTES);
+    let mut rng = StdRng::seed_from_u64(42);
+    let mut data = Vec::with_capacity(bytes + 64);
+    while data.len() < bytes {
+        // Keys of 8..64 printable bytes, like IDs, URLs and user names
+        let len = rng.gen_range(8..64);
+        data.extend((0..len).map(|_| rng.gen_range(b'!'..=b'~')));
+        data.push(b'\n');
+    }
+    data
+}
+
+fn hex_line(hash: u128, buf: &mut Vec<u8>) {
+    const DIGITS: &[u8; 16] = b"0123456789abcdef";
+    for i in (0..16).rev() {
+        buf.push(DIGITS[(hash >> (4 * i)) as usize & 0xf]);
+    }
+    buf.push(b'\n');
+}
+
+fn bench_lines(c: &mut Criterion) {
+    let data = input();
+    let mut group = c.benchmark_group("lines");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Bytes(data.len() as u64));
+
+    group.bench_function("split_position", |b| {
+        b.iter(|| data.split(|&b| b == b'\n').map(|l| l.len()).sum::<usize>())
+    });
+    group.bench_function("split_swar", |b| {
+        b.iter(|| split_lines(&data).map(|l| l.len()).sum::<usize>())
+    });
+
+    // Baseline: what a straightforward tool does, BufRead::split plus writeln! per hash
+    group.bench_function("bufread_writeln_city64", |b| {
+        b.iter(|| {
+            let mut out = Vec::with_capacity(data.len());
+            for line in std::io::BufReader::new(&data[..]).split(b'\n') {
+                let line = line.unwrap();
+                writeln!(out, "{:016x}", simplehash::city_hash64(&line)).unwrap();
+            }
+            out.len()
+        })
+    });
+
+    for algorithm in [
+        Algorithm::Fnv1a64,
+        Algorithm::City64,
+        Algorithm::Murmur3_128,
+    ] {
+        let hasher = LineHasher::new().algorithm(algorithm);
+        group.bench_function(BenchmarkId::new("binary", algorithm), |b| {
+            b.iter(|| {
+                let mut written = 0;
+                hasher
+                    .hash_reader(
+                        &data[..],
+                        |hash, buf| buf.extend_from_slice(&(hash as u64).to_le_bytes()),
+                        |bytes| {
+                            written += bytes.len();
+                            Ok(())
+                        },
+                    )
+                    .unwrap();
+                written
+            })
+        });
+    }
+
+    for threads in [1, 2, 4] {
+        let hasher = LineHasher::new()
+            .algorithm(Algorithm::City64)
+            .threads(threads);
+        group.bench_function(BenchmarkId::new("hex_city64_threads", threads), |b| {
+            b.iter(|| {
+                let mut written = 0;
+                hasher
+                    .hash_reader(&data[..], hex_line, |bytes| {
+                        written += bytes.len();
+                        Ok(())
+                    })
+                    .unwrap();
+                written
+            })
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_lines);
+criterion_main!(benches);
@@ -0,0 +1,82 @@
+use criterion::{Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, RngCore, SeedableRng};
+use simplehash::manifest::{Manifest, ManifestBuilder};
+use std::fs;
+use std::path::Path;
+
+// Set SIMPLEHASH_MANIFEST_FILES to resize the generated tree (default 1M files of up to 4 KiB)
+const DEFAULT_FILES: usize = 1_000_000;
+const FILES_PER_DIR: usize = 1000;
+
+fn generate(root: &Path, files: usize) {
+    let mut rng = StdRng::seed_from_u64(42);
+    let mut data = vec![0u8; 4096];
+    for i in 0..files {
+        let dir = root.join(format!("d{:04}", i / FILES_PER_DIR));
+        if i % FILES_PER_DIR == 0 {
+            fs::create_dir_all(&dir).unwrap();
+        }
+        let len = rng.gen_range(0..data.len());
+        rng.fill_bytes(&mut data[..len]);
+        fs::write(dir.join(format!("f{}", i)), &data[..len]).unwrap();
+    }
+}
+
+fn bench_manifest(c: &mut Criterion) {
+    let files = std::env::var("SIMPLEHASH_MANIFEST_FILES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_FILES);
+    let root =
+        std::env::temp_dir().join(format!("simplehash-manifest-bench-{}", std::process::id()));
+    generate(&root, files);
+    // Files modified within a second of a scan are hashed again on the next run
+    std::thread::sleep(std::time::Duration::from_millis(1100));
+
+    let builder = ManifestBuilder::new();
+    let cold = builder.build(&root).unwrap().manifest;
+    let bytes = cold.to_bytes();
+    println!(
+        "{} files, manifest {} bytes ({:.1} bytes per file)",
+        cold.entries.len(),
+        bytes.len(),
+        bytes.len() as f64 / cold.entries.len() as f64
+    );
+
+    let mut group = c.benchmark_group("manifest");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Elements(files as u64));
+
+    group.bench_function("cold", |b| {
+        b.iter(|| builder.build(&root).unwrap().hashed_files)
+    });
+    group.bench_function("warm_unchanged", |b| {
+        b.iter(|| builder.update(&root, &cold).unwrap().hashed_files)
+    });
+    group.bench_function("save_and_load", |b| {
+        let path = root.with_extension("manifest");
+        b.iter(|| {
+            cold.save(&path).unwrap();
+            Manifest::load(&path).unwrap().entries.len()
+        });
+        fs::remove_file(&path).unwrap();
+    });
+
+    // Rewrite 1% of the files; every update against the old manifest hashes them again
+    let mut rng = StdRng::seed_from_u64(7);
+    for entry in cold.entries.iter().step_by(100) {
+        let mut data = vec![0u8; rng.gen_range(0..4096)];
+        rng.fill_bytes(&mut data);
+        fs::write(root.join(&entry.path), &data).unwrap();
+    }
+    group.bench_function("warm_1pct_changed", |b| {
+        b.iter(|| builder.update(&root, &cold).unwrap().changes.len())
+    });
+
+    group.finish();
+    fs::remove_dir_all(&root).unwrap();
+}
+
+criterion_group!(benches, bench_manifest);
+criterion_main!(benches);
@@ -0,0 +1,94 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::memo::{Memoizer, MemoizerBuilder};
+use simplehash::murmur::MurmurHasher64;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+
+const DISTINCT: usize = 16;
+const CALLS: usize = 256;
+
+// Stands in for template rendering: a few dependent passes over the whole input
+fn render(input: &[u8]) -> u64 {
+    let mut acc = 0u64;
+    for round in 0..4u64 {
+        for &b in input {
+            acc = acc.rotate_left(5) ^ (b as u64).wrapping_add(round);
+        }
+    }
+    acc
+}
+
+// The baseline being replaced: the blob itself is the key
+type BlobMap = HashMap<Vec<u8>, u64, BuildHasherDefault<MurmurHasher64>>;
+
+fn bench_large_inputs(c: &mut Criterion) {
+    let mut group = c.benchmark_group("memo_large_inputs");
+    group.sample_size(10);
+
+    let mut rng = StdRng::seed_from_u64(42);
+    for &size in &[4 << 10, 64 << 10, 1 << 20] {
+        let blobs: Vec<Vec<u8>> = (0..DISTINCT)
+            .map(|_| (0..size).map(|_| rng.r#gen()).collect())
+            .collect();
+        // Repeated calls over a small working set, each on a fresh copy of the blob, as
+        // happens when the input is read or assembled per request
+        let calls: Vec<Vec<u8>> = (0..CALLS)
+            .map(|_| blobs[rng.gen_range(0..DISTINCT)].clone())
+            .collect();
+        group.throughput(criterion::Throughput::Elements(CALLS as u64));
+
+        group.bench_with_input(BenchmarkId::new("no_memo", size), &calls, |b, calls| {
+            b.iter(|| {
+                calls
+                    .iter()
+                    .map(|blob| render(black_box(blob)))
+                    .sum::<u64>()
+            });
+        });
+        group.bench_with_input(
+            BenchmarkId::new("hashmap_blob", size),
+            &calls,
+            |b, calls| {
+                let mut map = BlobMap::default();
+                b.iter(|| {
+                    calls
+                        .iter()
+                        .map(|blob| match map.get(black_box(blob.as_slice())) {
+                            Some(&v) => v,
+                            None => *map.entry(blob.clone()).or_insert_with(|| render(blob)),
+                        })
+                        .sum::<u64>()
+                });
+            },
+        );
+        group.bench_with_input(BenchmarkId::new("memoizer", size), &calls, |b, calls| {
+            let memo = Memoizer::new(64 << 20);
+            b.iter(|| {
+                calls
+                    .iter()
+                    .map(|blob| memo.get_or_compute(black_box(blob), render))
+                    .sum::<u64>()
+            });
+        });
+        group.bench_with_input(
+            BenchmarkId::new("memoizer_verify", size),
+            &calls,
+            |b, calls| {
+                let memo = MemoizerBuilder::new(64 << 20).verify(true).build();
+                b.iter(|| {
+                    calls
+                        .iter()
+                        .map(|blob| memo.get_or_compute(black_box(blob), render))
+                        .sum::<u64>()
+                });
+            },
+        );
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_large_inputs);
+criterion_main!(benches);
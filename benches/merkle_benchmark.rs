@@ -0,0 +1,71 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::merkle::{MerkleBuilder, MerkleHash};
+
+// Set SIMPLEHASH_MERKLE_BYTES to change the size of the hashed buffer (default 1 GiB)
+const DEFAULT_BYTES: usize = 1 << 30;
+const LEAF_SIZE: usize = 64 << 10;
+const WRITE_SIZE: u64 = 4096;
+
+fn bytes() -> usize {
+    std::env::var("SIMPLEHASH_MERKLE_BYTES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_BYTES)
+}
+
+fn bench_merkle(c: &mut Criterion) {
+    let mut rng = StdRng::seed_from_u64(42);
+    let mut data = vec![0u8; bytes()];
+    rng.fill(&mut data[..]);
+
+    let mut group = c.benchmark_group("merkle");
+    group.sample_size(10);
+
+    group.throughput(criterion::Throughput::Bytes(data.len() as u64));
+    for (name, hash) in [
+        ("city128", MerkleHash::City128),
+        ("murmur3_128", MerkleHash::Murmur3_128),
+    ] {
+        let builder = MerkleBuilder::new().leaf_size(LEAF_SIZE).hash(hash);
+        group.bench_function(BenchmarkId::new("full_build", name), |b| {
+            b.iter(|| builder.build(&data).root())
+        });
+    }
+
+    let builder = MerkleBuilder::new().leaf_size(LEAF_SIZE);
+    let original = builder.build(&data);
+    for writes in [1, 64, 4096] {
+        // Scatter 4 KiB writes over the buffer and update the tree with just those ranges
+        let ranges: Vec<_> = (0..writes)
+            .map(|_| {
+                let start = rng.gen_range(0..data.len() as u64 - WRITE_SIZE);
+                start..start + WRITE_SIZE
+            })
+            .collect();
+        for range in &ranges {
+            let byte = &mut data[range.start as usize];
+            *byte = byte.wrapping_add(1);
+        }
+        group.throughput(criterion::Throughput::Elements(writes));
+        // Re-applying the same writes costs the same as applying them once
+        let mut tree = original.clone();
+        group.bench_function(BenchmarkId::new("incremental_update", writes), |b| {
+            b.iter(|| {
+                tree.update(&data, &ranges);
+                tree.root()
+            })
+        });
+
+        let updated = builder.build(&data);
+        group.bench_function(BenchmarkId::new("diff", writes), |b| {
+            b.iter(|| original.diff(&updated).len())
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_merkle);
+criterion_main!(benches);
@@ -0,0 +1,105 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use simplehash::fnv::Fnv1aHasher64;
+use simplehash::mphf::{Mphf, MphfBuilder};
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+
+fn generate_urls(count: usize) -> Vec<String> {
+    (0..count)
+        .map(|i| {
+            format!(
+                "https://example.com/articles/{}/comments?page={}",
+                i,
+                i % 97
+            )
+        })
+        .collect()
+}
+
+fn bench_build(c: &mut Criterion) {
+    let mut group = c.benchmark_group("mphf_build");
+    group.sample_size(10);
+
+    for &count in &[1_000_000, 10_000_000] {
+        let keys = generate_urls(count);
+        group.throughput(criterion::Throughput::Elements(count as u64));
+
+        group.bench_with_input(BenchmarkId::new("parallel", count), &count, |b, _| {
+            b.iter(|| MphfBuilder::new().build(black_box(&keys)).unwrap());
+        });
+        group.bench_with_input(BenchmarkId::new("single_thread", count), &count, |b, _| {
+            b.iter(|| {
+                MphfBuilder::new()
+                    .threads(1)
+                    .build(black_box(&keys))
+                    .unwrap()
+            });
+        });
+
+        let mphf = Mphf::build(&keys).unwrap();
+        println!(
+            "mphf with {} keys: {:.2} bits/key",
+            count,
+            mphf.bits_per_key()
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_query(c: &mut Criterion) {
+    let mut group = c.benchmark_group("mphf_query");
+
+    for &count in &[1_000_000, 10_000_000] {
+        let keys = generate_urls(count);
+        let mphf = Mphf::build(&keys).unwrap();
+        let bytes = mphf.as_bytes().to_vec();
+        let view = Mphf::from_bytes(bytes.as_slice()).unwrap();
+
+        let mut map: HashMap<&str, usize, BuildHasherDefault<Fnv1aHasher64>> =
+            HashMap::with_capacity_and_hasher(count, BuildHasherDefault::default());
+        for (i, key) in keys.iter().enumerate() {
+            map.insert(key.as_str(), i);
+        }
+
+        // Stride through the keys so lookups are not served from a warm cache line
+        let probes: Vec<&[u8]> = (0..10_000)
+            .map(|i| keys[(i * 7919) % count].as_bytes())
+            .collect();
+
+        group.throughput(criterion::Throughput::Elements(probes.len() as u64));
+        group.bench_with_input(BenchmarkId::new("mphf_owned", count), &count, |b, _| {
+            b.iter(|| {
+                probes
+                    .iter()
+                    .map(|k| mphf.index(black_box(k)))
+                    .fold(0, usize::wrapping_add)
+            });
+        });
+        group.bench_with_input(
+            BenchmarkId::new("mphf_from_bytes", count),
+            &count,
+            |b, _| {
+                b.iter(|| {
+                    probes
+                        .iter()
+                        .map(|k| view.index(black_box(k)))
+                        .fold(0, usize::wrapping_add)
+                });
+            },
+        );
+        group.bench_with_input(BenchmarkId::new("hashmap_fnv1a", count), &count, |b, _| {
+            b.iter(|| {
+                probes
+                    .iter()
+                    .map(|k| map[std::str::from_utf8(black_box(k)).unwrap()])
+                    .fold(0, usize::wrapping_add)
+            });
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_build, bench_query);
+criterion_main!(benches);
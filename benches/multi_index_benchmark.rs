@@ -0,0 +1,88 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::multi_index::MultiIndexHash;
+
+// Random fingerprints plus near-duplicates of the first few, so queries have real matches
+fn generate_fingerprints(count: usize, rng: &mut StdRng) -> Vec<u64> {
+    let mut fingerprints: Vec<u64> = (0..count).map(|_| rng.r#gen::<u64>()).collect();
+    for i in 0..count / 100 {
+        let mut fp = fingerprints[i];
+        for _ in 0..rng.gen_range(0..4) {
+            fp ^= 1 << rng.gen_range(0..64);
+        }
+        fingerprints[count - 1 - i] = fp;
+    }
+    fingerprints
+}
+
+fn bench_build(c: &mut Criterion) {
+    let mut group = c.benchmark_group("multi_index_build");
+    group.sample_size(10);
+
+    let mut rng = StdRng::seed_from_u64(42);
+    for &count in &[100_000, 1_000_000] {
+        let fingerprints = generate_fingerprints(count, &mut rng);
+        let blocks = MultiIndexHash::recommended_blocks(count);
+
+        group.throughput(criterion::Throughput::Elements(count as u64));
+        group.bench_with_input(BenchmarkId::new("parallel", count), &count, |b, _| {
+            b.iter(|| MultiIndexHash::new(black_box(&fingerprints), blocks));
+        });
+        group.bench_with_input(BenchmarkId::new("single_thread", count), &count, |b, _| {
+            b.iter(|| MultiIndexHash::with_threads(black_box(&fingerprints), blocks, 1));
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_query_latency(c: &mut Criterion) {
+    let mut group = c.benchmark_group("multi_index_query");
+
+    let count = 1_000_000;
+    let mut rng = StdRng::seed_from_u64(7);
+    let fingerprints = generate_fingerprints(count, &mut rng);
+    let queries: Vec<u64> = (0..1000).map(|i| fingerprints[i * 7]).collect();
+
+    // Compare the recommended layout against the classic "r + 1 blocks" layout
+    for &blocks in &[MultiIndexHash::recommended_blocks(count), 4] {
+        let index = MultiIndexHash::new(&fingerprints, blocks);
+        for max_distance in 0..=3 {
+            let id = format!("blocks={}/r={}", blocks, max_distance);
+            group.bench_function(BenchmarkId::new("mih", id), |b| {
+                let mut results = Vec::new();
+                let mut i = 0;
+                b.iter(|| {
+                    results.clear();
+                    index.query_into(
+                        black_box(queries[i % queries.len()]),
+                        max_distance,
+                        &mut results,
+                    );
+                    i += 1;
+                    results.len()
+                });
+            });
+        }
+    }
+
+    // Baseline: popcount over every fingerprint
+    group.sample_size(10);
+    group.bench_function(BenchmarkId::new("linear_scan", "r=3"), |b| {
+        let mut i = 0;
+        b.iter(|| {
+            let q = black_box(queries[i % queries.len()]);
+            i += 1;
+            fingerprints
+                .iter()
+                .filter(|fp| (*fp ^ q).count_ones() <= 3)
+                .count()
+        });
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_build, bench_query_latency);
+criterion_main!(benches);
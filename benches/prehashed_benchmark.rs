@@ -0,0 +1,186 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::city::{CityHasher64, city_hash64};
+use simplehash::fnv::Fnv1aHasher64;
+use simplehash::murmur::MurmurHasher64;
+use simplehash::prehashed::{Prehashed, PrehashedMap};
+use simplehash::{fnv1a_64, murmurhash3_64};
+use std::collections::HashMap;
+use std::hash::{BuildHasher, BuildHasherDefault, Hasher};
+
+const SHARDS: usize = 16;
+
+// Minimal Bloom filter driven by one 64-bit hash (double hashing), standing in for the
+// filter stage of a lookup pipeline
+struct Bloom {
+    bits: Vec<u64>,
+    mask: u64,
+}
+
+impl Bloom {
+    fn new(bits_log2: u32) -> Self {
+        Self {
+            bits: vec![0; 1 << (bits_log2 - 6)],
+            mask: (1 << bits_log2) - 1,
+        }
+    }
+
+    fn positions(&self, hash: u64) -> impl Iterator<Item = u64> + '_ {
+        let (h1, h2) = (hash, (hash >> 32) | 1);
+        (0..4u64).map(move |i| h1.wrapping_add(i.wrapping_mul(h2)) & self.mask)
+    }
+
+    fn insert(&mut self, hash: u64) {
+        for bit in self.positions(hash).collect::<Vec<_>>() {
+            self.bits[(bit >> 6) as usize] |= 1 << (bit & 63);
+        }
+    }
+
+    fn contains(&self, hash: u64) -> bool {
+        self.positions(hash)
+            .all(|bit| self.bits[(bit >> 6) as usize] & (1 << (bit & 63)) != 0)
+    }
+}
+
+fn make_keys(count: usize, len: usize, rng: &mut StdRng) -> Vec<String> {
+    (0..count)
+        .map(|_| {
+            (0..len)
+                .map(|_| rng.gen_range(b'a'..=b'z') as char)
+                .collect()
+        })
+        .collect()
+}
+
+// Shard router -> Bloom filter -> per-shard cache map, hashing the key at every stage
+fn pipeline_rehash<H: Hasher + Default>(
+    keys: &[String],
+    queries: &[String],
+    hash: fn(&[u8]) -> u64,
+) -> usize {
+    let mut bloom = Bloom::new(20);
+    let mut shards: Vec<HashMap<&str, usize, BuildHasherDefault<H>>> =
+        (0..SHARDS).map(|_| HashMap::default()).collect();
+    for (i, key) in keys.iter().enumerate() {
+        let shard = hash(key.as_bytes()) as usize % SHARDS;
+        bloom.insert(hash(key.as_bytes()));
+        shards[shard].insert(key.as_str(), i);
+    }
+
+    let mut hits = 0;
+    for query in queries {
+        let query = black_box(query.as_str());
+        let shard = hash(query.as_bytes()) as usize % SHARDS;
+        if bloom.contains(hash(query.as_bytes())) && shards[shard].contains_key(query) {
+            hits += 1;
+        }
+    }
+    hits
+}
+
+// Same pipeline, hashing each key once and carrying the hash through every stage
+fn pipeline_prehashed(keys: &[String], queries: &[String], hash: fn(&[u8]) -> u64) -> usize {
+    let mut bloom = Bloom::new(20);
+    let mut shards: Vec<PrehashedMap<&str, usize>> =
+        (0..SHARDS).map(|_| PrehashedMap::default()).collect();
+    for (i, key) in keys.iter().enumerate() {
+        let key = Prehashed::with(key.as_str(), |k| hash(k.as_bytes()));
+        bloom.insert(key.hash());
+        shards[key.hash() as usize % SHARDS].insert(key, i);
+    }
+
+    let mut hits = 0;
+    for query in queries {
+        let query = Prehashed::with(black_box(query.as_str()), |k| hash(k.as_bytes()));
+        if bloom.contains(query.hash())
+            && shards[query.hash() as usize % SHARDS].contains_key(&query)
+        {
+            hits += 1;
+        }
+    }
+    hits
+}
+
+fn bench_pipeline(c: &mut Criterion) {
+    let mut group = c.benchmark_group("prehashed_pipeline");
+
+    let mut rng = StdRng::seed_from_u64(42);
+    let count = 50_000;
+    for &len in &[16, 64, 256] {
+        let keys = make_keys(count, len, &mut rng);
+        let mut queries = make_keys(count, len, &mut rng);
+        queries[..count / 2].clone_from_slice(&keys[..count / 2]);
+        group.throughput(criterion::Throughput::Elements((2 * count) as u64));
+
+        group.bench_with_input(BenchmarkId::new("rehash_fnv1a", len), &len, |b, _| {
+            b.iter(|| pipeline_rehash::<Fnv1aHasher64>(&keys, &queries, fnv1a_64));
+        });
+        group.bench_with_input(BenchmarkId::new("prehashed_fnv1a", len), &len, |b, _| {
+            b.iter(|| pipeline_prehashed(&keys, &queries, fnv1a_64));
+        });
+
+        let murmur: fn(&[u8]) -> u64 = |k| murmurhash3_64(k, 0);
+        group.bench_with_input(BenchmarkId::new("rehash_murmur", len), &len, |b, _| {
+            b.iter(|| pipeline_rehash::<MurmurHasher64>(&keys, &queries, murmur));
+        });
+        group.bench_with_input(BenchmarkId::new("prehashed_murmur", len), &len, |b, _| {
+            b.iter(|| pipeline_prehashed(&keys, &queries, murmur));
+        });
+
+        group.bench_with_input(BenchmarkId::new("rehash_city", len), &len, |b, _| {
+            b.iter(|| pipeline_rehash::<CityHasher64>(&keys, &queries, city_hash64));
+        });
+        group.bench_with_input(BenchmarkId::new("prehashed_city", len), &len, |b, _| {
+            b.iter(|| pipeline_prehashed(&keys, &queries, city_hash64));
+        });
+    }
+
+    group.finish();
+}
+
+// Growing a map from empty re-hashes every key on each resize unless the hash is stored
+fn bench_resize(c: &mut Criterion) {
+    let mut group = c.benchmark_group("prehashed_resize");
+
+    let mut rng = StdRng::seed_from_u64(7);
+    let count = 100_000;
+    let keys = make_keys(count, 128, &mut rng);
+    let hashed: Vec<Prehashed<&str>> = keys
+        .iter()
+        .map(|k| Prehashed::with(k.as_str(), |k| city_hash64(k.as_bytes())))
+        .collect();
+    group.throughput(criterion::Throughput::Elements(count as u64));
+
+    group.bench_function("city_hashmap", |b| {
+        b.iter(|| {
+            let build = BuildHasherDefault::<CityHasher64>::default();
+            let mut map = HashMap::with_hasher(build);
+            for key in &keys {
+                map.insert(black_box(key.as_str()), ());
+            }
+            map.len()
+        });
+    });
+    group.bench_function("prehashed_map", |b| {
+        b.iter(|| {
+            let mut map: PrehashedMap<&str, ()> = PrehashedMap::default();
+            for key in &hashed {
+                map.insert(black_box(*key), ());
+            }
+            map.len()
+        });
+    });
+    group.bench_function("city_hash_once", |b| {
+        b.iter(|| {
+            keys.iter()
+                .map(|k| BuildHasherDefault::<CityHasher64>::default().hash_one(k.as_str()))
+                .fold(0u64, |acc, h| acc ^ h)
+        });
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_pipeline, bench_resize);
+criterion_main!(benches);
@@ -0,0 +1,94 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{RngCore, SeedableRng};
+use simplehash::digest::Algorithm;
+use simplehash::mmap::MappedFile;
+use simplehash::records::RecordHasher;
+use std::io::Write;
+
+// Set SIMPLEHASH_RECORDS_BYTES to change the file size (default 1 GiB; 10 GiB for the large run)
+const DEFAULT_BYTES: usize = 1 << 30;
+
+fn write_file(path: &std::path::Path) -> usize {
+    let bytes = std::env::var("SIMPLEHASH_RECORDS_BYTES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_BYTES)
+        / 64
+        * 64;
+    let mut rng = StdRng::seed_from_u64(42);
+    let mut file = std::io::BufWriter::new(std::fs::File::create(path).unwrap());
+    let mut block = vec![0u8; 1 << 20];
+    let mut left = bytes;
+    while left > 0 {
+        let n = left.min(block.len());
+        rng.fill_bytes(&mut block[..n]);
+        file.write_all(&block[..n]).unwrap();
+        left -= n;
+    }
+    file.flush().unwrap();
+    bytes
+}
+
+fn bench_records(c: &mut Criterion) {
+    let path = std::env::temp_dir().join(format!("simplehash-records-{}", std::process::id()));
+    let bytes = write_file(&path);
+    let map = MappedFile::open(&path).unwrap();
+    let data = map.as_slice();
+
+    let mut group = c.benchmark_group("records");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Bytes(bytes as u64));
+
+    for (width, algorithm) in [
+        (8, Algorithm::Fnv1a64),
+        (8, Algorithm::City64),
+        (16, Algorithm::City64),
+        (16, Algorithm::Murmur3_128),
+    ] {
+        let out = algorithm.bits() as usize / 8;
+        let label = format!("{}x{}", algorithm, width);
+
+        // Baseline: the generic hash functions, building the column in 4 MiB pieces
+        group.bench_function(BenchmarkId::new("generic", &label), |b| {
+            let mut buf = Vec::new();
+            b.iter(|| {
+                let mut written = 0;
+                for piece in data.chunks((4 << 20) / width * width) {
+                    buf.clear();
+                    for record in piece.chunks_exact(width) {
+                        buf.extend_from_slice(&algorithm.hash(record).to_le_bytes()[..out]);
+                    }
+                    written += buf.len();
+                }
+                written
+            })
+        });
+
+        for threads in [1, 0] {
+            let hasher = RecordHasher::new(width)
+                .algorithm(algorithm)
+                .threads(threads);
+            let id = format!("{}/threads-{}", label, threads);
+            group.bench_function(BenchmarkId::new("record_hasher", id), |b| {
+                b.iter(|| {
+                    let mut written = 0;
+                    hasher
+                        .hash_slice(data, |column| {
+                            written += column.len();
+                            Ok(())
+                        })
+                        .unwrap();
+                    written
+                })
+            });
+        }
+    }
+
+    group.finish();
+    drop(map);
+    std::fs::remove_file(&path).unwrap();
+}
+
+criterion_group!(benches, bench_records);
+criterion_main!(benches);
@@ -0,0 +1,85 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::murmur::MurmurHasher64;
+use simplehash::rendezvous::RendezvousHasher;
+use simplehash::shard::{Routing, ShardKey, Sharder};
+use std::hash::BuildHasherDefault;
+use std::io::BufRead;
+
+// Set SIMPLEHASH_SHARD_LINES to change the number of records (default 4M)
+const DEFAULT_LINES: usize = 4_000_000;
+
+type Build = BuildHasherDefault<MurmurHasher64>;
+
+fn input() -> Vec<u8> {
+    let lines = std::env::var("SIMPLEHASH_SHARD_LINES")
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(DEFAULT_LINES);
+    let mut rng = StdRng::seed_from_u64(42);
+    let mut data = Vec::new();
+    for i in 0..lines {
+        // Tab-separated records keyed by the second field, like an event log keyed by user
+        let user: u32 = rng.gen_range(0..1_000_000);
+        data.extend_from_slice(format!("{}\tuser-{}\tevent-{}\n", i, user, i * 7).as_bytes());
+    }
+    data
+}
+
+fn bench_shard(c: &mut Criterion) {
+    let data = input();
+    let key = ShardKey::Field {
+        index: 2,
+        delimiter: b'\t',
+    };
+    let mut group = c.benchmark_group("shard");
+    group.sample_size(10);
+    group.throughput(criterion::Throughput::Bytes(data.len() as u64));
+
+    for shards in [16, 256] {
+        let mut sizes = vec![0usize; shards];
+        let nodes: Vec<u64> = (0..shards as u64).collect();
+
+        // Baseline: BufRead::split, a field split and RendezvousHasher::select_index per line
+        let rendezvous = RendezvousHasher::new(Build::default());
+        group.bench_function(BenchmarkId::new("bufread_select_index", shards), |b| {
+            b.iter(|| {
+                let mut out = vec![Vec::new(); shards];
+                for line in std::io::BufReader::new(&data[..]).split(b'\n') {
+                    let mut line = line.unwrap();
+                    let key = line.split(|&b| b == b'\t').nth(1).unwrap_or(&[]);
+                    let shard = rendezvous.select_index(&key, &nodes).unwrap();
+                    line.push(b'\n');
+                    out[shard].extend_from_slice(&line);
+                }
+                out.iter().map(Vec::len).sum::<usize>()
+            })
+        });
+
+        for (name, routing) in [("rendezvous", Routing::Rendezvous), ("jump", Routing::Jump)] {
+            for threads in [1, 2, 4] {
+                let sharder = Sharder::new(Build::default(), shards)
+                    .key(key)
+                    .routing(routing)
+                    .threads(threads);
+                let id = format!("{}_{}_threads", name, shards);
+                group.bench_function(BenchmarkId::new(id, threads), |b| {
+                    b.iter(|| {
+                        sharder
+                            .split_slice(&data, |shard, lines| {
+                                sizes[shard] += lines.len();
+                                Ok(())
+                            })
+                            .unwrap()
+                    })
+                });
+            }
+        }
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_shard);
+criterion_main!(benches);
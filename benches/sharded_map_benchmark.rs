@@ -0,0 +1,164 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::murmur::MurmurHasher64;
+use simplehash::sharded_map::ShardedMap;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+use std::sync::{Mutex, RwLock};
+use std::thread;
+
+type Murmur = BuildHasherDefault<MurmurHasher64>;
+
+const KEYS: u64 = 100_000;
+const OPS_PER_THREAD: usize = 50_000;
+
+// Common interface over the three maps so every variant runs the identical workload
+trait ConcurrentMap: Sync {
+    fn get(&self, key: u64) -> Option<u64>;
+    fn insert(&self, key: u64, value: u64);
+}
+
+impl ConcurrentMap for Mutex<HashMap<u64, u64, Murmur>> {
+    fn get(&self, key: u64) -> Option<u64> {
+        self.lock().unwrap().get(&key).copied()
+    }
+    fn insert(&self, key: u64, value: u64) {
+        self.lock().unwrap().insert(key, value);
+    }
+}
+
+impl ConcurrentMap for RwLock<HashMap<u64, u64, Murmur>> {
+    fn get(&self, key: u64) -> Option<u64> {
+        self.read().unwrap().get(&key).copied()
+    }
+    fn insert(&self, key: u64, value: u64) {
+        self.write().unwrap().insert(key, value);
+    }
+}
+
+impl ConcurrentMap for ShardedMap<u64, u64> {
+    fn get(&self, key: u64) -> Option<u64> {
+        ShardedMap::get(self, &key)
+    }
+    fn insert(&self, key: u64, value: u64) {
+        ShardedMap::insert(self, key, value);
+    }
+}
+
+// Per-thread operation streams: (key, is_write)
+fn workloads(threads: usize, write_percent: u32) -> Vec<Vec<(u64, bool)>> {
+    (0..threads)
+        .map(|t| {
+            let mut rng = StdRng::seed_from_u64(t as u64);
+            (0..OPS_PER_THREAD)
+                .map(|_| {
+                    (
+                        rng.gen_range(0..KEYS),
+                        rng.gen_range(0..100) < write_percent,
+                    )
+                })
+                .collect()
+        })
+        .collect()
+}
+
+fn run<M: ConcurrentMap>(map: &M, workloads: &[Vec<(u64, bool)>]) -> u64 {
+    thread::scope(|s| {
+        let handles: Vec<_> = workloads
+            .iter()
+            .map(|ops| {
+                s.spawn(move || {
+                    let mut found = 0u64;
+                    for &(key, is_write) in ops {
+                        if is_write {
+                            map.insert(key, key);
+                        } else if map.get(black_box(key)).is_some() {
+                            found += 1;
+                        }
+                    }
+                    found
+                })
+            })
+            .collect();
+        handles.into_iter().map(|h| h.join().unwrap()).sum()
+    })
+}
+
+fn bench_scaling(c: &mut Criterion) {
+    for &write_percent in &[1, 10, 50] {
+        let mut group = c.benchmark_group(format!("sharded_map_writes_{}pct", write_percent));
+
+        for &threads in &[1, 2, 4, 8, 16, 32, 64] {
+            let ops = workloads(threads, write_percent);
+            group.throughput(criterion::Throughput::Elements(
+                (threads * OPS_PER_THREAD) as u64,
+            ));
+
+            let mutex = Mutex::new(HashMap::with_hasher(Murmur::default()));
+            let rwlock = RwLock::new(HashMap::with_hasher(Murmur::default()));
+            let sharded = ShardedMap::new();
+            for key in (0..KEYS).step_by(2) {
+                ConcurrentMap::insert(&mutex, key, key);
+                ConcurrentMap::insert(&rwlock, key, key);
+                ConcurrentMap::insert(&sharded, key, key);
+            }
+
+            group.bench_with_input(
+                BenchmarkId::new("mutex_hashmap", threads),
+                &ops,
+                |b, ops| {
+                    b.iter(|| run(&mutex, ops));
+                },
+            );
+            group.bench_with_input(
+                BenchmarkId::new("rwlock_hashmap", threads),
+                &ops,
+                |b, ops| {
+                    b.iter(|| run(&rwlock, ops));
+                },
+            );
+            group.bench_with_input(BenchmarkId::new("sharded_map", threads), &ops, |b, ops| {
+                b.iter(|| run(&sharded, ops));
+            });
+        }
+
+        group.finish();
+    }
+}
+
+fn bench_batches(c: &mut Criterion) {
+    let mut group = c.benchmark_group("sharded_map_batch");
+
+    let map = ShardedMap::new();
+    map.insert_batch((0..KEYS).map(|k| (k, k)));
+    let mut rng = StdRng::seed_from_u64(42);
+    let keys: Vec<u64> = (0..10_000).map(|_| rng.gen_range(0..2 * KEYS)).collect();
+    group.throughput(criterion::Throughput::Elements(keys.len() as u64));
+
+    group.bench_function("get_single", |b| {
+        b.iter(|| {
+            keys.iter()
+                .filter(|k| map.get(black_box(*k)).is_some())
+                .count()
+        });
+    });
+    group.bench_function("get_batch", |b| {
+        b.iter(|| map.get_batch(black_box(&keys)).iter().flatten().count());
+    });
+    group.bench_function("insert_single", |b| {
+        b.iter(|| {
+            for &k in &keys {
+                map.insert(black_box(k), k);
+            }
+        });
+    });
+    group.bench_function("insert_batch", |b| {
+        b.iter(|| map.insert_batch(keys.iter().map(|&k| (black_box(k), k))));
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_scaling, bench_batches);
+criterion_main!(benches);
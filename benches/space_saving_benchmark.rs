@@ -0,0 +1,105 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::fnv::Fnv1aHasher64;
+use simplehash::space_saving::SpaceSaving;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+
+// Samples `len` keys from a Zipf distribution with exponent `s` over `universe` keys
+fn zipf_stream(len: usize, universe: usize, s: f64, rng: &mut StdRng) -> Vec<String> {
+    let mut cdf = Vec::with_capacity(universe);
+    let mut sum = 0.0;
+    for rank in 1..=universe {
+        sum += 1.0 / (rank as f64).powf(s);
+        cdf.push(sum);
+    }
+    (0..len)
+        .map(|_| {
+            let u = rng.r#gen::<f64>() * sum;
+            let rank = cdf.partition_point(|&c| c < u);
+            format!("cache:key:{}", rank)
+        })
+        .collect()
+}
+
+fn bench_zipf_updates(c: &mut Criterion) {
+    let mut group = c.benchmark_group("space_saving_zipf");
+
+    let mut rng = StdRng::seed_from_u64(42);
+    let len = 1_000_000;
+    for &s in &[0.8, 1.1, 1.5] {
+        let stream = zipf_stream(len, 1_000_000, s, &mut rng);
+        group.throughput(criterion::Throughput::Elements(len as u64));
+
+        group.bench_with_input(BenchmarkId::new("offer", s), &s, |b, _| {
+            b.iter(|| {
+                let mut summary = SpaceSaving::new(1000);
+                for key in &stream {
+                    summary.offer(black_box(key));
+                }
+                summary.len()
+            });
+        });
+
+        group.bench_with_input(BenchmarkId::new("offer_batch", s), &s, |b, _| {
+            b.iter(|| {
+                let mut summary = SpaceSaving::new(1000);
+                summary.offer_batch(black_box(&stream));
+                summary.len()
+            });
+        });
+
+        // Baseline: exact counting followed by a full sort
+        group.bench_with_input(BenchmarkId::new("exact_hashmap", s), &s, |b, _| {
+            b.iter(|| {
+                let mut counts: HashMap<&str, u64, BuildHasherDefault<Fnv1aHasher64>> =
+                    HashMap::default();
+                for key in &stream {
+                    *counts.entry(black_box(key.as_str())).or_default() += 1;
+                }
+                let mut top: Vec<_> = counts.into_iter().collect();
+                top.sort_unstable_by(|a, b| b.1.cmp(&a.1));
+                top.truncate(1000);
+                top.len()
+            });
+        });
+    }
+
+    group.finish();
+}
+
+fn bench_snapshot_and_merge(c: &mut Criterion) {
+    let mut group = c.benchmark_group("space_saving_merge");
+
+    let mut rng = StdRng::seed_from_u64(7);
+    let stream = zipf_stream(400_000, 1_000_000, 1.1, &mut rng);
+    // Four per-thread summaries, merged periodically into one
+    let summaries: Vec<SpaceSaving<String>> = stream
+        .chunks(stream.len() / 4)
+        .map(|chunk| {
+            let mut summary = SpaceSaving::new(1000);
+            summary.offer_batch(chunk);
+            summary
+        })
+        .collect();
+
+    group.bench_function("top_1000", |b| {
+        b.iter(|| summaries[0].top(black_box(1000)).len());
+    });
+
+    group.bench_function("merge_4_summaries", |b| {
+        b.iter(|| {
+            let mut merged = summaries[0].clone();
+            for other in &summaries[1..] {
+                merged.merge(black_box(other));
+            }
+            merged.len()
+        });
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_zipf_updates, bench_snapshot_and_merge);
+criterion_main!(benches);
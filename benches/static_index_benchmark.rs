@@ -0,0 +1,144 @@
+use criterion::{BenchmarkId, Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::city::CityHasher64;
+use simplehash::static_index::StaticIndex;
+use std::collections::HashMap;
+use std::hash::BuildHasherDefault;
+use std::io::Write;
+use std::path::PathBuf;
+
+type CityMap = HashMap<Vec<u8>, u64, BuildHasherDefault<CityHasher64>>;
+
+fn make_keys(count: usize) -> Vec<String> {
+    (0..count)
+        .map(|i| format!("/bucket/objects/{:012}", i))
+        .collect()
+}
+
+// Writes the index to a temp file so lookups go through a real memory map
+fn write_index(index: &StaticIndex, count: usize) -> PathBuf {
+    let path = std::env::temp_dir().join(format!(
+        "simplehash-bench-{}-{}.idx",
+        std::process::id(),
+        count
+    ));
+    std::fs::File::create(&path)
+        .unwrap()
+        .write_all(index.as_bytes())
+        .unwrap();
+    path
+}
+
+// The startup path being replaced: read serialized pairs and rebuild a HashMap
+fn load_hashmap(pairs: &[u8]) -> CityMap {
+    let mut map = CityMap::default();
+    let mut rest = pairs;
+    while !rest.is_empty() {
+        let len = u32::from_le_bytes(rest[..4].try_into().unwrap()) as usize;
+        let key = rest[4..4 + len].to_vec();
+        let value = u64::from_le_bytes(rest[4 + len..12 + len].try_into().unwrap());
+        map.insert(key, value);
+        rest = &rest[12 + len..];
+    }
+    map
+}
+
+fn bench_lookup(c: &mut Criterion) {
+    let mut group = c.benchmark_group("static_index_lookup");
+
+    let mut rng = StdRng::seed_from_u64(42);
+    for &count in &[100_000, 1_000_000, 10_000_000] {
+        let keys = make_keys(count);
+        let values: Vec<u64> = (0..count as u64).map(|i| i * 512).collect();
+        let index = StaticIndex::build(&keys, &values).unwrap();
+        let path = write_index(&index, count);
+        let mapped = StaticIndex::open(&path).unwrap();
+        let map: CityMap = keys
+            .iter()
+            .map(|k| k.as_bytes().to_vec())
+            .zip(values.iter().copied())
+            .collect();
+
+        // 90% hits, 10% misses
+        let queries: Vec<Vec<u8>> = (0..10_000)
+            .map(|i| {
+                if i % 10 == 0 {
+                    format!("/bucket/missing/{:012}", i).into_bytes()
+                } else {
+                    keys[rng.gen_range(0..count)].as_bytes().to_vec()
+                }
+            })
+            .collect();
+        group.throughput(criterion::Throughput::Elements(queries.len() as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("static_index_mmap", count),
+            &queries,
+            |b, q| {
+                b.iter(|| {
+                    q.iter()
+                        .filter_map(|k| mapped.get(black_box(k)))
+                        .sum::<u64>()
+                });
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("static_index_owned", count),
+            &queries,
+            |b, q| {
+                b.iter(|| {
+                    q.iter()
+                        .filter_map(|k| index.get(black_box(k)))
+                        .sum::<u64>()
+                });
+            },
+        );
+        group.bench_with_input(BenchmarkId::new("hashmap_city", count), &queries, |b, q| {
+            b.iter(|| {
+                q.iter()
+                    .filter_map(|k| map.get(black_box(k.as_slice())))
+                    .sum::<u64>()
+            });
+        });
+
+        drop(mapped);
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    group.finish();
+}
+
+fn bench_startup(c: &mut Criterion) {
+    let mut group = c.benchmark_group("static_index_startup");
+    group.sample_size(10);
+
+    let count = 1_000_000;
+    let keys = make_keys(count);
+    let values: Vec<u64> = (0..count as u64).collect();
+    let index = StaticIndex::build(&keys, &values).unwrap();
+    let path = write_index(&index, count);
+
+    let mut pairs = Vec::new();
+    for (key, value) in keys.iter().zip(&values) {
+        pairs.extend_from_slice(&(key.len() as u32).to_le_bytes());
+        pairs.extend_from_slice(key.as_bytes());
+        pairs.extend_from_slice(&value.to_le_bytes());
+    }
+
+    group.bench_function(BenchmarkId::new("mmap_open", count), |b| {
+        b.iter(|| StaticIndex::open(black_box(&path)).unwrap().len());
+    });
+    group.bench_function(BenchmarkId::new("hashmap_rebuild", count), |b| {
+        b.iter(|| load_hashmap(black_box(&pairs)).len());
+    });
+    group.bench_function(BenchmarkId::new("build", count), |b| {
+        b.iter(|| StaticIndex::build(black_box(&keys), &values).unwrap().len());
+    });
+
+    std::fs::remove_file(&path).unwrap();
+    group.finish();
+}
+
+criterion_group!(benches, bench_lookup, bench_startup);
+criterion_main!(benches);
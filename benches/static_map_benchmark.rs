@@ -0,0 +1,483 @@
+use criterion::{Criterion, black_box, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use simplehash::static_map;
+use simplehash::static_map::StaticMap;
+use std::collections::HashMap;
+
+// A 200-command protocol dispatch table
+static COMMANDS: StaticMap<u16> = static_map! {
+    "WATCH:blob" => 0,
+    "RENAME:session" => 1,
+    "create_shard" => 2,
+    "describe_bucket" => 3,
+    "DESCRIBE:alert" => 4,
+    "WATCH:alert" => 5,
+    "WATCH:token" => 6,
+    "scan_shard" => 7,
+    "UPDATE:queue" => 8,
+    "PATCH:alert" => 9,
+    "push_queue" => 10,
+    "update_token" => 11,
+    "PATCH:bucket" => 12,
+    "LIST:index" => 13,
+    "pop_blob" => 14,
+    "create_index" => 15,
+    "POP:config" => 16,
+    "CREATE:token" => 17,
+    "list_metric" => 18,
+    "get_user" => 19,
+    "scan_index" => 20,
+    "update_bucket" => 21,
+    "GET:blob" => 22,
+    "pop_metric" => 23,
+    "UPDATE:lease" => 24,
+    "del_shard" => 25,
+    "UPDATE:node" => 26,
+    "RENAME:bucket" => 27,
+    "patch_metric" => 28,
+    "flush_index" => 29,
+    "SET:lease" => 30,
+    "PUSH:topic" => 31,
+    "flush_node" => 32,
+    "push_lease" => 33,
+    "patch_node" => 34,
+    "LIST:user" => 35,
+    "patch_lease" => 36,
+    "flush_alert" => 37,
+    "scan_topic" => 38,
+    "SCAN:blob" => 39,
+    "GET:token" => 40,
+    "create_metric" => 41,
+    "SET:token" => 42,
+    "DESCRIBE:blob" => 43,
+    "get_shard" => 44,
+    "flush_bucket" => 45,
+    "flush_session" => 46,
+    "describe_session" => 47,
+    "create_alert" => 48,
+    "update_user" => 49,
+    "RENAME:shard" => 50,
+    "PATCH:shard" => 51,
+    "create_config" => 52,
+    "set_metric" => 53,
+    "WATCH:topic" => 54,
+    "rename_user" => 55,
+    "CREATE:queue" => 56,
+    "DEL:session" => 57,
+    "sync_blob" => 58,
+    "DESCRIBE:lease" => 59,
+    "scan_lease" => 60,
+    "set_config" => 61,
+    "RENAME:topic" => 62,
+    "get_alert" => 63,
+    "update_alert" => 64,
+    "LIST:queue" => 65,
+    "describe_metric" => 66,
+    "patch_session" => 67,
+    "DESCRIBE:index" => 68,
+    "list_config" => 69,
+    "pop_session" => 70,
+    "list_blob" => 71,
+    "POP:topic" => 72,
+    "sync_lease" => 73,
+    "SET:shard" => 74,
+    "WATCH:shard" => 75,
+    "flush_user" => 76,
+    "get_bucket" => 77,
+    "del_user" => 78,
+    "WATCH:queue" => 79,
+    "patch_token" => 80,
+    "describe_topic" => 81,
+    "SET:topic" => 82,
+    "PUSH:shard" => 83,
+    "create_bucket" => 84,
+    "set_index" => 85,
+    "PATCH:user" => 86,
+    "scan_node" => 87,
+    "UPDATE:config" => 88,
+    "push_session" => 89,
+    "update_metric" => 90,
+    "POP:index" => 91,
+    "SCAN:queue" => 92,
+    "update_session" => 93,
+    "get_config" => 94,
+    "DESCRIBE:shard" => 95,
+    "sync_metric" => 96,
+    "LIST:lease" => 97,
+    "scan_session" => 98,
+    "LIST:alert" => 99,
+    "SET:queue" => 100,
+    "SYNC:session" => 101,
+    "sync_bucket" => 102,
+    "CREATE:session" => 103,
+    "rename_alert" => 104,
+    "RENAME:blob" => 105,
+    "rename_node" => 106,
+    "del_queue" => 107,
+    "DESCRIBE:user" => 108,
+    "POP:token" => 109,
+    "patch_index" => 110,
+    "watch_bucket" => 111,
+    "PUSH:node" => 112,
+    "WATCH:session" => 113,
+    "pop_alert" => 114,
+    "update_topic" => 115,
+    "rename_metric" => 116,
+    "watch_config" => 117,
+    "CREATE:node" => 118,
+    "POP:shard" => 119,
+    "create_lease" => 120,
+    "del_blob" => 121,
+    "watch_user" => 122,
+    "get_lease" => 123,
+    "SYNC:topic" => 124,
+    "SYNC:token" => 125,
+    "UPDATE:blob" => 126,
+    "POP:node" => 127,
+    "sync_queue" => 128,
+    "flush_queue" => 129,
+    "set_alert" => 130,
+    "get_metric" => 131,
+    "create_user" => 132,
+    "LIST:shard" => 133,
+    "WATCH:node" => 134,
+    "set_user" => 135,
+    "SET:blob" => 136,
+    "SYNC:alert" => 137,
+    "FLUSH:config" => 138,
+    "PUSH:index" => 139,
+    "describe_config" => 140,
+    "push_config" => 141,
+    "SCAN:token" => 142,
+    "DEL:token" => 143,
+    "rename_config" => 144,
+    "DEL:lease" => 145,
+    "list_token" => 146,
+    "PUSH:user" => 147,
+    "get_session" => 148,
+    "LIST:topic" => 149,
+    "SYNC:user" => 150,
+    "GET:topic" => 151,
+    "flush_topic" => 152,
+    "pop_bucket" => 153,
+    "DESCRIBE:token" => 154,
+    "FLUSH:metric" => 155,
+    "push_metric" => 156,
+    "POP:queue" => 157,
+    "PUSH:alert" => 158,
+    "flush_shard" => 159,
+    "scan_config" => 160,
+    "SYNC:index" => 161,
+    "UPDATE:shard" => 162,
+    "set_session" => 163,
+    "DESCRIBE:node" => 164,
+    "patch_config" => 165,
+    "flush_blob" => 166,
+    "WATCH:metric" => 167,
+    "CREATE:blob" => 168,
+    "SCAN:metric" => 169,
+    "watch_index" => 170,
+    "flush_token" => 171,
+    "CREATE:topic" => 172,
+    "pop_lease" => 173,
+    "WATCH:lease" => 174,
+    "DESCRIBE:queue" => 175,
+    "list_bucket" => 176,
+    "list_node" => 177,
+    "PATCH:blob" => 178,
+    "del_node" => 179,
+    "flush_lease" => 180,
+    "set_bucket" => 181,
+    "PUSH:bucket" => 182,
+    "get_queue" => 183,
+    "get_index" => 184,
+    "del_index" => 185,
+    "RENAME:index" => 186,
+    "scan_user" => 187,
+    "DEL:alert" => 188,
+    "update_index" => 189,
+    "pop_user" => 190,
+    "sync_config" => 191,
+    "scan_bucket" => 192,
+    "PUSH:token" => 193,
+    "del_config" => 194,
+    "PUSH:blob" => 195,
+    "SYNC:node" => 196,
+    "scan_alert" => 197,
+    "del_metric" => 198,
+    "GET:node" => 199,
+};
+
+fn dispatch_match(command: &str) -> Option<u16> {
+    match command {
+        "WATCH:blob" => Some(0),
+        "RENAME:session" => Some(1),
+        "create_shard" => Some(2),
+        "describe_bucket" => Some(3),
+        "DESCRIBE:alert" => Some(4),
+        "WATCH:alert" => Some(5),
+        "WATCH:token" => Some(6),
+        "scan_shard" => Some(7),
+        "UPDATE:queue" => Some(8),
+        "PATCH:alert" => Some(9),
+        "push_queue" => Some(10),
+        "update_token" => Some(11),
+        "PATCH:bucket" => Some(12),
+        "LIST:index" => Some(13),
+        "pop_blob" => Some(14),
+        "create_index" => Some(15),
+        "POP:config" => Some(16),
+        "CREATE:token" => Some(17),
+        "list_metric" => Some(18),
+        "get_user" => Some(19),
+        "scan_index" => Some(20),
+        "update_bucket" => Some(21),
+        "GET:blob" => Some(22),
+        "pop_metric" => Some(23),
+        "UPDATE:lease" => Some(24),
+        "del_shard" => Some(25),
+        "UPDATE:node" => Some(26),
+        "RENAME:bucket" => Some(27),
+        "patch_metric" => Some(28),
+        "flush_index" => Some(29),
+        "SET:lease" => Some(30),
+        "PUSH:topic" => Some(31),
+        "flush_node" => Some(32),
+        "push_lease" => Some(33),
+        "patch_node" => Some(34),
+        "LIST:user" => Some(35),
+        "patch_lease" => Some(36),
+        "flush_alert" => Some(37),
+        "scan_topic" => Some(38),
+        "SCAN:blob" => Some(39),
+        "GET:token" => Some(40),
+        "create_metric" => Some(41),
+        "SET:token" => Some(42),
+        "DESCRIBE:blob" => Some(43),
+        "get_shard" => Some(44),
+        "flush_bucket" => Some(45),
+        "flush_session" => Some(46),
+        "describe_session" => Some(47),
+        "create_alert" => Some(48),
+        "update_user" => Some(49),
+        "RENAME:shard" => Some(50),
+        "PATCH:shard" => Some(51),
+        "create_config" => Some(52),
+        "set_metric" => Some(53),
+        "WATCH:topic" => Some(54),
+        "rename_user" => Some(55),
+        "CREATE:queue" => Some(56),
+        "DEL:session" => Some(57),
+        "sync_blob" => Some(58),
+        "DESCRIBE:lease" => Some(59),
+        "scan_lease" => Some(60),
+        "set_config" => Some(61),
+        "RENAME:topic" => Some(62),
+        "get_alert" => Some(63),
+        "update_alert" => Some(64),
+        "LIST:queue" => Some(65),
+        "describe_metric" => Some(66),
+        "patch_session" => Some(67),
+        "DESCRIBE:index" => Some(68),
+        "list_config" => Some(69),
+        "pop_session" => Some(70),
+        "list_blob" => Some(71),
+        "POP:topic" => Some(72),
+        "sync_lease" => Some(73),
+        "SET:shard" => Some(74),
+        "WATCH:shard" => Some(75),
+        "flush_user" => Some(76),
+        "get_bucket" => Some(77),
+        "del_user" => Some(78),
+        "WATCH:queue" => Some(79),
+        "patch_token" => Some(80),
+        "describe_topic" => Some(81),
+        "SET:topic" => Some(82),
+        "PUSH:shard" => Some(83),
+        "create_bucket" => Some(84),
+        "set_index" => Some(85),
+        "PATCH:user" => Some(86),
+        "scan_node" => Some(87),
+        "UPDATE:config" => Some(88),
+        "push_session" => Some(89),
+        "update_metric" => Some(90),
+        "POP:index" => Some(91),
+        "SCAN:queue" => Some(92),
+        "update_session" => Some(93),
+        "get_config" => Some(94),
+        "DESCRIBE:shard" => Some(95),
+        "sync_metric" => Some(96),
+        "LIST:lease" => Some(97),
+        "scan_session" => Some(98),
+        "LIST:alert" => Some(99),
+        "SET:queue" => Some(100),
+        "SYNC:session" => Some(101),
+        "sync_bucket" => Some(102),
+        "CREATE:session" => Some(103),
+        "rename_alert" => Some(104),
+        "RENAME:blob" => Some(105),
+        "rename_node" => Some(106),
+        "del_queue" => Some(107),
+        "DESCRIBE:user" => Some(108),
+        "POP:token" => Some(109),
+        "patch_index" => Some(110),
+        "watch_bucket" => Some(111),
+        "PUSH:node" => Some(112),
+        "WATCH:session" => Some(113),
+        "pop_alert" => Some(114),
+        "update_topic" => Some(115),
+        "rename_metric" => Some(116),
+        "watch_config" => Some(117),
+        "CREATE:node" => Some(118),
+        "POP:shard" => Some(119),
+        "create_lease" => Some(120),
+        "del_blob" => Some(121),
+        "watch_user" => Some(122),
+        "get_lease" => Some(123),
+        "SYNC:topic" => Some(124),
+        "SYNC:token" => Some(125),
+        "UPDATE:blob" => Some(126),
+        "POP:node" => Some(127),
+        "sync_queue" => Some(128),
+        "flush_queue" => Some(129),
+        "set_alert" => Some(130),
+        "get_metric" => Some(131),
+        "create_user" => Some(132),
+        "LIST:shard" => Some(133),
+        "WATCH:node" => Some(134),
+        "set_user" => Some(135),
+        "SET:blob" => Some(136),
+        "SYNC:alert" => Some(137),
+        "FLUSH:config" => Some(138),
+        "PUSH:index" => Some(139),
+        "describe_config" => Some(140),
+        "push_config" => Some(141),
+        "SCAN:token" => Some(142),
+        "DEL:token" => Some(143),
+        "rename_config" => Some(144),
+        "DEL:lease" => Some(145),
+        "list_token" => Some(146),
+        "PUSH:user" => Some(147),
+        "get_session" => Some(148),
+        "LIST:topic" => Some(149),
+        "SYNC:user" => Some(150),
+        "GET:topic" => Some(151),
+        "flush_topic" => Some(152),
+        "pop_bucket" => Some(153),
+        "DESCRIBE:token" => Some(154),
+        "FLUSH:metric" => Some(155),
+        "push_metric" => Some(156),
+        "POP:queue" => Some(157),
+        "PUSH:alert" => Some(158),
+        "flush_shard" => Some(159),
+        "scan_config" => Some(160),
+        "SYNC:index" => Some(161),
+        "UPDATE:shard" => Some(162),
+        "set_session" => Some(163),
+        "DESCRIBE:node" => Some(164),
+        "patch_config" => Some(165),
+        "flush_blob" => Some(166),
+        "WATCH:metric" => Some(167),
+        "CREATE:blob" => Some(168),
+        "SCAN:metric" => Some(169),
+        "watch_index" => Some(170),
+        "flush_token" => Some(171),
+        "CREATE:topic" => Some(172),
+        "pop_lease" => Some(173),
+        "WATCH:lease" => Some(174),
+        "DESCRIBE:queue" => Some(175),
+        "list_bucket" => Some(176),
+        "list_node" => Some(177),
+        "PATCH:blob" => Some(178),
+        "del_node" => Some(179),
+        "flush_lease" => Some(180),
+        "set_bucket" => Some(181),
+        "PUSH:bucket" => Some(182),
+        "get_queue" => Some(183),
+        "get_index" => Some(184),
+        "del_index" => Some(185),
+        "RENAME:index" => Some(186),
+        "scan_user" => Some(187),
+        "DEL:alert" => Some(188),
+        "update_index" => Some(189),
+        "pop_user" => Some(190),
+        "sync_config" => Some(191),
+        "scan_bucket" => Some(192),
+        "PUSH:token" => Some(193),
+        "del_config" => Some(194),
+        "PUSH:blob" => Some(195),
+        "SYNC:node" => Some(196),
+        "scan_alert" => Some(197),
+        "del_metric" => Some(198),
+        "GET:node" => Some(199),
+        _ => None,
+    }
+}
+
+// 90% known commands, 10% near misses
+fn queries() -> Vec<String> {
+    let mut rng = StdRng::seed_from_u64(42);
+    let keys: Vec<&str> = COMMANDS.keys().collect();
+    (0..10_000)
+        .map(|_| {
+            let key = keys[rng.gen_range(0..keys.len())];
+            if rng.gen_range(0..10) == 0 {
+                format!("{}s", key)
+            } else {
+                key.to_string()
+            }
+        })
+        .collect()
+}
+
+fn bench_static_map(c: &mut Criterion) {
+    let queries = queries();
+    let mut group = c.benchmark_group("static_map");
+    group.throughput(criterion::Throughput::Elements(queries.len() as u64));
+
+    group.bench_function("hashmap_build", |b| {
+        b.iter(|| {
+            COMMANDS
+                .iter()
+                .map(|(k, &v)| (k, v))
+                .collect::<HashMap<&str, u16>>()
+        })
+    });
+
+    let hashmap: HashMap<&str, u16> = COMMANDS.iter().map(|(k, &v)| (k, v)).collect();
+    group.bench_function("hashmap", |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter_map(|q| hashmap.get(black_box(q.as_str())))
+                .map(|&v| v as u64)
+                .sum::<u64>()
+        })
+    });
+
+    group.bench_function("match", |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter_map(|q| dispatch_match(black_box(q.as_str())))
+                .map(|v| v as u64)
+                .sum::<u64>()
+        })
+    });
+
+    group.bench_function("static_map", |b| {
+        b.iter(|| {
+            queries
+                .iter()
+                .filter_map(|q| COMMANDS.get(black_box(q.as_str())))
+                .map(|&v| v as u64)
+                .sum::<u64>()
+        })
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_static_map);
+criterion_main!(benches);
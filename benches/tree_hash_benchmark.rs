@@ -0,0 +1,94 @@
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use rand::rngs::StdRng;
+use rand::{Rng, RngCore, SeedableRng};
+use simplehash::digest::Algorithm;
+use simplehash::tree_hash::TreeHasher;
+use std::fs;
+use std::path::{Path, PathBuf};
+
+// Set SIMPLEHASH_TREE_FILES and SIMPLEHASH_TREE_HUGE_BYTES to resize the generated tree
+// (default 1M small files of up to 4 KiB plus four 256 MiB files)
+const DEFAULT_FILES: usize = 1_000_000;
+const DEFAULT_HUGE_BYTES: usize = 256 << 20;
+const HUGE_FILES: usize = 4;
+const FILES_PER_DIR: usize = 1000;
+
+fn env_or(name: &str, default: usize) -> usize {
+    std::env::var(name)
+        .ok()
+        .and_then(|v| v.parse().ok())
+        .unwrap_or(default)
+}
+
+fn generate(root: &Path) {
+    let mut rng = StdRng::seed_from_u64(42);
+    let files = env_or("SIMPLEHASH_TREE_FILES", DEFAULT_FILES);
+    let mut data = vec![0u8; 4096];
+    for i in 0..files {
+        let dir = root.join(format!("d{:04}/s{:02}", i / FILES_PER_DIR, i % 7));
+        if i % FILES_PER_DIR < 7 {
+            fs::create_dir_all(&dir).unwrap();
+        }
+        let len = rng.gen_range(0..data.len());
+        rng.fill_bytes(&mut data[..len]);
+        fs::write(dir.join(format!("f{}", i)), &data[..len]).unwrap();
+    }
+    let huge = env_or("SIMPLEHASH_TREE_HUGE_BYTES", DEFAULT_HUGE_BYTES);
+    let mut block = vec![0u8; huge.min(1 << 20)];
+    fs::create_dir_all(root.join("huge")).unwrap();
+    for i in 0..HUGE_FILES {
+        let mut file = fs::File::create(root.join(format!("huge/h{}", i))).unwrap();
+        let mut left = huge;
+        while left > 0 {
+            let n = left.min(block.len());
+            rng.fill_bytes(&mut block[..n]);
+            std::io::Write::write_all(&mut file, &block[..n]).unwrap();
+            left -= n;
+        }
+    }
+}
+
+// Baseline: a serial recursive walk that reads each file into a Vec and hashes it
+fn serial_walk(dir: &Path, algorithm: Algorithm, out: &mut Vec<(PathBuf, u128)>) {
+    for entry in fs::read_dir(dir).unwrap() {
+        let entry = entry.unwrap();
+        let file_type = entry.file_type().unwrap();
+        if file_type.is_dir() {
+            serial_walk(&entry.path(), algorithm, out);
+        } else if file_type.is_file() {
+            let data = fs::read(entry.path()).unwrap();
+            out.push((entry.path(), algorithm.hash(&data)));
+        }
+    }
+}
+
+fn bench_tree_hash(c: &mut Criterion) {
+    let root = std::env::temp_dir().join(format!("simplehash-tree-bench-{}", std::process::id()));
+    generate(&root);
+
+    let mut group = c.benchmark_group("tree_hash");
+    group.sample_size(10);
+    let files = env_or("SIMPLEHASH_TREE_FILES", DEFAULT_FILES) + HUGE_FILES;
+    group.throughput(criterion::Throughput::Elements(files as u64));
+
+    group.bench_function("serial_read_to_vec", |b| {
+        b.iter(|| {
+            let mut out = Vec::new();
+            serial_walk(&root, Algorithm::FarmFingerprint128, &mut out);
+            out.sort_unstable();
+            out.len()
+        })
+    });
+    for threads in [1, 2, 4, 8] {
+        let hasher = TreeHasher::new().threads(threads);
+        group.bench_function(BenchmarkId::new("tree_hasher", threads), |b| {
+            b.iter(|| hasher.hash(&root).unwrap().root)
+        });
+    }
+
+    group.finish();
+    fs::remove_dir_all(&root).unwrap();
+}
+
+criterion_group!(benches, bench_tree_hash);
+criterion_main!(benches);
@@ -0,0 +1,133 @@
+/// SimpleHash static index tool
+///
+/// Builds memory-mappable key→value index files (see `simplehash::static_index`) offline and
+/// queries them from the terminal.
+use simplehash::mmap::MappedFile;
+use simplehash::static_index::{StaticIndex, StaticIndexBuilder};
+use std::env;
+use std::fs;
+use std::io::{self, BufWriter, Write};
+use std::process;
+use std::time::Instant;
+
+fn usage(program: &str) -> ! {
+    eprintln!("Usage:");
+    eprintln!(
+        "  {} build <input> <output> [--offsets]   Build an index from <input>",
+        program
+    );
+    eprintln!(
+        "  {} get <index> <key>...                 Look up keys",
+        program
+    );
+    eprintln!(
+        "  {} info <index>                         Show index statistics",
+        program
+    );
+    eprintln!();
+    eprintln!("Input lines are `key<TAB>value` with a decimal u64 value. With --offsets, each");
+    eprintln!("line is a key and its value is the byte offset of the line in <input>.");
+    process::exit(2);
+}
+
+fn fail(message: impl std::fmt::Display) -> ! {
+    eprintln!("error: {}", message);
+    process::exit(1);
+}
+
+/// Parses the input file into parallel key and value vectors.
+fn read_pairs(input: &[u8], offsets: bool) -> (Vec<&[u8]>, Vec<u64>) {
+    let mut keys = Vec::new();
+    let mut values = Vec::new();
+    let mut offset = 0u64;
+    for (number, line) in input.split(|&b| b == b'\n').enumerate() {
+        let line_offset = offset;
+        offset += line.len() as u64 + 1;
+        let line = line.strip_suffix(b"\r").unwrap_or(line);
+        if line.is_empty() {
+            continue;
+        }
+        if offsets {
+            keys.push(line);
+            values.push(line_offset);
+            continue;
+        }
+        let Some(tab) = line.iter().rposition(|&b| b == b'\t') else {
+            fail(format!("line {}: expected `key<TAB>value`", number + 1));
+        };
+        let value = std::str::from_utf8(&line[tab + 1..])
+            .ok()
+            .and_then(|v| v.trim().parse().ok())
+            .unwrap_or_else(|| fail(format!("line {}: value is not a u64", number + 1)));
+        keys.push(&line[..tab]);
+        values.push(value);
+    }
+    (keys, values)
+}
+
+fn build(input_path: &str, output_path: &str, offsets: bool) -> io::Result<()> {
+    let started = Instant::now();
+    // Keys borrow from the mapped input rather than a heap copy of it
+    let input = MappedFile::open(input_path)?;
+    let (keys, values) = read_pairs(input.as_slice(), offsets);
+    let parsed = started.elapsed();
+
+    let index = StaticIndexBuilder::new()
+        .build(&keys, &values)
+        .unwrap_or_else(|err| fail(err));
+    let built = started.elapsed();
+
+    let mut out = BufWriter::new(fs::File::create(output_path)?);
+    out.write_all(index.as_bytes())?;
+    out.into_inner()
+        .map_err(|err| err.into_error())?
+        .sync_all()?;
+
+    println!("Keys:          {}", index.len());
+    println!("Index size:    {} bytes", index.as_bytes().len());
+    println!(
+        "Bytes per key: {:.2}",
+        index.as_bytes().len() as f64 / index.len().max(1) as f64
+    );
+    println!("Parsed in:     {:?}", parsed);
+    println!("Built in:      {:?}", built - parsed);
+    println!("Total:         {:?}", started.elapsed());
+    Ok(())
+}
+
+fn main() {
+    let args: Vec<String> = env::args().collect();
+    let program = args
+        .first()
+        .map(String::as_str)
+        .unwrap_or("simplehash-index");
+    let command = args.get(1).map(String::as_str);
+
+    let result = match (command, &args[args.len().min(2)..]) {
+        (Some("build"), [input, output]) => build(input, output, false),
+        (Some("build"), [input, output, flag]) if flag == "--offsets" => build(input, output, true),
+        (Some("get"), [path, keys @ ..]) if !keys.is_empty() => {
+            StaticIndex::open(path).map(|index| {
+                for key in keys {
+                    match index.get(key.as_bytes()) {
+                        Some(value) => println!("{}\t{}", key, value),
+                        None => println!("{}\t(not found)", key),
+                    }
+                }
+            })
+        }
+        (Some("info"), [path]) => {
+            let started = Instant::now();
+            StaticIndex::open(path).map(|index| {
+                println!("Keys:       {}", index.len());
+                println!("Index size: {} bytes", index.as_bytes().len());
+                println!("Opened in:  {:?}", started.elapsed());
+            })
+        }
+        _ => usage(program),
+    };
+
+    if let Err(err) = result {
+        fail(err);
+    }
+}
@@ -0,0 +1,599 @@
+use crate::farm::farm_hash64;
+use crate::parallel::resolve_threads;
+use crate::prehashed::NoHashBuildHasher;
+use crate::sharded_map::{CachePadded, REMIX};
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{RwLock, RwLockReadGuard, RwLockWriteGuard};
+
+// End of a fingerprint collision chain
+const NONE: u32 = u32::MAX;
+
+type Shards<K, V> = Box<[CachePadded<RwLock<Shard<K, V>>>]>;
+
+/// A concurrent in-process cache with CLOCK eviction, sharded by key fingerprint.
+///
+/// Each key is fingerprinted once with a 64-bit hash of its bytes (FarmHash by default).
+/// The top bits of the fingerprint pick a shard, and the shard indexes its entries by the
+/// fingerprint itself. Lookups take only the shard's read lock, and a hit just sets the
+/// entry's reference bit, so unlike an LRU list, concurrent readers never write shared
+/// state beyond that one flag. When a shard is over capacity, a clock hand sweeps its
+/// entries, clearing reference bits and evicting the first entry that was not used since
+/// the last pass.
+///
+/// Capacity is a total weight. By default every entry weighs 1, so it is an entry count.
+/// Use [`CacheBuilder::weigher`] to charge entries by their size in bytes instead.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::cache::ShardedCache;
+///
+/// let cache = ShardedCache::new(1_000);
+/// cache.insert("user:1".to_string(), 42u64);
+/// assert_eq!(cache.get("user:1"), Some(42));
+/// assert_eq!(cache.get("user:2"), None);
+/// ```
+pub struct ShardedCache<K, V> {
+    shards: Shards<K, V>,
+    shift: u32,
+    weigher: fn(&K, &V) -> usize,
+    fingerprint: fn(&[u8]) -> u64,
+}
+
+/// Configures and builds a [`ShardedCache`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::cache::ShardedCache;
+/// use simplehash::city::city_hash64;
+///
+/// // At most 64 MiB of keys and values, fingerprinted with CityHash
+/// let cache = ShardedCache::<String, Vec<u8>>::builder(64 << 20)
+///     .weigher(|key, value| key.len() + value.len())
+///     .fingerprint(city_hash64)
+///     .build();
+/// cache.insert("blob".to_string(), vec![0; 1024]);
+/// assert_eq!(cache.weight(), 1028);
+/// ```
+pub struct CacheBuilder<K, V> {
+    capacity: usize,
+    shards: usize,
+    weigher: fn(&K, &V) -> usize,
+    fingerprint: fn(&[u8]) -> u64,
+}
+
+struct Entry<K, V> {
+    key: K,
+    value: V,
+    fingerprint: u64,
+    weight: usize,
+    // Next entry in this shard with the same fingerprint, or `NONE`
+    next: u32,
+    referenced: AtomicBool,
+}
+
+struct Shard<K, V> {
+    // Remixed fingerprint to the first entry in its collision chain
+    index: HashMap<u64, u32, NoHashBuildHasher>,
+    entries: Vec<Option<Entry<K, V>>>,
+    free: Vec<u32>,
+    hand: usize,
+    weight: usize,
+    capacity: usize,
+}
+
+impl<K: AsRef<[u8]>, V> CacheBuilder<K, V> {
+    /// Creates a builder for a cache holding at most `capacity` total weight.
+    ///
+    /// # Parameters
+    ///
+    /// * `capacity` - Total weight of all entries; an entry count unless a weigher is set
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            capacity,
+            shards: 0,
+            weigher: |_, _| 1,
+            fingerprint: farm_hash64,
+        }
+    }
+
+    /// Sets the minimum number of shards (rounded up to a power of two, at most 2^16).
+    /// The default of `0` uses four shards per available CPU.
+    pub fn shards(mut self, shards: usize) -> Self {
+        self.shards = shards;
+        self
+    }
+
+    /// Sets the function that computes an entry's weight, such as its size in bytes.
+    pub fn weigher(mut self, weigher: fn(&K, &V) -> usize) -> Self {
+        self.weigher = weigher;
+        self
+    }
+
+    /// Sets the 64-bit hash used to fingerprint keys, such as
+    /// [`city_hash64`](crate::city::city_hash64). Defaults to
+    /// [`farm_hash64`](crate::farm::farm_hash64).
+    pub fn fingerprint(mut self, fingerprint: fn(&[u8]) -> u64) -> Self {
+        self.fingerprint = fingerprint;
+        self
+    }
+
+    /// Builds the cache. Capacity is split evenly between the shards.
+    pub fn build(self) -> ShardedCache<K, V> {
+        let shards = if self.shards == 0 {
+            resolve_threads(0) * 4
+        } else {
+            self.shards
+        };
+        let shards = shards.clamp(1, 1 << 16).next_power_of_two();
+        let capacity = self.capacity.div_ceil(shards);
+        ShardedCache {
+            shards: (0..shards)
+                .map(|_| CachePadded(RwLock::new(Shard::new(capacity))))
+                .collect(),
+            shift: 64 - shards.trailing_zeros(),
+            weigher: self.weigher,
+            fingerprint: self.fingerprint,
+        }
+    }
+}
+
+impl<K: AsRef<[u8]>, V> ShardedCache<K, V> {
+    /// Creates a cache holding at most `capacity` entries.
+    ///
+    /// # Parameters
+    ///
+    /// * `capacity` - Maximum number of entries
+    pub fn new(capacity: usize) -> Self {
+        CacheBuilder::new(capacity).build()
+    }
+
+    /// Returns a builder for a cache holding at most `capacity` total weight.
+    pub fn builder(capacity: usize) -> CacheBuilder<K, V> {
+        CacheBuilder::new(capacity)
+    }
+
+    /// Returns the number of shards.
+    #[inline]
+    pub fn shard_count(&self) -> usize {
+        self.shards.len()
+    }
+
+    #[inline]
+    fn shard_of(&self, fingerprint: u64) -> usize {
+        // checked_shr covers the single-shard case, where the shift is 64
+        fingerprint.checked_shr(self.shift).unwrap_or(0) as usize
+    }
+
+    #[inline]
+    fn read(&self, shard: usize) -> RwLockReadGuard<'_, Shard<K, V>> {
+        self.shards[shard].0.read().unwrap()
+    }
+
+    #[inline]
+    fn write(&self, shard: usize) -> RwLockWriteGuard<'_, Shard<K, V>> {
+        self.shards[shard].0.write().unwrap()
+    }
+
+    /// Inserts or replaces the value for `key`, evicting other entries from its shard as
+    /// needed to stay within capacity.
+    ///
+    /// # Returns
+    ///
+    /// `false` if the entry weighs more than a whole shard's capacity. It is not cached, and
+    /// any previous value for `key` is removed.
+    pub fn insert(&self, key: K, value: V) -> bool {
+        let fingerprint = (self.fingerprint)(key.as_ref());
+        let weight = (self.weigher)(&key, &value);
+        self.write(self.shard_of(fingerprint))
+            .insert(fingerprint, key, value, weight)
+    }
+
+    /// Returns a clone of the cached value for `key`, marking the entry as recently used.
+    pub fn get<Q: AsRef<[u8]> + ?Sized>(&self, key: &Q) -> Option<V>
+    where
+        V: Clone,
+    {
+        self.get_with(key, V::clone)
+    }
+
+    /// Calls `f` with the cached value for `key` while holding the shard's read lock,
+    /// marking the entry as recently used.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::cache::ShardedCache;
+    ///
+    /// let cache = ShardedCache::new(16);
+    /// cache.insert(b"page".to_vec(), vec![0u8; 4096]);
+    /// assert_eq!(cache.get_with(b"page", |v| v.len()), Some(4096));
+    /// ```
+    pub fn get_with<Q, R, F>(&self, key: &Q, f: F) -> Option<R>
+    where
+        Q: AsRef<[u8]> + ?Sized,
+        F: FnOnce(&V) -> R,
+    {
+        let key = key.as_ref();
+        let fingerprint = (self.fingerprint)(key);
+        self.read(self.shard_of(fingerprint))
+            .touch(fingerprint, key)
+            .map(f)
+    }
+
+    /// Returns `true` if `key` is cached, without marking it as recently used.
+    pub fn contains_key<Q: AsRef<[u8]> + ?Sized>(&self, key: &Q) -> bool {
+        let key = key.as_ref();
+        let fingerprint = (self.fingerprint)(key);
+        self.read(self.shard_of(fingerprint))
+            .find(fingerprint, key)
+            .is_some()
+    }
+
+    /// Removes `key` from the cache, returning its value if it was present.
+    pub fn remove<Q: AsRef<[u8]> + ?Sized>(&self, key: &Q) -> Option<V> {
+        let key = key.as_ref();
+        let fingerprint = (self.fingerprint)(key);
+        let mut shard = self.write(self.shard_of(fingerprint));
+        let index = shard.find(fingerprint, key)?;
+        Some(shard.remove_at(index).value)
+    }
+
+    /// Looks up many keys at once, taking each shard's read lock only once.
+    ///
+    /// Keys are fingerprinted up front and grouped by shard, so a batch touching `s` shards
+    /// costs `s` lock acquisitions instead of one per key. Results are in input order.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::cache::ShardedCache;
+    ///
+    /// let cache = ShardedCache::new(100);
+    /// cache.insert("a", 1);
+    /// cache.insert("b", 2);
+    /// assert_eq!(cache.get_batch(&["b", "x", "a"]), vec![Some(2), None, Some(1)]);
+    /// ```
+    pub fn get_batch<Q: AsRef<[u8]>>(&self, keys: &[Q]) -> Vec<Option<V>>
+    where
+        V: Clone,
+    {
+        let mut order: Vec<(u32, u64, u32)> = keys
+            .iter()
+            .enumerate()
+            .map(|(i, key)| {
+                let fingerprint = (self.fingerprint)(key.as_ref());
+                (self.shard_of(fingerprint) as u32, fingerprint, i as u32)
+            })
+            .collect();
+        order.sort_unstable_by_key(|&(shard, _, _)| shard);
+
+        let mut results = vec![None; keys.len()];
+        for group in order.chunk_by(|a, b| a.0 == b.0) {
+            let shard = self.read(group[0].0 as usize);
+            for &(_, fingerprint, i) in group {
+                results[i as usize] = shard.touch(fingerprint, keys[i as usize].as_ref()).cloned();
+            }
+        }
+        results
+    }
+
+    /// Returns the number of cached entries. Shards are counted one at a time, so the
+    /// result is only a snapshot when other threads are writing.
+    pub fn len(&self) -> usize {
+        (0..self.shards.len()).map(|s| self.read(s).len()).sum()
+    }
+
+    /// Returns `true` if no shard holds any entries.
+    pub fn is_empty(&self) -> bool {
+        (0..self.shards.len()).all(|s| self.read(s).is_empty())
+    }
+
+    /// Returns the total weight of the cached entries.
+    pub fn weight(&self) -> usize {
+        (0..self.shards.len()).map(|s| self.read(s).weight).sum()
+    }
+
+    /// Returns the total capacity, which is the configured capacity rounded up to a
+    /// multiple of the shard count.
+    pub fn capacity(&self) -> usize {
+        (0..self.shards.len()).map(|s| self.read(s).capacity).sum()
+    }
+
+    /// Removes all entries.
+    pub fn clear(&self) {
+        for s in 0..self.shards.len() {
+            let mut shard = self.write(s);
+            *shard = Shard::new(shard.capacity);
+        }
+    }
+}
+
+impl<K, V> std::fmt::Debug for ShardedCache<K, V> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("ShardedCache")
+            .field("shards", &self.shards.len())
+            .finish_non_exhaustive()
+    }
+}
+
+impl<K: AsRef<[u8]>, V> Shard<K, V> {
+    fn new(capacity: usize) -> Self {
+        Self {
+            index: HashMap::default(),
+            entries: Vec::new(),
+            free: Vec::new(),
+            hand: 0,
+            weight: 0,
+            capacity,
+        }
+    }
+
+    // Every fingerprint in a shard shares its top bits, so the index sees them remixed by
+    // an odd multiply, which keeps distinct fingerprints distinct
+    #[inline]
+    fn index_key(fingerprint: u64) -> u64 {
+        fingerprint.wrapping_mul(REMIX)
+    }
+
+    #[inline]
+    fn entry(&self, index: u32) -> &Entry<K, V> {
+        self.entries[index as usize]
+            .as_ref()
+            .expect("indexed entries are occupied")
+    }
+
+    fn find(&self, fingerprint: u64, key: &[u8]) -> Option<u32> {
+        let mut index = *self.index.get(&Self::index_key(fingerprint))?;
+        loop {
+            let entry = self.entry(index);
+            if entry.key.as_ref() == key {
+                return Some(index);
+            }
+            if entry.next == NONE {
+                return None;
+            }
+            index = entry.next;
+        }
+    }
+
+    // The hit path: only a read lock is held, and the reference bit is written only when it
+    // is not already set, so hot entries stay shared in every reader's cache
+    #[inline]
+    fn touch(&self, fingerprint: u64, key: &[u8]) -> Option<&V> {
+        let entry = self.entry(self.find(fingerprint, key)?);
+        if !entry.referenced.load(Ordering::Relaxed) {
+            entry.referenced.store(true, Ordering::Relaxed);
+        }
+        Some(&entry.value)
+    }
+
+    fn insert(&mut self, fingerprint: u64, key: K, value: V, weight: usize) -> bool {
+        let existing = self.find(fingerprint, key.as_ref());
+        if weight > self.capacity {
+            if let Some(index) = existing {
+                self.remove_at(index);
+            }
+            return false;
+        }
+
+        if let Some(index) = existing {
+            // Make room among the other entries first, so the sweep can never take the entry
+            // being updated; it alone always fits, since its weight is within the capacity
+            let old = self.entry(index).weight;
+            while self.weight - old + weight > self.capacity {
+                self.evict(index);
+            }
+            let entry = self.entries[index as usize].as_mut().unwrap();
+            self.weight = self.weight - entry.weight + weight;
+            entry.value = value;
+            entry.weight = weight;
+            // An update counts as a use
+            *entry.referenced.get_mut() = true;
+            return true;
+        }
+
+        while self.weight + weight > self.capacity {
+            self.evict(NONE);
+        }
+        let index = match self.free.pop() {
+            Some(index) => index,
+            None => {
+                self.entries.push(None);
+                (self.entries.len() - 1) as u32
+            }
+        };
+        // New entries go to the head of their fingerprint's chain
+        let next = self
+            .index
+            .insert(Self::index_key(fingerprint), index)
+            .unwrap_or(NONE);
+        self.entries[index as usize] = Some(Entry {
+            key,
+            value,
+            fingerprint,
+            weight,
+            next,
+            referenced: AtomicBool::new(false),
+        });
+        self.weight += weight;
+        true
+    }
+
+    // Advances the clock hand to the first entry not referenced since the last pass,
+    // clearing reference bits on the way, and evicts it. The entry at `keep` is passed over.
+    // Terminates within two sweeps as long as another entry is cached.
+    fn evict(&mut self, keep: u32) {
+        loop {
+            if self.hand >= self.entries.len() {
+                self.hand = 0;
+            }
+            let index = self.hand;
+            self.hand += 1;
+            if index == keep as usize {
+                continue;
+            }
+            let Some(entry) = &mut self.entries[index] else {
+                continue;
+            };
+            if !std::mem::replace(entry.referenced.get_mut(), false) {
+                self.remove_at(index as u32);
+                return;
+            }
+        }
+    }
+
+    fn remove_at(&mut self, index: u32) -> Entry<K, V> {
+        let entry = self.entries[index as usize].take().unwrap();
+        let key = Self::index_key(entry.fingerprint);
+        let head = self.index[&key];
+        if head == index {
+            if entry.next == NONE {
+                self.index.remove(&key);
+            } else {
+                self.index.insert(key, entry.next);
+            }
+        } else {
+            let mut previous = head;
+            while self.entry(previous).next != index {
+                previous = self.entry(previous).next;
+            }
+            self.entries[previous as usize].as_mut().unwrap().next = entry.next;
+        }
+        self.free.push(index);
+        self.weight -= entry.weight;
+        entry
+    }
+
+    fn len(&self) -> usize {
+        self.entries.len() - self.free.len()
+    }
+
+    fn is_empty(&self) -> bool {
+        self.index.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::thread;
+
+    #[test]
+    fn test_insert_get_remove() {
+        let cache = ShardedCache::builder(1000).shards(4).build();
+        for i in 0..500u32 {
+            assert!(cache.insert(format!("key{}", i), i));
+        }
+        assert_eq!(cache.len(), 500);
+        assert_eq!(cache.get("key42"), Some(42));
+        assert!(cache.insert("key42".to_string(), 0));
+        assert_eq!(cache.get("key42"), Some(0));
+        assert_eq!(cache.len(), 500);
+        assert_eq!(cache.remove("key42"), Some(0));
+        assert_eq!(cache.remove("key42"), None);
+        assert!(!cache.contains_key("key42"));
+        cache.clear();
+        assert!(cache.is_empty());
+        assert_eq!(cache.weight(), 0);
+    }
+
+    #[test]
+    fn test_clock_keeps_referenced_entries() {
+        let cache = ShardedCache::builder(100).shards(1).build();
+        for i in 0..100u32 {
+            cache.insert(i.to_le_bytes(), i);
+        }
+        // Reference the first half, then insert more than the unreferenced half can absorb
+        // in a single sweep
+        for i in 0..50u32 {
+            assert_eq!(cache.get(&i.to_le_bytes()), Some(i));
+        }
+        for i in 100..150u32 {
+            cache.insert(i.to_le_bytes(), i);
+        }
+        assert_eq!(cache.len(), 100);
+        assert!((0..50u32).all(|i| cache.contains_key(&i.to_le_bytes())));
+        assert!((50..100u32).all(|i| !cache.contains_key(&i.to_le_bytes())));
+    }
+
+    #[test]
+    fn test_weight_capacity() {
+        let cache = ShardedCache::<Vec<u8>, Vec<u8>>::builder(10_000)
+            .shards(2)
+            .weigher(|k, v| k.len() + v.len())
+            .build();
+        for i in 0..1000u32 {
+            let value = vec![0u8; (i % 200) as usize];
+            cache.insert(i.to_le_bytes().to_vec(), value);
+            assert!(cache.weight() <= cache.capacity());
+        }
+        assert!(cache.weight() > cache.capacity() / 2);
+        assert!(!cache.insert(b"huge".to_vec(), vec![0; 6000]));
+        assert!(!cache.contains_key(b"huge"));
+    }
+
+    #[test]
+    fn test_update_never_evicts_itself() {
+        let cache = ShardedCache::<&str, Vec<u8>>::builder(10)
+            .shards(1)
+            .weigher(|_, v| v.len())
+            .build();
+        for key in ["a", "b", "c"] {
+            assert!(cache.insert(key, vec![0; 2]));
+        }
+        // Growing "a" must evict one of the others, never "a" itself
+        assert!(cache.insert("a", vec![7; 7]));
+        assert_eq!(cache.get("a"), Some(vec![7; 7]));
+        assert!(cache.weight() <= cache.capacity());
+        assert_eq!(cache.len(), 2);
+        // Filling the whole capacity leaves only the updated entry
+        assert!(cache.insert("a", vec![1; 10]));
+        assert_eq!(cache.get("a"), Some(vec![1; 10]));
+        assert_eq!(cache.len(), 1);
+    }
+
+    #[test]
+    fn test_fingerprint_collisions() {
+        // Every key shares one fingerprint, so entries chain behind a single index slot
+        let cache = ShardedCache::builder(8)
+            .shards(1)
+            .fingerprint(|_| 7)
+            .build();
+        for i in 0..20u8 {
+            cache.insert([i], i);
+        }
+        assert_eq!(cache.len(), 8);
+        assert!((12..20u8).all(|i| cache.get(&[i]) == Some(i)));
+        assert_eq!(cache.remove(&[15u8]), Some(15));
+        assert_eq!(cache.remove(&[12u8]), Some(12));
+        assert_eq!(cache.get(&[19u8]), Some(19));
+        assert_eq!(cache.len(), 6);
+    }
+
+    #[test]
+    fn test_batch_and_threads() {
+        let cache = ShardedCache::builder(10_000).shards(16).build();
+        thread::scope(|s| {
+            for t in 0..4u64 {
+                let cache = &cache;
+                s.spawn(move || {
+                    for i in 0..1000u64 {
+                        let key = (t * 1000 + i).to_le_bytes();
+                        cache.insert(key, i);
+                        assert_eq!(cache.get(&key), Some(i));
+                    }
+                });
+            }
+        });
+        assert_eq!(cache.len(), 4000);
+
+        let keys: Vec<[u8; 8]> = (0..5000u64).rev().map(u64::to_le_bytes).collect();
+        let batch = cache.get_batch(&keys);
+        for (key, value) in keys.iter().zip(batch) {
+            assert_eq!(value, cache.get(key));
+        }
+    }
+}
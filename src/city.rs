@@ -151,6 +151,7 @@ fn hash32_len5to12(s: &[u8], len: usize) -> u32 {
     fmix(mur(c, mur(b, mur(a, d))))
 }
 
+#[inline]
 pub fn city_hash32(s: &[u8]) -> u32 {
     let len = s.len();
     if len <= 24 {
@@ -409,6 +410,7 @@ fn hash_len33to64(s: &[u8]) -> u64 {
     b.wrapping_add(x)
 }
 
+#[inline]
 pub fn city_hash64(s: &[u8]) -> u64 {
     let len = s.len();
     if len <= 32 {
@@ -672,6 +674,7 @@ pub fn city_hash128_with_seed(s: &[u8], seed: u128) -> u128 {
         ^ ((hash_len16(x.wrapping_add(w.1), y.wrapping_add(v.1)) as u128) << 64)
 }
 
+#[inline]
 pub fn city_hash128(s: &[u8]) -> u128 {
     let len = s.len();
     if len >= 16 {
@@ -683,6 +686,7 @@ pub fn city_hash128(s: &[u8]) -> u128 {
     }
 }
 
+#[derive(Debug, Clone)]
 pub struct CityHasher64 {
     buffer: Vec<u8>,
     seed: u64,
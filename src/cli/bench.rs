@@ -0,0 +1,300 @@
+// `simplehash bench`: measure hash throughput and latency on this host without Criterion.
+
+use super::{Args, parse_algorithms, usage_error};
+use simplehash::digest::Algorithm;
+use std::fmt::Write as _;
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+const USAGE: &str = "\
+Usage: simplehash bench [OPTIONS]
+
+Measures every algorithm over a sweep of input sizes on this host. Each measurement warms up
+first, then hashes distinct keys taken from a random buffer in timed batches of at least
+~2 us. Reports throughput (GB/s), cycles per byte, keys per second, and percentiles of the
+per-hash latency averaged within each batch.
+
+Options:
+  -a, --algorithm ALGS   Comma-separated algorithms, or `all` (default: all)
+  -s, --sizes SIZES      Comma-separated key sizes in bytes, with optional k/m suffix
+                         (default: 4,8,16,32,64,256,1k,4k,64k,1m)
+  -t, --time MS          Measured time per algorithm and size (default: 200)
+      --warmup MS        Warmup time per algorithm and size (default: 50)
+      --json             Print one JSON document instead of a table
+
+Cycles are read from the time-stamp counter on x86_64, which ticks at a constant reference
+rate rather than the current core clock; they are omitted on other architectures.
+";
+
+const DEFAULT_SIZES: &[usize] = &[4, 8, 16, 32, 64, 256, 1 << 10, 4 << 10, 64 << 10, 1 << 20];
+// Keys are drawn from a buffer this much larger than the key size, so repeated keys do not all
+// hit the same cache lines
+const POOL_BYTES: usize = 4 << 20;
+// Batches are grown until one takes at least this long, well above the timer resolution
+const MIN_BATCH: Duration = Duration::from_micros(2);
+
+struct Measurement {
+    algorithm: Algorithm,
+    size: usize,
+    hashes: u64,
+    seconds: f64,
+    cycles: Option<u64>,
+    // Average nanoseconds per hash in each batch, sorted
+    batch_ns: Vec<f64>,
+}
+
+impl Measurement {
+    fn bytes_per_sec(&self) -> f64 {
+        self.hashes as f64 * self.size as f64 / self.seconds
+    }
+
+    fn keys_per_sec(&self) -> f64 {
+        self.hashes as f64 / self.seconds
+    }
+
+    fn cycles_per_byte(&self) -> Option<f64> {
+        self.cycles
+            .map(|c| c as f64 / (self.hashes as f64 * self.size as f64))
+    }
+
+    fn percentile(&self, q: f64) -> f64 {
+        let last = self.batch_ns.len() - 1;
+        self.batch_ns[(last as f64 * q).round() as usize]
+    }
+}
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let algorithms = args
+        .value(&["-a", "--algorithm"])
+        .map(|spec| parse_algorithms(&spec, USAGE))
+        .unwrap_or_else(|| Algorithm::ALL.to_vec());
+    let sizes = args
+        .value(&["-s", "--sizes"])
+        .map(|spec| {
+            spec.split(',')
+                .map(|s| {
+                    parse_size(s.trim())
+                        .unwrap_or_else(|| usage_error(format!("invalid size {}", s), USAGE))
+                })
+                .collect()
+        })
+        .unwrap_or_else(|| DEFAULT_SIZES.to_vec());
+    let time = Duration::from_millis(args.parsed(&["-t", "--time"]).unwrap_or(200));
+    let warmup = Duration::from_millis(args.parsed(&["--warmup"]).unwrap_or(50));
+    let json = args.flag(&["--json"]);
+    if !args.finish().is_empty() {
+        usage_error("bench takes no arguments", USAGE);
+    }
+    if sizes.is_empty() || time.is_zero() {
+        usage_error("need at least one size and a positive --time", USAGE);
+    }
+
+    let pool = random_bytes(POOL_BYTES + sizes.iter().max().unwrap());
+    let mut results = Vec::new();
+    if !json {
+        println!(
+            "{:<12} {:>8} {:>8} {:>9} {:>9} {:>9} {:>9} {:>9}",
+            "algorithm", "size", "GB/s", "cycles/B", "keys/s", "p50", "p99", "p99.9"
+        );
+    }
+    for &algorithm in &algorithms {
+        for &size in &sizes {
+            let m = measure(algorithm, size, &pool, warmup, time);
+            if !json {
+                println!(
+                    "{:<12} {:>8} {:>8.2} {:>9} {:>9} {:>9} {:>9} {:>9}",
+                    algorithm.name(),
+                    size,
+                    m.bytes_per_sec() / 1e9,
+                    m.cycles_per_byte()
+                        .map_or("-".to_string(), |c| format!("{:.2}", c)),
+                    scaled(m.keys_per_sec(), &["", "k", "M", "G"], 1000.0),
+                    scaled(m.percentile(0.5), &["ns", "us", "ms", "s"], 1000.0),
+                    scaled(m.percentile(0.99), &["ns", "us", "ms", "s"], 1000.0),
+                    scaled(m.percentile(0.999), &["ns", "us", "ms", "s"], 1000.0),
+                );
+            }
+            results.push(m);
+        }
+    }
+    if json {
+        print!("{}", to_json(&results));
+    }
+}
+
+// Hashes keys of `size` bytes in batches for `warmup`, then for `time` while recording
+fn measure(
+    algorithm: Algorithm,
+    size: usize,
+    pool: &[u8],
+    warmup: Duration,
+    time: Duration,
+) -> Measurement {
+    let span = pool.len() - size + 1;
+    let mut offset = 0;
+    let mut run_batch = |n: u64| {
+        for _ in 0..n {
+            black_box(algorithm.hash(black_box(&pool[offset..offset + size])));
+            offset += size;
+            if offset >= span {
+                offset = 0;
+            }
+        }
+    };
+
+    // Grow the batch until it is long enough to time, warming up on the way
+    let mut batch = 1u64;
+    let started = Instant::now();
+    loop {
+        let t = Instant::now();
+        run_batch(batch);
+        if t.elapsed() >= MIN_BATCH && started.elapsed() >= warmup {
+            break;
+        }
+        if t.elapsed() < MIN_BATCH {
+            batch *= 2;
+        }
+    }
+
+    let mut batch_ns = Vec::new();
+    let mut hashes = 0;
+    let started = Instant::now();
+    let start_cycles = cycles();
+    while started.elapsed() < time {
+        let t = Instant::now();
+        run_batch(batch);
+        batch_ns.push(t.elapsed().as_nanos() as f64 / batch as f64);
+        hashes += batch;
+    }
+    let cycles = start_cycles.zip(cycles()).map(|(a, b)| b.wrapping_sub(a));
+    let seconds = started.elapsed().as_secs_f64();
+    batch_ns.sort_by(f64::total_cmp);
+    Measurement {
+        algorithm,
+        size,
+        hashes,
+        seconds,
+        cycles,
+        batch_ns,
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+fn cycles() -> Option<u64> {
+    // SAFETY: RDTSC is available on every x86_64 processor and has no side effects
+    #[allow(unused_unsafe)]
+    Some(unsafe { std::arch::x86_64::_rdtsc() })
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+fn cycles() -> Option<u64> {
+    None
+}
+
+// Formats `value` with three significant digits and the largest unit that keeps it >= 1
+fn scaled(mut value: f64, units: &[&str], step: f64) -> String {
+    let mut unit = 0;
+    while value >= step && unit + 1 < units.len() {
+        value /= step;
+        unit += 1;
+    }
+    let decimals = match value {
+        v if v >= 100.0 => 0,
+        v if v >= 10.0 => 1,
+        _ => 2,
+    };
+    format!("{:.*}{}", decimals, value, units[unit])
+}
+
+// Parses `4096`, `4k` or `1m`
+fn parse_size(spec: &str) -> Option<usize> {
+    let lower = spec.to_ascii_lowercase();
+    let (digits, scale) = match lower.as_bytes().last()? {
+        b'k' => (&lower[..lower.len() - 1], 1 << 10),
+        b'm' => (&lower[..lower.len() - 1], 1 << 20),
+        _ => (&lower[..], 1),
+    };
+    let size = digits.parse::<usize>().ok()?.checked_mul(scale)?;
+    (size > 0).then_some(size)
+}
+
+// xorshift64*: the buffer only needs to defeat trivially repetitive input
+fn random_bytes(len: usize) -> Vec<u8> {
+    let mut state = 0x9e37_79b9_7f4a_7c15u64;
+    let mut bytes = Vec::with_capacity(len + 8);
+    while bytes.len() < len {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        bytes.extend_from_slice(&state.wrapping_mul(0x2545_f491_4f6c_dd1d).to_le_bytes());
+    }
+    bytes.truncate(len);
+    bytes
+}
+
+// The host description and every measurement as JSON, without a serializer dependency
+fn to_json(results: &[Measurement]) -> String {
+    let threads = std::thread::available_parallelism().map_or(1, |n| n.get());
+    let mut out = String::new();
+    let _ = write!(
+        out,
+        "{{\"host\":{{\"os\":\"{}\",\"arch\":\"{}\",\"threads\":{},\"cpu\":{}}},\"results\":[",
+        std::env::consts::OS,
+        std::env::consts::ARCH,
+        threads,
+        cpu_model().map_or("null".to_string(), |m| json_string(&m)),
+    );
+    for (i, m) in results.iter().enumerate() {
+        if i > 0 {
+            out.push(',');
+        }
+        let _ = write!(
+            out,
+            "{{\"algorithm\":\"{}\",\"bits\":{},\"size\":{},\"hashes\":{},\"seconds\":{:.6},\
+             \"gb_per_sec\":{:.4},\"keys_per_sec\":{:.1},\"cycles_per_byte\":{},\
+             \"latency_ns\":{{\"p50\":{:.2},\"p90\":{:.2},\"p99\":{:.2},\"p999\":{:.2},\"max\":{:.2}}}}}",
+            m.algorithm.name(),
+            m.algorithm.bits(),
+            m.size,
+            m.hashes,
+            m.seconds,
+            m.bytes_per_sec() / 1e9,
+            m.keys_per_sec(),
+            m.cycles_per_byte()
+                .map_or("null".to_string(), |c| format!("{:.4}", c)),
+            m.percentile(0.5),
+            m.percentile(0.9),
+            m.percentile(0.99),
+            m.percentile(0.999),
+            m.percentile(1.0),
+        );
+    }
+    out.push_str("]}\n");
+    out
+}
+
+fn json_string(s: &str) -> String {
+    let mut out = String::from("\"");
+    for c in s.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            c if (c as u32) < 0x20 => {
+                let _ = write!(out, "\\u{:04x}", c as u32);
+            }
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+    out
+}
+
+// The CPU model name from /proc/cpuinfo, where there is one
+fn cpu_model() -> Option<String> {
+    let info = std::fs::read_to_string("/proc/cpuinfo").ok()?;
+    info.lines()
+        .find(|l| l.starts_with("model name"))
+        .and_then(|l| l.split_once(':'))
+        .map(|(_, model)| model.trim().to_string())
+}
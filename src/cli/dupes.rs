@@ -0,0 +1,75 @@
+// `simplehash dupes`: find duplicate files below one or more directories.
+
+use super::{Args, Format, OUTPUT_BUFFER, fail, usage_error, write_hash};
+use simplehash::duplicates::DuplicateFinder;
+use std::io::{self, BufWriter, Write};
+use std::time::Instant;
+
+const USAGE: &str = "\
+Usage: simplehash dupes [OPTIONS] DIR...
+
+Finds files with identical contents below the given directories and prints each group as
+`FINGERPRINT  SIZE  PATH` lines, largest files first, with a blank line between groups.
+Files are narrowed down by size, then by a hash of their first and last 4 KiB, and only the
+remaining candidates are read whole and fingerprinted with farm-fp128. A summary of the
+bytes read goes to standard error.
+
+Options:
+  -j, --threads N        Worker threads (default: all cores)
+      --min-size BYTES   Ignore smaller files; 0 includes empty files (default: 1)
+";
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let threads = args.parsed(&["-j", "--threads"]).unwrap_or(0);
+    let min_size = args.parsed(&["--min-size"]).unwrap_or(1);
+    let dirs = args.finish();
+    if dirs.is_empty() {
+        usage_error("expected at least one directory", USAGE);
+    }
+
+    let started = Instant::now();
+    let report = DuplicateFinder::new()
+        .min_size(min_size)
+        .threads(threads)
+        .find(&dirs)
+        .unwrap_or_else(|err| fail(err));
+    let elapsed = started.elapsed();
+
+    let result = (|| -> io::Result<()> {
+        let mut out = BufWriter::with_capacity(OUTPUT_BUFFER, io::stdout().lock());
+        for (i, group) in report.groups.iter().enumerate() {
+            if i > 0 {
+                writeln!(out)?;
+            }
+            for path in &group.paths {
+                write_hash(&mut out, group.fingerprint, 128, Format::Hex)?;
+                writeln!(out, "  {}  {}", group.size, path.display())?;
+            }
+        }
+        out.flush()
+    })();
+    match result {
+        Ok(()) => {}
+        Err(err) if err.kind() == io::ErrorKind::BrokenPipe => return,
+        Err(err) => fail(err),
+    }
+
+    for (path, err) in &report.errors {
+        eprintln!("simplehash: {}: {}", path.display(), err);
+    }
+    let stats = report.stats;
+    eprintln!(
+        "{} files, {} duplicate groups, {} bytes in extra copies; read {} of {} bytes ({:.2}%) in {:?}",
+        stats.files,
+        report.groups.len(),
+        report.wasted_bytes(),
+        stats.bytes_read,
+        stats.total_bytes,
+        stats.bytes_read as f64 * 100.0 / stats.total_bytes.max(1) as f64,
+        elapsed
+    );
+    if !report.errors.is_empty() {
+        std::process::exit(1);
+    }
+}
@@ -0,0 +1,91 @@
+// `simplehash file`: hash whole files, memory-mapping regular files and streaming pipes.
+
+use super::{Args, Format, OUTPUT_BUFFER, fail, parse_algorithms, usage_error, write_hash};
+use simplehash::digest::{self, Algorithm};
+use std::io::{self, BufWriter, Write};
+
+const USAGE: &str = "\
+Usage: simplehash file [OPTIONS] [FILE...]
+
+Hashes each FILE (or standard input when FILE is omitted or `-`). Regular files are
+memory-mapped and read once for all streaming algorithms; pipes are read in 1 MiB blocks.
+
+Options:
+  -a, --algorithm ALGS   Comma-separated algorithms, or `all` (default: murmur3-128)
+  -f, --format FORMAT    hex (default), dec, or binary (raw little-endian hash bytes)
+      --populate         Fault the whole mapping in up front (MAP_POPULATE)
+
+With one algorithm each line is `HASH  FILE`; with several it is `ALG (FILE) = HASH`.
+";
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let algorithms = args
+        .value(&["-a", "--algorithm"])
+        .map(|spec| parse_algorithms(&spec, USAGE))
+        .unwrap_or_else(|| vec![Algorithm::Murmur3_128]);
+    let format = args
+        .value(&["-f", "--format"])
+        .map(|name| Format::parse(&name, USAGE))
+        .unwrap_or(Format::Hex);
+    let populate = args.flag(&["--populate"]);
+    let mut paths = args.finish();
+    if paths.is_empty() {
+        paths.push("-".to_string());
+    }
+    if paths.iter().filter(|p| *p == "-").count() > 1 {
+        usage_error("standard input can only be hashed once", USAGE);
+    }
+
+    let stdout = io::stdout();
+    let mut out = BufWriter::with_capacity(OUTPUT_BUFFER, stdout.lock());
+    let mut failed = false;
+    for path in &paths {
+        let hashes = if path == "-" {
+            digest::hash_reader(io::stdin().lock(), &algorithms)
+        } else {
+            digest::hash_file(path, &algorithms, populate)
+        };
+        match hashes {
+            Ok(hashes) => {
+                if let Err(err) = write_line(&mut out, path, &algorithms, &hashes, format) {
+                    fail(err);
+                }
+            }
+            Err(err) => {
+                eprintln!("simplehash: {}: {}", path, err);
+                failed = true;
+            }
+        }
+    }
+    if let Err(err) = out.flush() {
+        fail(err);
+    }
+    if failed {
+        std::process::exit(1);
+    }
+}
+
+fn write_line<W: Write>(
+    out: &mut W,
+    path: &str,
+    algorithms: &[Algorithm],
+    hashes: &[u128],
+    format: Format,
+) -> io::Result<()> {
+    for (algorithm, &hash) in algorithms.iter().zip(hashes) {
+        match format {
+            Format::Binary => write_hash(out, hash, algorithm.bits(), format)?,
+            _ if algorithms.len() == 1 => {
+                write_hash(out, hash, algorithm.bits(), format)?;
+                writeln!(out, "  {}", path)?;
+            }
+            _ => {
+                write!(out, "{} ({}) = ", algorithm, path)?;
+                write_hash(out, hash, algorithm.bits(), format)?;
+                writeln!(out)?;
+            }
+        }
+    }
+    Ok(())
+}
@@ -0,0 +1,78 @@
+// `simplehash lines`: hash every line of standard input (or a file) in one pass.
+
+use super::{
+    Args, Format, OUTPUT_BUFFER, encode_hash, fail, map_from_position, parse_algorithms,
+    stdin_file, usage_error,
+};
+use simplehash::digest::Algorithm;
+use simplehash::lines::LineHasher;
+use std::fs::File;
+use std::io::{self, BufWriter, Write};
+
+const USAGE: &str = "\
+Usage: simplehash lines [OPTIONS] [FILE]
+
+Hashes each `\\n`-terminated line of FILE (or standard input when FILE is omitted or `-`)
+and writes one hash per line, in input order. The newline is not part of the key; a
+carriage return before it is. Regular files, including a redirected standard input, are
+memory-mapped; pipes are read in 8 MiB blocks.
+
+Options:
+  -a, --algorithm ALG    Hash algorithm (default: murmur3-128)
+  -f, --format FORMAT    hex (default), dec, or binary (packed little-endian hashes with no
+                         separators, 4, 8 or 16 bytes each)
+  -j, --threads N        Worker threads, 0 for all cores (default: 1); output order is kept
+";
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let algorithm = match args.value(&["-a", "--algorithm"]) {
+        Some(spec) => match parse_algorithms(&spec, USAGE)[..] {
+            [algorithm] => algorithm,
+            _ => usage_error("lines takes a single algorithm", USAGE),
+        },
+        None => Algorithm::Murmur3_128,
+    };
+    let format = args
+        .value(&["-f", "--format"])
+        .map(|name| Format::parse(&name, USAGE))
+        .unwrap_or(Format::Hex);
+    let threads = args.parsed(&["-j", "--threads"]).unwrap_or(1);
+    let path = match &args.finish()[..] {
+        [] => None,
+        [path] if path == "-" => None,
+        [path] => Some(path.clone()),
+        _ => usage_error("expected at most one file", USAGE),
+    };
+    let name = path.as_deref().unwrap_or("standard input");
+    let input = match &path {
+        Some(path) => File::open(path).map(Some),
+        None => stdin_file(),
+    }
+    .unwrap_or_else(|err| fail(format!("{}: {}", name, err)));
+
+    let bits = algorithm.bits();
+    let hasher = LineHasher::new().algorithm(algorithm).threads(threads);
+    let encode = |hash, buf: &mut Vec<u8>| {
+        encode_hash(buf, hash, bits, format);
+        if format != Format::Binary {
+            buf.push(b'\n');
+        }
+    };
+    let mut out = BufWriter::with_capacity(OUTPUT_BUFFER, io::stdout().lock());
+    let sink = |bytes: &[u8]| out.write_all(bytes);
+    let result = match input {
+        // Regular files, including redirected standard input, are hashed in place
+        Some(file) if file.metadata().is_ok_and(|m| m.is_file()) => map_from_position(file)
+            .and_then(|(map, offset)| hasher.hash_slice(&map.as_slice()[offset..], encode, sink)),
+        Some(file) => hasher.hash_reader(file, encode, sink),
+        None => hasher.hash_reader(io::stdin().lock(), encode, sink),
+    }
+    .and_then(|_| out.flush());
+    if let Err(err) = result {
+        // A closed pipe (`| head`) is a normal way to stop
+        if err.kind() != io::ErrorKind::BrokenPipe {
+            fail(format!("{}: {}", name, err));
+        }
+    }
+}
@@ -0,0 +1,100 @@
+// `simplehash manifest`: keep a binary manifest of a tree and print what changed since the last run.
+
+use super::{Args, OUTPUT_BUFFER, fail, usage_error};
+use simplehash::manifest::{ChangeKind, Manifest, ManifestBuilder};
+use std::io::{self, BufWriter, Write};
+use std::path::Path;
+use std::time::Instant;
+
+const USAGE: &str = "\
+Usage: simplehash manifest --manifest FILE [OPTIONS] DIR
+
+Fingerprints every regular file below DIR with farm-fp128 and stores path, size, mtime,
+inode and fingerprint in FILE, a compact binary manifest. When FILE already exists only files
+whose size, mtime or inode changed are read again. Prints the changed files as `A PATH`
+(added), `M PATH` (modified) or `D PATH` (deleted) lines sorted by path; a first run lists
+every file as added. A summary goes to standard error.
+
+Options:
+  -m, --manifest FILE    Manifest to read and update (required)
+  -j, --threads N        Worker threads (default: all cores)
+  -n, --dry-run          Print the changes without writing the manifest
+";
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let manifest_path = args
+        .value(&["-m", "--manifest"])
+        .unwrap_or_else(|| usage_error("--manifest is required", USAGE));
+    let threads = args.parsed(&["-j", "--threads"]).unwrap_or(0);
+    let dry_run = args.flag(&["-n", "--dry-run"]);
+    let [dir] = &args.finish()[..] else {
+        usage_error("expected one directory", USAGE);
+    };
+
+    let started = Instant::now();
+    let previous = match Manifest::load(&manifest_path) {
+        Ok(previous) => previous,
+        Err(err) if err.kind() == io::ErrorKind::NotFound => Manifest::default(),
+        Err(err) => fail(format!("{}: {}", manifest_path, err)),
+    };
+    let mut builder = ManifestBuilder::new().threads(threads);
+    // A manifest kept inside the tree must not list itself
+    if let Some(relative) = relative_to(Path::new(&manifest_path), Path::new(dir)) {
+        builder = builder.exclude(relative);
+    }
+    let update = builder
+        .update(dir, &previous)
+        .unwrap_or_else(|err| fail(format!("{}: {}", dir, err)));
+    if !dry_run {
+        update
+            .manifest
+            .save(&manifest_path)
+            .unwrap_or_else(|err| fail(format!("{}: {}", manifest_path, err)));
+    }
+    let elapsed = started.elapsed();
+
+    let result = (|| -> io::Result<()> {
+        let mut out = BufWriter::with_capacity(OUTPUT_BUFFER, io::stdout().lock());
+        for (kind, path) in &update.changes {
+            let tag = match kind {
+                ChangeKind::Added => 'A',
+                ChangeKind::Modified => 'M',
+                ChangeKind::Removed => 'D',
+            };
+            writeln!(out, "{} {}", tag, path.display())?;
+        }
+        out.flush()
+    })();
+    match result {
+        Ok(()) => {}
+        Err(err) if err.kind() == io::ErrorKind::BrokenPipe => {}
+        Err(err) => fail(err),
+    }
+
+    for (path, err) in &update.errors {
+        eprintln!("simplehash: {}: {}", path.display(), err);
+    }
+    eprintln!(
+        "{} files, {} changed; hashed {} files ({} bytes) in {:?}",
+        update.manifest.entries.len(),
+        update.changes.len(),
+        update.hashed_files,
+        update.hashed_bytes,
+        elapsed
+    );
+    if !update.errors.is_empty() {
+        std::process::exit(1);
+    }
+}
+
+// The path of `file` below `dir`, if it is inside it
+fn relative_to(file: &Path, dir: &Path) -> Option<std::path::PathBuf> {
+    let dir = dir.canonicalize().ok()?;
+    let parent = match file.parent() {
+        Some(parent) if !parent.as_os_str().is_empty() => parent,
+        _ => Path::new("."),
+    };
+    let file = parent.canonicalize().ok()?.join(file.file_name()?);
+    file.strip_prefix(&dir).ok().map(Path::to_path_buf)
+}
@@ -0,0 +1,256 @@
+// Shared helpers for the `simplehash` subcommands: argument parsing, algorithm selection and
+// hash output. Arguments are parsed by hand to keep the crate free of CLI dependencies.
+
+pub mod bench;
+pub mod dupes;
+pub mod file;
+pub mod lines;
+pub mod manifest;
+pub mod records;
+pub mod shard;
+pub mod tree;
+
+use simplehash::digest::Algorithm;
+use simplehash::mmap::MappedFile;
+use std::fmt;
+use std::fs::File;
+use std::io::{self, Seek, Write};
+use std::process;
+
+/// Buffer size for writers that emit one hash per input item
+pub const OUTPUT_BUFFER: usize = 1 << 20;
+
+/// Prints `message` and exits with status 1.
+pub fn fail(message: impl fmt::Display) -> ! {
+    eprintln!("error: {}", message);
+    process::exit(1);
+}
+
+/// Prints a usage error followed by `usage` and exits with status 2.
+pub fn usage_error(message: impl fmt::Display, usage: &str) -> ! {
+    eprintln!("error: {}", message);
+    eprintln!();
+    eprint!("{}", usage);
+    process::exit(2);
+}
+
+/// The arguments of one subcommand, consumed option by option.
+///
+/// Options may be written `--name value` or `--name=value`. Whatever is left after the
+/// subcommand has taken its options must be positional; `--` ends option parsing.
+pub struct Args {
+    args: Vec<String>,
+    usage: &'static str,
+}
+
+impl Args {
+    pub fn new(args: &[String], usage: &'static str) -> Self {
+        if args.iter().any(|a| a == "-h" || a == "--help") {
+            print!("{}", usage);
+            process::exit(0);
+        }
+        Self {
+            args: args.to_vec(),
+            usage,
+        }
+    }
+
+    // Index of the `--` terminator, or the end
+    fn options_end(&self) -> usize {
+        self.args
+            .iter()
+            .position(|a| a == "--")
+            .unwrap_or(self.args.len())
+    }
+
+    /// Removes every occurrence of a boolean option and returns whether it was present.
+    pub fn flag(&mut self, names: &[&str]) -> bool {
+        let end = self.options_end();
+        let before = self.args.len();
+        let mut i = 0;
+        self.args.retain(|a| {
+            i += 1;
+            i > end || !names.contains(&a.as_str())
+        });
+        self.args.len() != before
+    }
+
+    /// Removes an option with a value and returns the value of its last occurrence.
+    pub fn value(&mut self, names: &[&str]) -> Option<String> {
+        let mut found = None;
+        let mut i = 0;
+        while i < self.options_end() {
+            let arg = &self.args[i];
+            if names.contains(&arg.as_str()) {
+                if i + 1 >= self.options_end() {
+                    usage_error(format!("{} needs a value", arg), self.usage);
+                }
+                found = Some(self.args.remove(i + 1));
+                self.args.remove(i);
+            } else if let Some(value) = names
+                .iter()
+                .find_map(|n| arg.strip_prefix(n).and_then(|rest| rest.strip_prefix('=')))
+            {
+                found = Some(value.to_string());
+                self.args.remove(i);
+            } else {
+                i += 1;
+            }
+        }
+        found
+    }
+
+    /// Removes an option and parses its value, exiting with a usage error if it is invalid.
+    pub fn parsed<T: std::str::FromStr>(&mut self, names: &[&str]) -> Option<T> {
+        let usage = self.usage;
+        self.value(names).map(|v| {
+            v.parse().unwrap_or_else(|_| {
+                usage_error(format!("invalid value for {}: {}", names[0], v), usage)
+            })
+        })
+    }
+
+    /// Returns the remaining positional arguments, rejecting unknown options.
+    pub fn finish(mut self) -> Vec<String> {
+        let end = self.options_end();
+        if let Some(unknown) = self.args[..end]
+            .iter()
+            .find(|a| a.starts_with('-') && a.len() > 1)
+        {
+            usage_error(format!("unknown option {}", unknown), self.usage);
+        }
+        if end < self.args.len() {
+            self.args.remove(end);
+        }
+        self.args
+    }
+}
+
+/// Parses a comma-separated list of algorithm names, or `all`.
+pub fn parse_algorithms(spec: &str, usage: &str) -> Vec<Algorithm> {
+    if spec == "all" {
+        return Algorithm::ALL.to_vec();
+    }
+    spec.split(',')
+        .map(|name| {
+            Algorithm::from_name(name.trim()).unwrap_or_else(|| {
+                let known: Vec<&str> = Algorithm::ALL.iter().map(|a| a.name()).collect();
+                usage_error(
+                    format!("unknown algorithm {} (known: {})", name, known.join(", ")),
+                    usage,
+                )
+            })
+        })
+        .collect()
+}
+
+/// How hashes are written.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Format {
+    /// Lowercase hex, zero-padded to the hash width.
+    Hex,
+    /// Unsigned decimal.
+    Decimal,
+    /// Raw little-endian bytes of the hash width, with no separators.
+    Binary,
+}
+
+impl Format {
+    pub fn parse(name: &str, usage: &str) -> Self {
+        match name {
+            "hex" => Format::Hex,
+            "dec" | "decimal" => Format::Decimal,
+            "bin" | "binary" | "raw" => Format::Binary,
+            _ => usage_error(
+                format!("unknown format {} (use hex, dec or binary)", name),
+                usage,
+            ),
+        }
+    }
+}
+
+/// Writes `value`, a hash of `bits` bits, without any separator.
+#[inline]
+pub fn write_hash<W: Write>(out: &mut W, value: u128, bits: u32, format: Format) -> io::Result<()> {
+    match format {
+        Format::Hex => write!(out, "{:01$x}", value, bits as usize / 4),
+        Format::Decimal => write!(out, "{}", value),
+        Format::Binary => out.write_all(&value.to_le_bytes()[..bits as usize / 8]),
+    }
+}
+
+// Lowercase hex digits of every byte value
+const HEX_PAIRS: [[u8; 2]; 256] = {
+    const DIGITS: &[u8; 16] = b"0123456789abcdef";
+    let mut table = [[0u8; 2]; 256];
+    let mut i = 0;
+    while i < 256 {
+        table[i] = [DIGITS[i >> 4], DIGITS[i & 0xf]];
+        i += 1;
+    }
+    table
+};
+
+/// Appends `value`, a hash of `bits` bits, to `out` without any separator.
+///
+/// Produces the same bytes as [`write_hash`] without going through `fmt`, for output of one
+/// hash per input line where formatting would otherwise cost more than the hashing.
+#[inline]
+pub fn encode_hash(out: &mut Vec<u8>, value: u128, bits: u32, format: Format) {
+    match format {
+        Format::Hex => {
+            // Two digits per table lookup, least significant byte last
+            let mut buf = [0u8; 32];
+            let bytes = bits as usize / 8;
+            for (i, pair) in buf[..2 * bytes].chunks_exact_mut(2).rev().enumerate() {
+                pair.copy_from_slice(&HEX_PAIRS[(value >> (8 * i)) as u8 as usize]);
+            }
+            out.extend_from_slice(&buf[..2 * bytes]);
+        }
+        Format::Decimal => {
+            let mut buf = [0u8; 39];
+            let mut start = buf.len();
+            // 128-bit division is slow, so only the digits above 64 bits use it
+            let mut wide = value;
+            while wide > u64::MAX as u128 {
+                start -= 1;
+                buf[start] = b'0' + (wide % 10) as u8;
+                wide /= 10;
+            }
+            let mut rest = wide as u64;
+            loop {
+                start -= 1;
+                buf[start] = b'0' + (rest % 10) as u8;
+                rest /= 10;
+                if rest == 0 {
+                    break;
+                }
+            }
+            out.extend_from_slice(&buf[start..]);
+        }
+        Format::Binary => out.extend_from_slice(&value.to_le_bytes()[..bits as usize / 8]),
+    }
+}
+
+/// Returns standard input as a `File` where the platform allows, so a redirected file can be
+/// memory-mapped instead of read.
+#[cfg(unix)]
+pub fn stdin_file() -> io::Result<Option<File>> {
+    use std::os::fd::AsFd;
+    Ok(Some(File::from(io::stdin().as_fd().try_clone_to_owned()?)))
+}
+
+#[cfg(not(unix))]
+pub fn stdin_file() -> io::Result<Option<File>> {
+    Ok(None)
+}
+
+/// Maps a regular file and returns its current read position, so input that a previous
+/// command in the shell has partly consumed is picked up where it left off.
+pub fn map_from_position(mut file: File) -> io::Result<(MappedFile, usize)> {
+    let offset = file.stream_position()?;
+    let map = MappedFile::map(&file)?;
+    map.advise_sequential()?;
+    let offset = usize::try_from(offset).unwrap_or(usize::MAX).min(map.len());
+    Ok((map, offset))
+}
@@ -0,0 +1,156 @@
+// `simplehash shard`: split line-delimited records into N files by a hashed key.
+
+use super::{Args, fail, map_from_position, stdin_file, usage_error};
+use simplehash::city::CityHasher64;
+use simplehash::fnv::Fnv1aHasher64;
+use simplehash::murmur::MurmurHasher64;
+use simplehash::shard::{Routing, ShardKey, Sharder};
+use std::fs::File;
+use std::hash::{BuildHasher, BuildHasherDefault, Hasher};
+use std::io::{self, BufWriter, Write};
+use std::time::Instant;
+
+const USAGE: &str = "\
+Usage: simplehash shard --n N [OPTIONS] [FILE]
+
+Splits the `\\n`-terminated lines of FILE (or standard input when FILE is omitted or `-`)
+into N files named PREFIX-00000, PREFIX-00001, ... by a hash of each line or of one field.
+Every file keeps its lines in input order. With rendezvous routing a line with key K lands in
+shard `RendezvousHasher::select_index(&K, &[0, 1, .., N - 1])` of the library, with K hashed
+as a byte slice by the same hasher, so services routing keys that way find them here.
+
+Options:
+  -n, --n N              Number of shards (required)
+  -b, --by KEY           `line` (default), or the 1-based number of the field to hash
+  -d, --delimiter CHAR   Field delimiter, a single byte or `\\t` (default: tab)
+  -m, --method METHOD    rendezvous (default; O(N) per line) or jump (O(log N) per line)
+      --hasher HASHER    fnv1a-64, murmur3-64 (default) or city64
+  -o, --output PREFIX    Prefix of the shard files (default: shard)
+  -j, --threads N        Worker threads for parsing and routing, 0 for all cores (default: 1)
+  -v, --verbose          Print the line count and throughput to standard error
+";
+
+// Buffer per shard file; many shards share the page cache, so this is kept small
+const SHARD_BUFFER: usize = 64 << 10;
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let shards: usize = args
+        .parsed(&["-n", "--n"])
+        .unwrap_or_else(|| usage_error("--n is required", USAGE));
+    let by = args.value(&["-b", "--by"]);
+    let delimiter = match args.value(&["-d", "--delimiter"]).as_deref() {
+        None | Some("\\t") => b'\t',
+        Some(d) if d.len() == 1 => d.as_bytes()[0],
+        Some(d) => usage_error(format!("invalid delimiter {:?}", d), USAGE),
+    };
+    let key = match by.as_deref() {
+        None | Some("line") => ShardKey::Line,
+        Some(field) => match field.parse() {
+            Ok(index) if index > 0 => ShardKey::Field { index, delimiter },
+            _ => usage_error(format!("invalid --by {}", field), USAGE),
+        },
+    };
+    let routing = match args.value(&["-m", "--method"]).as_deref() {
+        None | Some("rendezvous") => Routing::Rendezvous,
+        Some("jump") => Routing::Jump,
+        Some(method) => usage_error(format!("unknown method {}", method), USAGE),
+    };
+    let hasher = args
+        .value(&["--hasher"])
+        .unwrap_or_else(|| "murmur3-64".to_string());
+    let prefix = args
+        .value(&["-o", "--output"])
+        .unwrap_or_else(|| "shard".to_string());
+    let threads = args.parsed(&["-j", "--threads"]).unwrap_or(1);
+    let verbose = args.flag(&["-v", "--verbose"]);
+    let path = match &args.finish()[..] {
+        [] => None,
+        [path] if path == "-" => None,
+        [path] => Some(path.clone()),
+        _ => usage_error("expected at most one file", USAGE),
+    };
+    if shards == 0 || u32::try_from(shards).is_err() {
+        usage_error("--n must be between 1 and 2^32 - 1", USAGE);
+    }
+
+    let options = Options {
+        shards,
+        key,
+        routing,
+        threads,
+        prefix,
+        path,
+        verbose,
+    };
+    match hasher.as_str() {
+        "fnv1a-64" => split(BuildHasherDefault::<Fnv1aHasher64>::default(), &options),
+        "murmur3-64" => split(BuildHasherDefault::<MurmurHasher64>::default(), &options),
+        "city64" => split(BuildHasherDefault::<CityHasher64>::default(), &options),
+        other => usage_error(format!("unknown hasher {}", other), USAGE),
+    }
+}
+
+struct Options {
+    shards: usize,
+    key: ShardKey,
+    routing: Routing,
+    threads: usize,
+    prefix: String,
+    path: Option<String>,
+    verbose: bool,
+}
+
+fn split<H, B>(build_hasher: B, options: &Options)
+where
+    H: Hasher + Clone + Sync,
+    B: BuildHasher<Hasher = H> + Clone + Sync,
+{
+    let name = options.path.as_deref().unwrap_or("standard input");
+    let input = match &options.path {
+        Some(path) => File::open(path).map(Some),
+        None => stdin_file(),
+    }
+    .unwrap_or_else(|err| fail(format!("{}: {}", name, err)));
+
+    let mut outputs: Vec<_> = (0..options.shards)
+        .map(|shard| {
+            let path = format!("{}-{:05}", options.prefix, shard);
+            let file = File::create(&path).unwrap_or_else(|err| fail(format!("{}: {}", path, err)));
+            BufWriter::with_capacity(SHARD_BUFFER, file)
+        })
+        .collect();
+
+    let started = Instant::now();
+    let sharder = Sharder::new(build_hasher, options.shards)
+        .key(options.key)
+        .routing(options.routing)
+        .threads(options.threads);
+    let sink = |shard: usize, lines: &[u8]| outputs[shard].write_all(lines);
+    let result = match input {
+        // Regular files, including redirected standard input, are split in place
+        Some(file) if file.metadata().is_ok_and(|m| m.is_file()) => map_from_position(file)
+            .and_then(|(map, offset)| sharder.split_slice(&map.as_slice()[offset..], sink)),
+        Some(file) => sharder.split_reader(file, sink),
+        None => sharder.split_reader(io::stdin().lock(), sink),
+    }
+    .and_then(|lines| {
+        outputs.iter_mut().try_for_each(|out| out.flush())?;
+        Ok(lines)
+    });
+    match result {
+        Ok(lines) => {
+            if options.verbose {
+                let elapsed = started.elapsed();
+                eprintln!(
+                    "{} lines into {} shards in {:.3?}, {:.0} lines/s",
+                    lines,
+                    options.shards,
+                    elapsed,
+                    lines as f64 / elapsed.as_secs_f64()
+                );
+            }
+        }
+        Err(err) => fail(format!("{}: {}", name, err)),
+    }
+}
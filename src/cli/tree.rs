@@ -0,0 +1,86 @@
+// `simplehash tree`: hash every file below a directory into a sorted manifest.
+
+use super::{Args, Format, OUTPUT_BUFFER, fail, parse_algorithms, usage_error, write_hash};
+use simplehash::digest::Algorithm;
+use simplehash::tree_hash::TreeHasher;
+use std::io::{self, BufWriter, Write};
+use std::time::Instant;
+
+const USAGE: &str = "\
+Usage: simplehash tree [OPTIONS] DIR
+
+Hashes every regular file below DIR in parallel and prints `HASH  SIZE  PATH` lines sorted
+by path, followed by a summary with the whole-tree root digest on standard error. Files
+larger than the chunk size get a tree digest: the hash of their chunk hashes.
+
+Options:
+  -a, --algorithm ALG    Hash algorithm (default: farm-fp128)
+  -j, --threads N        Worker threads (default: all cores)
+      --chunk-size BYTES Chunk size for large files (default: 16777216)
+      --root             Print only the root digest
+";
+
+pub fn run(args: &[String]) {
+    let mut args = Args::new(args, USAGE);
+    let algorithm = match args.value(&["-a", "--algorithm"]) {
+        Some(spec) => match parse_algorithms(&spec, USAGE)[..] {
+            [algorithm] => algorithm,
+            _ => usage_error("tree takes a single algorithm", USAGE),
+        },
+        None => Algorithm::FarmFingerprint128,
+    };
+    let threads = args.parsed(&["-j", "--threads"]).unwrap_or(0);
+    let chunk_size: u64 = args.parsed(&["--chunk-size"]).unwrap_or(16 << 20);
+    let root_only = args.flag(&["--root"]);
+    let [dir] = &args.finish()[..] else {
+        usage_error("expected one directory", USAGE);
+    };
+    if chunk_size == 0 {
+        usage_error("--chunk-size must be positive", USAGE);
+    }
+
+    let started = Instant::now();
+    let manifest = TreeHasher::new()
+        .algorithm(algorithm)
+        .chunk_size(chunk_size)
+        .threads(threads)
+        .hash(dir)
+        .unwrap_or_else(|err| fail(format!("{}: {}", dir, err)));
+    let elapsed = started.elapsed();
+
+    let bits = algorithm.bits();
+    let result = (|| -> io::Result<()> {
+        let mut out = BufWriter::with_capacity(OUTPUT_BUFFER, io::stdout().lock());
+        if root_only {
+            write_hash(&mut out, manifest.root, bits, Format::Hex)?;
+            writeln!(out)?;
+        } else {
+            for entry in &manifest.entries {
+                write_hash(&mut out, entry.hash, bits, Format::Hex)?;
+                writeln!(out, "  {}  {}", entry.size, entry.path.display())?;
+            }
+        }
+        out.flush()
+    })();
+    if let Err(err) = result {
+        fail(err);
+    }
+
+    for (path, err) in &manifest.errors {
+        eprintln!("simplehash: {}: {}", path.display(), err);
+    }
+    if !root_only {
+        let bytes = manifest.total_bytes();
+        eprintln!(
+            "{} files, {} bytes in {:?} ({:.1} MB/s)",
+            manifest.entries.len(),
+            bytes,
+            elapsed,
+            bytes as f64 / elapsed.as_secs_f64().max(1e-9) / 1e6
+        );
+        eprintln!("root {:01$x}", manifest.root, bits as usize / 4);
+    }
+    if !manifest.errors.is_empty() {
+        std::process::exit(1);
+    }
+}
@@ -0,0 +1,668 @@
+use crate::murmur::MurmurHasher64;
+use std::borrow::Borrow;
+use std::fmt;
+use std::hash::Hash;
+use std::mem::MaybeUninit;
+
+// Slots per bucket; one bucket's tags fill exactly one u64
+const SLOTS: usize = 8;
+
+// Upper bound on buckets visited by the breadth-first search for a cuckoo path
+const MAX_SEARCH: usize = 512;
+
+// Load factor at which the table doubles. Breadth-first cuckoo paths can push a table with
+// eight-slot buckets past 99%, but inserts slow down sharply in the last few percent.
+const MAX_LOAD: f64 = 0.95;
+
+// A failed insert below this load factor is caused by keys whose hashes collide in both
+// buckets, not by a full table, so growing would not help and the entry goes to the stash
+const MIN_GROW_LOAD: f64 = 0.5;
+
+const LOW7: u64 = 0x7f7f_7f7f_7f7f_7f7f;
+const HIGH: u64 = 0x8080_8080_8080_8080;
+
+/// A bucketized cuckoo hash map for read-heavy lookup tables.
+///
+/// Every key hashes (once, with 128-bit MurmurHash3) to two candidate buckets of eight slots
+/// and an 8-bit tag. A lookup compares the tag against a bucket's eight slots in one SIMD
+/// operation and only touches the keys whose tags match, checking the alternate bucket only
+/// when the key is not in its primary one. That is at most two bucket probes no matter how
+/// full the table is. Tags live in their own dense array, one `u64` per bucket, so the
+/// filtering step rarely misses the cache.
+///
+/// Inserts that find both buckets full move existing entries to their alternate buckets
+/// along the shortest cuckoo path found by breadth-first search, so the table fills to 95%
+/// before it has to grow.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::cuckoo::CuckooMap;
+///
+/// let mut map = CuckooMap::new();
+/// map.insert("alpha", 1);
+/// map.insert("beta", 2);
+/// assert_eq!(map.get("alpha"), Some(&1));
+/// assert_eq!(map.insert("alpha", 3), Some(1));
+/// assert_eq!(map.remove("beta"), Some(2));
+/// assert_eq!(map.len(), 1);
+/// ```
+pub struct CuckooMap<K, V> {
+    // Byte `i` of each word is the tag of the bucket's slot `i`; `0` marks an empty slot
+    tags: Vec<u64>,
+    // `SLOTS` entries per bucket, initialized exactly where the tag is non-zero
+    slots: Vec<MaybeUninit<(K, V)>>,
+    // Overflow for entries that no cuckoo path can place, almost always empty
+    stash: Vec<(K, V)>,
+    mask: usize,
+    len: usize,
+}
+
+#[derive(Clone, Copy)]
+struct Location {
+    primary: usize,
+    alternate: usize,
+    tag: u8,
+}
+
+#[derive(Clone, Copy)]
+struct Step {
+    bucket: usize,
+    // Index of the step this one was reached from, `usize::MAX` for the two start buckets
+    parent: usize,
+    // Slot in the parent's bucket whose entry moves into this bucket
+    slot: usize,
+}
+
+impl<K: Hash + Eq, V> CuckooMap<K, V> {
+    /// Creates an empty map.
+    pub fn new() -> Self {
+        Self::with_buckets(2)
+    }
+
+    /// Creates an empty map that can hold `capacity` entries without growing.
+    ///
+    /// # Parameters
+    ///
+    /// * `capacity` - Expected number of entries
+    pub fn with_capacity(capacity: usize) -> Self {
+        let buckets = (capacity as f64 / (MAX_LOAD * SLOTS as f64)).ceil() as usize;
+        Self::with_buckets(buckets.max(2).next_power_of_two())
+    }
+
+    fn with_buckets(buckets: usize) -> Self {
+        let mut slots = Vec::with_capacity(buckets * SLOTS);
+        slots.resize_with(buckets * SLOTS, MaybeUninit::uninit);
+        Self {
+            tags: vec![0; buckets],
+            slots,
+            stash: Vec::new(),
+            mask: buckets - 1,
+            len: 0,
+        }
+    }
+
+    /// Inserts a key-value pair, returning the previous value if the key was present.
+    ///
+    /// # Parameters
+    ///
+    /// * `key` - Key to insert
+    /// * `value` - Value to store under `key`
+    ///
+    /// # Returns
+    ///
+    /// * `Some(old)` if `key` was already present, with its value replaced
+    /// * `None` if `key` is new
+    pub fn insert(&mut self, key: K, value: V) -> Option<V> {
+        let mut location = self.locate(&key);
+        if let Some(slot) = self.get_mut_at(location, &key) {
+            return Some(std::mem::replace(slot, value));
+        }
+
+        self.len += 1;
+        if self.load_factor() > MAX_LOAD {
+            self.resize(self.tags.len() * 2);
+            location = self.locate(&key);
+        }
+        let mut entry = (key, value);
+        loop {
+            match self.place(location, entry) {
+                Ok(()) => return None,
+                Err(rejected) if self.load_factor() < MIN_GROW_LOAD => {
+                    self.stash.push(rejected);
+                    return None;
+                }
+                Err(rejected) => {
+                    self.resize(self.tags.len() * 2);
+                    location = self.locate(&rejected.0);
+                    entry = rejected;
+                }
+            }
+        }
+    }
+
+    /// Returns a reference to the value stored under `key`.
+    ///
+    /// # Parameters
+    ///
+    /// * `key` - Key to look up, in any borrowed form of the map's key type
+    #[inline]
+    pub fn get<Q>(&self, key: &Q) -> Option<&V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        match self.find(self.locate(key), key) {
+            // SAFETY: `find` only returns slots whose tag marks them as initialized
+            Some(index) => Some(unsafe { &self.slots[index].assume_init_ref().1 }),
+            None => self.stash_position(key).map(|i| &self.stash[i].1),
+        }
+    }
+
+    /// Returns a mutable reference to the value stored under `key`.
+    ///
+    /// # Parameters
+    ///
+    /// * `key` - Key to look up, in any borrowed form of the map's key type
+    pub fn get_mut<Q>(&mut self, key: &Q) -> Option<&mut V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        self.get_mut_at(self.locate(key), key)
+    }
+
+    /// Returns `true` if the map contains `key`.
+    ///
+    /// # Parameters
+    ///
+    /// * `key` - Key to look up, in any borrowed form of the map's key type
+    #[inline]
+    pub fn contains_key<Q>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        self.get(key).is_some()
+    }
+
+    /// Removes `key` from the map, returning its value if it was present.
+    ///
+    /// # Parameters
+    ///
+    /// * `key` - Key to remove, in any borrowed form of the map's key type
+    pub fn remove<Q>(&mut self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        if let Some(index) = self.find(self.locate(key), key) {
+            self.set_tag(index, 0);
+            self.len -= 1;
+            // SAFETY: the slot was initialized and its tag is now cleared, so it is read once
+            return Some(unsafe { self.slots[index].assume_init_read().1 });
+        }
+        let position = self.stash_position(key)?;
+        self.len -= 1;
+        Some(self.stash.swap_remove(position).1)
+    }
+
+    #[inline]
+    fn locate<Q: Hash + ?Sized>(&self, key: &Q) -> Location {
+        let mut hasher = MurmurHasher64::default();
+        key.hash(&mut hasher);
+        let hash = hasher.finish_u128();
+        let high = (hash >> 64) as u64;
+
+        let primary = hash as usize & self.mask;
+        let mut alternate = high as usize & self.mask;
+        if alternate == primary {
+            // Two distinct buckets keep every key movable; there are always at least two
+            alternate ^= 1;
+        }
+        Location {
+            primary,
+            alternate,
+            // The top byte is independent of the bucket bits; zero is reserved for empty
+            tag: ((high >> 56) as u8).max(1),
+        }
+    }
+
+    #[inline]
+    fn find<Q>(&self, location: Location, key: &Q) -> Option<usize>
+    where
+        K: Borrow<Q>,
+        Q: Eq + ?Sized,
+    {
+        for bucket in [location.primary, location.alternate] {
+            // SAFETY: bucket indices are masked to the table size
+            let word = unsafe { *self.tags.get_unchecked(bucket) };
+            let mut matches = match_bucket(word, location.tag);
+            while matches != 0 {
+                let index = bucket * SLOTS + matches.trailing_zeros() as usize;
+                if self.key_at(index).borrow() == key {
+                    return Some(index);
+                }
+                matches &= matches - 1;
+            }
+        }
+        None
+    }
+
+    fn get_mut_at<Q>(&mut self, location: Location, key: &Q) -> Option<&mut V>
+    where
+        K: Borrow<Q>,
+        Q: Eq + ?Sized,
+    {
+        match self.find(location, key) {
+            // SAFETY: `find` only returns slots whose tag marks them as initialized
+            Some(index) => Some(unsafe { &mut self.slots[index].assume_init_mut().1 }),
+            None => {
+                let position = self.stash_position(key)?;
+                Some(&mut self.stash[position].1)
+            }
+        }
+    }
+
+    fn stash_position<Q>(&self, key: &Q) -> Option<usize>
+    where
+        K: Borrow<Q>,
+        Q: Eq + ?Sized,
+    {
+        if self.stash.is_empty() {
+            return None;
+        }
+        self.stash.iter().position(|(k, _)| k.borrow() == key)
+    }
+
+    // Stores a new entry in one of its buckets, moving others along a cuckoo path if both
+    // are full. Hands the entry back if no path exists within the search budget.
+    fn place(&mut self, location: Location, entry: (K, V)) -> Result<(), (K, V)> {
+        for bucket in [location.primary, location.alternate] {
+            if let Some(slot) = empty_slot(self.tags[bucket]) {
+                self.write(bucket * SLOTS + slot, location.tag, entry);
+                return Ok(());
+            }
+        }
+
+        let Some(path) = self.search(location) else {
+            return Err(entry);
+        };
+        // Walk back from the bucket with a free slot, shifting each entry one step along
+        let mut step = path[path.len() - 1];
+        let mut free = empty_slot(self.tags[step.bucket]).expect("path ends at a free slot");
+        while step.parent != usize::MAX {
+            let parent = path[step.parent];
+            self.relocate(
+                parent.bucket * SLOTS + step.slot,
+                step.bucket * SLOTS + free,
+            );
+            free = step.slot;
+            step = parent;
+        }
+        self.write(step.bucket * SLOTS + free, location.tag, entry);
+        Ok(())
+    }
+
+    // Breadth-first search from both candidate buckets for the shortest chain of moves that
+    // ends at a bucket with a free slot. Every bucket on the returned path is distinct.
+    fn search(&self, location: Location) -> Option<Vec<Step>> {
+        let mut steps = Vec::with_capacity(MAX_SEARCH);
+        for bucket in [location.primary, location.alternate] {
+            steps.push(Step {
+                bucket,
+                parent: usize::MAX,
+                slot: 0,
+            });
+        }
+
+        let mut head = 0;
+        while head < steps.len() {
+            let bucket = steps[head].bucket;
+            for slot in 0..SLOTS {
+                let other = self.locate(self.key_at(bucket * SLOTS + slot));
+                let next = if other.primary == bucket {
+                    other.alternate
+                } else {
+                    other.primary
+                };
+                let step = Step {
+                    bucket: next,
+                    parent: head,
+                    slot,
+                };
+                if empty_slot(self.tags[next]).is_some() {
+                    steps.push(step);
+                    return Some(steps);
+                }
+                if steps.len() < MAX_SEARCH && !steps.iter().any(|s| s.bucket == next) {
+                    steps.push(step);
+                }
+            }
+            head += 1;
+        }
+        None
+    }
+
+    fn resize(&mut self, buckets: usize) {
+        let mut old = std::mem::replace(self, Self::with_buckets(buckets));
+        self.len = old.len;
+        let stash = std::mem::take(&mut old.stash);
+
+        for bucket in 0..old.tags.len() {
+            let mut occupied = !zero_bytes(old.tags[bucket]) & HIGH;
+            // Cleared before the entries move out so `old` never drops them
+            old.tags[bucket] = 0;
+            while occupied != 0 {
+                let index = bucket * SLOTS + occupied.trailing_zeros() as usize / 8;
+                // SAFETY: the slot was tagged as initialized and is read exactly once
+                let entry = unsafe { old.slots[index].assume_init_read() };
+                self.reinsert(entry);
+                occupied &= occupied - 1;
+            }
+        }
+        for entry in stash {
+            self.reinsert(entry);
+        }
+    }
+
+    fn reinsert(&mut self, entry: (K, V)) {
+        let location = self.locate(&entry.0);
+        if let Err(entry) = self.place(location, entry) {
+            self.stash.push(entry);
+        }
+    }
+}
+
+impl<K, V> CuckooMap<K, V> {
+    /// Returns the number of entries in the map.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns `true` if the map contains no entries.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Returns the number of slots in the table.
+    #[inline]
+    pub fn capacity(&self) -> usize {
+        self.slots.len()
+    }
+
+    /// Returns the fraction of slots in use, between `0.0` and `1.0`.
+    #[inline]
+    pub fn load_factor(&self) -> f64 {
+        self.len as f64 / self.capacity() as f64
+    }
+
+    /// Returns an iterator over the entries in arbitrary order.
+    pub fn iter(&self) -> impl Iterator<Item = (&K, &V)> + '_ {
+        self.tags
+            .iter()
+            .enumerate()
+            .flat_map(|(bucket, &word)| {
+                let occupied = !zero_bytes(word) & HIGH;
+                (0..SLOTS)
+                    .filter(move |slot| occupied & (0x80 << (slot * 8)) != 0)
+                    .map(move |slot| bucket * SLOTS + slot)
+            })
+            .map(|index| {
+                let (key, value) = self.entry_at(index);
+                (key, value)
+            })
+            .chain(self.stash.iter().map(|(key, value)| (key, value)))
+    }
+
+    /// Removes every entry, keeping the allocated table.
+    pub fn clear(&mut self) {
+        self.drop_entries();
+        self.stash.clear();
+        self.len = 0;
+    }
+
+    #[inline]
+    fn entry_at(&self, index: usize) -> &(K, V) {
+        debug_assert!(self.tags[index / SLOTS] & (0xff << (index % SLOTS * 8)) != 0);
+        // SAFETY: callers only pass indices of tagged, and therefore initialized, slots
+        unsafe { self.slots.get_unchecked(index).assume_init_ref() }
+    }
+
+    #[inline]
+    fn key_at(&self, index: usize) -> &K {
+        &self.entry_at(index).0
+    }
+
+    #[inline]
+    fn set_tag(&mut self, index: usize, tag: u8) {
+        let shift = index % SLOTS * 8;
+        let word = &mut self.tags[index / SLOTS];
+        *word = (*word & !(0xff << shift)) | (tag as u64) << shift;
+    }
+
+    #[inline]
+    fn write(&mut self, index: usize, tag: u8, entry: (K, V)) {
+        self.slots[index].write(entry);
+        self.set_tag(index, tag);
+    }
+
+    fn relocate(&mut self, from: usize, to: usize) {
+        let tag = (self.tags[from / SLOTS] >> (from % SLOTS * 8)) as u8;
+        self.set_tag(from, 0);
+        // SAFETY: `from` was initialized and is untagged before being read; `to` is empty
+        let entry = unsafe { self.slots[from].assume_init_read() };
+        self.write(to, tag, entry);
+    }
+
+    fn drop_entries(&mut self) {
+        for bucket in 0..self.tags.len() {
+            let mut occupied = !zero_bytes(self.tags[bucket]) & HIGH;
+            self.tags[bucket] = 0;
+            if !std::mem::needs_drop::<(K, V)>() {
+                continue;
+            }
+            while occupied != 0 {
+                let index = bucket * SLOTS + occupied.trailing_zeros() as usize / 8;
+                // SAFETY: the slot was tagged as initialized and its tag is now cleared
+                unsafe { self.slots[index].assume_init_drop() };
+                occupied &= occupied - 1;
+            }
+        }
+    }
+}
+
+impl<K: Hash + Eq, V> Default for CuckooMap<K, V> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<K, V> Drop for CuckooMap<K, V> {
+    fn drop(&mut self) {
+        self.drop_entries();
+    }
+}
+
+impl<K: Hash + Eq, V> FromIterator<(K, V)> for CuckooMap<K, V> {
+    fn from_iter<I: IntoIterator<Item = (K, V)>>(iter: I) -> Self {
+        let iter = iter.into_iter();
+        let mut map = Self::with_capacity(iter.size_hint().0);
+        map.extend(iter);
+        map
+    }
+}
+
+impl<K: Hash + Eq, V> Extend<(K, V)> for CuckooMap<K, V> {
+    fn extend<I: IntoIterator<Item = (K, V)>>(&mut self, iter: I) {
+        for (key, value) in iter {
+            self.insert(key, value);
+        }
+    }
+}
+
+impl<K: fmt::Debug, V: fmt::Debug> fmt::Debug for CuckooMap<K, V> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_map().entries(self.iter()).finish()
+    }
+}
+
+// Sets the high bit of every byte of `word` that is zero, exactly (no false positives)
+#[inline(always)]
+fn zero_bytes(word: u64) -> u64 {
+    !(((word & LOW7) + LOW7) | word | LOW7)
+}
+
+#[inline(always)]
+fn empty_slot(word: u64) -> Option<usize> {
+    let zeros = zero_bytes(word);
+    (zeros != 0).then(|| zeros.trailing_zeros() as usize / 8)
+}
+
+/// Compares `tag` against the eight tags of a bucket, returning a mask with bit `i` set when
+/// slot `i` matches.
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+fn match_bucket(word: u64, tag: u8) -> u32 {
+    use std::arch::x86_64::{_mm_cmpeq_epi8, _mm_cvtsi64_si128, _mm_movemask_epi8, _mm_set1_epi8};
+    // SAFETY: SSE2 is part of the x86_64 baseline
+    #[allow(unused_unsafe)]
+    let mask = unsafe {
+        let tags = _mm_cvtsi64_si128(word as i64);
+        _mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8(tag as i8))) as u32
+    };
+    // Only the low eight lanes hold tags
+    mask & 0xff
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+#[inline(always)]
+fn match_bucket(word: u64, tag: u8) -> u32 {
+    match_word(word, tag)
+}
+
+// Portable fallback: SWAR byte comparison, gathered into the same mask as the SSE2 version
+#[cfg(any(test, not(target_arch = "x86_64")))]
+#[inline(always)]
+fn match_word(word: u64, tag: u8) -> u32 {
+    let zeros = zero_bytes(word ^ (tag as u64).wrapping_mul(0x0101_0101_0101_0101));
+    // Moves the high bit of byte `i` to bit `56 + i`
+    ((zeros >> 7).wrapping_mul(0x0102_0408_1020_4080) >> 56) as u32
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::hash::Hasher;
+    use std::rc::Rc;
+
+    #[test]
+    fn test_insert_get_remove() {
+        let mut map = CuckooMap::new();
+        for i in 0..10_000u64 {
+            assert_eq!(map.insert(i, i * 2), None);
+        }
+        assert_eq!(map.len(), 10_000);
+        for i in 0..10_000u64 {
+            assert_eq!(map.get(&i), Some(&(i * 2)));
+        }
+        assert_eq!(map.get(&10_000), None);
+
+        assert_eq!(map.insert(7, 0), Some(14));
+        *map.get_mut(&8).unwrap() += 1;
+        assert_eq!(map.get(&8), Some(&17));
+
+        for i in (0..10_000u64).step_by(2) {
+            assert!(map.remove(&i).is_some());
+        }
+        assert_eq!(map.len(), 5_000);
+        assert!(!map.contains_key(&4));
+        assert!(map.contains_key(&5));
+        assert_eq!(map.iter().count(), 5_000);
+    }
+
+    #[test]
+    fn test_borrowed_lookup() {
+        let map: CuckooMap<String, usize> = ["a", "bb", "ccc"]
+            .iter()
+            .map(|s| (s.to_string(), s.len()))
+            .collect();
+        assert_eq!(map.get("bb"), Some(&2));
+        assert_eq!(map.get("dddd"), None);
+    }
+
+    #[test]
+    fn test_fills_to_max_load_without_growing() {
+        let mut map = CuckooMap::with_capacity(60_000);
+        let capacity = map.capacity();
+        let count = (capacity as f64 * MAX_LOAD) as u64;
+        for i in 0..count {
+            map.insert(i, ());
+        }
+        assert_eq!(map.capacity(), capacity);
+        assert!(map.stash.is_empty());
+        assert!(map.load_factor() > 0.949);
+        assert!((0..count).all(|k| map.contains_key(&k)));
+
+        map.insert(count, ());
+        assert_eq!(map.capacity(), capacity * 2);
+        assert!((0..=count).all(|k| map.contains_key(&k)));
+    }
+
+    #[test]
+    fn test_colliding_keys_use_stash() {
+        // Every key hashes identically, so at most two buckets' worth fit in the table
+        #[derive(PartialEq, Eq)]
+        struct Same(u32);
+        impl Hash for Same {
+            fn hash<H: Hasher>(&self, state: &mut H) {
+                state.write_u8(0);
+            }
+        }
+
+        let mut map = CuckooMap::new();
+        for i in 0..100 {
+            map.insert(Same(i), i);
+        }
+        assert_eq!(map.len(), 100);
+        assert!(!map.stash.is_empty());
+        assert!((0..100).all(|i| map.get(&Same(i)) == Some(&i)));
+        assert_eq!(map.remove(&Same(99)), Some(99));
+        assert_eq!(map.get(&Same(99)), None);
+    }
+
+    #[test]
+    fn test_drops_every_entry_once() {
+        let counter = Rc::new(());
+        let mut map = CuckooMap::new();
+        for i in 0..1_000 {
+            map.insert(i, Rc::clone(&counter));
+        }
+        map.remove(&3);
+        map.insert(4, Rc::clone(&counter));
+        assert_eq!(Rc::strong_count(&counter), 1_000);
+        map.clear();
+        assert_eq!(Rc::strong_count(&counter), 1);
+        for i in 0..100 {
+            map.insert(i, Rc::clone(&counter));
+        }
+        drop(map);
+        assert_eq!(Rc::strong_count(&counter), 1);
+    }
+
+    #[test]
+    fn test_tag_matching() {
+        let words = [0u64, u64::MAX, 0x0102_0304_0506_0708, 0x00ff_00ff_0101_8080];
+        for &word in &words {
+            for tag in 0..=255u8 {
+                let expected = (0..SLOTS)
+                    .filter(|i| (word >> (i * 8)) as u8 == tag)
+                    .fold(0, |mask, i| mask | 1 << i);
+                assert_eq!(match_word(word, tag), expected);
+                assert_eq!(match_bucket(word, tag), expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,576 @@
+use crate::farm::farm_fingerprint128;
+use crate::prehashed::NoHashBuildHasher;
+use std::cmp::Reverse;
+use std::collections::{BinaryHeap, HashSet};
+use std::fmt;
+use std::fs::{self, File};
+use std::io::{self, BufReader, BufWriter, Read, Seek, SeekFrom, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+// Memory charged per buffered record on top of its bytes, and per fingerprint in the
+// in-memory set (including hash table slack)
+const ENTRY_OVERHEAD: usize = 40;
+const SET_ENTRY_OVERHEAD: usize = 24;
+// On disk, every record is its fingerprint, sequence number and length, then its bytes
+const HEADER_LEN: usize = 28;
+const IO_BUFFER: usize = 1 << 16;
+const MIN_IO_BUFFER: usize = 4 << 10;
+
+static SPILL_DIRS: AtomicUsize = AtomicUsize::new(0);
+
+/// Configures and builds a [`Dedup`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::dedup::DedupBuilder;
+/// use simplehash::murmurhash3_128;
+///
+/// let mut dedup = DedupBuilder::new(64 << 20)
+///     .partitions(16)
+///     .fingerprint(|record| murmurhash3_128(record, 0))
+///     .build();
+/// for line in ["b", "a", "b", "c", "a"] {
+///     dedup.push(line.as_bytes()).unwrap();
+/// }
+/// let unique: Vec<Vec<u8>> = dedup.finish().unwrap().map(Result::unwrap).collect();
+/// assert_eq!(unique, [b"b", b"a", b"c"]);
+/// ```
+#[derive(Debug, Clone)]
+pub struct DedupBuilder {
+    memory_budget: usize,
+    partitions: usize,
+    spill_dir: Option<PathBuf>,
+    fingerprint: fn(&[u8]) -> u128,
+}
+
+impl DedupBuilder {
+    /// Creates a builder for a deduplicator that buffers at most about `memory_budget` bytes
+    /// of records and fingerprints before spilling. It spills to 64 partitions under the
+    /// system temporary directory and fingerprints with FarmHash Fingerprint128.
+    pub fn new(memory_budget: usize) -> Self {
+        Self {
+            memory_budget,
+            partitions: 64,
+            spill_dir: None,
+            fingerprint: farm_fingerprint128,
+        }
+    }
+
+    /// Sets the number of hash partitions spilled records are split into. The merge phase
+    /// holds one partition's unique records in memory at a time, so use more partitions when
+    /// the distinct records are many times larger than the memory budget.
+    ///
+    /// Every partition file also gets an I/O buffer while spilling and merging, outside the
+    /// budget. Buffers shrink from 64 KiB as partitions are added so that together they take
+    /// about an eighth of the budget, but never below 4 KiB each (16 MiB for 4096 partitions).
+    ///
+    /// # Panics
+    ///
+    /// Panics if `partitions` is not between 1 and 4096.
+    pub fn partitions(mut self, partitions: usize) -> Self {
+        assert!(
+            (1..=4096).contains(&partitions),
+            "partitions must be between 1 and 4096"
+        );
+        self.partitions = partitions;
+        self
+    }
+
+    /// Sets the directory spill files are created under. A private subdirectory is created
+    /// on the first spill and removed once the output is dropped.
+    pub fn spill_dir<P: AsRef<Path>>(mut self, dir: P) -> Self {
+        self.spill_dir = Some(dir.as_ref().to_path_buf());
+        self
+    }
+
+    /// Sets the 128-bit fingerprint function, such as [`crate::murmurhash3_128`] with a fixed
+    /// seed.
+    pub fn fingerprint(mut self, fingerprint: fn(&[u8]) -> u128) -> Self {
+        self.fingerprint = fingerprint;
+        self
+    }
+
+    // Buffer per partition file, so that all of them together take about an eighth of the budget
+    fn io_buffer(&self) -> usize {
+        (self.memory_budget / 8 / self.partitions).clamp(MIN_IO_BUFFER, IO_BUFFER)
+    }
+
+    /// Builds the deduplicator.
+    pub fn build(self) -> Dedup {
+        Dedup {
+            config: self,
+            seen: HashSet::default(),
+            arena: Vec::new(),
+            entries: Vec::new(),
+            next_seq: 0,
+            spill: None,
+        }
+    }
+}
+
+/// A streaming deduplicator for record streams whose distinct set may exceed memory.
+///
+/// Each record is fingerprinted once with a 128-bit hash, and records are treated as equal
+/// when their fingerprints are (a false match needs a 128-bit collision). While they fit the
+/// memory budget, the first occurrence of each record is buffered and later ones are dropped
+/// against an in-memory fingerprint set. When the budget is exceeded, the buffer is sorted by
+/// fingerprint and spilled as one run per hash partition, and the set starts over.
+///
+/// [`Dedup::finish`] merges each partition's runs, keeping the earliest occurrence of every
+/// fingerprint, and streams the unique records back in the order they were first pushed.
+/// Streams that never spill are returned straight from memory.
+pub struct Dedup {
+    config: DedupBuilder,
+    seen: HashSet<u128, NoHashBuildHasher>,
+    arena: Vec<u8>,
+    entries: Vec<Buffered>,
+    next_seq: u64,
+    spill: Option<Spill>,
+}
+
+// A record kept in memory: its bytes are `arena[start..start + len]`
+struct Buffered {
+    fingerprint: u128,
+    seq: u64,
+    start: usize,
+    len: usize,
+}
+
+// Spill files: partition `p` holds run `r` at bytes `bounds[p][r]..bounds[p][r + 1]`
+struct Spill {
+    dir: SpillDir,
+    files: Vec<BufWriter<File>>,
+    bounds: Vec<Vec<u64>>,
+}
+
+// Removes the spill directory when the last owner of the spilled data goes away
+struct SpillDir(PathBuf);
+
+impl Drop for SpillDir {
+    fn drop(&mut self) {
+        let _ = fs::remove_dir_all(&self.0);
+    }
+}
+
+impl Dedup {
+    /// Creates a deduplicator with the default settings of [`DedupBuilder::new`].
+    pub fn new(memory_budget: usize) -> Self {
+        DedupBuilder::new(memory_budget).build()
+    }
+
+    /// Creates a builder for configuring a deduplicator.
+    pub fn builder(memory_budget: usize) -> DedupBuilder {
+        DedupBuilder::new(memory_budget)
+    }
+
+    /// Adds a record to the stream.
+    ///
+    /// # Errors
+    ///
+    /// Returns any I/O error raised while spilling the buffer to disk.
+    pub fn push(&mut self, record: &[u8]) -> io::Result<()> {
+        let fingerprint = (self.config.fingerprint)(record);
+        let seq = self.next_seq;
+        self.next_seq += 1;
+        if !self.seen.insert(fingerprint) {
+            return Ok(());
+        }
+        self.entries.push(Buffered {
+            fingerprint,
+            seq,
+            start: self.arena.len(),
+            len: record.len(),
+        });
+        self.arena.extend_from_slice(record);
+        if self.buffered_bytes() > self.config.memory_budget {
+            self.spill_buffer()?;
+        }
+        Ok(())
+    }
+
+    /// Returns the number of records pushed so far.
+    pub fn records(&self) -> u64 {
+        self.next_seq
+    }
+
+    /// Returns the number of runs spilled to disk so far.
+    pub fn spills(&self) -> usize {
+        // The last bound of each partition is the end of the run being written next
+        self.spill.as_ref().map_or(0, |s| s.bounds[0].len() - 2)
+    }
+
+    /// Returns the memory currently charged against the budget, in bytes.
+    pub fn buffered_bytes(&self) -> usize {
+        self.arena.len()
+            + self.entries.len() * ENTRY_OVERHEAD
+            + self.seen.len() * SET_ENTRY_OVERHEAD
+    }
+
+    /// Ends the stream and returns its unique records in first-occurrence order.
+    ///
+    /// # Errors
+    ///
+    /// Returns any I/O error raised while spilling the last buffer or merging the runs.
+    pub fn finish(mut self) -> io::Result<UniqueRecords> {
+        if self.spill.is_none() {
+            return Ok(UniqueRecords {
+                source: Source::Memory {
+                    arena: std::mem::take(&mut self.arena),
+                    entries: std::mem::take(&mut self.entries).into_iter(),
+                },
+            });
+        }
+
+        if !self.entries.is_empty() {
+            self.spill_buffer()?;
+        }
+        let mut spill = self.spill.take().expect("spill files exist");
+        for file in &mut spill.files {
+            file.flush()?;
+        }
+        drop(std::mem::take(&mut spill.files));
+
+        let buffer = self.config.io_buffer();
+        let mut readers = Vec::with_capacity(self.config.partitions);
+        for (p, bounds) in spill.bounds.iter().enumerate() {
+            let resolved = resolve_partition(&spill.dir.0, p, bounds, buffer)?;
+            readers.push(RunReader::open(&resolved, 0, u64::MAX, buffer)?);
+        }
+        let mut current = Vec::with_capacity(readers.len());
+        let mut heap = BinaryHeap::with_capacity(readers.len());
+        for (i, reader) in readers.iter_mut().enumerate() {
+            let record = reader.next_record()?;
+            if let Some(record) = &record {
+                heap.push(Reverse((record.seq, i)));
+            }
+            current.push(record);
+        }
+        Ok(UniqueRecords {
+            source: Source::Disk {
+                readers,
+                current,
+                heap,
+                _dir: spill.dir,
+            },
+        })
+    }
+
+    // Sorts the buffer by fingerprint, which also groups it by partition, and appends it to
+    // the partition files as one run each
+    fn spill_buffer(&mut self) -> io::Result<()> {
+        if self.spill.is_none() {
+            self.spill = Some(self.create_spill()?);
+        }
+        let spill = self.spill.as_mut().expect("spill files exist");
+        let partitions = self.config.partitions;
+
+        self.entries.sort_unstable_by_key(|e| e.fingerprint);
+        for e in &self.entries {
+            let p = partition_of(e.fingerprint, partitions);
+            let record = &self.arena[e.start..e.start + e.len];
+            write_record(&mut spill.files[p], e.fingerprint, e.seq, record)?;
+            let end = spill.bounds[p].last_mut().expect("bounds start at zero");
+            *end += (HEADER_LEN + record.len()) as u64;
+        }
+        for bounds in &mut spill.bounds {
+            let end = *bounds.last().expect("bounds start at zero");
+            bounds.push(end);
+        }
+
+        self.entries.clear();
+        self.arena.clear();
+        self.seen.clear();
+        Ok(())
+    }
+
+    fn create_spill(&self) -> io::Result<Spill> {
+        let base = self
+            .config
+            .spill_dir
+            .clone()
+            .unwrap_or_else(std::env::temp_dir);
+        let dir = base.join(format!(
+            "simplehash-dedup-{}-{}",
+            std::process::id(),
+            SPILL_DIRS.fetch_add(1, Ordering::Relaxed)
+        ));
+        fs::create_dir_all(&dir)?;
+        let dir = SpillDir(dir);
+        let mut files = Vec::with_capacity(self.config.partitions);
+        for p in 0..self.config.partitions {
+            let file = File::create(dir.0.join(format!("{}.run", p)))?;
+            files.push(BufWriter::with_capacity(self.config.io_buffer(), file));
+        }
+        Ok(Spill {
+            dir,
+            files,
+            // Each partition's first run starts at 0 and its end grows as records are spilled
+            bounds: vec![vec![0, 0]; self.config.partitions],
+        })
+    }
+}
+
+impl fmt::Debug for Dedup {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("Dedup")
+            .field("records", &self.next_seq)
+            .field("buffered", &self.entries.len())
+            .field("buffered_bytes", &self.buffered_bytes())
+            .field("spills", &self.spills())
+            .finish()
+    }
+}
+
+/// The unique records of a [`Dedup`] stream, in first-occurrence order.
+///
+/// Spilled streams are read back from disk lazily; the spill files are deleted when this
+/// iterator is dropped.
+pub struct UniqueRecords {
+    source: Source,
+}
+
+enum Source {
+    Memory {
+        arena: Vec<u8>,
+        entries: std::vec::IntoIter<Buffered>,
+    },
+    Disk {
+        readers: Vec<RunReader>,
+        current: Vec<Option<Record>>,
+        heap: BinaryHeap<Reverse<(u64, usize)>>,
+        _dir: SpillDir,
+    },
+}
+
+impl Iterator for UniqueRecords {
+    type Item = io::Result<Vec<u8>>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        match &mut self.source {
+            Source::Memory { arena, entries } => entries
+                .next()
+                .map(|e| Ok(arena[e.start..e.start + e.len].to_vec())),
+            Source::Disk {
+                readers,
+                current,
+                heap,
+                ..
+            } => {
+                let Reverse((_, i)) = heap.pop()?;
+                let record = current[i].take().expect("heap entries have a record");
+                match readers[i].next_record() {
+                    Ok(Some(next)) => {
+                        heap.push(Reverse((next.seq, i)));
+                        current[i] = Some(next);
+                    }
+                    Ok(None) => {}
+                    Err(err) => return Some(Err(err)),
+                }
+                Some(Ok(record.data))
+            }
+        }
+    }
+}
+
+impl fmt::Debug for UniqueRecords {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let spilled = matches!(self.source, Source::Disk { .. });
+        f.debug_struct("UniqueRecords")
+            .field("spilled", &spilled)
+            .finish()
+    }
+}
+
+struct Record {
+    fingerprint: u128,
+    seq: u64,
+    data: Vec<u8>,
+}
+
+// Reads the records of one run in file order
+struct RunReader {
+    reader: io::Take<BufReader<File>>,
+}
+
+impl RunReader {
+    fn open(path: &Path, start: u64, len: u64, buffer: usize) -> io::Result<Self> {
+        let mut file = File::open(path)?;
+        file.seek(SeekFrom::Start(start))?;
+        Ok(Self {
+            reader: BufReader::with_capacity(buffer, file).take(len),
+        })
+    }
+
+    fn next_record(&mut self) -> io::Result<Option<Record>> {
+        let mut header = [0u8; HEADER_LEN];
+        match self.reader.read_exact(&mut header) {
+            Ok(()) => {}
+            Err(err) if err.kind() == io::ErrorKind::UnexpectedEof => return Ok(None),
+            Err(err) => return Err(err),
+        }
+        let fingerprint = u128::from_le_bytes(header[..16].try_into().unwrap());
+        let seq = u64::from_le_bytes(header[16..24].try_into().unwrap());
+        let len = u32::from_le_bytes(header[24..].try_into().unwrap()) as usize;
+        let mut data = vec![0u8; len];
+        self.reader.read_exact(&mut data)?;
+        Ok(Some(Record {
+            fingerprint,
+            seq,
+            data,
+        }))
+    }
+}
+
+fn write_record<W: Write>(out: &mut W, fingerprint: u128, seq: u64, data: &[u8]) -> io::Result<()> {
+    let len = u32::try_from(data.len())
+        .map_err(|_| io::Error::new(io::ErrorKind::InvalidInput, "record exceeds 4 GiB"))?;
+    out.write_all(&fingerprint.to_le_bytes())?;
+    out.write_all(&seq.to_le_bytes())?;
+    out.write_all(&len.to_le_bytes())?;
+    out.write_all(data)
+}
+
+// Maps the top 64 bits of a fingerprint onto `0..partitions`, preserving fingerprint order
+#[inline]
+fn partition_of(fingerprint: u128, partitions: usize) -> usize {
+    (((fingerprint >> 64) * partitions as u128) >> 64) as usize
+}
+
+// Merges the fingerprint-sorted runs of partition `p`, keeps the earliest occurrence of each
+// fingerprint, and writes the survivors in sequence order to a new file. Returns its path.
+fn resolve_partition(dir: &Path, p: usize, bounds: &[u64], buffer: usize) -> io::Result<PathBuf> {
+    let runs_path = dir.join(format!("{}.run", p));
+    let mut runs = Vec::with_capacity(bounds.len() - 1);
+    for window in bounds.windows(2) {
+        if window[1] > window[0] {
+            runs.push(RunReader::open(
+                &runs_path,
+                window[0],
+                window[1] - window[0],
+                buffer,
+            )?);
+        }
+    }
+
+    let mut current = Vec::with_capacity(runs.len());
+    let mut heap = BinaryHeap::with_capacity(runs.len());
+    for (i, run) in runs.iter_mut().enumerate() {
+        let record = run.next_record()?;
+        if let Some(record) = &record {
+            heap.push(Reverse((record.fingerprint, record.seq, i)));
+        }
+        current.push(record);
+    }
+
+    // Equal fingerprints pop in sequence order, so the first one popped is the earliest
+    let mut survivors: Vec<Record> = Vec::new();
+    while let Some(Reverse((fingerprint, _, i))) = heap.pop() {
+        let record = current[i].take().expect("heap entries have a record");
+        current[i] = runs[i].next_record()?;
+        if let Some(next) = &current[i] {
+            heap.push(Reverse((next.fingerprint, next.seq, i)));
+        }
+        if survivors
+            .last()
+            .is_none_or(|last| last.fingerprint != fingerprint)
+        {
+            survivors.push(record);
+        }
+    }
+    drop(runs);
+    fs::remove_file(&runs_path)?;
+
+    survivors.sort_unstable_by_key(|r| r.seq);
+    let resolved = dir.join(format!("{}.unique", p));
+    let mut out = BufWriter::with_capacity(IO_BUFFER, File::create(&resolved)?);
+    for record in &survivors {
+        write_record(&mut out, record.fingerprint, record.seq, &record.data)?;
+    }
+    out.flush()?;
+    Ok(resolved)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // Records with many repeats spread over the whole stream
+    fn stream(n: u64) -> Vec<Vec<u8>> {
+        (0..n)
+            .map(|i| format!("record-{}", crate::murmur::fmix64(i) % (n / 3)).into_bytes())
+            .collect()
+    }
+
+    fn naive(records: &[Vec<u8>]) -> Vec<Vec<u8>> {
+        let mut seen = std::collections::HashSet::new();
+        records
+            .iter()
+            .filter(|r| seen.insert(r.as_slice()))
+            .cloned()
+            .collect()
+    }
+
+    #[test]
+    fn test_in_memory_preserves_order() {
+        let records = stream(10_000);
+        let mut dedup = Dedup::new(64 << 20);
+        for r in &records {
+            dedup.push(r).unwrap();
+        }
+        assert_eq!(dedup.spills(), 0);
+        let unique: Vec<Vec<u8>> = dedup.finish().unwrap().map(Result::unwrap).collect();
+        assert_eq!(unique, naive(&records));
+    }
+
+    #[test]
+    fn test_spilled_matches_in_memory() {
+        let records = stream(60_000);
+        let base =
+            std::env::temp_dir().join(format!("simplehash-dedup-test-{}", std::process::id()));
+        let mut dedup = DedupBuilder::new(64 << 10)
+            .partitions(7)
+            .spill_dir(&base)
+            .build();
+        // A push that spills leaves the buffer empty, since the set of seen fingerprints is
+        // cleared with it
+        let mut spilled = 0;
+        for r in &records {
+            dedup.push(r).unwrap();
+            if dedup.buffered_bytes() == 0 {
+                spilled += 1;
+                assert_eq!(dedup.spills(), spilled);
+            }
+        }
+        assert!(spilled > 10);
+        assert_eq!(dedup.spills(), spilled);
+
+        let output = dedup.finish().unwrap();
+        assert_eq!(fs::read_dir(&base).unwrap().count(), 1);
+        let unique: Vec<Vec<u8>> = output.map(Result::unwrap).collect();
+        assert_eq!(unique, naive(&records));
+        // The iterator was consumed and dropped, taking its spill directory with it
+        assert_eq!(fs::read_dir(&base).unwrap().count(), 0);
+        fs::remove_dir(&base).unwrap();
+    }
+
+    #[test]
+    fn test_io_buffers_shrink_with_partitions() {
+        assert_eq!(DedupBuilder::new(64 << 20).io_buffer(), IO_BUFFER);
+        assert_eq!(
+            DedupBuilder::new(64 << 20).partitions(1024).io_buffer(),
+            8 << 10
+        );
+        assert_eq!(
+            DedupBuilder::new(64 << 20).partitions(4096).io_buffer(),
+            MIN_IO_BUFFER
+        );
+    }
+
+    #[test]
+    fn test_empty_stream() {
+        let dedup = Dedup::new(1024);
+        assert_eq!(dedup.finish().unwrap().count(), 0);
+    }
+}
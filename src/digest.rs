@@ -0,0 +1,390 @@
+use crate::city::{city_hash32, city_hash64, city_hash128};
+use crate::farm::{farm_fingerprint64, farm_fingerprint128, farm_hash32, farm_hash64};
+use crate::fnv::{Fnv1aHasher32, Fnv1aHasher64, FnvHasher32, FnvHasher64};
+use crate::mmap::MappedFile;
+use crate::murmur::{MurmurHasher32, MurmurHasher128};
+use crate::{fnv1_32, fnv1_64, fnv1a_32, fnv1a_64, murmurhash3_32, murmurhash3_128};
+use std::fmt;
+use std::fs::File;
+use std::hash::Hasher;
+use std::io::{self, Read};
+use std::path::Path;
+
+/// Bytes read per `read` call when streaming, and bytes hashed per step of a single pass
+pub const CHUNK_LEN: usize = 1 << 20;
+// MurmurHash3 hashers consume 4- or 16-byte blocks and only handle a partial block at the end,
+// so streamed input is fed to them in multiples of this
+const MURMUR_BLOCK: usize = 16;
+
+/// A hash function selectable by name, for tools that hash files, lines or records.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum Algorithm {
+    /// FNV-1, 32-bit.
+    Fnv1_32,
+    /// FNV-1a, 32-bit.
+    Fnv1a32,
+    /// FNV-1, 64-bit.
+    Fnv1_64,
+    /// FNV-1a, 64-bit.
+    Fnv1a64,
+    /// MurmurHash3 x86 32-bit, seed 0.
+    Murmur3_32,
+    /// MurmurHash3 128-bit, seed 0.
+    Murmur3_128,
+    /// CityHash32.
+    City32,
+    /// CityHash64.
+    City64,
+    /// CityHash128.
+    City128,
+    /// FarmHash32 (may change between FarmHash versions).
+    Farm32,
+    /// FarmHash64 (may change between FarmHash versions).
+    Farm64,
+    /// FarmHash Fingerprint64 (stable).
+    FarmFingerprint64,
+    /// FarmHash Fingerprint128 (stable).
+    FarmFingerprint128,
+}
+
+impl Algorithm {
+    /// Every algorithm, in the order tools list them.
+    pub const ALL: &'static [Algorithm] = &[
+        Algorithm::Fnv1_32,
+        Algorithm::Fnv1a32,
+        Algorithm::Fnv1_64,
+        Algorithm::Fnv1a64,
+        Algorithm::Murmur3_32,
+        Algorithm::Murmur3_128,
+        Algorithm::City32,
+        Algorithm::City64,
+        Algorithm::City128,
+        Algorithm::Farm32,
+        Algorithm::Farm64,
+        Algorithm::FarmFingerprint64,
+        Algorithm::FarmFingerprint128,
+    ];
+
+    /// Returns the algorithm's command-line name, such as `"fnv1a-64"` or `"city128"`.
+    pub fn name(self) -> &'static str {
+        match self {
+            Algorithm::Fnv1_32 => "fnv1-32",
+            Algorithm::Fnv1a32 => "fnv1a-32",
+            Algorithm::Fnv1_64 => "fnv1-64",
+            Algorithm::Fnv1a64 => "fnv1a-64",
+            Algorithm::Murmur3_32 => "murmur3-32",
+            Algorithm::Murmur3_128 => "murmur3-128",
+            Algorithm::City32 => "city32",
+            Algorithm::City64 => "city64",
+            Algorithm::City128 => "city128",
+            Algorithm::Farm32 => "farm32",
+            Algorithm::Farm64 => "farm64",
+            Algorithm::FarmFingerprint64 => "farm-fp64",
+            Algorithm::FarmFingerprint128 => "farm-fp128",
+        }
+    }
+
+    /// Looks an algorithm up by its [`Algorithm::name`], ignoring ASCII case.
+    pub fn from_name(name: &str) -> Option<Self> {
+        Self::ALL
+            .iter()
+            .copied()
+            .find(|a| a.name().eq_ignore_ascii_case(name))
+    }
+
+    /// Returns the width of the hash in bits: 32, 64 or 128.
+    pub fn bits(self) -> u32 {
+        match self {
+            Algorithm::Fnv1_32
+            | Algorithm::Fnv1a32
+            | Algorithm::Murmur3_32
+            | Algorithm::City32
+            | Algorithm::Farm32 => 32,
+            Algorithm::Fnv1_64
+            | Algorithm::Fnv1a64
+            | Algorithm::City64
+            | Algorithm::Farm64
+            | Algorithm::FarmFingerprint64 => 64,
+            Algorithm::Murmur3_128 | Algorithm::City128 | Algorithm::FarmFingerprint128 => 128,
+        }
+    }
+
+    /// Returns whether the algorithm can hash input incrementally. The others need the whole
+    /// input in one slice.
+    pub fn is_streaming(self) -> bool {
+        matches!(
+            self,
+            Algorithm::Fnv1_32
+                | Algorithm::Fnv1a32
+                | Algorithm::Fnv1_64
+                | Algorithm::Fnv1a64
+                | Algorithm::Murmur3_32
+                | Algorithm::Murmur3_128
+        )
+    }
+
+    /// Hashes `data`, returning the hash zero-extended to 128 bits.
+    #[inline]
+    pub fn hash(self, data: &[u8]) -> u128 {
+        match self {
+            Algorithm::Fnv1_32 => fnv1_32(data) as u128,
+            Algorithm::Fnv1a32 => fnv1a_32(data) as u128,
+            Algorithm::Fnv1_64 => fnv1_64(data) as u128,
+            Algorithm::Fnv1a64 => fnv1a_64(data) as u128,
+            Algorithm::Murmur3_32 => murmurhash3_32(data, 0) as u128,
+            Algorithm::Murmur3_128 => murmurhash3_128(data, 0),
+            Algorithm::City32 => city_hash32(data) as u128,
+            Algorithm::City64 => city_hash64(data) as u128,
+            Algorithm::City128 => city_hash128(data),
+            Algorithm::Farm32 => farm_hash32(data) as u128,
+            Algorithm::Farm64 => farm_hash64(data) as u128,
+            Algorithm::FarmFingerprint64 => farm_fingerprint64(data) as u128,
+            Algorithm::FarmFingerprint128 => farm_fingerprint128(data),
+        }
+    }
+}
+
+impl fmt::Display for Algorithm {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.name())
+    }
+}
+
+// Incremental state of one streaming algorithm
+#[derive(Debug, Clone)]
+enum State {
+    Fnv1_32(FnvHasher32),
+    Fnv1a32(Fnv1aHasher32),
+    Fnv1_64(FnvHasher64),
+    Fnv1a64(Fnv1aHasher64),
+    Murmur3_32(MurmurHasher32),
+    Murmur3_128(MurmurHasher128),
+    // Non-streaming algorithms hash the buffered input in `finish`
+    OneShot(Algorithm),
+}
+
+/// Computes several hashes of the same input in one pass, fed in chunks of any size.
+///
+/// Streaming algorithms (see [`Algorithm::is_streaming`]) consume each chunk while it is
+/// still in cache. If any other algorithm is selected, the input is also buffered so it can
+/// be hashed whole by [`MultiHasher::finish`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::digest::{Algorithm, MultiHasher};
+///
+/// let algorithms = [Algorithm::Fnv1a64, Algorithm::Murmur3_128];
+/// let mut hasher = MultiHasher::new(&algorithms);
+/// hasher.update(b"hello ");
+/// hasher.update(b"world");
+///
+/// let hashes = hasher.finish();
+/// assert_eq!(hashes[0], Algorithm::Fnv1a64.hash(b"hello world"));
+/// assert_eq!(hashes[1], Algorithm::Murmur3_128.hash(b"hello world"));
+/// ```
+#[derive(Debug, Clone)]
+pub struct MultiHasher {
+    states: Vec<State>,
+    // Bytes not yet fed to the MurmurHash3 states, always fewer than MURMUR_BLOCK
+    pending: Vec<u8>,
+    buffer: Option<Vec<u8>>,
+}
+
+impl MultiHasher {
+    /// Creates a hasher computing `algorithms`, in that order.
+    pub fn new(algorithms: &[Algorithm]) -> Self {
+        let states = algorithms
+            .iter()
+            .map(|&a| match a {
+                Algorithm::Fnv1_32 => State::Fnv1_32(FnvHasher32::new()),
+                Algorithm::Fnv1a32 => State::Fnv1a32(Fnv1aHasher32::new()),
+                Algorithm::Fnv1_64 => State::Fnv1_64(FnvHasher64::new()),
+                Algorithm::Fnv1a64 => State::Fnv1a64(Fnv1aHasher64::new()),
+                Algorithm::Murmur3_32 => State::Murmur3_32(MurmurHasher32::new(0)),
+                Algorithm::Murmur3_128 => State::Murmur3_128(MurmurHasher128::new(0)),
+                other => State::OneShot(other),
+            })
+            .collect();
+        let buffered = algorithms.iter().any(|a| !a.is_streaming());
+        Self {
+            states,
+            pending: Vec::with_capacity(MURMUR_BLOCK),
+            buffer: buffered.then(Vec::new),
+        }
+    }
+
+    /// Feeds the next chunk of input.
+    pub fn update(&mut self, mut data: &[u8]) {
+        if let Some(buffer) = &mut self.buffer {
+            buffer.extend_from_slice(data);
+        }
+        for state in &mut self.states {
+            match state {
+                State::Fnv1_32(h) => h.write(data),
+                State::Fnv1a32(h) => h.write(data),
+                State::Fnv1_64(h) => h.write(data),
+                State::Fnv1a64(h) => h.write(data),
+                _ => {}
+            }
+        }
+
+        // Top up a partial MurmurHash3 block first, then feed whole blocks and keep the rest
+        if !self.pending.is_empty() {
+            let take = (MURMUR_BLOCK - self.pending.len()).min(data.len());
+            self.pending.extend_from_slice(&data[..take]);
+            data = &data[take..];
+            if self.pending.len() < MURMUR_BLOCK {
+                return;
+            }
+            let block = std::mem::take(&mut self.pending);
+            self.write_murmur(&block);
+            self.pending = block;
+            self.pending.clear();
+        }
+        let aligned = data.len() / MURMUR_BLOCK * MURMUR_BLOCK;
+        self.write_murmur(&data[..aligned]);
+        self.pending.extend_from_slice(&data[aligned..]);
+    }
+
+    /// Returns the hashes, in the order the algorithms were given.
+    pub fn finish(mut self) -> Vec<u128> {
+        let pending = std::mem::take(&mut self.pending);
+        self.write_murmur(&pending);
+        let buffer = self.buffer.unwrap_or_default();
+        self.states
+            .iter()
+            .map(|state| match state {
+                State::Fnv1_32(h) => h.finish_raw() as u128,
+                State::Fnv1a32(h) => h.finish_raw() as u128,
+                State::Fnv1_64(h) => h.finish_raw() as u128,
+                State::Fnv1a64(h) => h.finish_raw() as u128,
+                State::Murmur3_32(h) => h.finish_u32() as u128,
+                State::Murmur3_128(h) => h.finish_u128(),
+                State::OneShot(a) => a.hash(&buffer),
+            })
+            .collect()
+    }
+
+    fn write_murmur(&mut self, data: &[u8]) {
+        if data.is_empty() {
+            return;
+        }
+        for state in &mut self.states {
+            match state {
+                State::Murmur3_32(h) => h.write(data),
+                State::Murmur3_128(h) => h.write(data),
+                _ => {}
+            }
+        }
+    }
+}
+
+/// Computes each of `algorithms` over `data`.
+///
+/// The streaming algorithms share one pass: every [`CHUNK_LEN`] chunk is hashed by all of
+/// them before moving on, so a large memory-mapped file is read from memory once. The other
+/// algorithms then hash the whole slice.
+pub fn hash_slice(data: &[u8], algorithms: &[Algorithm]) -> Vec<u128> {
+    let streaming: Vec<Algorithm> = algorithms
+        .iter()
+        .copied()
+        .filter(|a| a.is_streaming())
+        .collect();
+    let mut streamed = if streaming.len() > 1 {
+        let mut hasher = MultiHasher::new(&streaming);
+        for chunk in data.chunks(CHUNK_LEN) {
+            hasher.update(chunk);
+        }
+        hasher.finish().into_iter()
+    } else {
+        Vec::new().into_iter()
+    };
+    algorithms
+        .iter()
+        .map(|&a| {
+            if streaming.len() > 1 && a.is_streaming() {
+                streamed.next().unwrap()
+            } else {
+                a.hash(data)
+            }
+        })
+        .collect()
+}
+
+/// Streams `reader` through [`MultiHasher`] in [`CHUNK_LEN`] reads.
+///
+/// # Errors
+///
+/// Returns the first read error other than `Interrupted`.
+pub fn hash_reader<R: Read>(mut reader: R, algorithms: &[Algorithm]) -> io::Result<Vec<u128>> {
+    let mut hasher = MultiHasher::new(algorithms);
+    let mut buf = vec![0u8; CHUNK_LEN];
+    loop {
+        match reader.read(&mut buf) {
+            Ok(0) => return Ok(hasher.finish()),
+            Ok(n) => hasher.update(&buf[..n]),
+            Err(err) if err.kind() == io::ErrorKind::Interrupted => {}
+            Err(err) => return Err(err),
+        }
+    }
+}
+
+/// Hashes the file at `path` with each of `algorithms`.
+///
+/// Regular files are memory-mapped and advised for sequential access (or, with `populate`,
+/// faulted in up front) and hashed with [`hash_slice`]. Pipes, sockets and devices are
+/// streamed with [`hash_reader`].
+///
+/// # Errors
+///
+/// Returns any error from opening, mapping or reading the file.
+pub fn hash_file<P: AsRef<Path>>(
+    path: P,
+    algorithms: &[Algorithm],
+    populate: bool,
+) -> io::Result<Vec<u128>> {
+    let file = File::open(path)?;
+    if !file.metadata()?.is_file() {
+        return hash_reader(file, algorithms);
+    }
+    let map = if populate {
+        MappedFile::map_populated(&file)?
+    } else {
+        let map = MappedFile::map(&file)?;
+        map.advise_sequential()?;
+        map
+    };
+    Ok(hash_slice(map.as_slice(), algorithms))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_names_round_trip() {
+        for &a in Algorithm::ALL {
+            assert_eq!(Algorithm::from_name(a.name()), Some(a));
+            assert!(a.bits() == 128 || a.hash(b"abc") >> a.bits() == 0);
+        }
+        assert_eq!(Algorithm::from_name("CITY64"), Some(Algorithm::City64));
+        assert_eq!(Algorithm::from_name("md5"), None);
+    }
+
+    #[test]
+    fn test_streaming_matches_one_shot() {
+        let data: Vec<u8> = (0..10_000u32).map(|i| (i * 7 + i / 13) as u8).collect();
+        let expected: Vec<u128> = Algorithm::ALL.iter().map(|a| a.hash(&data)).collect();
+
+        for chunk in [1, 3, 15, 16, 17, 1000, 10_000] {
+            let mut hasher = MultiHasher::new(Algorithm::ALL);
+            for part in data.chunks(chunk) {
+                hasher.update(part);
+            }
+            assert_eq!(hasher.finish(), expected, "chunk size {}", chunk);
+        }
+        assert_eq!(hash_slice(&data, Algorithm::ALL), expected);
+        assert_eq!(hash_reader(&data[..], Algorithm::ALL).unwrap(), expected);
+    }
+}
@@ -0,0 +1,354 @@
+use crate::mmap::MappedFile;
+use crate::parallel;
+use crate::tree_hash::walk;
+use crate::{city_hash64, farm_fingerprint128};
+use std::collections::{HashMap, HashSet};
+use std::fs::File;
+use std::io::{self, Read, Seek, SeekFrom};
+use std::path::{Path, PathBuf};
+
+// Bytes sampled from each end of a file in the second stage
+const SAMPLE_BYTES: u64 = 4096;
+
+/// Files with identical contents.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct DuplicateGroup {
+    /// The size of every file in the group, in bytes.
+    pub size: u64,
+    /// The `farm_fingerprint128` of the contents.
+    pub fingerprint: u128,
+    /// The files, sorted.
+    pub paths: Vec<PathBuf>,
+}
+
+/// How much of the input each stage of [`DuplicateFinder::find`] looked at.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct DuplicateStats {
+    /// Regular files found.
+    pub files: u64,
+    /// Total size of those files.
+    pub total_bytes: u64,
+    /// Files that shared their size with another file and were sampled.
+    pub sampled_files: u64,
+    /// Files that were read completely.
+    pub hashed_files: u64,
+    /// Bytes read from disk over all stages.
+    pub bytes_read: u64,
+}
+
+/// The result of [`DuplicateFinder::find`].
+#[derive(Debug, Default)]
+pub struct DuplicateReport {
+    /// Groups of two or more identical files, largest files first.
+    pub groups: Vec<DuplicateGroup>,
+    /// How much of the input each stage looked at.
+    pub stats: DuplicateStats,
+    /// Files and directories that could not be read.
+    pub errors: Vec<(PathBuf, io::Error)>,
+}
+
+impl DuplicateReport {
+    /// Returns the bytes taken by all copies beyond the first of each group.
+    pub fn wasted_bytes(&self) -> u64 {
+        self.groups
+            .iter()
+            .map(|g| g.size * (g.paths.len() as u64 - 1))
+            .sum()
+    }
+}
+
+/// Finds duplicate files below one or more directories, reading as little as possible.
+///
+/// Candidates are narrowed in stages, and a file only goes on to the next stage while it still
+/// shares its key with another file:
+///
+/// 1. the directory walk groups files by size, which needs no reads at all;
+/// 2. `city_hash64` of the first and last 4 KiB separates files that differ near either end
+///    (files of at most 8 KiB are read whole here and fingerprinted directly);
+/// 3. `farm_fingerprint128` of the whole memory-mapped file confirms the duplicates.
+///
+/// Each stage runs on worker threads. Hard links to one file are reported as duplicates.
+///
+/// # Example
+///
+/// ```no_run
+/// use simplehash::duplicates::DuplicateFinder;
+///
+/// let report = DuplicateFinder::new().find(&["photos", "backup/photos"])?;
+/// for group in &report.groups {
+///     println!("{} bytes: {:?}", group.size, group.paths);
+/// }
+/// println!(
+///     "read {} of {} bytes",
+///     report.stats.bytes_read, report.stats.total_bytes
+/// );
+/// # Ok::<(), std::io::Error>(())
+/// ```
+#[derive(Debug, Clone)]
+pub struct DuplicateFinder {
+    min_size: u64,
+    threads: usize,
+}
+
+impl Default for DuplicateFinder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl DuplicateFinder {
+    /// Creates a finder that skips empty files and uses all available cores.
+    pub fn new() -> Self {
+        Self {
+            min_size: 1,
+            threads: 0,
+        }
+    }
+
+    /// Ignores files smaller than `min_size` bytes. `0` also groups empty files.
+    pub fn min_size(mut self, min_size: u64) -> Self {
+        self.min_size = min_size;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Finds the duplicate files below every directory in `roots`.
+    ///
+    /// Roots are canonicalized, repeated roots and roots nested in another root are searched
+    /// once, so no file is compared with itself. Paths in the report start with their
+    /// canonical root. Files that fail to read are reported in [`DuplicateReport::errors`] and
+    /// left out of the groups.
+    ///
+    /// # Errors
+    ///
+    /// Returns the error if one of `roots` cannot be read as a directory.
+    pub fn find<P: AsRef<Path>>(&self, roots: &[P]) -> io::Result<DuplicateReport> {
+        let mut canonical = Vec::with_capacity(roots.len());
+        for root in roots {
+            let root = root.as_ref();
+            std::fs::read_dir(root)?;
+            canonical.push(root.canonicalize()?);
+        }
+        canonical.sort_unstable();
+        let mut distinct: Vec<PathBuf> = Vec::with_capacity(canonical.len());
+        for root in canonical {
+            if !distinct.iter().any(|kept| root.starts_with(kept)) {
+                distinct.push(root);
+            }
+        }
+
+        let mut report = DuplicateReport::default();
+        let mut by_size: HashMap<u64, Vec<PathBuf>> = HashMap::new();
+        let mut seen = HashSet::new();
+        for root in &distinct {
+            let (files, errors) = walk(root, self.threads);
+            report
+                .errors
+                .extend(errors.into_iter().map(|(path, err)| (root.join(path), err)));
+            for (path, meta) in files {
+                let path = root.join(path);
+                // The walk does not follow links, so a path below a distinct canonical root
+                // names a file once; the set guards the grouping regardless
+                if !seen.insert(path.clone()) {
+                    continue;
+                }
+                report.stats.files += 1;
+                report.stats.total_bytes += meta.len();
+                if meta.len() >= self.min_size {
+                    by_size.entry(meta.len()).or_default().push(path);
+                }
+            }
+        }
+
+        // Stage 2: sample both ends of every file whose size is not unique
+        let candidates: Vec<(u64, PathBuf)> = by_size
+            .into_iter()
+            .filter(|(_, paths)| paths.len() > 1)
+            .flat_map(|(size, paths)| paths.into_iter().map(move |path| (size, path)))
+            .collect();
+        report.stats.sampled_files = candidates.len() as u64;
+        let sampled = parallel::map_indices(candidates.len(), self.threads, |i| {
+            let (size, path) = &candidates[i];
+            sample(path, *size)
+        });
+        let mut by_sample: HashMap<(u64, u128), Vec<PathBuf>> = HashMap::new();
+        let mut confirmed = Vec::new();
+        for ((size, path), result) in candidates.into_iter().zip(sampled) {
+            match result {
+                Ok((key, read, whole)) => {
+                    report.stats.bytes_read += read;
+                    if whole {
+                        report.stats.hashed_files += 1;
+                        confirmed.push((size, key, path));
+                    } else {
+                        by_sample.entry((size, key)).or_default().push(path);
+                    }
+                }
+                Err(err) => report.errors.push((path, err)),
+            }
+        }
+
+        // Stage 3: fingerprint every file that still matches another one in full
+        let candidates: Vec<(u64, PathBuf)> = by_sample
+            .into_iter()
+            .filter(|(_, paths)| paths.len() > 1)
+            .flat_map(|((size, _), paths)| paths.into_iter().map(move |path| (size, path)))
+            .collect();
+        let fingerprints = parallel::map_indices(candidates.len(), self.threads, |i| {
+            let (size, path) = &candidates[i];
+            fingerprint(path, *size)
+        });
+        for ((size, path), result) in candidates.into_iter().zip(fingerprints) {
+            match result {
+                Ok(fingerprint) => {
+                    report.stats.hashed_files += 1;
+                    report.stats.bytes_read += size;
+                    confirmed.push((size, fingerprint, path));
+                }
+                Err(err) => report.errors.push((path, err)),
+            }
+        }
+
+        let mut groups: HashMap<(u64, u128), Vec<PathBuf>> = HashMap::new();
+        for (size, fingerprint, path) in confirmed {
+            groups.entry((size, fingerprint)).or_default().push(path);
+        }
+        report.groups = groups
+            .into_iter()
+            .filter(|(_, paths)| paths.len() > 1)
+            .map(|((size, fingerprint), mut paths)| {
+                paths.sort_unstable();
+                DuplicateGroup {
+                    size,
+                    fingerprint,
+                    paths,
+                }
+            })
+            .collect();
+        report
+            .groups
+            .sort_unstable_by(|a, b| b.size.cmp(&a.size).then_with(|| a.paths.cmp(&b.paths)));
+        report.errors.sort_unstable_by(|a, b| a.0.cmp(&b.0));
+        Ok(report)
+    }
+}
+
+// Returns the stage 2 key of a file, the bytes read, and whether the key is already the full
+// fingerprint. Files of at most two samples are read whole and fingerprinted.
+fn sample(path: &Path, size: u64) -> io::Result<(u128, u64, bool)> {
+    let mut file = File::open(path)?;
+    if size <= 2 * SAMPLE_BYTES {
+        let mut data = Vec::with_capacity(size as usize);
+        file.read_to_end(&mut data)?;
+        if data.len() as u64 != size {
+            return Err(changed());
+        }
+        return Ok((farm_fingerprint128(&data), size, true));
+    }
+    let mut ends = [0u8; 2 * SAMPLE_BYTES as usize];
+    let (head, tail) = ends.split_at_mut(SAMPLE_BYTES as usize);
+    file.read_exact(head)?;
+    file.seek(SeekFrom::Start(size - SAMPLE_BYTES))?;
+    file.read_exact(tail)?;
+    Ok((city_hash64(&ends) as u128, 2 * SAMPLE_BYTES, false))
+}
+
+fn fingerprint(path: &Path, size: u64) -> io::Result<u128> {
+    let map = MappedFile::open(path)?;
+    if map.len() as u64 != size {
+        return Err(changed());
+    }
+    let _ = map.advise_sequential();
+    Ok(farm_fingerprint128(map.as_slice()))
+}
+
+fn changed() -> io::Error {
+    io::Error::other("file changed size while searching for duplicates")
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::fs;
+
+    #[test]
+    fn test_finds_duplicates_in_stages() {
+        let root =
+            std::env::temp_dir().join(format!("simplehash-duplicates-{}", std::process::id()));
+        let _ = fs::remove_dir_all(&root);
+        fs::create_dir_all(root.join("a/b")).unwrap();
+        fs::create_dir_all(root.join("c")).unwrap();
+        let root = root.canonicalize().unwrap();
+        let big: Vec<u8> = (0..100_000u32).map(|i| (i * 7 % 251) as u8).collect();
+        let mut middle = big.clone();
+        middle[50_000] ^= 1;
+        let mut tail = big.clone();
+        tail[99_999] ^= 1;
+        let files: Vec<(&str, &[u8])> = vec![
+            ("a/big", &big),
+            ("a/b/big-copy", &big),
+            ("c/big-copy", &big),
+            ("a/middle", &middle),
+            ("c/tail", &tail),
+            ("a/small", b"same"),
+            ("c/small", b"same"),
+            ("c/other", b"diff"),
+            ("a/unique", b"unique size"),
+            ("a/empty", b""),
+            ("c/empty", b""),
+        ];
+        for (path, data) in &files {
+            fs::write(root.join(path), data).unwrap();
+        }
+
+        let finder = DuplicateFinder::new().threads(3);
+        let report = finder.find(&[root.join("a"), root.join("c")]).unwrap();
+        let with_empty = finder.clone().min_size(0).find(&[&root]).unwrap();
+        // Repeated and nested roots are searched once
+        let overlapping = finder
+            .find(&[
+                root.join("a"),
+                root.clone(),
+                root.join("a/b"),
+                root.join("c/../a"),
+            ])
+            .unwrap();
+        fs::remove_dir_all(&root).unwrap();
+
+        assert!(report.errors.is_empty());
+        assert_eq!(report.groups.len(), 2);
+        assert_eq!(
+            report.groups[0],
+            DuplicateGroup {
+                size: 100_000,
+                fingerprint: farm_fingerprint128(&big),
+                paths: vec![
+                    root.join("a/b/big-copy"),
+                    root.join("a/big"),
+                    root.join("c/big-copy")
+                ],
+            }
+        );
+        assert_eq!(
+            report.groups[1].paths,
+            [root.join("a/small"), root.join("c/small")]
+        );
+        assert_eq!(report.wasted_bytes(), 200_004);
+
+        // The tail change is caught by sampling; only the middle change needs a full read
+        let stats = report.stats;
+        assert_eq!(stats.files, 11);
+        assert_eq!(stats.sampled_files, 8);
+        assert_eq!(stats.hashed_files, 7);
+        assert_eq!(stats.bytes_read, 5 * 8192 + 4 * 100_000 + 12);
+        assert_eq!(with_empty.groups.len(), 3);
+        assert_eq!(overlapping.stats.files, 11);
+        assert_eq!(overlapping.groups, report.groups);
+        assert_eq!(overlapping.wasted_bytes(), report.wasted_bytes());
+    }
+}
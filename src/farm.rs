@@ -1,3 +1,20 @@
+/// FarmHash32 (may change between FarmHash versions).
+pub fn farm_hash32(key: &[u8]) -> u32 {
+    farmhash_sys::farmhash::hash32(key)
+}
+
 pub fn farm_hash64(key: &[u8]) -> u64 {
     farmhash_sys::farmhash::hash64(key)
 }
+
+/// FarmHash Fingerprint64: a 64-bit hash that is stable across platforms and library versions,
+/// suitable for values that are persisted or compared between processes.
+pub fn farm_fingerprint64(key: &[u8]) -> u64 {
+    farmhash_sys::farmhash::fingerprint64(key)
+}
+
+/// FarmHash Fingerprint128, returned as a `u128` with the high half in the upper 64 bits.
+pub fn farm_fingerprint128(key: &[u8]) -> u128 {
+    let fp = farmhash_sys::farmhash::fingerprint128(key);
+    ((fp.high as u128) << 64) | fp.low as u128
+}
@@ -0,0 +1,467 @@
+use crate::city::city_hash64;
+use crate::murmurhash3_32;
+use crate::parallel;
+
+// Documents vectorized per parallel work item
+const DOCS_PER_CHUNK: usize = 256;
+const MAX_NGRAM: usize = 8;
+
+/// The hash function a [`HashingVectorizer`] maps features with.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FeatureHash {
+    /// Signed 32-bit MurmurHash3 with the given seed. With seed 0 the column is
+    /// `|h| % n_features` and the sign is the sign of `h`, as in scikit-learn's
+    /// `FeatureHasher` and `HashingVectorizer`.
+    Murmur3 {
+        /// The MurmurHash3 seed.
+        seed: u32,
+    },
+    /// 64-bit CityHash: the column is `h % n_features` and the sign is the top bit of `h`.
+    City64,
+}
+
+/// A sparse matrix in compressed sparse row (CSR) form.
+///
+/// Row `r` has its column indices in `indices[indptr[r]..indptr[r + 1]]`, sorted and
+/// distinct, with the matching values at the same positions of `data`. The arrays have the
+/// layout `scipy.sparse.csr_matrix((data, indices, indptr))` expects.
+#[derive(Debug, Clone, PartialEq)]
+pub struct CsrMatrix {
+    /// Row offsets into `indices` and `data`, one more than the number of rows.
+    pub indptr: Vec<usize>,
+    /// Column index of every stored value.
+    pub indices: Vec<u32>,
+    /// The stored values.
+    pub data: Vec<f32>,
+    /// The number of columns.
+    pub n_features: usize,
+}
+
+impl CsrMatrix {
+    /// Returns the number of rows.
+    pub fn rows(&self) -> usize {
+        self.indptr.len() - 1
+    }
+
+    /// Returns the number of stored values.
+    pub fn nnz(&self) -> usize {
+        self.indices.len()
+    }
+
+    /// Returns the column indices and values of row `r`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `r` is not less than [`CsrMatrix::rows`].
+    pub fn row(&self, r: usize) -> (&[u32], &[f32]) {
+        let range = self.indptr[r]..self.indptr[r + 1];
+        (&self.indices[range.clone()], &self.data[range])
+    }
+}
+
+/// Maps documents to sparse feature vectors with the hashing trick.
+///
+/// Documents are split into tokens (runs of at least two alphanumeric or `_` characters,
+/// like scikit-learn's default `token_pattern`), optionally lowercased, and combined into word
+/// n-grams joined by single spaces. Each n-gram is hashed straight to a column; no vocabulary
+/// is kept. With alternate signs, each feature adds `+1` or `-1` depending on its hash, so
+/// collisions cancel out in expectation instead of piling up.
+///
+/// Tokens are found in place and each n-gram is assembled in a reused buffer, so nothing is
+/// allocated per token or n-gram. [`HashingVectorizer::transform`] vectorizes batches of
+/// documents in parallel and returns a [`CsrMatrix`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::feature_hash::HashingVectorizer;
+///
+/// let vectorizer = HashingVectorizer::new(1 << 20).ngram_range(1, 2);
+/// let matrix = vectorizer.transform(&["the quick fox", "The quick dog"]);
+///
+/// assert_eq!(matrix.rows(), 2);
+/// // Three unigrams and two bigrams per document
+/// assert_eq!(matrix.row(0).0.len(), 5);
+/// ```
+#[derive(Debug, Clone)]
+pub struct HashingVectorizer {
+    n_features: usize,
+    ngram_range: (usize, usize),
+    hash: FeatureHash,
+    alternate_sign: bool,
+    lowercase: bool,
+    min_token_len: usize,
+    l2_normalize: bool,
+    threads: usize,
+}
+
+impl HashingVectorizer {
+    /// Creates a vectorizer with `n_features` columns that hashes lowercased unigrams with
+    /// signed MurmurHash3 (seed 0) and alternate signs, using all available cores.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `n_features` is 0 or greater than 2^31.
+    pub fn new(n_features: usize) -> Self {
+        assert!(
+            (1..=1 << 31).contains(&n_features),
+            "n_features must be between 1 and 2^31"
+        );
+        Self {
+            n_features,
+            ngram_range: (1, 1),
+            hash: FeatureHash::Murmur3 { seed: 0 },
+            alternate_sign: true,
+            lowercase: true,
+            min_token_len: 2,
+            l2_normalize: false,
+            threads: 0,
+        }
+    }
+
+    /// Emits word n-grams for every `n` in `min..=max`.
+    ///
+    /// # Panics
+    ///
+    /// Panics unless `1 <= min <= max <= 8`.
+    pub fn ngram_range(mut self, min: usize, max: usize) -> Self {
+        assert!(
+            1 <= min && min <= max && max <= MAX_NGRAM,
+            "n-gram range must satisfy 1 <= min <= max <= 8"
+        );
+        self.ngram_range = (min, max);
+        self
+    }
+
+    /// Sets the hash function that maps features to columns and signs.
+    pub fn hash_function(mut self, hash: FeatureHash) -> Self {
+        self.hash = hash;
+        self
+    }
+
+    /// Sets whether features add `±1` by hash sign (`true`) or always `+1`.
+    pub fn alternate_sign(mut self, alternate_sign: bool) -> Self {
+        self.alternate_sign = alternate_sign;
+        self
+    }
+
+    /// Sets whether tokens are lowercased before hashing.
+    pub fn lowercase(mut self, lowercase: bool) -> Self {
+        self.lowercase = lowercase;
+        self
+    }
+
+    /// Sets the minimum token length in characters (scikit-learn's default pattern uses 2).
+    pub fn min_token_len(mut self, min_token_len: usize) -> Self {
+        self.min_token_len = min_token_len.max(1);
+        self
+    }
+
+    /// Sets whether each row is scaled to unit Euclidean norm, as scikit-learn's
+    /// `HashingVectorizer` does by default.
+    pub fn l2_normalize(mut self, l2_normalize: bool) -> Self {
+        self.l2_normalize = l2_normalize;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Returns the column and signed weight of a single feature string.
+    #[inline]
+    pub fn hash_feature(&self, feature: &[u8]) -> (u32, f32) {
+        let n = self.n_features as u64;
+        let (index, negative) = match self.hash {
+            FeatureHash::Murmur3 { seed } => {
+                let h = murmurhash3_32(feature, seed) as i32;
+                (h.unsigned_abs() as u64 % n, h < 0)
+            }
+            FeatureHash::City64 => {
+                let h = city_hash64(feature);
+                (h % n, h >> 63 == 1)
+            }
+        };
+        let sign = if self.alternate_sign && negative {
+            -1.0
+        } else {
+            1.0
+        };
+        (index as u32, sign)
+    }
+
+    /// Calls `f(column, weight)` for every n-gram of `document`, in document order and
+    /// without combining repeats.
+    pub fn for_each_feature<F: FnMut(u32, f32)>(&self, document: &str, mut f: F) {
+        let mut gram = Vec::new();
+        self.features(document, &mut gram, &mut f);
+    }
+
+    /// Vectorizes `documents`, one row each, in parallel.
+    ///
+    /// Repeated features within a document are summed, and entries that cancel to zero are
+    /// dropped.
+    pub fn transform<S: AsRef<str> + Sync>(&self, documents: &[S]) -> CsrMatrix {
+        let chunks = parallel::map_indices(
+            documents.len().div_ceil(DOCS_PER_CHUNK),
+            self.threads,
+            |c| {
+                let docs =
+                    &documents[c * DOCS_PER_CHUNK..((c + 1) * DOCS_PER_CHUNK).min(documents.len())];
+                let mut gram = Vec::new();
+                let mut row: Vec<(u32, f32)> = Vec::new();
+                let mut lengths = Vec::with_capacity(docs.len());
+                let mut indices = Vec::new();
+                let mut data = Vec::new();
+                for doc in docs {
+                    row.clear();
+                    self.features(doc.as_ref(), &mut gram, &mut |i, v| row.push((i, v)));
+                    let before = indices.len();
+                    self.compress_row(&mut row, &mut indices, &mut data);
+                    lengths.push(indices.len() - before);
+                }
+                (lengths, indices, data)
+            },
+        );
+
+        let nnz = chunks.iter().map(|(_, indices, _)| indices.len()).sum();
+        let mut matrix = CsrMatrix {
+            indptr: Vec::with_capacity(documents.len() + 1),
+            indices: Vec::with_capacity(nnz),
+            data: Vec::with_capacity(nnz),
+            n_features: self.n_features,
+        };
+        matrix.indptr.push(0);
+        for (lengths, indices, data) in chunks {
+            for len in lengths {
+                let end = matrix.indptr.last().unwrap() + len;
+                matrix.indptr.push(end);
+            }
+            matrix.indices.extend_from_slice(&indices);
+            matrix.data.extend_from_slice(&data);
+        }
+        matrix
+    }
+
+    // Tokenizes `document` and emits every n-gram, assembling each one in `gram`
+    fn features<F: FnMut(u32, f32)>(&self, document: &str, gram: &mut Vec<u8>, f: &mut F) {
+        let (min_n, max_n) = self.ngram_range;
+        // Byte ranges of the last `max_n` tokens, as a ring
+        let mut window = [(0usize, 0usize); MAX_NGRAM];
+        let mut seen = 0usize;
+
+        for token in Tokens::new(document, self.min_token_len) {
+            window[seen % MAX_NGRAM] = token;
+            seen += 1;
+            for n in min_n..=max_n.min(seen) {
+                gram.clear();
+                for k in (0..n).rev() {
+                    let (start, end) = window[(seen - 1 - k) % MAX_NGRAM];
+                    if !gram.is_empty() {
+                        gram.push(b' ');
+                    }
+                    self.push_token(&document[start..end], gram);
+                }
+                let (index, value) = self.hash_feature(gram);
+                f(index, value);
+            }
+        }
+    }
+
+    #[inline]
+    fn push_token(&self, token: &str, gram: &mut Vec<u8>) {
+        if !self.lowercase {
+            gram.extend_from_slice(token.as_bytes());
+        } else if token.is_ascii() {
+            gram.extend(token.bytes().map(|b| b.to_ascii_lowercase()));
+        } else {
+            let mut utf8 = [0u8; 4];
+            for c in token.chars().flat_map(char::to_lowercase) {
+                gram.extend_from_slice(c.encode_utf8(&mut utf8).as_bytes());
+            }
+        }
+    }
+
+    // Sorts a row's features by column, sums repeats, and appends the non-zero results
+    fn compress_row(&self, row: &mut [(u32, f32)], indices: &mut Vec<u32>, data: &mut Vec<f32>) {
+        row.sort_unstable_by_key(|&(i, _)| i);
+        let start = indices.len();
+        let mut k = 0;
+        while k < row.len() {
+            let index = row[k].0;
+            let mut value = 0.0;
+            while k < row.len() && row[k].0 == index {
+                value += row[k].1;
+                k += 1;
+            }
+            if value != 0.0 {
+                indices.push(index);
+                data.push(value);
+            }
+        }
+        if self.l2_normalize {
+            let norm = data[start..].iter().map(|v| v * v).sum::<f32>().sqrt();
+            if norm > 0.0 {
+                data[start..].iter_mut().for_each(|v| *v /= norm);
+            }
+        }
+    }
+}
+
+// Iterates the byte ranges of a document's tokens: maximal runs of alphanumeric or `_`
+// characters that are at least `min_len` characters long
+struct Tokens<'a> {
+    text: &'a str,
+    pos: usize,
+    min_len: usize,
+}
+
+impl<'a> Tokens<'a> {
+    fn new(text: &'a str, min_len: usize) -> Self {
+        Self {
+            text,
+            pos: 0,
+            min_len,
+        }
+    }
+}
+
+#[inline]
+fn is_word(c: char) -> bool {
+    c.is_alphanumeric() || c == '_'
+}
+
+impl Iterator for Tokens<'_> {
+    type Item = (usize, usize);
+
+    fn next(&mut self) -> Option<(usize, usize)> {
+        let bytes = self.text.as_bytes();
+        loop {
+            // Skip separators, with an ASCII fast path
+            while self.pos < bytes.len() {
+                let b = bytes[self.pos];
+                if b.is_ascii() {
+                    if b.is_ascii_alphanumeric() || b == b'_' {
+                        break;
+                    }
+                    self.pos += 1;
+                } else {
+                    let c = self.text[self.pos..].chars().next().unwrap();
+                    if is_word(c) {
+                        break;
+                    }
+                    self.pos += c.len_utf8();
+                }
+            }
+            if self.pos >= bytes.len() {
+                return None;
+            }
+
+            let start = self.pos;
+            let mut chars = 0;
+            while self.pos < bytes.len() {
+                let b = bytes[self.pos];
+                if b.is_ascii() {
+                    if !(b.is_ascii_alphanumeric() || b == b'_') {
+                        break;
+                    }
+                    self.pos += 1;
+                } else {
+                    let c = self.text[self.pos..].chars().next().unwrap();
+                    if !is_word(c) {
+                        break;
+                    }
+                    self.pos += c.len_utf8();
+                }
+                chars += 1;
+            }
+            if chars >= self.min_len {
+                return Some((start, self.pos));
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn features(vectorizer: &HashingVectorizer, doc: &str) -> Vec<(u32, f32)> {
+        let mut out = Vec::new();
+        vectorizer.for_each_feature(doc, |i, v| out.push((i, v)));
+        out
+    }
+
+    #[test]
+    fn test_matches_scikit_learn_hashing() {
+        // sklearn.utils.murmurhash3_32("foo", seed=0) == -156908512
+        let vectorizer = HashingVectorizer::new(1 << 20);
+        assert_eq!(
+            vectorizer.hash_feature(b"foo"),
+            (156908512 % (1 << 20), -1.0)
+        );
+        assert_eq!(
+            vectorizer.alternate_sign(false).hash_feature(b"foo"),
+            (156908512 % (1 << 20), 1.0)
+        );
+    }
+
+    #[test]
+    fn test_tokenizes_like_default_pattern() {
+        let text = "A cat's   naïve_fox, x2 Ünïcode!";
+        let tokens: Vec<&str> = Tokens::new(text, 2).map(|(s, e)| &text[s..e]).collect();
+        assert_eq!(tokens, ["cat", "naïve_fox", "x2", "Ünïcode"]);
+    }
+
+    #[test]
+    fn test_ngrams_hash_joined_tokens() {
+        let vectorizer = HashingVectorizer::new(1 << 18)
+            .ngram_range(1, 3)
+            .hash_function(FeatureHash::City64);
+        let expected: Vec<(u32, f32)> = [
+            "the",
+            "quick",
+            "the quick",
+            "fox",
+            "quick fox",
+            "the quick fox",
+        ]
+        .iter()
+        .map(|g| vectorizer.hash_feature(g.as_bytes()))
+        .collect();
+        assert_eq!(features(&vectorizer, "The QUICK -- fox"), expected);
+    }
+
+    #[test]
+    fn test_transform_builds_csr() {
+        let docs: Vec<String> = (0..1000)
+            .map(|i| format!("doc {} shares words with doc {}", i, i % 7))
+            .collect();
+        let vectorizer = HashingVectorizer::new(1 << 16).ngram_range(1, 2).threads(4);
+        let matrix = vectorizer.transform(&docs);
+        assert_eq!(matrix.rows(), docs.len());
+
+        for (r, doc) in docs.iter().enumerate() {
+            let mut expected: Vec<(u32, f32)> = features(&vectorizer, doc);
+            expected.sort_by_key(|&(i, _)| i);
+            let mut summed: Vec<(u32, f32)> = Vec::new();
+            for (i, v) in expected {
+                match summed.last_mut() {
+                    Some(last) if last.0 == i => last.1 += v,
+                    _ => summed.push((i, v)),
+                }
+            }
+            summed.retain(|&(_, v)| v != 0.0);
+            let (indices, data) = matrix.row(r);
+            let actual: Vec<(u32, f32)> =
+                indices.iter().copied().zip(data.iter().copied()).collect();
+            assert_eq!(actual, summed);
+        }
+
+        let normalized = vectorizer.l2_normalize(true).transform(&docs[..1]);
+        let norm: f32 = normalized.data.iter().map(|v| v * v).sum();
+        assert!((norm - 1.0).abs() < 1e-5);
+    }
+}
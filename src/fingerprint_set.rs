@@ -0,0 +1,417 @@
+use std::fmt;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+
+// Slot value for a slot that has never been written
+const EMPTY: u64 = 0;
+
+/// Slot value marking a removed fingerprint. It is never stored as a fingerprint; see
+/// [`FingerprintSet::normalize`].
+pub const TOMBSTONE: u64 = u64::MAX;
+
+// How many fingerprints ahead `insert_batch` prefetches
+const PREFETCH_DISTANCE: usize = 8;
+
+/// Error returned when a [`FingerprintSet`] has reached its capacity.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct SetFull {
+    /// Number of fingerprints from the batch that were processed before the set filled up
+    /// (always 0 for single inserts). Resume the batch from this index after growing.
+    pub processed: usize,
+    /// Number of those processed fingerprints that were newly inserted
+    pub inserted: usize,
+}
+
+impl fmt::Display for SetFull {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "fingerprint set is full after processing {} fingerprints",
+            self.processed
+        )
+    }
+}
+
+impl std::error::Error for SetFull {}
+
+/// A lock-free, fixed-capacity set of 64-bit fingerprints.
+///
+/// Fingerprints (for example from [`city_hash64`](crate::city::city_hash64) or
+/// [`farm_fingerprint64`](crate::farm::farm_fingerprint64)) are stored directly in an
+/// open-addressed array of `AtomicU64` slots with linear probing. Insertion claims an empty
+/// slot with a single compare-and-swap, so any number of threads can insert, query and
+/// remove concurrently through `&self` without locks.
+///
+/// Two slot values are reserved: `0` marks an empty slot and [`TOMBSTONE`] a removed one.
+/// Fingerprints equal to either are remapped by [`normalize`](FingerprintSet::normalize),
+/// which merges them with a neighbouring value; for hashed keys that happens with probability
+/// 2^-63. Tombstoned slots are not reused until the set is [`grow`](FingerprintSet::grow)n,
+/// which migrates the live fingerprints into a larger table.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::city::city_hash64;
+/// use simplehash::fingerprint_set::FingerprintSet;
+/// use std::thread;
+///
+/// let seen = FingerprintSet::with_capacity(1000);
+/// let fresh: usize = thread::scope(|s| {
+///     let handles: Vec<_> = (0..4)
+///         .map(|_| {
+///             let seen = &seen;
+///             s.spawn(move || {
+///                 (0..100)
+///                     .map(|i| city_hash64(format!("event-{}", i).as_bytes()))
+///                     .filter(|&fp| seen.insert(fp).unwrap())
+///                     .count()
+///             })
+///         })
+///         .collect();
+///     handles.into_iter().map(|h| h.join().unwrap()).sum()
+/// });
+/// // Each event was new to exactly one thread
+/// assert_eq!(fresh, 100);
+/// assert_eq!(seen.len(), 100);
+/// ```
+pub struct FingerprintSet {
+    slots: Box<[AtomicU64]>,
+    mask: usize,
+    max_used: usize,
+    // Slots that are no longer empty, live or tombstoned
+    used: AtomicUsize,
+    removed: AtomicUsize,
+}
+
+impl FingerprintSet {
+    /// Creates a set that can hold at least `capacity` fingerprints.
+    ///
+    /// The slot array is the next power of two that keeps the load at or below 7/8.
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self::with_slots((capacity + capacity / 7 + 1).next_power_of_two().max(16))
+    }
+
+    // `slots` must be a power of two
+    fn with_slots(slots: usize) -> Self {
+        Self {
+            slots: (0..slots).map(|_| AtomicU64::new(EMPTY)).collect(),
+            mask: slots - 1,
+            max_used: slots / 8 * 7,
+            used: AtomicUsize::new(0),
+            removed: AtomicUsize::new(0),
+        }
+    }
+
+    /// Maps the two reserved slot values onto ordinary fingerprints.
+    ///
+    /// All methods apply this to their input, so callers only need it when comparing
+    /// fingerprints obtained from the set with their own.
+    #[inline]
+    pub fn normalize(fingerprint: u64) -> u64 {
+        match fingerprint {
+            EMPTY => 1,
+            TOMBSTONE => TOMBSTONE - 1,
+            fp => fp,
+        }
+    }
+
+    #[inline]
+    fn home(&self, fingerprint: u64) -> usize {
+        fingerprint as usize & self.mask
+    }
+
+    /// Inserts `fingerprint`, returning `Ok(true)` if it was not already present.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`SetFull`] if the fingerprint is new but the set has no room left for it.
+    #[inline]
+    pub fn insert(&self, fingerprint: u64) -> Result<bool, SetFull> {
+        self.insert_normalized(Self::normalize(fingerprint))
+            .ok_or(SetFull {
+                processed: 0,
+                inserted: 0,
+            })
+    }
+
+    // Returns None when the set is full
+    #[inline]
+    fn insert_normalized(&self, fp: u64) -> Option<bool> {
+        let mut slot = self.home(fp);
+        for _ in 0..=self.mask {
+            let mut current = self.slots[slot].load(Ordering::Acquire);
+            if current == EMPTY {
+                // Relaxed: the bound only needs to be approximate, concurrent inserters may
+                // overshoot it by at most one slot each and the table keeps 1/8 free
+                if self.used.load(Ordering::Relaxed) >= self.max_used {
+                    return None;
+                }
+                match self.slots[slot].compare_exchange(
+                    EMPTY,
+                    fp,
+                    Ordering::AcqRel,
+                    Ordering::Acquire,
+                ) {
+                    Ok(_) => {
+                        self.used.fetch_add(1, Ordering::Relaxed);
+                        return Some(true);
+                    }
+                    // Another thread claimed the slot first; re-examine what it wrote
+                    Err(actual) => current = actual,
+                }
+            }
+            if current == fp {
+                return Some(false);
+            }
+            slot = (slot + 1) & self.mask;
+        }
+        None
+    }
+
+    /// Returns `true` if `fingerprint` is in the set.
+    #[inline]
+    pub fn contains(&self, fingerprint: u64) -> bool {
+        self.find(Self::normalize(fingerprint)).is_some()
+    }
+
+    #[inline]
+    fn find(&self, fp: u64) -> Option<usize> {
+        let mut slot = self.home(fp);
+        for _ in 0..=self.mask {
+            match self.slots[slot].load(Ordering::Acquire) {
+                EMPTY => return None,
+                current if current == fp => return Some(slot),
+                _ => slot = (slot + 1) & self.mask,
+            }
+        }
+        None
+    }
+
+    /// Removes `fingerprint`, returning `true` if it was present.
+    ///
+    /// The slot is tombstoned rather than emptied, so it stays occupied until the next
+    /// [`grow`](FingerprintSet::grow).
+    pub fn remove(&self, fingerprint: u64) -> bool {
+        let fp = Self::normalize(fingerprint);
+        match self.find(fp) {
+            Some(slot) => {
+                let removed = self.slots[slot]
+                    .compare_exchange(fp, TOMBSTONE, Ordering::AcqRel, Ordering::Acquire)
+                    .is_ok();
+                if removed {
+                    self.removed.fetch_add(1, Ordering::Relaxed);
+                }
+                removed
+            }
+            None => false,
+        }
+    }
+
+    /// Inserts a batch of fingerprints and returns how many were new.
+    ///
+    /// Slots a few fingerprints ahead are prefetched while the current one is processed, so
+    /// the cache misses of a large, randomly accessed table overlap instead of being paid
+    /// one after another.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`SetFull`] with the progress made so far if the set fills up mid-batch.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::fingerprint_set::FingerprintSet;
+    ///
+    /// let mut set = FingerprintSet::with_capacity(16);
+    /// let batch: Vec<u64> = (1..=100).collect();
+    /// let mut done = 0;
+    /// while let Err(full) = set.insert_batch(&batch[done..]) {
+    ///     done += full.processed;
+    ///     set.grow();
+    /// }
+    /// assert_eq!(set.len(), 100);
+    /// ```
+    pub fn insert_batch(&self, fingerprints: &[u64]) -> Result<usize, SetFull> {
+        let mut inserted = 0;
+        for (i, &fingerprint) in fingerprints.iter().enumerate() {
+            if let Some(&ahead) = fingerprints.get(i + PREFETCH_DISTANCE) {
+                prefetch(&self.slots[self.home(Self::normalize(ahead))]);
+            }
+            match self.insert_normalized(Self::normalize(fingerprint)) {
+                Some(true) => inserted += 1,
+                Some(false) => {}
+                None => {
+                    return Err(SetFull {
+                        processed: i,
+                        inserted,
+                    });
+                }
+            }
+        }
+        Ok(inserted)
+    }
+
+    /// Migrates the live fingerprints into a table with twice as many slots, dropping
+    /// tombstones.
+    ///
+    /// Growing needs exclusive access. To grow while other threads keep inserting, keep the
+    /// set in an `RwLock`: insert under the read lock, and on [`SetFull`] retry under the
+    /// write lock after growing.
+    pub fn grow(&mut self) {
+        // The live count never exceeds the capacity, so it always fits the doubled table
+        let live = self.len();
+        let mut grown = Self::with_slots(self.slots.len() * 2);
+        for slot in self.slots.iter_mut() {
+            let fp = *slot.get_mut();
+            if fp != EMPTY && fp != TOMBSTONE {
+                let mut target = grown.home(fp);
+                while *grown.slots[target].get_mut() != EMPTY {
+                    target = (target + 1) & grown.mask;
+                }
+                *grown.slots[target].get_mut() = fp;
+            }
+        }
+        *grown.used.get_mut() = live;
+        *self = grown;
+    }
+
+    /// Returns the number of fingerprints in the set.
+    pub fn len(&self) -> usize {
+        self.used.load(Ordering::Relaxed) - self.removed.load(Ordering::Relaxed)
+    }
+
+    /// Returns `true` if the set holds no fingerprints.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns how many slots can be filled, including tombstones, before inserts fail.
+    pub fn capacity(&self) -> usize {
+        self.max_used
+    }
+
+    /// Returns the heap size of the slot array in bytes.
+    pub fn memory_usage(&self) -> usize {
+        self.slots.len() * std::mem::size_of::<AtomicU64>()
+    }
+
+    /// Iterates over the fingerprints currently in the set, in slot order.
+    ///
+    /// The iterator reads slots one at a time; fingerprints inserted or removed concurrently
+    /// may or may not be observed.
+    pub fn iter(&self) -> impl Iterator<Item = u64> + '_ {
+        self.slots
+            .iter()
+            .map(|slot| slot.load(Ordering::Acquire))
+            .filter(|&fp| fp != EMPTY && fp != TOMBSTONE)
+    }
+}
+
+impl fmt::Debug for FingerprintSet {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("FingerprintSet")
+            .field("len", &self.len())
+            .field("capacity", &self.capacity())
+            .finish()
+    }
+}
+
+#[inline(always)]
+fn prefetch(slot: &AtomicU64) {
+    #[cfg(target_arch = "x86_64")]
+    // SAFETY: prefetching is a hint and never faults, even for invalid addresses
+    #[allow(unused_unsafe)]
+    unsafe {
+        use std::arch::x86_64::{_MM_HINT_T0, _mm_prefetch};
+        _mm_prefetch(slot.as_ptr() as *const i8, _MM_HINT_T0);
+    }
+    #[cfg(not(target_arch = "x86_64"))]
+    let _ = slot;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::city::city_hash64;
+    use std::collections::HashSet;
+
+    #[test]
+    fn test_insert_contains_remove() {
+        let set = FingerprintSet::with_capacity(1000);
+        let fps: Vec<u64> = (0..1000u64)
+            .map(|i| city_hash64(&i.to_le_bytes()))
+            .collect();
+        for &fp in &fps {
+            assert_eq!(set.insert(fp), Ok(true));
+            assert_eq!(set.insert(fp), Ok(false));
+        }
+        assert_eq!(set.len(), 1000);
+        assert!(fps.iter().all(|&fp| set.contains(fp)));
+
+        for &fp in fps.iter().step_by(3) {
+            assert!(set.remove(fp));
+            assert!(!set.remove(fp));
+        }
+        for (i, &fp) in fps.iter().enumerate() {
+            assert_eq!(set.contains(fp), i % 3 != 0);
+        }
+        assert_eq!(set.len(), 1000 - 334);
+        // A removed fingerprint can be inserted again
+        assert_eq!(set.insert(fps[0]), Ok(true));
+    }
+
+    #[test]
+    fn test_reserved_values() {
+        let set = FingerprintSet::with_capacity(4);
+        assert_eq!(set.insert(0), Ok(true));
+        assert_eq!(set.insert(TOMBSTONE), Ok(true));
+        assert!(set.contains(0) && set.contains(1));
+        assert!(set.contains(TOMBSTONE) && set.contains(TOMBSTONE - 1));
+        assert_eq!(set.len(), 2);
+    }
+
+    #[test]
+    fn test_full_and_grow() {
+        let mut set = FingerprintSet::with_capacity(10);
+        let capacity = set.capacity();
+        let fps: Vec<u64> = (1..=capacity as u64 * 2).collect();
+
+        let err = set.insert_batch(&fps).unwrap_err();
+        assert_eq!(err.processed, capacity);
+        assert_eq!(err.inserted, capacity);
+        assert!(set.insert(u64::MAX - 7).is_err());
+        // Existing fingerprints are still found when the set is full
+        assert_eq!(set.insert(1), Ok(false));
+
+        set.remove(1);
+        let memory = set.memory_usage();
+        set.grow();
+        assert_eq!(set.memory_usage(), 2 * memory);
+        assert_eq!(set.capacity(), 2 * capacity);
+        assert_eq!(set.len(), capacity - 1);
+        assert_eq!(set.insert_batch(&fps[capacity..]), Ok(fps.len() - capacity));
+        let expected: HashSet<u64> = fps[1..].iter().copied().collect();
+        assert_eq!(set.iter().collect::<HashSet<u64>>(), expected);
+    }
+
+    #[test]
+    fn test_concurrent_inserts_are_deduplicated() {
+        let set = FingerprintSet::with_capacity(20_000);
+        let fresh: usize = std::thread::scope(|s| {
+            let handles: Vec<_> = (0..4u64)
+                .map(|t| {
+                    let set = &set;
+                    s.spawn(move || {
+                        // Overlapping ranges: every fingerprint is offered by two threads
+                        let fps: Vec<u64> = (t * 5000..t * 5000 + 10_000)
+                            .map(|i| city_hash64(&(i % 20_000).to_le_bytes()))
+                            .collect();
+                        set.insert_batch(&fps).unwrap()
+                    })
+                })
+                .collect();
+            handles.into_iter().map(|h| h.join().unwrap()).sum()
+        });
+        assert_eq!(fresh, 20_000);
+        assert_eq!(set.len(), 20_000);
+    }
+}
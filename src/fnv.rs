@@ -2,8 +2,8 @@ use std::hash::Hasher as StdHasher;
 
 const FNV_32_OFFSET: u32 = 0x811c9dc5;
 const FNV_32_PRIME: u32 = 0x01000193;
-const FNV_64_OFFSET: u64 = 0xcbf29ce484222325;
-const FNV_64_PRIME: u64 = 0x00000100000001b3;
+pub(crate) const FNV_64_OFFSET: u64 = 0xcbf29ce484222325;
+pub(crate) const FNV_64_PRIME: u64 = 0x00000100000001b3;
 
 // FNV-1 32-bit hasher implementation
 #[derive(Debug, Copy, Clone)]
@@ -0,0 +1,782 @@
+use crate::join::ColumnKey;
+use crate::murmur::fmix64;
+use crate::parallel::{self, resolve_threads};
+use std::sync::Mutex;
+
+// Groups a thread-local pre-aggregation table holds before it is flushed to the partitions
+const LOCAL_GROUPS: usize = 1 << 14;
+// Rows per local group below which pre-aggregation is not worth its lookups
+const MIN_REDUCTION: usize = 2;
+const ROWS_PER_PARTITION: usize = 1 << 16;
+const MAX_PARTITION_BITS: u32 = 10;
+const MIN_CHUNK_ROWS: usize = 1 << 16;
+// Rows looked up together before their values are folded in column by column
+const BATCH_ROWS: usize = 1 << 10;
+// Rows pre-aggregated before their partial states are merged, which bounds the memory used
+// on top of the inputs and the final groups
+const BLOCK_ROWS: usize = 1 << 22;
+const EMPTY: u32 = u32::MAX;
+// Keeps value 0 away from fmix64's fixed point before it feeds a HyperLogLog
+const DISTINCT_SEED: u64 = 0x9e3779b97f4a7c15;
+
+/// An aggregate computed per group by [`GroupBy`].
+///
+/// Each variant except `Count` names a value column by its index in the `values` slice
+/// passed to [`GroupBy::run`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Aggregate {
+    /// Number of rows in the group.
+    Count,
+    /// Wrapping sum of the column.
+    Sum(usize),
+    /// Minimum of the column.
+    Min(usize),
+    /// Maximum of the column.
+    Max(usize),
+    /// HyperLogLog estimate of the number of distinct values in the column.
+    Distinct(usize),
+}
+
+/// The result of a [`GroupBy`]: one row per distinct key.
+///
+/// `columns[a][g]` is aggregate `a` (in the order passed to [`GroupBy::new`]) for the group
+/// keyed by `keys[g]`. Groups come out grouped by partition, not sorted.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Grouped<K> {
+    /// The distinct keys.
+    pub keys: Vec<K>,
+    /// One column per requested aggregate.
+    pub columns: Vec<Vec<i64>>,
+}
+
+impl<K> Grouped<K> {
+    /// Returns the number of groups.
+    pub fn len(&self) -> usize {
+        self.keys.len()
+    }
+
+    /// Returns `true` if there are no groups.
+    pub fn is_empty(&self) -> bool {
+        self.keys.is_empty()
+    }
+}
+
+/// A parallel hash aggregation (`GROUP BY`) engine over columnar inputs.
+///
+/// Keys are hashed once with [`ColumnKey::column_hash`]; multi-column keys are columns of
+/// tuples. Each worker pre-aggregates its rows in a small thread-local table and flushes the
+/// partial states to radix partitions chosen by the top bits of the hash. Partitions are then
+/// merged in parallel, each into its own table, so no table is shared between threads.
+///
+/// When a worker's local table stops reducing its input (high-cardinality keys, about one
+/// row per group), the worker switches to scattering rows straight to the partitions, and
+/// all aggregation happens in the cache-sized partition merges.
+///
+/// `Distinct` keeps a HyperLogLog of `2^precision` one-byte registers per group (256 bytes
+/// and about 6.5% standard error with the default precision of 8).
+///
+/// # Example
+///
+/// ```
+/// use simplehash::group_by::{Aggregate, GroupBy};
+///
+/// let store = ["north", "south", "north", "north"];
+/// let amount = [10, 5, 7, 10];
+/// let customer = [1, 2, 1, 3];
+///
+/// let result = GroupBy::new(&[
+///     Aggregate::Count,
+///     Aggregate::Sum(0),
+///     Aggregate::Max(0),
+///     Aggregate::Distinct(1),
+/// ])
+/// .run(&store, &[&amount, &customer]);
+///
+/// let north = result.keys.iter().position(|&k| k == "north").unwrap();
+/// let row: Vec<i64> = result.columns.iter().map(|c| c[north]).collect();
+/// assert_eq!(row, [3, 27, 10, 2]);
+/// ```
+#[derive(Debug, Clone)]
+pub struct GroupBy {
+    aggregates: Vec<Aggregate>,
+    precision: u32,
+    partition_bits: Option<u32>,
+    threads: usize,
+}
+
+impl GroupBy {
+    /// Creates an engine computing `aggregates` for every group, using all available cores.
+    pub fn new(aggregates: &[Aggregate]) -> Self {
+        Self {
+            aggregates: aggregates.to_vec(),
+            precision: 8,
+            partition_bits: None,
+            threads: 0,
+        }
+    }
+
+    /// Sets the HyperLogLog precision for `Distinct` aggregates: `2^precision` bytes per
+    /// group, with a standard error of about `1.04 / sqrt(2^precision)`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `precision` is not between 4 and 16.
+    pub fn distinct_precision(mut self, precision: u32) -> Self {
+        assert!(
+            (4..=16).contains(&precision),
+            "precision must be between 4 and 16"
+        );
+        self.precision = precision;
+        self
+    }
+
+    /// Fixes the number of partitions to `2^bits` instead of deriving it from the row count.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `bits` is greater than 10.
+    pub fn partition_bits(mut self, bits: u32) -> Self {
+        assert!(
+            bits <= MAX_PARTITION_BITS,
+            "at most 2^10 partitions are supported"
+        );
+        self.partition_bits = Some(bits);
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Groups the rows by `keys` and computes the aggregates over `values`.
+    ///
+    /// # Parameters
+    ///
+    /// * `keys` - The key column
+    /// * `values` - Value columns, referenced by index from the aggregates
+    ///
+    /// # Returns
+    ///
+    /// One row per distinct key, with one column per aggregate.
+    ///
+    /// # Panics
+    ///
+    /// Panics if an aggregate names a missing value column, if a value column's length
+    /// differs from the key column's, or if there are more than `u32::MAX` groups.
+    pub fn run<K: ColumnKey>(&self, keys: &[K], values: &[&[i64]]) -> Grouped<K> {
+        let layout = Layout::new(&self.aggregates, self.precision, values.len());
+        for aggregate in &self.aggregates {
+            if let Some(column) = aggregate.column() {
+                assert!(
+                    column < values.len(),
+                    "aggregate refers to missing value column {}",
+                    column
+                );
+            }
+        }
+        assert!(
+            values.iter().all(|v| v.len() == keys.len()),
+            "value columns must have as many rows as the key column"
+        );
+
+        let bits = self
+            .partition_bits
+            .unwrap_or_else(|| self.default_partition_bits(keys.len()));
+        let partitions = 1usize << bits;
+        let tables: Vec<Mutex<Table<K>>> = (0..partitions)
+            .map(|_| Mutex::new(Table::with_capacity(0)))
+            .collect();
+
+        for start in (0..keys.len()).step_by(BLOCK_ROWS) {
+            let end = (start + BLOCK_ROWS).min(keys.len());
+            let partials = pre_aggregate(&layout, keys, values, start..end, bits, self.threads);
+            parallel::map_indices(partitions, self.threads, |p| {
+                let mut table = tables[p].lock().unwrap();
+                let mut groups = Vec::with_capacity(BATCH_ROWS);
+                for chunk in &partials {
+                    table.merge_chunk(&layout, chunk, p, &mut groups);
+                }
+            });
+        }
+
+        let finished = parallel::map_indices(partitions, self.threads, |p| {
+            let mut table = tables[p].lock().unwrap();
+            table.finish(&layout)
+        });
+        let mut out = Grouped {
+            keys: Vec::new(),
+            columns: vec![Vec::new(); self.aggregates.len()],
+        };
+        for part in finished {
+            out.keys.extend_from_slice(&part.keys);
+            for (column, values) in out.columns.iter_mut().zip(&part.columns) {
+                column.extend_from_slice(values);
+            }
+        }
+        out
+    }
+
+    fn default_partition_bits(&self, rows: usize) -> u32 {
+        let for_rows = rows
+            .div_ceil(ROWS_PER_PARTITION)
+            .next_power_of_two()
+            .trailing_zeros();
+        let workers = resolve_threads(self.threads);
+        let for_threads = if workers > 1 {
+            (workers * 4).next_power_of_two().trailing_zeros()
+        } else {
+            0
+        };
+        for_rows.max(for_threads).min(MAX_PARTITION_BITS)
+    }
+}
+
+impl Aggregate {
+    fn column(self) -> Option<usize> {
+        match self {
+            Aggregate::Count => None,
+            Aggregate::Sum(c) | Aggregate::Min(c) | Aggregate::Max(c) | Aggregate::Distinct(c) => {
+                Some(c)
+            }
+        }
+    }
+}
+
+// Where each aggregate's state lives: a slot in the group's `i64` accumulators, or a run of
+// HyperLogLog registers
+struct Layout {
+    ops: Vec<(Aggregate, usize)>,
+    acc_width: usize,
+    hll_width: usize,
+    precision: u32,
+    // Value columns read by at least one aggregate
+    columns: Vec<usize>,
+    num_columns: usize,
+}
+
+impl Layout {
+    fn new(aggregates: &[Aggregate], precision: u32, num_columns: usize) -> Self {
+        let registers = 1usize << precision;
+        let (mut acc_width, mut hll_width) = (0, 0);
+        let ops = aggregates
+            .iter()
+            .map(|&aggregate| {
+                let offset = match aggregate {
+                    Aggregate::Distinct(_) => {
+                        hll_width += registers;
+                        hll_width - registers
+                    }
+                    _ => {
+                        acc_width += 1;
+                        acc_width - 1
+                    }
+                };
+                (aggregate, offset)
+            })
+            .collect();
+        let mut columns: Vec<usize> = aggregates.iter().filter_map(|a| a.column()).collect();
+        columns.sort_unstable();
+        columns.dedup();
+        Self {
+            ops,
+            acc_width,
+            hll_width,
+            precision,
+            columns,
+            num_columns,
+        }
+    }
+}
+
+// Aggregate states stored column-wise, one entry per group
+struct States<K> {
+    keys: Vec<K>,
+    hashes: Vec<u64>,
+    acc: Vec<i64>,
+    hll: Vec<u8>,
+}
+
+impl<K: ColumnKey> States<K> {
+    fn new() -> Self {
+        Self {
+            keys: Vec::new(),
+            hashes: Vec::new(),
+            acc: Vec::new(),
+            hll: Vec::new(),
+        }
+    }
+
+    #[inline]
+    fn len(&self) -> usize {
+        self.keys.len()
+    }
+
+    fn push_empty(&mut self, layout: &Layout, key: K, hash: u64) {
+        self.keys.push(key);
+        self.hashes.push(hash);
+        for &(aggregate, _) in &layout.ops {
+            match aggregate {
+                Aggregate::Count | Aggregate::Sum(_) => self.acc.push(0),
+                Aggregate::Min(_) => self.acc.push(i64::MAX),
+                Aggregate::Max(_) => self.acc.push(i64::MIN),
+                Aggregate::Distinct(_) => {}
+            }
+        }
+        self.hll.resize(self.hll.len() + layout.hll_width, 0);
+    }
+
+    fn push_copy(&mut self, layout: &Layout, src: &States<K>, i: usize) {
+        self.keys.push(src.keys[i]);
+        self.hashes.push(src.hashes[i]);
+        let acc = i * layout.acc_width;
+        self.acc
+            .extend_from_slice(&src.acc[acc..acc + layout.acc_width]);
+        let hll = i * layout.hll_width;
+        self.hll
+            .extend_from_slice(&src.hll[hll..hll + layout.hll_width]);
+    }
+
+    // Folds rows `first_row..` of `values` into `groups` (one group per row), one aggregate
+    // at a time so each inner loop is a tight scatter over a single column
+    fn update_batch(
+        &mut self,
+        layout: &Layout,
+        groups: &[u32],
+        values: &[&[i64]],
+        first_row: usize,
+    ) {
+        debug_assert!(groups.iter().all(|&g| (g as usize) < self.len()));
+        let w = layout.acc_width;
+        // SAFETY (every `get_unchecked_mut` below): group ids come from `Table::groups` on the
+        // table owning these states, so each group's `w` accumulators exist
+        for &(aggregate, offset) in &layout.ops {
+            let column = |c: usize| &values[c][first_row..first_row + groups.len()];
+            match aggregate {
+                Aggregate::Count => {
+                    for &g in groups {
+                        *unsafe { self.acc.get_unchecked_mut(g as usize * w + offset) } += 1;
+                    }
+                }
+                Aggregate::Sum(c) => {
+                    for (&g, &v) in groups.iter().zip(column(c)) {
+                        let a = unsafe { self.acc.get_unchecked_mut(g as usize * w + offset) };
+                        *a = a.wrapping_add(v);
+                    }
+                }
+                Aggregate::Min(c) => {
+                    for (&g, &v) in groups.iter().zip(column(c)) {
+                        let a = unsafe { self.acc.get_unchecked_mut(g as usize * w + offset) };
+                        *a = (*a).min(v);
+                    }
+                }
+                Aggregate::Max(c) => {
+                    for (&g, &v) in groups.iter().zip(column(c)) {
+                        let a = unsafe { self.acc.get_unchecked_mut(g as usize * w + offset) };
+                        *a = (*a).max(v);
+                    }
+                }
+                Aggregate::Distinct(c) => {
+                    let registers = 1 << layout.precision;
+                    for (&g, &v) in groups.iter().zip(column(c)) {
+                        let start = g as usize * layout.hll_width + offset;
+                        hll_insert(&mut self.hll[start..start + registers], v, layout.precision);
+                    }
+                }
+            }
+        }
+    }
+
+    #[inline]
+    fn merge(&mut self, layout: &Layout, g: usize, src: &States<K>, i: usize) {
+        let (w, hw) = (layout.acc_width, layout.hll_width);
+        let acc = &mut self.acc[g * w..(g + 1) * w];
+        let other = &src.acc[i * w..(i + 1) * w];
+        for &(aggregate, offset) in &layout.ops {
+            match aggregate {
+                Aggregate::Count | Aggregate::Sum(_) => {
+                    acc[offset] = acc[offset].wrapping_add(other[offset])
+                }
+                Aggregate::Min(_) => acc[offset] = acc[offset].min(other[offset]),
+                Aggregate::Max(_) => acc[offset] = acc[offset].max(other[offset]),
+                Aggregate::Distinct(_) => {}
+            }
+        }
+        // Register-wise max merges every HyperLogLog of the group at once
+        let hll = &mut self.hll[g * hw..(g + 1) * hw];
+        for (r, &o) in hll.iter_mut().zip(&src.hll[i * hw..(i + 1) * hw]) {
+            *r = (*r).max(o);
+        }
+    }
+}
+
+// Rows a worker did not pre-aggregate, scattered by partition into contiguous columns:
+// partition `p` owns `offsets[p]..offsets[p + 1]` of each. Only the value columns the
+// aggregates read are filled; the others stay empty.
+struct Rows<K> {
+    keys: Vec<K>,
+    hashes: Vec<u64>,
+    values: Vec<Vec<i64>>,
+    offsets: Vec<usize>,
+}
+
+// What one worker hands to the partitions
+struct Chunk<K> {
+    states: Vec<States<K>>,
+    rows: Rows<K>,
+}
+
+// An open-addressing index over `States`, keyed by the full hash and the key
+struct Table<K> {
+    states: States<K>,
+    slots: Vec<u32>,
+    mask: usize,
+}
+
+impl<K: ColumnKey> Table<K> {
+    fn with_capacity(groups: usize) -> Self {
+        let slots = (groups * 2).next_power_of_two().max(16);
+        Self {
+            states: States::new(),
+            slots: vec![EMPTY; slots],
+            mask: slots - 1,
+        }
+    }
+
+    // Returns the slot holding `key`, or the empty slot where it belongs
+    #[inline]
+    fn slot(&self, key: K, hash: u64) -> usize {
+        let mut i = hash as usize & self.mask;
+        loop {
+            let g = self.slots[i];
+            if g == EMPTY
+                || (self.states.hashes[g as usize] == hash && self.states.keys[g as usize] == key)
+            {
+                return i;
+            }
+            i = (i + 1) & self.mask;
+        }
+    }
+
+    // Resolves the group of every key, creating empty states for new ones
+    fn groups(&mut self, layout: &Layout, keys: &[K], hashes: &[u64], groups: &mut Vec<u32>) {
+        groups.clear();
+        self.reserve(keys.len());
+        for (&key, &hash) in keys.iter().zip(hashes) {
+            let i = self.slot(key, hash);
+            if self.slots[i] == EMPTY {
+                self.slots[i] = self.states.len() as u32;
+                self.states.push_empty(layout, key, hash);
+            }
+            groups.push(self.slots[i]);
+        }
+    }
+
+    // Folds a worker's partial states and raw rows for partition `p` into this table
+    fn merge_chunk(&mut self, layout: &Layout, chunk: &Chunk<K>, p: usize, groups: &mut Vec<u32>) {
+        let src = &chunk.states[p];
+        self.reserve(src.len());
+        for i in 0..src.len() {
+            let s = self.slot(src.keys[i], src.hashes[i]);
+            match self.slots[s] {
+                EMPTY => {
+                    self.slots[s] = self.states.len() as u32;
+                    self.states.push_copy(layout, src, i);
+                }
+                g => self.states.merge(layout, g as usize, src, i),
+            }
+        }
+
+        let rows = &chunk.rows;
+        let values: Vec<&[i64]> = rows.values.iter().map(|v| v.as_slice()).collect();
+        let (first, last) = (rows.offsets[p], rows.offsets[p + 1]);
+        for start in (first..last).step_by(BATCH_ROWS) {
+            let end = (start + BATCH_ROWS).min(last);
+            self.groups(
+                layout,
+                &rows.keys[start..end],
+                &rows.hashes[start..end],
+                groups,
+            );
+            self.states.update_batch(layout, groups, &values, start);
+        }
+    }
+
+    // Makes room for `additional` more groups, keeping the index at most half full
+    fn reserve(&mut self, additional: usize) {
+        let groups = self.states.len() + additional;
+        if groups * 2 <= self.slots.len() {
+            return;
+        }
+        assert!(groups < EMPTY as usize, "too many groups");
+        let slots = (groups * 2).next_power_of_two();
+        self.mask = slots - 1;
+        self.slots = vec![EMPTY; slots];
+        for (g, &hash) in self.states.hashes.iter().enumerate() {
+            let mut i = hash as usize & self.mask;
+            while self.slots[i] != EMPTY {
+                i = (i + 1) & self.mask;
+            }
+            self.slots[i] = g as u32;
+        }
+    }
+
+    // Moves every state into the partition picked by the top bits of its hash
+    fn flush_into(&mut self, layout: &Layout, partitions: &mut [States<K>], shift: u32) {
+        let states = &self.states;
+        for i in 0..states.len() {
+            let p = states.hashes[i].checked_shr(shift).unwrap_or(0) as usize;
+            partitions[p].push_copy(layout, states, i);
+        }
+        self.states = States::new();
+        self.slots.fill(EMPTY);
+    }
+
+    fn finish(&mut self, layout: &Layout) -> Grouped<K> {
+        let states = std::mem::replace(&mut self.states, States::new());
+        let groups = states.len();
+        let columns = layout
+            .ops
+            .iter()
+            .map(|&(aggregate, offset)| match aggregate {
+                Aggregate::Distinct(_) => {
+                    let registers = 1 << layout.precision;
+                    (0..groups)
+                        .map(|g| {
+                            let start = g * layout.hll_width + offset;
+                            hll_estimate(&states.hll[start..start + registers]).round() as i64
+                        })
+                        .collect()
+                }
+                _ => (0..groups)
+                    .map(|g| states.acc[g * layout.acc_width + offset])
+                    .collect(),
+            })
+            .collect();
+        Grouped {
+            keys: states.keys,
+            columns,
+        }
+    }
+}
+
+// Pre-aggregates `rows` in parallel chunks. Returns, per chunk, what goes to each partition.
+fn pre_aggregate<K: ColumnKey>(
+    layout: &Layout,
+    keys: &[K],
+    values: &[&[i64]],
+    rows: std::ops::Range<usize>,
+    bits: u32,
+    threads: usize,
+) -> Vec<Chunk<K>> {
+    let shift = 64 - bits;
+    let chunk_rows = rows
+        .len()
+        .div_ceil(resolve_threads(threads) * 4)
+        .max(MIN_CHUNK_ROWS);
+
+    parallel::map_indices(rows.len().div_ceil(chunk_rows), threads, |c| {
+        let start = rows.start + c * chunk_rows;
+        let end = (start + chunk_rows).min(rows.end);
+        let mut partitions: Vec<States<K>> = (0..1 << bits).map(|_| States::new()).collect();
+        let mut local = Table::with_capacity(LOCAL_GROUPS);
+        let mut hashes = Vec::with_capacity(BATCH_ROWS);
+        let mut groups = Vec::with_capacity(BATCH_ROWS);
+        let mut since_flush = 0;
+        let mut row = start;
+
+        while row < end {
+            let batch = &keys[row..(row + BATCH_ROWS).min(end)];
+            hashes.clear();
+            hashes.extend(batch.iter().map(|k| k.column_hash()));
+            local.groups(layout, batch, &hashes, &mut groups);
+            local.states.update_batch(layout, &groups, values, row);
+            row += batch.len();
+            since_flush += batch.len();
+            if local.states.len() >= LOCAL_GROUPS {
+                local.flush_into(layout, &mut partitions, shift);
+                if since_flush < LOCAL_GROUPS * MIN_REDUCTION {
+                    break;
+                }
+                since_flush = 0;
+            }
+        }
+        local.flush_into(layout, &mut partitions, shift);
+
+        // High cardinality: the local table barely reduced its input, so scatter the remaining
+        // rows to the partition merges directly
+        let rest = &keys[row..end];
+        let hashes: Vec<u64> = rest.iter().map(|k| k.column_hash()).collect();
+        let mut offsets = vec![0usize; (1 << bits) + 1];
+        for &h in &hashes {
+            offsets[h.checked_shr(shift).unwrap_or(0) as usize + 1] += 1;
+        }
+        for p in 0..1 << bits {
+            offsets[p + 1] += offsets[p];
+        }
+        let mut rows = Rows {
+            keys: rest.first().map_or(Vec::new(), |&k| vec![k; rest.len()]),
+            hashes: vec![0; rest.len()],
+            values: (0..layout.num_columns)
+                .map(|c| {
+                    if layout.columns.contains(&c) {
+                        vec![0; rest.len()]
+                    } else {
+                        Vec::new()
+                    }
+                })
+                .collect(),
+            offsets,
+        };
+        let mut cursor = rows.offsets.clone();
+        for (i, (&hash, &key)) in hashes.iter().zip(rest).enumerate() {
+            let p = hash.checked_shr(shift).unwrap_or(0) as usize;
+            let at = cursor[p];
+            cursor[p] += 1;
+            rows.keys[at] = key;
+            rows.hashes[at] = hash;
+            for &c in &layout.columns {
+                rows.values[c][at] = values[c][row + i];
+            }
+        }
+        Chunk {
+            states: partitions,
+            rows,
+        }
+    })
+}
+
+#[inline]
+fn hll_insert(registers: &mut [u8], value: i64, precision: u32) {
+    let hash = fmix64(value as u64 ^ DISTINCT_SEED);
+    let index = (hash >> (64 - precision)) as usize;
+    // The sentinel bit caps the rank at 64 - precision + 1
+    let rank = ((hash << precision) | (1 << (precision - 1))).leading_zeros() as u8 + 1;
+    registers[index] = registers[index].max(rank);
+}
+
+fn hll_estimate(registers: &[u8]) -> f64 {
+    let m = registers.len() as f64;
+    let alpha = match registers.len() {
+        16 => 0.673,
+        32 => 0.697,
+        64 => 0.709,
+        _ => 0.7213 / (1.0 + 1.079 / m),
+    };
+    let sum: f64 = registers.iter().map(|&r| (-(r as f64)).exp2()).sum();
+    let raw = alpha * m * m / sum;
+    let zeros = registers.iter().filter(|&&r| r == 0).count();
+    if raw <= 2.5 * m && zeros > 0 {
+        // Linear counting is more accurate while many registers are still empty
+        m * (m / zeros as f64).ln()
+    } else {
+        raw
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::{HashMap, HashSet};
+
+    const ALL: [Aggregate; 4] = [
+        Aggregate::Count,
+        Aggregate::Sum(0),
+        Aggregate::Min(0),
+        Aggregate::Max(0),
+    ];
+
+    fn naive(keys: &[u64], values: &[i64]) -> HashMap<u64, [i64; 4]> {
+        let mut groups: HashMap<u64, [i64; 4]> = HashMap::new();
+        for (&k, &v) in keys.iter().zip(values) {
+            let g = groups.entry(k).or_insert([0, 0, i64::MAX, i64::MIN]);
+            g[0] += 1;
+            g[1] += v;
+            g[2] = g[2].min(v);
+            g[3] = g[3].max(v);
+        }
+        groups
+    }
+
+    fn as_map(result: &Grouped<u64>) -> HashMap<u64, [i64; 4]> {
+        result
+            .keys
+            .iter()
+            .enumerate()
+            .map(|(g, &k)| {
+                let row = [0, 1, 2, 3].map(|a| result.columns[a][g]);
+                (k, row)
+            })
+            .collect()
+    }
+
+    fn pseudo_random(n: usize, seed: u64) -> impl Iterator<Item = u64> {
+        (0..n as u64).map(move |i| fmix64(i ^ seed))
+    }
+
+    #[test]
+    fn test_low_cardinality_matches_naive() {
+        let keys: Vec<u64> = pseudo_random(300_000, 1).map(|h| h % 37).collect();
+        let values: Vec<i64> = pseudo_random(300_000, 2)
+            .map(|h| (h % 1000) as i64 - 500)
+            .collect();
+        let result = GroupBy::new(&ALL).threads(3).run(&keys, &[&values]);
+        assert_eq!(result.len(), 37);
+        assert_eq!(as_map(&result), naive(&keys, &values));
+    }
+
+    #[test]
+    fn test_high_cardinality_matches_naive() {
+        // About 1.5 rows per group, so workers abandon local pre-aggregation
+        let keys: Vec<u64> = pseudo_random(400_000, 3).map(|h| h % 270_000).collect();
+        let values: Vec<i64> = pseudo_random(400_000, 4).map(|h| h as i64 >> 8).collect();
+        for bits in [0, 6] {
+            let result = GroupBy::new(&ALL)
+                .partition_bits(bits)
+                .threads(2)
+                .run(&keys, &[&values]);
+            assert_eq!(as_map(&result), naive(&keys, &values));
+        }
+    }
+
+    #[test]
+    fn test_distinct_estimates() {
+        let keys: Vec<(&str, u32)> = (0..200_000)
+            .map(|i| if i % 2 == 0 { ("even", 0) } else { ("odd", 1) })
+            .collect();
+        // "even" rows cycle through 20,000 values and "odd" rows through 10
+        let values: Vec<i64> = (0..200_000)
+            .map(|i| if i % 2 == 0 { i % 40_000 } else { i % 20 })
+            .collect();
+        let result = GroupBy::new(&[Aggregate::Distinct(0)])
+            .distinct_precision(10)
+            .run(&keys, &[&values]);
+
+        for (g, key) in result.keys.iter().enumerate() {
+            let exact = values
+                .iter()
+                .zip(&keys)
+                .filter(|(_, k)| *k == key)
+                .map(|(v, _)| v)
+                .collect::<HashSet<_>>()
+                .len() as f64;
+            let estimate = result.columns[0][g] as f64;
+            assert!(
+                (estimate - exact).abs() / exact < 0.1,
+                "{:?}: estimated {} distinct values, expected {}",
+                key,
+                estimate,
+                exact
+            );
+        }
+    }
+
+    #[test]
+    fn test_empty_input() {
+        let keys: [u32; 0] = [];
+        let result = GroupBy::new(&[Aggregate::Count]).run(&keys, &[]);
+        assert!(result.is_empty());
+        assert_eq!(result.columns, vec![Vec::<i64>::new()]);
+    }
+}
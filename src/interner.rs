@@ -0,0 +1,420 @@
+use crate::farm::farm_hash64;
+use std::sync::RwLock;
+
+const FIRST_CHUNK: usize = 4 * 1024;
+const MAX_CHUNK: usize = 1024 * 1024;
+
+/// A dense handle for a string stored in an [`Interner`].
+///
+/// Symbols are assigned in insertion order starting at zero, so they can index plain vectors.
+#[derive(Debug, Copy, Clone, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct Symbol(u32);
+
+impl Symbol {
+    /// Returns the symbol's dense index.
+    #[inline]
+    pub fn as_u32(self) -> u32 {
+        self.0
+    }
+
+    /// Returns the symbol's dense index as a `usize`.
+    #[inline]
+    pub fn as_usize(self) -> usize {
+        self.0 as usize
+    }
+}
+
+// Bump allocator for string bytes. Chunks are allocated once and never moved or freed until
+// the arena is dropped, so pointers into them stay valid for the arena's lifetime. Bytes are
+// only ever written past the end of what has been handed out.
+#[derive(Debug)]
+struct Arena {
+    chunks: Vec<(*mut u8, usize)>,
+    // Chunk currently being filled; oversized strings get dedicated chunks and leave it alone
+    current: *mut u8,
+    capacity: usize,
+    used: usize,
+    bytes: usize,
+}
+
+impl Arena {
+    fn new() -> Self {
+        Self {
+            chunks: Vec::new(),
+            current: std::ptr::null_mut(),
+            capacity: 0,
+            used: 0,
+            bytes: 0,
+        }
+    }
+
+    fn new_chunk(&mut self, size: usize) -> *mut u8 {
+        let base = Box::into_raw(vec![0u8; size].into_boxed_slice()) as *mut u8;
+        self.chunks.push((base, size));
+        self.bytes += size;
+        base
+    }
+
+    fn alloc(&mut self, s: &[u8]) -> *const u8 {
+        if s.is_empty() {
+            return std::ptr::NonNull::<u8>::dangling().as_ptr();
+        }
+        let dst = if self.capacity - self.used >= s.len() {
+            // SAFETY: `used + len <= capacity`, so the write stays inside the current chunk
+            let dst = unsafe { self.current.add(self.used) };
+            self.used += s.len();
+            dst
+        } else {
+            let next = if self.capacity == 0 {
+                FIRST_CHUNK
+            } else {
+                (self.capacity * 2).min(MAX_CHUNK)
+            };
+            if s.len() > next {
+                self.new_chunk(s.len())
+            } else {
+                self.current = self.new_chunk(next);
+                self.capacity = next;
+                self.used = s.len();
+                self.current
+            }
+        };
+        // SAFETY: `dst` points at `s.len()` bytes of this arena that no reference covers yet
+        unsafe { std::ptr::copy_nonoverlapping(s.as_ptr(), dst, s.len()) };
+        dst
+    }
+}
+
+impl Drop for Arena {
+    fn drop(&mut self) {
+        for &(base, cap) in &self.chunks {
+            // SAFETY: every chunk came from `Box::into_raw` on a boxed slice of `cap` bytes
+            drop(unsafe { Box::from_raw(std::ptr::slice_from_raw_parts_mut(base, cap)) });
+        }
+    }
+}
+
+#[derive(Debug, Copy, Clone)]
+struct Span {
+    ptr: *const u8,
+    len: usize,
+}
+
+/// A string interner that stores strings contiguously in a bump arena and maps them to
+/// dense [`Symbol`]s.
+///
+/// Unlike a `HashMap<String, u32>`, interning does not allocate per string: bytes are copied
+/// into large arena chunks that never move, so [`resolve`](Interner::resolve) can hand out
+/// `&str`s that live as long as the interner.
+///
+/// The lookup table is open-addressed with linear probing. Each slot packs the upper 32 bits
+/// of the string's [`farm_hash64`] (its *tag*) with the symbol, and the slot position is
+/// derived from the tag. Growing the table therefore re-slots entries from their stored tags
+/// without re-hashing a single string, and most mismatching probes are rejected on the tag
+/// before any bytes are compared.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::interner::Interner;
+///
+/// let mut interner = Interner::new();
+/// let a = interner.intern("foo");
+/// let b = interner.intern("bar");
+/// assert_eq!(interner.intern("foo"), a);
+/// assert_eq!(a.as_u32(), 0);
+/// assert_eq!(b.as_u32(), 1);
+/// assert_eq!(interner.resolve(b), "bar");
+/// ```
+#[derive(Debug)]
+pub struct Interner {
+    arena: Arena,
+    spans: Vec<Span>,
+    // (tag << 32) | (symbol + 1); zero marks an empty slot
+    slots: Vec<u64>,
+}
+
+// SAFETY: the raw pointers only refer to arena memory owned by the interner, which is never
+// mutated once handed out, so sharing or sending the interner is as safe as for `Vec<String>`.
+unsafe impl Send for Interner {}
+unsafe impl Sync for Interner {}
+
+impl Default for Interner {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Interner {
+    /// Creates an empty interner.
+    pub fn new() -> Self {
+        Self::with_capacity(0)
+    }
+
+    /// Creates an empty interner with room for `capacity` strings before the table grows.
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self {
+            arena: Arena::new(),
+            spans: Vec::with_capacity(capacity),
+            slots: vec![0; (capacity * 2).next_power_of_two().max(16)],
+        }
+    }
+
+    /// Returns the symbol for `s`, interning it first if needed.
+    pub fn intern(&mut self, s: &str) -> Symbol {
+        self.intern_hashed(s, farm_hash64(s.as_bytes()))
+    }
+
+    /// Returns the symbol for `s` if it has been interned.
+    pub fn get(&self, s: &str) -> Option<Symbol> {
+        self.get_hashed(s, farm_hash64(s.as_bytes()))
+    }
+
+    /// Returns the string for `symbol`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `symbol` was not produced by this interner.
+    #[inline]
+    pub fn resolve(&self, symbol: Symbol) -> &str {
+        let span = self.spans[symbol.as_usize()];
+        // SAFETY: spans point at valid UTF-8 copied into the arena, which outlives `&self`
+        unsafe { std::str::from_utf8_unchecked(std::slice::from_raw_parts(span.ptr, span.len)) }
+    }
+
+    /// Returns the number of interned strings.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.spans.len()
+    }
+
+    /// Returns `true` if no strings have been interned.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.spans.is_empty()
+    }
+
+    /// Iterates over all symbols and their strings in symbol order.
+    pub fn iter(&self) -> impl Iterator<Item = (Symbol, &str)> + '_ {
+        (0..self.spans.len() as u32).map(move |i| (Symbol(i), self.resolve(Symbol(i))))
+    }
+
+    /// Returns the approximate heap size of the interner in bytes.
+    pub fn memory_usage(&self) -> usize {
+        self.arena.bytes
+            + self.spans.capacity() * std::mem::size_of::<Span>()
+            + self.slots.len() * 8
+    }
+
+    #[inline]
+    fn find(&self, s: &str, tag: u32) -> Result<Symbol, usize> {
+        let mask = self.slots.len() - 1;
+        let mut slot = tag as usize & mask;
+        loop {
+            let entry = self.slots[slot];
+            if entry == 0 {
+                return Err(slot);
+            }
+            if (entry >> 32) as u32 == tag {
+                let symbol = Symbol((entry as u32) - 1);
+                if self.resolve(symbol) == s {
+                    return Ok(symbol);
+                }
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    fn get_hashed(&self, s: &str, hash: u64) -> Option<Symbol> {
+        self.find(s, (hash >> 32) as u32).ok()
+    }
+
+    fn intern_hashed(&mut self, s: &str, hash: u64) -> Symbol {
+        let tag = (hash >> 32) as u32;
+        let slot = match self.find(s, tag) {
+            Ok(symbol) => return symbol,
+            Err(slot) => slot,
+        };
+        assert!(
+            self.spans.len() < u32::MAX as usize,
+            "symbol space exhausted"
+        );
+
+        let symbol = Symbol(self.spans.len() as u32);
+        let ptr = self.arena.alloc(s.as_bytes());
+        self.spans.push(Span { ptr, len: s.len() });
+        self.slots[slot] = ((tag as u64) << 32) | (symbol.0 as u64 + 1);
+
+        if self.spans.len() * 2 > self.slots.len() {
+            self.grow();
+        }
+        symbol
+    }
+
+    // Doubles the table, placing entries by their stored tags
+    fn grow(&mut self) {
+        let mut slots = vec![0u64; self.slots.len() * 2];
+        let mask = slots.len() - 1;
+        for &entry in self.slots.iter().filter(|&&e| e != 0) {
+            let mut slot = (entry >> 32) as usize & mask;
+            while slots[slot] != 0 {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+        }
+        self.slots = slots;
+    }
+}
+
+/// A thread-safe [`Interner`] for read-mostly workloads.
+///
+/// Lookups and resolves take a shared lock; only interning a new string takes the exclusive
+/// lock. Strings are hashed before any lock is taken, and resolved `&str`s borrow the arena
+/// directly, so they remain usable after the lock is released.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::interner::SharedInterner;
+/// use std::thread;
+///
+/// let interner = SharedInterner::new();
+/// thread::scope(|s| {
+///     for _ in 0..4 {
+///         s.spawn(|| interner.intern("shared"));
+///     }
+/// });
+/// assert_eq!(interner.len(), 1);
+/// ```
+#[derive(Debug, Default)]
+pub struct SharedInterner {
+    inner: RwLock<Interner>,
+}
+
+impl SharedInterner {
+    /// Creates an empty shared interner.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Returns the symbol for `s`, interning it first if needed.
+    pub fn intern(&self, s: &str) -> Symbol {
+        let hash = farm_hash64(s.as_bytes());
+        if let Some(symbol) = self.inner.read().unwrap().get_hashed(s, hash) {
+            return symbol;
+        }
+        // Another thread may have interned `s` between the two locks; intern_hashed re-checks
+        self.inner.write().unwrap().intern_hashed(s, hash)
+    }
+
+    /// Returns the symbol for `s` if it has been interned.
+    pub fn get(&self, s: &str) -> Option<Symbol> {
+        let hash = farm_hash64(s.as_bytes());
+        self.inner.read().unwrap().get_hashed(s, hash)
+    }
+
+    /// Returns the string for `symbol`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `symbol` was not produced by this interner.
+    pub fn resolve(&self, symbol: Symbol) -> &str {
+        let span = self.inner.read().unwrap().spans[symbol.as_usize()];
+        // SAFETY: the arena never moves or frees bytes while `self` is alive, and only writes
+        // past what it has handed out, so the span stays valid after the lock is dropped
+        unsafe { std::str::from_utf8_unchecked(std::slice::from_raw_parts(span.ptr, span.len)) }
+    }
+
+    /// Returns the number of interned strings.
+    pub fn len(&self) -> usize {
+        self.inner.read().unwrap().len()
+    }
+
+    /// Returns `true` if no strings have been interned.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Consumes the shared interner and returns the underlying single-threaded one.
+    pub fn into_inner(self) -> Interner {
+        self.inner.into_inner().unwrap()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::HashMap;
+
+    #[test]
+    fn test_intern_and_resolve() {
+        let mut interner = Interner::with_capacity(4);
+        let words: Vec<String> = (0..10_000).map(|i| format!("identifier_{}", i)).collect();
+        let symbols: Vec<Symbol> = words.iter().map(|w| interner.intern(w)).collect();
+
+        for (i, (word, symbol)) in words.iter().zip(&symbols).enumerate() {
+            assert_eq!(symbol.as_usize(), i);
+            assert_eq!(interner.resolve(*symbol), word);
+            assert_eq!(interner.intern(word), *symbol);
+            assert_eq!(interner.get(word), Some(*symbol));
+        }
+        assert_eq!(interner.len(), words.len());
+        assert_eq!(interner.get("missing"), None);
+
+        let collected: HashMap<&str, Symbol> = interner.iter().map(|(s, w)| (w, s)).collect();
+        assert_eq!(collected.len(), words.len());
+    }
+
+    #[test]
+    fn test_empty_and_oversized_strings() {
+        let mut interner = Interner::new();
+        let empty = interner.intern("");
+        let big = "x".repeat(3 * MAX_CHUNK);
+        let small = interner.intern("small");
+        let huge = interner.intern(&big);
+        let after = interner.intern("after");
+
+        assert_eq!(interner.resolve(empty), "");
+        assert_eq!(interner.resolve(small), "small");
+        assert_eq!(interner.resolve(huge), big);
+        assert_eq!(interner.resolve(after), "after");
+        assert_eq!(interner.intern(""), empty);
+    }
+
+    #[test]
+    fn test_resolved_strings_survive_growth() {
+        let mut interner = Interner::new();
+        let first = interner.intern("first");
+        let ptr = interner.resolve(first).as_ptr();
+        for i in 0..100_000 {
+            interner.intern(&i.to_string());
+        }
+        assert_eq!(interner.resolve(first).as_ptr(), ptr);
+    }
+
+    #[test]
+    fn test_shared_interner_is_consistent_across_threads() {
+        let interner = SharedInterner::new();
+        let results: Vec<Vec<Symbol>> = std::thread::scope(|s| {
+            let handles: Vec<_> = (0..4)
+                .map(|t| {
+                    let interner = &interner;
+                    s.spawn(move || {
+                        (0..2000)
+                            .map(|i| interner.intern(&format!("sym{}", (i * (t + 1)) % 2000)))
+                            .collect::<Vec<_>>()
+                    })
+                })
+                .collect();
+            handles.into_iter().map(|h| h.join().unwrap()).collect()
+        });
+
+        assert_eq!(interner.len(), 2000);
+        for symbols in &results {
+            for &symbol in symbols {
+                let text = interner.resolve(symbol);
+                assert_eq!(interner.get(text), Some(symbol));
+            }
+        }
+    }
+}
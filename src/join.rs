@@ -0,0 +1,484 @@
+use crate::farm::farm_hash64;
+use crate::murmur::fmix64;
+use crate::parallel::{self, resolve_threads};
+use std::mem::size_of;
+
+// Share of a core's L2 cache that one partition's build table should fit in
+const L2_BUDGET: usize = 256 << 10;
+// More partitions than this makes the single scatter pass thrash the TLB
+const MAX_PARTITION_BITS: u32 = 12;
+// Smallest run of rows worth hashing and scattering on its own thread
+const MIN_CHUNK_ROWS: usize = 1 << 16;
+// Probe rows partitioned at a time, which bounds the memory used on top of the inputs
+const PROBE_BLOCK_ROWS: usize = 1 << 24;
+
+/// A value in a key column that can be hashed with one of the crate's hash functions.
+///
+/// Integers are mixed with the MurmurHash3 64-bit finalizer and strings or byte slices are
+/// hashed with FarmHash. Pairs and triples of keys combine their elements' hashes, so a
+/// multi-column key is a column of tuples. Keys are small `Copy` values (integers, borrowed
+/// slices or tuples of them) so that partitioning can move them next to their row indices.
+pub trait ColumnKey: Copy + Eq + Send + Sync {
+    /// Returns the 64-bit hash of the key.
+    fn column_hash(self) -> u64;
+}
+
+macro_rules! impl_column_key_int {
+    ($($t:ty),*) => {
+        $(
+            impl ColumnKey for $t {
+                #[inline(always)]
+                fn column_hash(self) -> u64 {
+                    fmix64(self as u64)
+                }
+            }
+        )*
+    };
+}
+
+impl_column_key_int!(u8, u16, u32, u64, usize, i8, i16, i32, i64, isize);
+
+impl ColumnKey for &str {
+    #[inline(always)]
+    fn column_hash(self) -> u64 {
+        farm_hash64(self.as_bytes())
+    }
+}
+
+impl ColumnKey for &[u8] {
+    #[inline(always)]
+    fn column_hash(self) -> u64 {
+        farm_hash64(self)
+    }
+}
+
+impl ColumnKey for &String {
+    #[inline(always)]
+    fn column_hash(self) -> u64 {
+        farm_hash64(self.as_bytes())
+    }
+}
+
+// Multi-column keys: mix the first hash's halves out of the way before combining
+impl<A: ColumnKey, B: ColumnKey> ColumnKey for (A, B) {
+    #[inline(always)]
+    fn column_hash(self) -> u64 {
+        fmix64(self.0.column_hash().rotate_left(32) ^ self.1.column_hash())
+    }
+}
+
+impl<A: ColumnKey, B: ColumnKey, C: ColumnKey> ColumnKey for (A, B, C) {
+    #[inline(always)]
+    fn column_hash(self) -> u64 {
+        (self.0, (self.1, self.2)).column_hash()
+    }
+}
+
+/// The rows a [`HashJoin`] emits.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum JoinKind {
+    /// Every (build row, probe row) pair with equal keys.
+    Inner,
+    /// Probe rows with at least one matching build row, each emitted once.
+    Semi,
+    /// Probe rows with no matching build row.
+    Anti,
+}
+
+/// Row indices produced by a [`HashJoin`].
+///
+/// For [`JoinKind::Inner`], `build[i]` and `probe[i]` are the rows of one matching pair.
+/// Semi and anti joins only fill `probe`. Rows come out grouped by partition, not in input
+/// order.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct JoinIndices {
+    /// Matching rows of the build side (inner joins only).
+    pub build: Vec<u32>,
+    /// Matching (or, for anti joins, unmatched) rows of the probe side.
+    pub probe: Vec<u32>,
+}
+
+impl JoinIndices {
+    /// Returns the number of emitted rows.
+    pub fn len(&self) -> usize {
+        self.probe.len()
+    }
+
+    /// Returns `true` if the join emitted no rows.
+    pub fn is_empty(&self) -> bool {
+        self.probe.is_empty()
+    }
+}
+
+/// A radix-partitioned parallel hash join over key columns.
+///
+/// Both sides are hashed once with [`ColumnKey::column_hash`]. The top bits of the hash
+/// scatter the rows into partitions, chosen so that each partition's build table fits in
+/// L2 cache. Each build partition becomes a bucketed table laid out contiguously (entries
+/// sorted by bucket, with an offset array instead of chain pointers). The probe side is then
+/// partitioned the same way, in blocks of 16M rows, and every probe partition only touches
+/// its own cache-resident table.
+///
+/// Partitions are handed to worker threads dynamically, so a worker that finishes early
+/// takes the next unclaimed partition and skewed partitions do not stall the others.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::join::{HashJoin, JoinKind};
+///
+/// let customers = ["ada", "grace", "edsger"];
+/// let orders = ["grace", "ada", "alan", "grace"];
+///
+/// let mut pairs = HashJoin::new(JoinKind::Inner).join(&customers, &orders);
+/// let mut matched: Vec<(u32, u32)> = pairs.build.drain(..).zip(pairs.probe).collect();
+/// matched.sort();
+/// assert_eq!(matched, [(0, 1), (1, 0), (1, 3)]);
+///
+/// let unmatched = HashJoin::new(JoinKind::Anti).join(&customers, &orders);
+/// assert_eq!(unmatched.probe, [2]);
+/// ```
+#[derive(Debug, Clone)]
+pub struct HashJoin {
+    kind: JoinKind,
+    partition_bits: Option<u32>,
+    threads: usize,
+}
+
+impl HashJoin {
+    /// Creates a join of the given kind that sizes partitions for L2 and uses all cores.
+    pub fn new(kind: JoinKind) -> Self {
+        Self {
+            kind,
+            partition_bits: None,
+            threads: 0,
+        }
+    }
+
+    /// Fixes the number of partitions to `2^bits` instead of deriving it from the build size.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `bits` is greater than 12.
+    pub fn partition_bits(mut self, bits: u32) -> Self {
+        assert!(
+            bits <= MAX_PARTITION_BITS,
+            "at most 2^12 partitions are supported"
+        );
+        self.partition_bits = Some(bits);
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Joins `probe` against `build` and returns the matching row indices.
+    ///
+    /// The build side is held in memory as hash tables, so it should be the smaller input.
+    ///
+    /// # Parameters
+    ///
+    /// * `build` - Key column of the side the hash tables are built from
+    /// * `probe` - Key column of the side streamed against those tables
+    ///
+    /// # Returns
+    ///
+    /// The row indices described by this join's [`JoinKind`].
+    ///
+    /// # Panics
+    ///
+    /// Panics if either column has more than `u32::MAX` rows.
+    pub fn join<K: ColumnKey>(&self, build: &[K], probe: &[K]) -> JoinIndices {
+        assert!(
+            build.len() <= u32::MAX as usize && probe.len() <= u32::MAX as usize,
+            "join inputs are limited to u32::MAX rows"
+        );
+        let bits = self
+            .partition_bits
+            .unwrap_or_else(|| self.default_partition_bits::<K>(build.len()));
+        let partitions = 1usize << bits;
+
+        let build_parts = partition(build, 0, bits, self.threads);
+        let tables =
+            parallel::map_indices(partitions, self.threads, |p| Table::new(&build_parts, p));
+        drop(build_parts);
+
+        let mut out = JoinIndices::default();
+        for (block, keys) in probe.chunks(PROBE_BLOCK_ROWS).enumerate() {
+            let probe_parts = partition(keys, block * PROBE_BLOCK_ROWS, bits, self.threads);
+            let results = parallel::map_indices(partitions, self.threads, |p| {
+                let mut result = JoinIndices::default();
+                for chunk in &probe_parts {
+                    tables[p].probe(chunk.partition(p), self.kind, &mut result);
+                }
+                result
+            });
+            drop(probe_parts);
+            for result in results {
+                out.build.extend_from_slice(&result.build);
+                out.probe.extend_from_slice(&result.probe);
+            }
+        }
+        out
+    }
+
+    fn default_partition_bits<K>(&self, build_rows: usize) -> u32 {
+        // Each build row costs one entry plus about one bucket offset
+        let rows_per_partition = L2_BUDGET / (size_of::<Entry<K>>() + 4);
+        let for_cache = build_rows
+            .div_ceil(rows_per_partition)
+            .next_power_of_two()
+            .trailing_zeros();
+        // Enough partitions to keep every worker busy
+        let workers = resolve_threads(self.threads);
+        let for_threads = if workers > 1 {
+            (workers * 4).next_power_of_two().trailing_zeros()
+        } else {
+            0
+        };
+        for_cache.max(for_threads).min(MAX_PARTITION_BITS)
+    }
+}
+
+// A key moved next to its row, with the low 32 bits of its hash for bucketing and filtering
+#[derive(Clone, Copy)]
+struct Entry<K> {
+    tag: u32,
+    row: u32,
+    key: K,
+}
+
+// One chunk of a column, scattered by partition
+struct Partitioned<K> {
+    entries: Vec<Entry<K>>,
+    offsets: Vec<usize>,
+}
+
+impl<K> Partitioned<K> {
+    #[inline]
+    fn partition(&self, p: usize) -> &[Entry<K>] {
+        &self.entries[self.offsets[p]..self.offsets[p + 1]]
+    }
+}
+
+// Hashes `keys` and scatters them by the top `bits` of their hashes, in parallel chunks
+fn partition<K: ColumnKey>(
+    keys: &[K],
+    first_row: usize,
+    bits: u32,
+    threads: usize,
+) -> Vec<Partitioned<K>> {
+    let partitions = 1usize << bits;
+    let shift = 64 - bits;
+    let chunk_rows = keys
+        .len()
+        .div_ceil(resolve_threads(threads) * 4)
+        .max(MIN_CHUNK_ROWS);
+
+    parallel::map_indices(keys.len().div_ceil(chunk_rows), threads, |c| {
+        let start = c * chunk_rows;
+        let chunk = &keys[start..(start + chunk_rows).min(keys.len())];
+        let hashes: Vec<u64> = chunk.iter().map(|k| k.column_hash()).collect();
+
+        let mut offsets = vec![0usize; partitions + 1];
+        for &h in &hashes {
+            offsets[h.checked_shr(shift).unwrap_or(0) as usize + 1] += 1;
+        }
+        for p in 0..partitions {
+            offsets[p + 1] += offsets[p];
+        }
+
+        let filler = Entry {
+            tag: 0,
+            row: 0,
+            key: chunk[0],
+        };
+        let mut entries = vec![filler; chunk.len()];
+        let mut cursor = offsets.clone();
+        for (i, (&h, &key)) in hashes.iter().zip(chunk).enumerate() {
+            let p = h.checked_shr(shift).unwrap_or(0) as usize;
+            entries[cursor[p]] = Entry {
+                tag: h as u32,
+                row: (first_row + start + i) as u32,
+                key,
+            };
+            cursor[p] += 1;
+        }
+        Partitioned { entries, offsets }
+    })
+}
+
+// The build table of one partition: entries sorted by bucket, with bucket `b` spanning
+// `entries[offsets[b]..offsets[b + 1]]`
+struct Table<K> {
+    entries: Vec<Entry<K>>,
+    offsets: Vec<u32>,
+    mask: u32,
+}
+
+impl<K: ColumnKey> Table<K> {
+    fn new(chunks: &[Partitioned<K>], p: usize) -> Self {
+        let len: usize = chunks.iter().map(|c| c.partition(p).len()).sum();
+        let buckets = len.next_power_of_two();
+        let mask = (buckets - 1) as u32;
+
+        let mut offsets = vec![0u32; buckets + 1];
+        for chunk in chunks {
+            for e in chunk.partition(p) {
+                offsets[(e.tag & mask) as usize + 1] += 1;
+            }
+        }
+        for b in 0..buckets {
+            offsets[b + 1] += offsets[b];
+        }
+
+        let mut entries = Vec::with_capacity(len);
+        if let Some(first) = chunks.iter().find_map(|c| c.partition(p).first()) {
+            entries.resize(len, *first);
+        }
+        let mut cursor = offsets.clone();
+        for chunk in chunks {
+            for e in chunk.partition(p) {
+                let b = (e.tag & mask) as usize;
+                entries[cursor[b] as usize] = *e;
+                cursor[b] += 1;
+            }
+        }
+        Self {
+            entries,
+            offsets,
+            mask,
+        }
+    }
+
+    #[inline(always)]
+    fn bucket(&self, tag: u32) -> &[Entry<K>] {
+        let b = (tag & self.mask) as usize;
+        &self.entries[self.offsets[b] as usize..self.offsets[b + 1] as usize]
+    }
+
+    fn probe(&self, probes: &[Entry<K>], kind: JoinKind, out: &mut JoinIndices) {
+        if self.entries.is_empty() {
+            if kind == JoinKind::Anti {
+                out.probe.extend(probes.iter().map(|e| e.row));
+            }
+            return;
+        }
+        match kind {
+            JoinKind::Inner => {
+                for e in probes {
+                    for m in self.bucket(e.tag) {
+                        if m.tag == e.tag && m.key == e.key {
+                            out.build.push(m.row);
+                            out.probe.push(e.row);
+                        }
+                    }
+                }
+            }
+            JoinKind::Semi | JoinKind::Anti => {
+                let keep = kind == JoinKind::Semi;
+                for e in probes {
+                    let found = self
+                        .bucket(e.tag)
+                        .iter()
+                        .any(|m| m.tag == e.tag && m.key == e.key);
+                    if found == keep {
+                        out.probe.push(e.row);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::HashMap;
+
+    // Reference nested-map join, sorted for comparison
+    fn naive<K: ColumnKey + std::hash::Hash>(
+        build: &[K],
+        probe: &[K],
+        kind: JoinKind,
+    ) -> Vec<(u32, u32)> {
+        let mut index: HashMap<K, Vec<u32>> = HashMap::new();
+        for (i, &k) in build.iter().enumerate() {
+            index.entry(k).or_default().push(i as u32);
+        }
+        let mut out = Vec::new();
+        for (j, k) in probe.iter().enumerate() {
+            let rows = index.get(k).map_or(&[][..], |r| r.as_slice());
+            match kind {
+                JoinKind::Inner => out.extend(rows.iter().map(|&i| (i, j as u32))),
+                JoinKind::Semi if !rows.is_empty() => out.push((0, j as u32)),
+                JoinKind::Anti if rows.is_empty() => out.push((0, j as u32)),
+                _ => {}
+            }
+        }
+        out.sort();
+        out
+    }
+
+    fn sorted(result: JoinIndices, kind: JoinKind) -> Vec<(u32, u32)> {
+        let mut out: Vec<(u32, u32)> = match kind {
+            JoinKind::Inner => result.build.into_iter().zip(result.probe).collect(),
+            _ => result.probe.into_iter().map(|j| (0, j)).collect(),
+        };
+        out.sort();
+        out
+    }
+
+    #[test]
+    fn test_matches_naive_join_on_integers() {
+        // Duplicate keys on both sides, plus misses
+        let build: Vec<u64> = (0..50_000u64).map(|i| i % 20_000).collect();
+        let probe: Vec<u64> = (0..120_000u64).map(|i| (i * 7) % 30_000).collect();
+        for kind in [JoinKind::Inner, JoinKind::Semi, JoinKind::Anti] {
+            for bits in [0, 3, 10] {
+                let join = HashJoin::new(kind).partition_bits(bits).threads(4);
+                assert_eq!(
+                    sorted(join.join(&build, &probe), kind),
+                    naive(&build, &probe, kind),
+                    "{:?} with {} partition bits",
+                    kind,
+                    bits
+                );
+            }
+        }
+    }
+
+    #[test]
+    fn test_string_keys() {
+        let owned: Vec<String> = (0..5_000).map(|i| format!("key-{}", i % 1_000)).collect();
+        let build: Vec<&str> = owned.iter().map(|s| s.as_str()).collect();
+        let probe: Vec<&str> = ["key-7", "key-999", "nope", "key-0"].to_vec();
+        for kind in [JoinKind::Inner, JoinKind::Semi, JoinKind::Anti] {
+            let result = HashJoin::new(kind).join(&build, &probe);
+            assert_eq!(sorted(result, kind), naive(&build, &probe, kind));
+        }
+    }
+
+    #[test]
+    fn test_empty_inputs() {
+        let empty: [u32; 0] = [];
+        let keys = [1u32, 2, 3];
+        assert!(
+            HashJoin::new(JoinKind::Inner)
+                .join(&empty, &keys)
+                .is_empty()
+        );
+        assert!(
+            HashJoin::new(JoinKind::Inner)
+                .join(&keys, &empty)
+                .is_empty()
+        );
+        assert_eq!(
+            HashJoin::new(JoinKind::Anti).join(&empty, &keys).len(),
+            keys.len()
+        );
+    }
+}
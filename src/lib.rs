@@ -11,6 +11,32 @@
 //! - CityHash (64-bit variant)
 //! - Rendezvous hashing (Highest Random Weight hashing)
 //!
+//! Built on these hash functions, the library also provides:
+//! - [`interner`]: an arena-backed string interner handing out dense `u32` symbols
+//! - [`prehashed`]: keys carrying a precomputed hash, with a pass-through `BuildHasher`
+//! - [`sharded_map`]: a sharded concurrent hash map that hashes each key once
+//! - [`fingerprint_set`]: a lock-free concurrent set of 64-bit fingerprints for deduplication
+//! - [`multi_index`]: multi-index hashing for Hamming-distance search over 64-bit fingerprints
+//! - [`mphf`]: minimal perfect hash functions for static key sets, queryable in place from bytes
+//! - [`static_index`]: memory-mapped static key→value index files queried in place
+//! - [`cuckoo`]: a bucketized cuckoo hash map with SIMD tag matching and two-probe lookups
+//! - [`cache`]: a sharded in-process cache with CLOCK eviction and weight-based capacity
+//! - [`memo`]: single-flight memoization of pure functions keyed by 128-bit input fingerprints
+//! - [`join`]: a radix-partitioned parallel hash join (inner, semi, anti) over key columns
+//! - [`group_by`]: parallel hash aggregation (count/sum/min/max/distinct) with radix-partitioned merging
+//! - [`dedup`]: streaming deduplication by 128-bit fingerprints that spills partitioned runs to disk
+//! - [`feature_hash`]: a hashing-trick vectorizer from text n-grams to signed sparse CSR features
+//! - [`static_map`]: a string-keyed map whose perfect hash layout is computed at compile time by [`static_map!`]
+//! - [`merkle`]: Merkle trees over fixed-size leaves with incremental updates, diffs and persistence
+//! - [`digest`]: hash functions selectable by name, with single-pass multi-algorithm hashing of slices, readers and files
+//! - [`tree_hash`]: parallel directory hashing on a work-stealing pool, with chunked large files and a root digest
+//! - [`lines`]: SWAR newline scanning and order-preserving parallel hashing of line-delimited keys
+//! - [`records`]: width-specialized parallel hashing of packed fixed-width binary records into a hash column
+//! - [`shard`]: parallel splitting of line-delimited records into N files by rendezvous or jump hashing of a key
+//! - [`duplicates`]: staged duplicate file search by size, sampled ends and full fingerprints
+//! - [`manifest`]: compact binary file manifests updated incrementally by re-hashing only files whose metadata changed
+//! - [`space_saving`]: SpaceSaving heavy-hitters (top-K) tracking over streams
+//!
 //! Non-cryptographic hash functions are designed for fast computation and good distribution
 //! properties, making them suitable for hash tables, checksums, and other general-purpose
 //! hashing needs. They are NOT suitable for cryptographic purposes.
@@ -203,18 +229,69 @@
 
 use std::hash::Hasher;
 
+pub mod cache;
 pub mod city;
+pub mod cuckoo;
+pub mod dedup;
+pub mod digest;
+pub mod duplicates;
 pub mod farm;
+pub mod feature_hash;
+pub mod fingerprint_set;
 pub mod fnv;
+pub mod group_by;
+pub mod interner;
+pub mod join;
+pub mod lines;
+pub mod manifest;
+pub mod memo;
+pub mod merkle;
+pub mod mmap;
+pub mod mphf;
+pub mod multi_index;
 pub mod murmur;
+mod parallel;
+pub mod prehashed;
+pub mod records;
 pub mod rendezvous;
+pub mod shard;
+pub mod sharded_map;
+pub mod space_saving;
+pub mod static_index;
+pub mod static_map;
+pub mod tree_hash;
 
 // Re-export for users to use directly
+pub use cache::*;
 pub use city::*;
+pub use cuckoo::*;
+pub use dedup::*;
+pub use digest::*;
+pub use duplicates::*;
 pub use farm::*;
+pub use feature_hash::*;
+pub use fingerprint_set::*;
 pub use fnv::*;
+pub use group_by::*;
+pub use interner::*;
+pub use join::*;
+pub use lines::*;
+pub use manifest::*;
+pub use memo::*;
+pub use merkle::*;
+pub use mmap::*;
+pub use mphf::*;
+pub use multi_index::*;
 pub use murmur::*;
+pub use prehashed::*;
+pub use records::*;
 pub use rendezvous::*;
+pub use shard::*;
+pub use sharded_map::*;
+pub use space_saving::*;
+pub use static_index::*;
+pub use static_map::*;
+pub use tree_hash::*;
 
 /// Computes the FNV-1 hash (32-bit) of the provided data.
 ///
@@ -0,0 +1,440 @@
+use crate::digest::Algorithm;
+use crate::parallel;
+use std::io::{self, Read};
+
+const LO: u64 = 0x0101_0101_0101_0101;
+const HI: u64 = 0x8080_8080_8080_8080;
+
+// Segments per worker in one block, so a worker that finishes early can take another
+const SEGMENTS_PER_THREAD: usize = 4;
+
+/// Returns the index of the first `needle` in `haystack`.
+///
+/// Scans eight bytes at a time: XOR-ing a word with the needle repeated in every byte turns
+/// matches into zero bytes, and `(x - 0x01..01) & !x & 0x80..80` flags the zero bytes. The
+/// lowest flag is always exact, so its position is the first match.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::lines::find_byte;
+///
+/// assert_eq!(find_byte(b'\n', b"key one\nkey two\n"), Some(7));
+/// assert_eq!(find_byte(b'\n', b"no newline"), None);
+/// ```
+#[inline]
+pub fn find_byte(needle: u8, haystack: &[u8]) -> Option<usize> {
+    let pattern = LO * needle as u64;
+    let mut chunks = haystack.chunks_exact(8);
+    let mut offset = 0;
+    for chunk in &mut chunks {
+        let word = u64::from_le_bytes(chunk.try_into().unwrap()) ^ pattern;
+        let found = word.wrapping_sub(LO) & !word & HI;
+        if found != 0 {
+            return Some(offset + (found.trailing_zeros() / 8) as usize);
+        }
+        offset += 8;
+    }
+    chunks
+        .remainder()
+        .iter()
+        .position(|&b| b == needle)
+        .map(|i| offset + i)
+}
+
+/// An iterator over the `\n`-terminated lines of a byte slice, without their terminators.
+///
+/// A final line without a terminator is still returned, but a trailing `\n` does not produce
+/// an empty last line. `\r` is kept, so CRLF input hashes the carriage return too.
+#[derive(Debug, Clone)]
+pub struct Lines<'a> {
+    rest: &'a [u8],
+}
+
+/// Splits `data` into lines using [`find_byte`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::lines::split_lines;
+///
+/// let lines: Vec<&[u8]> = split_lines(b"a\n\nbc\nd").collect();
+/// assert_eq!(lines, [&b"a"[..], b"", b"bc", b"d"]);
+/// ```
+pub fn split_lines(data: &[u8]) -> Lines<'_> {
+    Lines { rest: data }
+}
+
+impl<'a> Iterator for Lines<'a> {
+    type Item = &'a [u8];
+
+    #[inline]
+    fn next(&mut self) -> Option<&'a [u8]> {
+        if self.rest.is_empty() {
+            return None;
+        }
+        let (line, rest) = match find_byte(b'\n', self.rest) {
+            Some(end) => (&self.rest[..end], &self.rest[end + 1..]),
+            None => (self.rest, &[][..]),
+        };
+        self.rest = rest;
+        Some(line)
+    }
+}
+
+/// Hashes every line of a stream, for pipelines with far too many keys to run a process each.
+///
+/// Input is read in large blocks that are cut at the last newline; the partial line at the end
+/// is carried into the next block. With more than one thread each block is split at newlines
+/// into segments that are hashed and encoded in parallel, and the encoded segments are passed
+/// on in input order, so the output matches the single-threaded output byte for byte.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::digest::Algorithm;
+/// use simplehash::lines::LineHasher;
+///
+/// let input = &b"alpha\nbeta\n"[..];
+/// let mut out = Vec::new();
+/// let lines = LineHasher::new()
+///     .algorithm(Algorithm::Fnv1a64)
+///     .hash_reader(
+///         input,
+///         |hash, buf| buf.extend_from_slice(&(hash as u64).to_le_bytes()),
+///         |bytes| {
+///             out.extend_from_slice(bytes);
+///             Ok(())
+///         },
+///     )?;
+/// assert_eq!(lines, 2);
+/// assert_eq!(out[..8], simplehash::fnv1a_64(b"alpha").to_le_bytes());
+/// # Ok::<(), std::io::Error>(())
+/// ```
+#[derive(Debug, Clone)]
+pub struct LineHasher {
+    algorithm: Algorithm,
+    threads: usize,
+    block_size: usize,
+}
+
+impl Default for LineHasher {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl LineHasher {
+    /// Creates a single-threaded hasher using [`Algorithm::Murmur3_128`] and 8 MiB blocks.
+    pub fn new() -> Self {
+        Self {
+            algorithm: Algorithm::Murmur3_128,
+            threads: 1,
+            block_size: 8 << 20,
+        }
+    }
+
+    /// Sets the hash function applied to each line.
+    pub fn algorithm(mut self, algorithm: Algorithm) -> Self {
+        self.algorithm = algorithm;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets the size of each read. Blocks grow as needed to hold a longer line.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `block_size` is 0.
+    pub fn block_size(mut self, block_size: usize) -> Self {
+        assert!(block_size > 0, "block size must be positive");
+        self.block_size = block_size;
+        self
+    }
+
+    /// Appends the hash of every line of `data` to `out`, in order.
+    pub fn hash_lines(&self, data: &[u8], out: &mut Vec<u128>) {
+        let algorithm = self.algorithm;
+        let segments = segments(data, parallel::resolve_threads(self.threads));
+        let parts = parallel::map_indices(segments.len() - 1, self.threads, |i| {
+            split_lines(&data[segments[i]..segments[i + 1]])
+                .map(|line| algorithm.hash(line))
+                .collect::<Vec<_>>()
+        });
+        for part in parts {
+            out.extend(part);
+        }
+    }
+
+    /// Hashes every line read from `reader` and returns the number of lines.
+    ///
+    /// `encode` appends the encoding of one hash to a buffer. It runs on the workers, so
+    /// formatting scales with the hashing. `sink` receives the encoded hashes in input order,
+    /// one buffer per segment.
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error from `reader` or `sink`.
+    pub fn hash_reader<R, E, S>(&self, reader: R, encode: E, mut sink: S) -> io::Result<u64>
+    where
+        R: Read,
+        E: Fn(u128, &mut Vec<u8>) + Sync,
+        S: FnMut(&[u8]) -> io::Result<()>,
+    {
+        let workers = parallel::resolve_threads(self.threads);
+        let mut lines = 0;
+        // Reused by the single-threaded path, which encodes everything into one buffer
+        let mut encoded = Vec::new();
+        for_each_block(reader, self.block_size, |block| {
+            lines += self.encode_block(block, workers, &encode, &mut sink, &mut encoded)?;
+            Ok(())
+        })?;
+        Ok(lines)
+    }
+
+    /// Hashes every line of an in-memory buffer, such as a memory-mapped file, and returns the
+    /// number of lines.
+    ///
+    /// Works like [`LineHasher::hash_reader`] without copying the input: `data` is cut into
+    /// pieces of about the block size at newlines and each piece is encoded in place.
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error from `sink`.
+    pub fn hash_slice<E, S>(&self, data: &[u8], encode: E, mut sink: S) -> io::Result<u64>
+    where
+        E: Fn(u128, &mut Vec<u8>) + Sync,
+        S: FnMut(&[u8]) -> io::Result<()>,
+    {
+        let workers = parallel::resolve_threads(self.threads);
+        let mut lines = 0;
+        let mut encoded = Vec::new();
+        for_each_slice_block(data, self.block_size, |block| {
+            lines += self.encode_block(block, workers, &encode, &mut sink, &mut encoded)?;
+            Ok(())
+        })?;
+        Ok(lines)
+    }
+
+    // Encodes the lines of one block, in segments on the workers when there are several
+    fn encode_block<E, S>(
+        &self,
+        data: &[u8],
+        workers: usize,
+        encode: &E,
+        sink: &mut S,
+        encoded: &mut Vec<u8>,
+    ) -> io::Result<u64>
+    where
+        E: Fn(u128, &mut Vec<u8>) + Sync,
+        S: FnMut(&[u8]) -> io::Result<()>,
+    {
+        if workers <= 1 {
+            encoded.clear();
+            let lines = self.encode_lines(data, encode, encoded);
+            sink(encoded)?;
+            return Ok(lines);
+        }
+        let segments = segments(data, workers);
+        let parts = parallel::map_indices(segments.len() - 1, workers, |i| {
+            let mut buf = Vec::new();
+            let count = self.encode_lines(&data[segments[i]..segments[i + 1]], encode, &mut buf);
+            (count, buf)
+        });
+        let mut lines = 0;
+        for (count, buf) in parts {
+            lines += count;
+            sink(&buf)?;
+        }
+        Ok(lines)
+    }
+
+    #[inline]
+    fn encode_lines<E: Fn(u128, &mut Vec<u8>)>(
+        &self,
+        data: &[u8],
+        encode: &E,
+        out: &mut Vec<u8>,
+    ) -> u64 {
+        let mut count = 0;
+        for line in split_lines(data) {
+            encode(self.algorithm.hash(line), out);
+            count += 1;
+        }
+        count
+    }
+}
+
+/// Reads `reader` in blocks of about `block_size` bytes that end at a newline and passes each
+/// block to `f`. The partial line at the end of a read is carried into the next block, and
+/// a line longer than the block grows it. The last block may lack a final newline.
+pub(crate) fn for_each_block<R, F>(mut reader: R, block_size: usize, mut f: F) -> io::Result<()>
+where
+    R: Read,
+    F: FnMut(&[u8]) -> io::Result<()>,
+{
+    let mut block = vec![0u8; block_size];
+    let mut filled = 0;
+    loop {
+        let mut eof = false;
+        while filled < block.len() {
+            match reader.read(&mut block[filled..]) {
+                Ok(0) => {
+                    eof = true;
+                    break;
+                }
+                Ok(n) => filled += n,
+                Err(err) if err.kind() == io::ErrorKind::Interrupted => {}
+                Err(err) => return Err(err),
+            }
+        }
+
+        // Pass on everything up to the last newline, or everything once the input has ended
+        let end = if eof {
+            filled
+        } else {
+            match block[..filled].iter().rposition(|&b| b == b'\n') {
+                Some(last) => last + 1,
+                None => {
+                    // One line fills the whole block: grow it and keep reading
+                    block.resize(block.len() * 2, 0);
+                    continue;
+                }
+            }
+        };
+
+        f(&block[..end])?;
+        if eof {
+            return Ok(());
+        }
+        block.copy_within(end..filled, 0);
+        filled -= end;
+    }
+}
+
+/// Cuts `data` after newlines into blocks of about `block_size` bytes and passes each to `f`.
+pub(crate) fn for_each_slice_block<F>(
+    mut data: &[u8],
+    block_size: usize,
+    mut f: F,
+) -> io::Result<()>
+where
+    F: FnMut(&[u8]) -> io::Result<()>,
+{
+    while !data.is_empty() {
+        let end = if data.len() > block_size {
+            find_byte(b'\n', &data[block_size..]).map_or(data.len(), |i| block_size + i + 1)
+        } else {
+            data.len()
+        };
+        f(&data[..end])?;
+        data = &data[end..];
+    }
+    Ok(())
+}
+
+/// Cuts `data` after newlines into roughly equal segments for `workers` threads, returning the
+/// boundaries. A single worker gets a single segment.
+pub(crate) fn segments(data: &[u8], workers: usize) -> Vec<usize> {
+    let pieces = workers * SEGMENTS_PER_THREAD;
+    let mut bounds = vec![0];
+    if pieces > SEGMENTS_PER_THREAD {
+        for i in 1..pieces {
+            let target = (data.len() * i / pieces).max(*bounds.last().unwrap());
+            match find_byte(b'\n', &data[target..]) {
+                Some(offset) if target + offset + 1 < data.len() => {
+                    bounds.push(target + offset + 1)
+                }
+                _ => break,
+            }
+        }
+    }
+    bounds.push(data.len());
+    bounds.dedup();
+    bounds
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_find_byte_matches_naive_search() {
+        let data: Vec<u8> = (0..300u32).map(|i| (i * 37 % 256) as u8).collect();
+        for needle in [0u8, 1, b'\n', 0x7f, 0x80, 0xfe, 0xff] {
+            for start in 0..20 {
+                for end in (start..data.len()).step_by(7) {
+                    let haystack = &data[start..end];
+                    let expected = haystack.iter().position(|&b| b == needle);
+                    assert_eq!(find_byte(needle, haystack), expected);
+                }
+            }
+        }
+        // A byte just above the needle must not produce a false match
+        assert_eq!(
+            find_byte(b'\n', b"\x0b\x0b\x0b\x0b\x0b\x0b\x0b\x0b\n"),
+            Some(8)
+        );
+    }
+
+    #[test]
+    fn test_hash_reader_preserves_order_across_blocks_and_threads() {
+        let mut input = Vec::new();
+        for i in 0..5000 {
+            input.extend_from_slice(format!("key-{}", i * 7919).as_bytes());
+            input.push(b'\n');
+        }
+        input.extend_from_slice(&[b'x'; 100]); // longer than a block, no trailing newline
+        let expected: Vec<u128> = input
+            .split(|&b| b == b'\n')
+            .map(|line| Algorithm::City64.hash(line))
+            .collect();
+
+        for threads in [1, 3] {
+            let hasher = LineHasher::new()
+                .algorithm(Algorithm::City64)
+                .threads(threads)
+                .block_size(64);
+            let mut out = Vec::new();
+            let lines = hasher
+                .hash_reader(
+                    &input[..],
+                    |hash, buf| buf.extend_from_slice(&hash.to_le_bytes()),
+                    |bytes| {
+                        out.extend_from_slice(bytes);
+                        Ok(())
+                    },
+                )
+                .unwrap();
+            let hashes: Vec<u128> = out
+                .chunks(16)
+                .map(|c| u128::from_le_bytes(c.try_into().unwrap()))
+                .collect();
+            assert_eq!(lines, 5001);
+            assert_eq!(hashes, expected);
+
+            let mut sliced = Vec::new();
+            let sliced_lines = hasher
+                .hash_slice(
+                    &input,
+                    |hash, buf| buf.extend_from_slice(&hash.to_le_bytes()),
+                    |bytes| {
+                        sliced.extend_from_slice(bytes);
+                        Ok(())
+                    },
+                )
+                .unwrap();
+            assert_eq!(sliced_lines, 5001);
+            assert_eq!(sliced, out);
+
+            let mut direct = Vec::new();
+            hasher.hash_lines(&input, &mut direct);
+            assert_eq!(direct, expected);
+        }
+    }
+}
@@ -1,7 +1,10 @@
 /// SimpleHash CLI
 ///
 /// This is a command-line interface for the SimpleHash library, allowing quick calculation
-/// of various non-cryptographic hash functions from the terminal.
+/// of various non-cryptographic hash functions from the terminal. Subcommands hash files and
+/// other bulk input; any other argument is hashed as a string with every algorithm.
+mod cli;
+
 use simplehash::fnv::Fnv1aHasher64;
 use simplehash::rendezvous::RendezvousHasher;
 use simplehash::{
@@ -11,18 +14,49 @@ use std::env;
 use std::hash::BuildHasherDefault;
 use std::time::Instant;
 
+fn usage(program: &str) {
+    println!("Usage: {} <string_to_hash>", program);
+    println!("       {} <command> [options]", program);
+    println!();
+    println!("Commands:");
+    println!("  bench     Measure hash throughput and latency on this host");
+    println!("  dupes     Find duplicate files below directories");
+    println!("  file      Hash files or standard input");
+    println!("  lines     Hash each line of standard input");
+    println!("  manifest  Update a binary manifest of a tree and list changed files");
+    println!("  records   Hash fixed-width binary records into a packed hash column");
+    println!("  shard     Split lines into N files by a hashed key");
+    println!("  tree      Hash every file below a directory into a manifest");
+    println!();
+    println!(
+        "Run `{} <command> --help` for the options of a command.",
+        program
+    );
+}
+
 /// Main entry point for the CLI application.
 ///
-/// Calculates and displays multiple hash values for the provided input string.
-/// If no input string is provided, displays usage information.
+/// Dispatches subcommands, or calculates and displays multiple hash values for the provided
+/// input string. If no argument is provided, displays usage information.
 fn main() {
     let args: Vec<String> = env::args().collect();
-    if args.len() < 2 {
-        println!("Usage: {} <string_to_hash>", args[0]);
-        return;
+    let program = args.first().map(String::as_str).unwrap_or("simplehash");
+    match args.get(1).map(String::as_str) {
+        None | Some("-h") | Some("--help") => usage(program),
+        Some("bench") => cli::bench::run(&args[2..]),
+        Some("dupes") => cli::dupes::run(&args[2..]),
+        Some("file") => cli::file::run(&args[2..]),
+        Some("lines") => cli::lines::run(&args[2..]),
+        Some("manifest") => cli::manifest::run(&args[2..]),
+        Some("records") => cli::records::run(&args[2..]),
+        Some("shard") => cli::shard::run(&args[2..]),
+        Some("tree") => cli::tree::run(&args[2..]),
+        Some(input) => hash_string(input),
     }
+}
 
-    let input = &args[1];
+/// Calculates and displays every hash of `input`, followed by a rendezvous hashing demo.
+fn hash_string(input: &str) {
     let bytes = input.as_bytes();
     let now = Instant::now();
 
@@ -0,0 +1,573 @@
+use crate::mmap::MappedFile;
+use crate::parallel;
+use crate::tree_hash::walk;
+use crate::{farm_fingerprint64, farm_fingerprint128};
+use std::ffi::OsStr;
+use std::fmt;
+use std::fs;
+use std::io;
+use std::path::{Path, PathBuf};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+const MAGIC: &[u8; 8] = b"SHMANI01";
+const HEADER_LEN: usize = 32;
+// Files up to this size are read into memory; larger ones are memory-mapped
+const MAP_THRESHOLD: u64 = 1 << 20;
+// A file modified this close to the scan that recorded it may have been modified again
+// within the same timestamp tick, so its entry is not trusted (git's "racily clean" files)
+const RACY_NS: i64 = 1_000_000_000;
+
+/// Errors returned when loading a serialized [`Manifest`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum ManifestError {
+    /// The bytes are not a valid manifest.
+    InvalidData(&'static str),
+}
+
+impl fmt::Display for ManifestError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            ManifestError::InvalidData(reason) => write!(f, "invalid manifest data: {}", reason),
+        }
+    }
+}
+
+impl std::error::Error for ManifestError {}
+
+impl From<ManifestError> for io::Error {
+    fn from(err: ManifestError) -> Self {
+        io::Error::new(io::ErrorKind::InvalidData, err)
+    }
+}
+
+/// One regular file in a [`Manifest`]: the stat metadata it was hashed with, and its
+/// `farm_fingerprint128`.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ManifestEntry {
+    /// The path relative to the manifest root.
+    pub path: PathBuf,
+    /// The file size in bytes.
+    pub size: u64,
+    /// Modification time in nanoseconds since the Unix epoch.
+    pub mtime_ns: i64,
+    /// The inode number, or 0 where the platform has none.
+    pub inode: u64,
+    /// The `farm_fingerprint128` of the contents.
+    pub fingerprint: u128,
+}
+
+/// The fingerprints of every regular file under a directory, sorted by path, as kept between
+/// runs of [`ManifestBuilder::update`].
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct Manifest {
+    /// One entry per file, sorted by path.
+    pub entries: Vec<ManifestEntry>,
+    /// When the scan that produced the manifest started, in nanoseconds since the Unix epoch.
+    pub scanned_ns: i64,
+}
+
+impl Manifest {
+    /// Serializes the manifest: a 32-byte header, then one record per entry with the path
+    /// stored as the length of the prefix shared with the previous path plus the rest, and
+    /// the numbers as LEB128 varints. The header ends with a checksum of its other fields and
+    /// the records.
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut data = vec![0u8; HEADER_LEN];
+        let mut previous: &[u8] = &[];
+        for entry in &self.entries {
+            let path = entry.path.as_os_str().as_encoded_bytes();
+            let shared = path
+                .iter()
+                .zip(previous)
+                .take_while(|(a, b)| a == b)
+                .count();
+            put_varint(&mut data, shared as u64);
+            put_varint(&mut data, (path.len() - shared) as u64);
+            data.extend_from_slice(&path[shared..]);
+            put_varint(&mut data, entry.size);
+            put_varint(&mut data, zigzag(entry.mtime_ns));
+            put_varint(&mut data, entry.inode);
+            data.extend_from_slice(&entry.fingerprint.to_le_bytes());
+            previous = path;
+        }
+        data[0..8].copy_from_slice(MAGIC);
+        data[8..16].copy_from_slice(&self.scanned_ns.to_le_bytes());
+        data[16..24].copy_from_slice(&(self.entries.len() as u64).to_le_bytes());
+        let checksum = checksum(&data[..24], &data[HEADER_LEN..]);
+        data[24..32].copy_from_slice(&checksum.to_le_bytes());
+        data
+    }
+
+    /// Restores a manifest from [`Manifest::to_bytes`] output.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`ManifestError::InvalidData`] if the header, checksum or records are
+    /// inconsistent.
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, ManifestError> {
+        if bytes.len() < HEADER_LEN || &bytes[0..8] != MAGIC {
+            return Err(ManifestError::InvalidData("bad magic"));
+        }
+        let scanned_ns = i64::from_le_bytes(bytes[8..16].try_into().unwrap());
+        let count = u64::from_le_bytes(bytes[16..24].try_into().unwrap());
+        let stored = u64::from_le_bytes(bytes[24..32].try_into().unwrap());
+        let mut body = &bytes[HEADER_LEN..];
+        if checksum(&bytes[..24], body) != stored {
+            return Err(ManifestError::InvalidData("checksum mismatch"));
+        }
+
+        // Every record takes at least 21 bytes, which bounds the allocation
+        let mut entries = Vec::with_capacity(count.min(body.len() as u64 / 21) as usize);
+        let mut path: Vec<u8> = Vec::new();
+        for _ in 0..count {
+            let shared = take_varint(&mut body)? as usize;
+            let rest = take_varint(&mut body)? as usize;
+            if shared > path.len() || rest > body.len() {
+                return Err(ManifestError::InvalidData("bad path"));
+            }
+            path.truncate(shared);
+            path.extend_from_slice(&body[..rest]);
+            body = &body[rest..];
+            let size = take_varint(&mut body)?;
+            let mtime_ns = unzigzag(take_varint(&mut body)?);
+            let inode = take_varint(&mut body)?;
+            if body.len() < 16 {
+                return Err(ManifestError::InvalidData("truncated record"));
+            }
+            let fingerprint = u128::from_le_bytes(body[..16].try_into().unwrap());
+            body = &body[16..];
+            entries.push(ManifestEntry {
+                path: path_from_bytes(&path)?,
+                size,
+                mtime_ns,
+                inode,
+                fingerprint,
+            });
+        }
+        if !body.is_empty() {
+            return Err(ManifestError::InvalidData("trailing bytes"));
+        }
+        Ok(Manifest {
+            entries,
+            scanned_ns,
+        })
+    }
+
+    /// Writes the manifest to `path` (see [`Manifest::to_bytes`]), replacing any previous
+    /// file only once the new one is complete.
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be written.
+    pub fn save<P: AsRef<Path>>(&self, path: P) -> io::Result<()> {
+        let path = path.as_ref();
+        let mut temp = path.as_os_str().to_owned();
+        temp.push(".tmp");
+        fs::write(&temp, self.to_bytes())?;
+        fs::rename(&temp, path)
+    }
+
+    /// Reads a manifest written by [`Manifest::save`].
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be read, or an `InvalidData` error wrapping
+    /// [`ManifestError`] if it is not a valid manifest.
+    pub fn load<P: AsRef<Path>>(path: P) -> io::Result<Self> {
+        Ok(Self::from_bytes(&fs::read(path)?)?)
+    }
+}
+
+/// How a file's contents changed between two manifests.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ChangeKind {
+    /// The file is new since the previous manifest.
+    Added,
+    /// The file's fingerprint differs from the previous manifest.
+    Modified,
+    /// The file was in the previous manifest but no longer exists.
+    Removed,
+}
+
+/// The result of [`ManifestBuilder::update`].
+#[derive(Debug, Default)]
+pub struct ManifestUpdate {
+    /// The manifest of the tree as it is now.
+    pub manifest: Manifest,
+    /// Files whose contents were added, modified or removed, sorted by path. A file whose
+    /// metadata changed but whose fingerprint did not is not listed.
+    pub changes: Vec<(ChangeKind, PathBuf)>,
+    /// Files that were hashed because they were new or their metadata changed.
+    pub hashed_files: u64,
+    /// Bytes read to hash them.
+    pub hashed_bytes: u64,
+    /// Files and directories that could not be read. Files that fail to hash keep their
+    /// previous entry, if they had one.
+    pub errors: Vec<(PathBuf, io::Error)>,
+}
+
+/// Keeps a [`Manifest`] of a directory tree up to date, re-hashing only files whose size,
+/// modification time or inode changed.
+///
+/// The directory walk runs on a work-stealing pool and the files to hash are spread over
+/// worker threads. A file modified less than a second before the previous scan started is
+/// hashed again anyway, since a second change within the same timestamp tick would not show
+/// in its metadata.
+///
+/// # Example
+///
+/// ```no_run
+/// use simplehash::manifest::{Manifest, ManifestBuilder};
+///
+/// let previous = Manifest::load("tree.manifest").unwrap_or_default();
+/// let update = ManifestBuilder::new().update("dataset", &previous)?;
+/// for (kind, path) in &update.changes {
+///     println!("{:?} {}", kind, path.display());
+/// }
+/// update.manifest.save("tree.manifest")?;
+/// # Ok::<(), std::io::Error>(())
+/// ```
+#[derive(Debug, Clone)]
+pub struct ManifestBuilder {
+    threads: usize,
+    exclude: Vec<PathBuf>,
+}
+
+impl Default for ManifestBuilder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ManifestBuilder {
+    /// Creates a builder using all available cores.
+    pub fn new() -> Self {
+        Self {
+            threads: 0,
+            exclude: Vec::new(),
+        }
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Leaves the file at `path`, relative to the root, out of the manifest, for example the
+    /// manifest file itself.
+    pub fn exclude<P: Into<PathBuf>>(mut self, path: P) -> Self {
+        self.exclude.push(path.into());
+        self
+    }
+
+    /// Hashes every regular file below `root` into a new manifest.
+    ///
+    /// # Errors
+    ///
+    /// Returns the error if `root` itself cannot be read as a directory.
+    pub fn build<P: AsRef<Path>>(&self, root: P) -> io::Result<ManifestUpdate> {
+        self.update(root, &Manifest::default())
+    }
+
+    /// Brings `previous` up to date with the files below `root`.
+    ///
+    /// Entries whose metadata still matches are kept without reading the file; the others
+    /// are hashed in parallel.
+    ///
+    /// # Errors
+    ///
+    /// Returns the error if `root` itself cannot be read as a directory.
+    pub fn update<P: AsRef<Path>>(
+        &self,
+        root: P,
+        previous: &Manifest,
+    ) -> io::Result<ManifestUpdate> {
+        let root = root.as_ref();
+        fs::read_dir(root)?;
+        let scanned_ns = time_ns(SystemTime::now());
+        let (mut files, mut errors) = walk(root, self.threads);
+        files.retain(|(path, _)| !self.exclude.contains(path));
+        files.sort_unstable_by(|a, b| path_bytes(&a.0).cmp(path_bytes(&b.0)));
+
+        // Merge the sorted listing with the sorted previous entries
+        let mut entries = Vec::with_capacity(files.len());
+        // Indices into `entries` to hash, with the previous entry when there was one
+        let mut stale: Vec<(usize, Option<&ManifestEntry>)> = Vec::new();
+        let mut removed = Vec::new();
+        let mut old = previous.entries.iter().peekable();
+        for (path, meta) in files {
+            while let Some(entry) = old.next_if(|e| path_bytes(&e.path) < path_bytes(&path)) {
+                removed.push(entry);
+            }
+            let entry = ManifestEntry {
+                size: meta.len(),
+                mtime_ns: meta.modified().map_or(0, time_ns),
+                inode: inode(&meta),
+                fingerprint: 0,
+                path,
+            };
+            match old.next_if(|e| e.path == entry.path) {
+                Some(old)
+                    if old.size == entry.size
+                        && old.mtime_ns == entry.mtime_ns
+                        && old.inode == entry.inode
+                        && old.mtime_ns < previous.scanned_ns.saturating_sub(RACY_NS) =>
+                {
+                    entries.push(ManifestEntry {
+                        fingerprint: old.fingerprint,
+                        ..entry
+                    })
+                }
+                old => {
+                    stale.push((entries.len(), old));
+                    entries.push(entry);
+                }
+            }
+        }
+        removed.extend(old);
+
+        let fingerprints = parallel::map_indices(stale.len(), self.threads, |i| {
+            let entry = &entries[stale[i].0];
+            fingerprint(&root.join(&entry.path), entry.size)
+        });
+        let mut update = ManifestUpdate::default();
+        let mut failed = Vec::new();
+        for (&(index, old), result) in stale.iter().zip(fingerprints) {
+            let entry = &mut entries[index];
+            match (result, old) {
+                (Ok(fingerprint), old) => {
+                    update.hashed_files += 1;
+                    update.hashed_bytes += entry.size;
+                    entry.fingerprint = fingerprint;
+                    match old {
+                        None => update.changes.push((ChangeKind::Added, entry.path.clone())),
+                        Some(old) if old.fingerprint != fingerprint => update
+                            .changes
+                            .push((ChangeKind::Modified, entry.path.clone())),
+                        Some(_) => {}
+                    }
+                }
+                (Err(err), Some(old)) => {
+                    errors.push((entry.path.clone(), err));
+                    *entry = old.clone();
+                }
+                (Err(err), None) => {
+                    errors.push((entry.path.clone(), err));
+                    failed.push(index);
+                }
+            }
+        }
+        if !failed.is_empty() {
+            let mut index = 0;
+            entries.retain(|_| {
+                index += 1;
+                failed.binary_search(&(index - 1)).is_err()
+            });
+        }
+        update.changes.extend(
+            removed
+                .into_iter()
+                .map(|e| (ChangeKind::Removed, e.path.clone())),
+        );
+        update
+            .changes
+            .sort_unstable_by(|a, b| path_bytes(&a.1).cmp(path_bytes(&b.1)));
+        errors.sort_unstable_by(|a, b| a.0.cmp(&b.0));
+        update.errors = errors;
+        update.manifest = Manifest {
+            entries,
+            scanned_ns,
+        };
+        Ok(update)
+    }
+}
+
+fn fingerprint(path: &Path, size: u64) -> io::Result<u128> {
+    if size > MAP_THRESHOLD {
+        let map = MappedFile::open(path)?;
+        let _ = map.advise_sequential();
+        Ok(farm_fingerprint128(map.as_slice()))
+    } else {
+        Ok(farm_fingerprint128(&fs::read(path)?))
+    }
+}
+
+fn path_bytes(path: &Path) -> &[u8] {
+    path.as_os_str().as_encoded_bytes()
+}
+
+// Covers the header fields before the checksum as well as the records, so a damaged scan
+// time or entry count is caught too
+fn checksum(header: &[u8], body: &[u8]) -> u64 {
+    let mut input = [0u8; 32];
+    input[..24].copy_from_slice(header);
+    input[24..].copy_from_slice(&farm_fingerprint64(body).to_le_bytes());
+    farm_fingerprint64(&input)
+}
+
+#[cfg(unix)]
+fn path_from_bytes(bytes: &[u8]) -> Result<PathBuf, ManifestError> {
+    use std::os::unix::ffi::OsStrExt;
+    Ok(PathBuf::from(OsStr::from_bytes(bytes)))
+}
+
+#[cfg(not(unix))]
+fn path_from_bytes(bytes: &[u8]) -> Result<PathBuf, ManifestError> {
+    std::str::from_utf8(bytes)
+        .map(|s| PathBuf::from(OsStr::new(s)))
+        .map_err(|_| ManifestError::InvalidData("path is not valid UTF-8"))
+}
+
+#[cfg(unix)]
+fn inode(meta: &fs::Metadata) -> u64 {
+    std::os::unix::fs::MetadataExt::ino(meta)
+}
+
+#[cfg(not(unix))]
+fn inode(_meta: &fs::Metadata) -> u64 {
+    0
+}
+
+fn time_ns(time: SystemTime) -> i64 {
+    match time.duration_since(UNIX_EPOCH) {
+        Ok(after) => after.as_nanos() as i64,
+        Err(before) => -(before.duration().as_nanos() as i64),
+    }
+}
+
+fn zigzag(value: i64) -> u64 {
+    ((value << 1) ^ (value >> 63)) as u64
+}
+
+fn unzigzag(value: u64) -> i64 {
+    ((value >> 1) as i64) ^ -((value & 1) as i64)
+}
+
+fn put_varint(data: &mut Vec<u8>, mut value: u64) {
+    while value >= 0x80 {
+        data.push(value as u8 | 0x80);
+        value >>= 7;
+    }
+    data.push(value as u8);
+}
+
+fn take_varint(data: &mut &[u8]) -> Result<u64, ManifestError> {
+    let mut value = 0u64;
+    for (i, &byte) in data.iter().enumerate().take(10) {
+        value |= ((byte & 0x7f) as u64) << (7 * i);
+        if byte < 0x80 {
+            *data = &data[i + 1..];
+            return Ok(value);
+        }
+    }
+    Err(ManifestError::InvalidData("bad varint"))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_manifest_round_trips() {
+        let manifest = Manifest {
+            entries: vec![
+                ManifestEntry {
+                    path: PathBuf::from("a/b/one"),
+                    size: 3,
+                    mtime_ns: 1_700_000_000_123_456_789,
+                    inode: 42,
+                    fingerprint: farm_fingerprint128(b"one"),
+                },
+                ManifestEntry {
+                    path: PathBuf::from("a/b/two"),
+                    size: 1 << 40,
+                    mtime_ns: -5,
+                    inode: u64::MAX,
+                    fingerprint: u128::MAX,
+                },
+            ],
+            scanned_ns: 1_700_000_001_000_000_000,
+        };
+        let bytes = manifest.to_bytes();
+        assert_eq!(Manifest::from_bytes(&bytes).unwrap(), manifest);
+
+        let mut corrupt = bytes.clone();
+        *corrupt.last_mut().unwrap() ^= 1;
+        assert_eq!(
+            Manifest::from_bytes(&corrupt),
+            Err(ManifestError::InvalidData("checksum mismatch"))
+        );
+        for at in [8, 16] {
+            let mut corrupt = bytes.clone();
+            corrupt[at] ^= 1;
+            assert_eq!(
+                Manifest::from_bytes(&corrupt),
+                Err(ManifestError::InvalidData("checksum mismatch"))
+            );
+        }
+        assert_eq!(
+            Manifest::from_bytes(&bytes[..20]),
+            Err(ManifestError::InvalidData("bad magic"))
+        );
+    }
+
+    #[test]
+    fn test_update_rehashes_only_changed_files() {
+        let root = std::env::temp_dir().join(format!("simplehash-manifest-{}", std::process::id()));
+        let _ = fs::remove_dir_all(&root);
+        fs::create_dir_all(root.join("a/b")).unwrap();
+        for (path, data) in [("a/one", "one"), ("a/b/two", "two"), ("three", "three")] {
+            fs::write(root.join(path), data).unwrap();
+        }
+        let builder = ManifestBuilder::new().threads(3).exclude("manifest");
+        fs::write(root.join("manifest"), "excluded").unwrap();
+
+        let cold = builder.build(&root).unwrap();
+        assert_eq!(cold.hashed_files, 3);
+        assert_eq!(cold.changes.len(), 3);
+        assert!(
+            cold.changes
+                .iter()
+                .all(|(kind, _)| *kind == ChangeKind::Added)
+        );
+        assert_eq!(cold.manifest.entries[0].path, Path::new("a/b/two"));
+        assert_eq!(
+            cold.manifest.entries[0].fingerprint,
+            farm_fingerprint128(b"two")
+        );
+
+        // Pretend the previous scan happened long after the files were written
+        let mut previous = cold.manifest.clone();
+        previous.scanned_ns += 10 * RACY_NS;
+        let warm = builder.update(&root, &previous).unwrap();
+        assert_eq!(warm.hashed_files, 0);
+        assert!(warm.changes.is_empty());
+        assert_eq!(warm.manifest.entries, cold.manifest.entries);
+
+        // Without that, the files are too recent to trust and are hashed again
+        let racy = builder.update(&root, &cold.manifest).unwrap();
+        assert_eq!(racy.hashed_files, 3);
+        assert!(racy.changes.is_empty());
+
+        fs::write(root.join("a/one"), "ONE, longer").unwrap();
+        fs::remove_file(root.join("three")).unwrap();
+        fs::write(root.join("a/four"), "four").unwrap();
+        let changed = builder.update(&root, &previous).unwrap();
+        let saved = root.join("manifest");
+        changed.manifest.save(&saved).unwrap();
+        let loaded = Manifest::load(&saved).unwrap();
+        fs::remove_dir_all(&root).unwrap();
+
+        assert_eq!(changed.hashed_files, 2);
+        assert_eq!(
+            changed.changes,
+            [
+                (ChangeKind::Added, PathBuf::from("a/four")),
+                (ChangeKind::Modified, PathBuf::from("a/one")),
+                (ChangeKind::Removed, PathBuf::from("three")),
+            ]
+        );
+        assert_eq!(loaded, changed.manifest);
+    }
+}
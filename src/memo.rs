@@ -0,0 +1,528 @@
+use crate::farm::farm_fingerprint128;
+use crate::parallel::resolve_threads;
+use crate::prehashed::NoHashBuildHasher;
+use crate::sharded_map::CachePadded;
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, OnceLock, RwLock};
+
+// Bookkeeping charged per entry on top of the value: the map node, the clock queue slot and
+// the shared result cell
+const ENTRY_OVERHEAD: usize = 96;
+
+type Shards<V> = Box<[CachePadded<RwLock<MemoShard<V>>>]>;
+
+/// A memoization cache for expensive pure functions of large inputs.
+///
+/// Results are keyed by a 128-bit fingerprint of the input bytes (FarmHash Fingerprint128 by
+/// default), so the cache never stores or compares the inputs themselves. Megabyte inputs
+/// cost one hashing pass and 16 bytes of key. With [`MemoizerBuilder::verify`], each entry
+/// also keeps a copy of its input, and a hit is only served when the input matches exactly.
+///
+/// Concurrent calls for the same input are single-flight: one caller runs the computation
+/// and the others wait for its result instead of computing it again. The cache is bounded by
+/// memory. Each entry is charged its value's weight plus a fixed overhead (and its input
+/// when verifying), and entries are evicted in CLOCK order, so results that were hit since
+/// the hand last passed get a second chance.
+///
+/// Values are returned by clone; wrap large results in an [`Arc`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::memo::Memoizer;
+///
+/// let memo = Memoizer::new(64 << 20);
+/// let template = vec![b'x'; 1 << 20];
+/// let render = |input: &[u8]| input.iter().filter(|&&b| b == b'x').count();
+///
+/// assert_eq!(memo.get_or_compute(&template, render), 1 << 20);
+/// // Served from the cache: the closure is not called again
+/// assert_eq!(memo.get_or_compute(&template, |_| unreachable!()), 1 << 20);
+/// ```
+pub struct Memoizer<V> {
+    shards: Shards<V>,
+    shift: u32,
+    weigher: fn(&V) -> usize,
+    fingerprint: fn(&[u8]) -> u128,
+    verify: bool,
+}
+
+/// Configures and builds a [`Memoizer`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::city::city_hash128;
+/// use simplehash::memo::MemoizerBuilder;
+///
+/// let memo = MemoizerBuilder::<String>::new(256 << 20)
+///     .weigher(|plan| plan.capacity())
+///     .fingerprint(city_hash128)
+///     .verify(true)
+///     .build();
+/// let plan = memo.get_or_compute(b"SELECT * FROM t", |q| format!("scan {}", q.len()));
+/// assert_eq!(plan, "scan 15");
+/// ```
+pub struct MemoizerBuilder<V> {
+    capacity: usize,
+    shards: usize,
+    weigher: fn(&V) -> usize,
+    fingerprint: fn(&[u8]) -> u128,
+    verify: bool,
+}
+
+// Shared between the cache and every caller waiting on the same input
+struct Flight<V> {
+    value: OnceLock<V>,
+    input: Option<Box<[u8]>>,
+    referenced: AtomicBool,
+}
+
+struct Node<V> {
+    flight: Arc<Flight<V>>,
+    weight: usize,
+    // Distinguishes this node from earlier ones for the same fingerprint in the clock queue
+    id: u64,
+}
+
+struct MemoShard<V> {
+    map: HashMap<u128, Node<V>, NoHashBuildHasher>,
+    clock: VecDeque<(u128, u64)>,
+    next_id: u64,
+    weight: usize,
+    capacity: usize,
+}
+
+impl<V> MemoizerBuilder<V> {
+    /// Creates a builder for a memoizer holding at most `capacity` bytes of results.
+    ///
+    /// # Parameters
+    ///
+    /// * `capacity` - Memory budget in bytes, as measured by the weigher plus per-entry
+    ///   overhead
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            capacity,
+            shards: 0,
+            weigher: |_| std::mem::size_of::<V>(),
+            fingerprint: farm_fingerprint128,
+            verify: false,
+        }
+    }
+
+    /// Sets the minimum number of shards (rounded up to a power of two, at most 2^16).
+    /// The default of `0` uses four shards per available CPU.
+    pub fn shards(mut self, shards: usize) -> Self {
+        self.shards = shards;
+        self
+    }
+
+    /// Sets the function that computes a result's size in bytes, including heap data it owns.
+    /// Defaults to `size_of::<V>()`.
+    pub fn weigher(mut self, weigher: fn(&V) -> usize) -> Self {
+        self.weigher = weigher;
+        self
+    }
+
+    /// Sets the 128-bit hash used to fingerprint inputs, such as
+    /// [`city_hash128`](crate::city::city_hash128). Defaults to
+    /// [`farm_fingerprint128`](crate::farm::farm_fingerprint128).
+    pub fn fingerprint(mut self, fingerprint: fn(&[u8]) -> u128) -> Self {
+        self.fingerprint = fingerprint;
+        self
+    }
+
+    /// Keeps a copy of each input and serves a hit only when the input matches it byte for
+    /// byte. Inputs count against the memory budget. Off by default.
+    pub fn verify(mut self, verify: bool) -> Self {
+        self.verify = verify;
+        self
+    }
+
+    /// Builds the memoizer. The memory budget is split evenly between the shards.
+    pub fn build(self) -> Memoizer<V> {
+        let shards = if self.shards == 0 {
+            resolve_threads(0) * 4
+        } else {
+            self.shards
+        };
+        let shards = shards.clamp(1, 1 << 16).next_power_of_two();
+        let capacity = self.capacity.div_ceil(shards);
+        Memoizer {
+            shards: (0..shards)
+                .map(|_| {
+                    CachePadded(RwLock::new(MemoShard {
+                        map: HashMap::default(),
+                        clock: VecDeque::new(),
+                        next_id: 0,
+                        weight: 0,
+                        capacity,
+                    }))
+                })
+                .collect(),
+            shift: 64 - shards.trailing_zeros(),
+            weigher: self.weigher,
+            fingerprint: self.fingerprint,
+            verify: self.verify,
+        }
+    }
+}
+
+impl<V: Clone> Memoizer<V> {
+    /// Creates a memoizer holding at most `capacity` bytes of results, weighing each result
+    /// as `size_of::<V>()`.
+    ///
+    /// # Parameters
+    ///
+    /// * `capacity` - Memory budget in bytes
+    pub fn new(capacity: usize) -> Self {
+        MemoizerBuilder::new(capacity).build()
+    }
+
+    #[inline]
+    fn shard(&self, fingerprint: u128) -> &RwLock<MemoShard<V>> {
+        // checked_shr covers the single-shard case, where the shift is 64
+        let high = (fingerprint >> 64) as u64;
+        &self.shards[high.checked_shr(self.shift).unwrap_or(0) as usize].0
+    }
+
+    /// Returns the memoized result for `input`, calling `compute` to produce it on a miss.
+    ///
+    /// If other threads ask for the same input while it is being computed, they block until
+    /// the result is ready and share it. If `compute` panics, the panic propagates to its
+    /// caller and one of the waiting callers computes the result instead.
+    ///
+    /// # Parameters
+    ///
+    /// * `input` - Bytes the result depends on, and nothing else
+    /// * `compute` - Pure function of `input`
+    pub fn get_or_compute<F>(&self, input: &[u8], compute: F) -> V
+    where
+        F: FnOnce(&[u8]) -> V,
+    {
+        let fingerprint = (self.fingerprint)(input);
+        let shard = self.shard(fingerprint);
+
+        let existing = shard.read().unwrap().map.get(&fingerprint).map(|node| {
+            let flight = Arc::clone(&node.flight);
+            if !flight.referenced.load(Ordering::Relaxed) {
+                flight.referenced.store(true, Ordering::Relaxed);
+            }
+            flight
+        });
+        let flight = match existing {
+            Some(flight) => flight,
+            None => self.start(shard, fingerprint, input),
+        };
+
+        if flight
+            .input
+            .as_ref()
+            .is_some_and(|stored| **stored != *input)
+        {
+            // A fingerprint collision: the result belongs to a different input
+            return compute(input);
+        }
+
+        let mut computed = false;
+        let value = flight
+            .value
+            .get_or_init(|| {
+                computed = true;
+                compute(input)
+            })
+            .clone();
+        if computed {
+            self.charge(shard, fingerprint, &flight, (self.weigher)(&value));
+        }
+        value
+    }
+
+    // Registers an in-flight entry for a missing fingerprint, or returns the one another
+    // thread registered first
+    fn start(
+        &self,
+        shard: &RwLock<MemoShard<V>>,
+        fingerprint: u128,
+        input: &[u8],
+    ) -> Arc<Flight<V>> {
+        let mut shard = shard.write().unwrap();
+        if let Some(node) = shard.map.get(&fingerprint) {
+            return Arc::clone(&node.flight);
+        }
+        let flight = Arc::new(Flight {
+            value: OnceLock::new(),
+            input: self.verify.then(|| input.into()),
+            referenced: AtomicBool::new(false),
+        });
+        let weight = ENTRY_OVERHEAD + flight.input.as_ref().map_or(0, |i| i.len());
+        let id = shard.next_id;
+        shard.next_id += 1;
+        shard.map.insert(
+            fingerprint,
+            Node {
+                flight: Arc::clone(&flight),
+                weight,
+                id,
+            },
+        );
+        shard.clock.push_back((fingerprint, id));
+        shard.weight += weight;
+        shard.evict_to_capacity();
+        shard.compact_clock();
+        flight
+    }
+
+    // Adds a freshly computed result's weight to its entry, unless it was evicted meanwhile
+    fn charge(
+        &self,
+        shard: &RwLock<MemoShard<V>>,
+        fingerprint: u128,
+        flight: &Arc<Flight<V>>,
+        weight: usize,
+    ) {
+        let mut shard = shard.write().unwrap();
+        let Some(node) = shard.map.get_mut(&fingerprint) else {
+            return;
+        };
+        if !Arc::ptr_eq(&node.flight, flight) {
+            return;
+        }
+        node.weight += weight;
+        shard.weight += weight;
+        shard.evict_to_capacity();
+    }
+
+    /// Returns the memoized result for `input` if it has been computed, without computing it
+    /// or waiting for a computation in progress.
+    pub fn get(&self, input: &[u8]) -> Option<V> {
+        let fingerprint = (self.fingerprint)(input);
+        let shard = self.shard(fingerprint).read().unwrap();
+        let flight = &shard.map.get(&fingerprint)?.flight;
+        if flight
+            .input
+            .as_ref()
+            .is_some_and(|stored| **stored != *input)
+        {
+            return None;
+        }
+        let value = flight.value.get()?.clone();
+        flight.referenced.store(true, Ordering::Relaxed);
+        Some(value)
+    }
+
+    /// Forgets the result for `input`, returning `true` if one was cached or in progress.
+    /// Callers already waiting on an in-progress computation still receive its result.
+    pub fn invalidate(&self, input: &[u8]) -> bool {
+        let fingerprint = (self.fingerprint)(input);
+        let mut shard = self.shard(fingerprint).write().unwrap();
+        match shard.map.remove(&fingerprint) {
+            Some(node) => {
+                shard.weight -= node.weight;
+                shard.compact_clock();
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Returns the number of entries, including computations in progress.
+    pub fn len(&self) -> usize {
+        self.shards
+            .iter()
+            .map(|s| s.0.read().unwrap().map.len())
+            .sum()
+    }
+
+    /// Returns `true` if nothing is memoized.
+    pub fn is_empty(&self) -> bool {
+        self.shards
+            .iter()
+            .all(|s| s.0.read().unwrap().map.is_empty())
+    }
+
+    /// Returns the bytes currently charged against the memory budget.
+    pub fn weight(&self) -> usize {
+        self.shards.iter().map(|s| s.0.read().unwrap().weight).sum()
+    }
+
+    /// Returns the memory budget in bytes, rounded up to a multiple of the shard count.
+    pub fn capacity(&self) -> usize {
+        self.shards
+            .iter()
+            .map(|s| s.0.read().unwrap().capacity)
+            .sum()
+    }
+
+    /// Forgets every result.
+    pub fn clear(&self) {
+        for shard in self.shards.iter() {
+            let mut shard = shard.0.write().unwrap();
+            shard.map.clear();
+            shard.clock.clear();
+            shard.weight = 0;
+        }
+    }
+}
+
+impl<V> std::fmt::Debug for Memoizer<V> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("Memoizer")
+            .field("shards", &self.shards.len())
+            .field("verify", &self.verify)
+            .finish_non_exhaustive()
+    }
+}
+
+impl<V> MemoShard<V> {
+    // Pops entries off the clock queue until the shard fits its budget. Entries hit since
+    // the hand last passed are cleared and requeued once; queue slots left behind by
+    // invalidated or replaced entries are dropped.
+    fn evict_to_capacity(&mut self) {
+        while self.weight > self.capacity {
+            let Some((fingerprint, id)) = self.clock.pop_front() else {
+                return;
+            };
+            let Some(node) = self.map.get(&fingerprint) else {
+                continue;
+            };
+            if node.id != id {
+                continue;
+            }
+            if node.flight.referenced.swap(false, Ordering::Relaxed) {
+                self.clock.push_back((fingerprint, id));
+                continue;
+            }
+            let node = self.map.remove(&fingerprint).unwrap();
+            self.weight -= node.weight;
+        }
+    }
+
+    // Drops the queue slots of invalidated or replaced entries once they outnumber the live
+    // ones, so the queue stays within twice the entry count even when the shard never fills
+    // its budget. Each pass removes at least half the queue, which keeps the cost amortized.
+    fn compact_clock(&mut self) {
+        if self.clock.len() <= 2 * self.map.len() {
+            return;
+        }
+        let map = &self.map;
+        self.clock
+            .retain(|(fingerprint, id)| map.get(fingerprint).is_some_and(|node| node.id == *id));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::AtomicUsize;
+    use std::thread;
+    use std::time::Duration;
+
+    #[test]
+    fn test_computes_once() {
+        let memo = Memoizer::new(1 << 20);
+        let calls = AtomicUsize::new(0);
+        let square_len = |input: &[u8]| {
+            calls.fetch_add(1, Ordering::Relaxed);
+            input.len() * input.len()
+        };
+        for _ in 0..3 {
+            assert_eq!(memo.get_or_compute(b"abcd", square_len), 16);
+            assert_eq!(memo.get_or_compute(b"abcdef", square_len), 36);
+        }
+        assert_eq!(calls.load(Ordering::Relaxed), 2);
+        assert_eq!(memo.get(b"abcd"), Some(16));
+        assert_eq!(memo.get(b"xyz"), None);
+        assert!(memo.invalidate(b"abcd"));
+        assert_eq!(memo.get(b"abcd"), None);
+        assert_eq!(memo.len(), 1);
+        memo.clear();
+        assert!(memo.is_empty());
+        assert_eq!(memo.weight(), 0);
+    }
+
+    #[test]
+    fn test_verification_catches_collisions() {
+        // Every input shares one fingerprint
+        let memo = MemoizerBuilder::new(1 << 20)
+            .fingerprint(|_| 42)
+            .verify(true)
+            .build();
+        assert_eq!(memo.get_or_compute(b"one", |i| i.to_vec()), b"one");
+        assert_eq!(memo.get_or_compute(b"two", |i| i.to_vec()), b"two");
+        assert_eq!(memo.get(b"two"), None);
+        assert_eq!(memo.get(b"one"), Some(b"one".to_vec()));
+
+        let unverified = MemoizerBuilder::new(1 << 20).fingerprint(|_| 42).build();
+        unverified.get_or_compute(b"one", |i| i.to_vec());
+        assert_eq!(unverified.get(b"two"), Some(b"one".to_vec()));
+    }
+
+    #[test]
+    fn test_memory_bound() {
+        let memo = MemoizerBuilder::<Vec<u8>>::new(64 * 1024)
+            .shards(2)
+            .weigher(|v| v.len())
+            .build();
+        for i in 0..1000u32 {
+            memo.get_or_compute(&i.to_le_bytes(), |_| vec![0; 1000]);
+            assert!(memo.weight() <= memo.capacity());
+        }
+        assert!(memo.len() > 20);
+        // Hot entries survive a scan of cold ones
+        let hot = 5000u32.to_le_bytes();
+        memo.get_or_compute(&hot, |_| vec![1; 1000]);
+        for i in 0..1000u32 {
+            memo.get(&hot);
+            memo.get_or_compute(&(10_000 + i).to_le_bytes(), |_| vec![0; 1000]);
+        }
+        assert_eq!(memo.get(&hot), Some(vec![1; 1000]));
+    }
+
+    #[test]
+    fn test_invalidated_slots_do_not_accumulate() {
+        let memo = MemoizerBuilder::<u64>::new(1 << 20).shards(1).build();
+        for i in 0..100_000u64 {
+            memo.get_or_compute(b"key", |_| i);
+            assert!(memo.invalidate(b"key"));
+        }
+        assert_eq!(memo.len(), 0);
+        assert_eq!(memo.weight(), 0);
+        let clock = memo.shards[0].0.read().unwrap().clock.len();
+        assert!(clock <= 1, "{} clock slots", clock);
+
+        for i in 0..1000u64 {
+            memo.get_or_compute(&i.to_le_bytes(), |_| i);
+            if i % 2 == 0 {
+                memo.invalidate(&i.to_le_bytes());
+            }
+        }
+        let shard = memo.shards[0].0.read().unwrap();
+        assert_eq!(shard.map.len(), 500);
+        assert!(shard.clock.len() <= 2 * shard.map.len());
+    }
+
+    #[test]
+    fn test_single_flight() {
+        let memo: Memoizer<u64> = Memoizer::new(1 << 20);
+        let calls = AtomicUsize::new(0);
+        let input = vec![7u8; 100_000];
+        let results: Vec<u64> = thread::scope(|s| {
+            let handles: Vec<_> = (0..8)
+                .map(|_| {
+                    s.spawn(|| {
+                        memo.get_or_compute(&input, |bytes| {
+                            calls.fetch_add(1, Ordering::SeqCst);
+                            thread::sleep(Duration::from_millis(50));
+                            bytes.iter().map(|&b| b as u64).sum()
+                        })
+                    })
+                })
+                .collect();
+            handles.into_iter().map(|h| h.join().unwrap()).collect()
+        });
+        assert!(results.iter().all(|&r| r == 700_000));
+        assert_eq!(calls.load(Ordering::SeqCst), 1);
+    }
+}
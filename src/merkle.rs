@@ -0,0 +1,587 @@
+use crate::city::{city_hash128, city_hash128_with_seed};
+use crate::mmap::MappedFile;
+use crate::murmurhash3_128;
+use crate::parallel;
+use std::fmt;
+use std::fs;
+use std::io;
+use std::ops::Range;
+use std::path::Path;
+
+const MAGIC: &[u8; 8] = b"SHMRKL01";
+const HEADER_LEN: usize = 32;
+// Bytes hashed per parallel work item
+const TASK_BYTES: usize = 4 << 20;
+// Inner nodes are hashed with a different seed than leaves so a leaf can never be
+// mistaken for a pair of child hashes
+const INNER_SEED: u32 = 0x6d65726b;
+
+/// The 128-bit hash a [`MerkleTree`] is built with.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum MerkleHash {
+    /// [`city_hash128`] for leaves; inner nodes use [`city_hash128_with_seed`].
+    City128,
+    /// [`murmurhash3_128`] with seed 0 for leaves and a fixed non-zero seed for inner nodes.
+    Murmur3_128,
+}
+
+impl MerkleHash {
+    #[inline]
+    fn leaf(self, data: &[u8]) -> u128 {
+        match self {
+            MerkleHash::City128 => city_hash128(data),
+            MerkleHash::Murmur3_128 => murmurhash3_128(data, 0),
+        }
+    }
+
+    #[inline]
+    fn inner(self, left: u128, right: u128) -> u128 {
+        let mut pair = [0u8; 32];
+        pair[..16].copy_from_slice(&left.to_le_bytes());
+        pair[16..].copy_from_slice(&right.to_le_bytes());
+        match self {
+            MerkleHash::City128 => city_hash128_with_seed(&pair, INNER_SEED as u128),
+            MerkleHash::Murmur3_128 => murmurhash3_128(&pair, INNER_SEED),
+        }
+    }
+
+    fn tag(self) -> u64 {
+        match self {
+            MerkleHash::City128 => 0,
+            MerkleHash::Murmur3_128 => 1,
+        }
+    }
+}
+
+/// Errors returned when loading a serialized [`MerkleTree`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum MerkleError {
+    /// The bytes are not a valid tree.
+    InvalidData(&'static str),
+}
+
+impl fmt::Display for MerkleError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            MerkleError::InvalidData(reason) => write!(f, "invalid merkle tree data: {}", reason),
+        }
+    }
+}
+
+impl std::error::Error for MerkleError {}
+
+impl From<MerkleError> for io::Error {
+    fn from(err: MerkleError) -> Self {
+        io::Error::new(io::ErrorKind::InvalidData, err)
+    }
+}
+
+/// Configures and builds a [`MerkleTree`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::merkle::MerkleBuilder;
+///
+/// let mut data = vec![0u8; 1 << 20];
+/// let mut tree = MerkleBuilder::new().leaf_size(4096).build(&data);
+/// let before = tree.clone();
+///
+/// data[10_000] = 1;
+/// tree.update(&data, &[10_000..10_001]);
+///
+/// assert_ne!(tree.root(), before.root());
+/// assert_eq!(tree.diff(&before), vec![8192..12288]);
+/// ```
+#[derive(Debug, Clone)]
+pub struct MerkleBuilder {
+    leaf_size: usize,
+    hash: MerkleHash,
+    threads: usize,
+}
+
+impl Default for MerkleBuilder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl MerkleBuilder {
+    /// Creates a builder with 64 KiB leaves, [`MerkleHash::Murmur3_128`] (the faster of the two
+    /// on large leaves), and all available cores.
+    pub fn new() -> Self {
+        Self {
+            leaf_size: 64 << 10,
+            hash: MerkleHash::Murmur3_128,
+            threads: 0,
+        }
+    }
+
+    /// Sets the number of bytes per leaf. Smaller leaves localize changes more precisely at
+    /// the cost of a larger tree (16 bytes per leaf).
+    ///
+    /// # Panics
+    ///
+    /// Panics if `leaf_size` is 0.
+    pub fn leaf_size(mut self, leaf_size: usize) -> Self {
+        assert!(leaf_size > 0, "leaf size must be positive");
+        self.leaf_size = leaf_size;
+        self
+    }
+
+    /// Sets the hash function for leaves and inner nodes.
+    pub fn hash(mut self, hash: MerkleHash) -> Self {
+        self.hash = hash;
+        self
+    }
+
+    /// Sets the number of worker threads used to hash leaves (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Builds the tree of `data`, hashing the leaves in parallel.
+    pub fn build(&self, data: &[u8]) -> MerkleTree {
+        let mut tree = MerkleTree {
+            hash: self.hash,
+            leaf_size: self.leaf_size,
+            len: data.len() as u64,
+            threads: self.threads,
+            levels: vec![Vec::new()],
+        };
+        let leaves: Vec<usize> = (0..leaf_count(tree.len, tree.leaf_size)).collect();
+        tree.levels[0] = tree.hash_leaves(data, &leaves);
+        tree.rehash_parents(leaves);
+        tree
+    }
+
+    /// Memory-maps the file at `path` and builds its tree.
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be opened or mapped.
+    pub fn build_file<P: AsRef<Path>>(&self, path: P) -> io::Result<MerkleTree> {
+        let file = MappedFile::open(path)?;
+        Ok(self.build(file.as_slice()))
+    }
+}
+
+/// A Merkle tree over fixed-size leaves of a byte string, such as a large file.
+///
+/// Leaf `i` hashes bytes `i * leaf_size..(i + 1) * leaf_size` (the last leaf may be
+/// shorter, and empty data has one empty leaf). Each inner node hashes the concatenation of
+/// its two children; a node without a right sibling is carried up unchanged.
+///
+/// After some byte ranges change, [`MerkleTree::update`] re-hashes only the leaves that
+/// overlap them and their O(log n) ancestors instead of the whole input.
+/// [`MerkleTree::diff`] compares two trees top-down, skipping identical subtrees, to find
+/// the byte ranges that differ. Trees persist with [`MerkleTree::save`] and
+/// [`MerkleTree::load`]; only the leaf hashes are stored.
+#[derive(Debug, Clone)]
+pub struct MerkleTree {
+    hash: MerkleHash,
+    leaf_size: usize,
+    len: u64,
+    threads: usize,
+    // levels[0] holds the leaf hashes and the last level holds the root alone
+    levels: Vec<Vec<u128>>,
+}
+
+// Trees are equal when they describe the same leaves, whatever thread count they update with
+impl PartialEq for MerkleTree {
+    fn eq(&self, other: &Self) -> bool {
+        self.hash == other.hash
+            && self.leaf_size == other.leaf_size
+            && self.len == other.len
+            && self.levels == other.levels
+    }
+}
+
+impl Eq for MerkleTree {}
+
+impl MerkleTree {
+    /// Builds the tree of `data` with the default [`MerkleBuilder`] parameters.
+    pub fn build(data: &[u8]) -> Self {
+        MerkleBuilder::new().build(data)
+    }
+
+    /// Returns the root hash, which identifies the whole input.
+    pub fn root(&self) -> u128 {
+        self.levels.last().unwrap()[0]
+    }
+
+    /// Returns the number of bytes covered.
+    pub fn len(&self) -> u64 {
+        self.len
+    }
+
+    /// Returns whether the tree covers no bytes.
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Returns the number of bytes per leaf.
+    pub fn leaf_size(&self) -> usize {
+        self.leaf_size
+    }
+
+    /// Returns the hash function the tree was built with.
+    pub fn hash_function(&self) -> MerkleHash {
+        self.hash
+    }
+
+    /// Returns the leaf hashes in order.
+    pub fn leaves(&self) -> &[u128] {
+        &self.levels[0]
+    }
+
+    /// Returns the number of levels, including the leaves and the root.
+    pub fn height(&self) -> usize {
+        self.levels.len()
+    }
+
+    /// Brings the tree up to date with `data`, the new full contents, given the byte ranges
+    /// that were written since the tree was built or last updated.
+    ///
+    /// Only the leaves overlapping `changed` (and, if the length changed, the leaves between
+    /// the old and new end) are re-hashed, followed by their ancestors. Ranges past the end
+    /// of `data` are ignored. Bytes changed outside `changed` are not detected.
+    pub fn update(&mut self, data: &[u8], changed: &[Range<u64>]) {
+        let new_len = data.len() as u64;
+        let old_count = self.levels[0].len();
+        let new_count = leaf_count(new_len, self.leaf_size);
+        let size = self.leaf_size as u64;
+
+        let mut dirty = Vec::new();
+        for range in changed {
+            let end = range.end.min(new_len);
+            if range.start < end {
+                dirty.extend((range.start / size) as usize..end.div_ceil(size) as usize);
+            }
+        }
+        if new_len != self.len {
+            // The old last leaf may have grown, the new last leaf may have shrunk, and every
+            // leaf in between is new
+            dirty.extend(old_count.min(new_count) - 1..new_count);
+        }
+        if dirty.is_empty() {
+            return;
+        }
+        dirty.sort_unstable();
+        dirty.dedup();
+
+        self.len = new_len;
+        self.levels[0].resize(new_count, 0);
+        let hashes = self.hash_leaves(data, &dirty);
+        for (&leaf, hash) in dirty.iter().zip(hashes) {
+            self.levels[0][leaf] = hash;
+        }
+        self.rehash_parents(dirty);
+    }
+
+    /// Memory-maps the file at `path` and applies [`MerkleTree::update`] with its contents.
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be opened or mapped.
+    pub fn update_file<P: AsRef<Path>>(
+        &mut self,
+        path: P,
+        changed: &[Range<u64>],
+    ) -> io::Result<()> {
+        let file = MappedFile::open(path)?;
+        self.update(file.as_slice(), changed);
+        Ok(())
+    }
+
+    /// Returns the sorted, disjoint byte ranges whose leaves differ between `self` and
+    /// `other`, including bytes present in only one of them.
+    ///
+    /// Subtrees with equal hashes over the same leaves are skipped, so comparing trees with
+    /// few differences touches O(d log n) nodes for d differing leaves.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the trees use different leaf sizes or hash functions.
+    pub fn diff(&self, other: &MerkleTree) -> Vec<Range<u64>> {
+        assert!(
+            self.leaf_size == other.leaf_size && self.hash == other.hash,
+            "trees must share leaf size and hash function"
+        );
+        let (a_leaves, b_leaves) = (self.levels[0].len(), other.levels[0].len());
+        let top = self.levels.len().min(other.levels.len()) - 1;
+        let top_nodes = self.levels[top].len().max(other.levels[top].len());
+
+        let mut changed_leaves = Vec::new();
+        let mut stack: Vec<(usize, usize)> = (0..top_nodes).rev().map(|j| (top, j)).collect();
+        while let Some((level, j)) = stack.pop() {
+            let a = self.levels[level].get(j);
+            let b = other.levels[level].get(j);
+            if a.is_some() && a == b && covered(a_leaves, level, j) == covered(b_leaves, level, j) {
+                continue;
+            }
+            if level == 0 {
+                changed_leaves.push(j);
+                continue;
+            }
+            for child in [2 * j + 1, 2 * j] {
+                if child < self.levels[level - 1].len() || child < other.levels[level - 1].len() {
+                    stack.push((level - 1, child));
+                }
+            }
+        }
+
+        let size = self.leaf_size as u64;
+        let end = self.len.max(other.len);
+        let mut ranges: Vec<Range<u64>> = Vec::new();
+        for leaf in changed_leaves {
+            let range = leaf as u64 * size..((leaf as u64 + 1) * size).min(end);
+            match ranges.last_mut() {
+                Some(last) if last.end == range.start => last.end = range.end,
+                _ => ranges.push(range),
+            }
+        }
+        ranges.retain(|r| !r.is_empty());
+        ranges
+    }
+
+    /// Serializes the tree: a 32-byte header followed by the little-endian leaf hashes.
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut data = vec![0u8; HEADER_LEN + self.levels[0].len() * 16];
+        data[0..8].copy_from_slice(MAGIC);
+        put_u64(&mut data, 8, self.hash.tag());
+        put_u64(&mut data, 16, self.leaf_size as u64);
+        put_u64(&mut data, 24, self.len);
+        for (i, hash) in self.levels[0].iter().enumerate() {
+            let at = HEADER_LEN + i * 16;
+            data[at..at + 16].copy_from_slice(&hash.to_le_bytes());
+        }
+        data
+    }
+
+    /// Restores a tree from [`MerkleTree::to_bytes`] output, recomputing the inner nodes.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`MerkleError::InvalidData`] if the header or size is inconsistent.
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, MerkleError> {
+        if bytes.len() < HEADER_LEN || &bytes[0..8] != MAGIC {
+            return Err(MerkleError::InvalidData("bad magic"));
+        }
+        let hash = match get_u64(bytes, 8) {
+            0 => MerkleHash::City128,
+            1 => MerkleHash::Murmur3_128,
+            _ => return Err(MerkleError::InvalidData("unknown hash function")),
+        };
+        let leaf_size = get_u64(bytes, 16);
+        let len = get_u64(bytes, 24);
+        if leaf_size == 0 || leaf_size > usize::MAX as u64 {
+            return Err(MerkleError::InvalidData("bad leaf size"));
+        }
+        let leaf_size = leaf_size as usize;
+        let count = leaf_count(len, leaf_size);
+        // A crafted length can make the leaf bytes overflow
+        if count.checked_mul(16) != Some(bytes.len() - HEADER_LEN) {
+            return Err(MerkleError::InvalidData("leaf count mismatch"));
+        }
+
+        let leaves = bytes[HEADER_LEN..]
+            .chunks_exact(16)
+            .map(|chunk| u128::from_le_bytes(chunk.try_into().unwrap()))
+            .collect();
+        let mut tree = MerkleTree {
+            hash,
+            leaf_size,
+            len,
+            threads: 0,
+            levels: vec![leaves],
+        };
+        tree.rehash_parents((0..count).collect());
+        Ok(tree)
+    }
+
+    /// Writes the tree to `path` (see [`MerkleTree::to_bytes`]).
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be written.
+    pub fn save<P: AsRef<Path>>(&self, path: P) -> io::Result<()> {
+        fs::write(path, self.to_bytes())
+    }
+
+    /// Reads a tree written by [`MerkleTree::save`].
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be read, or an `InvalidData` error wrapping
+    /// [`MerkleError`] if it is not a valid tree.
+    pub fn load<P: AsRef<Path>>(path: P) -> io::Result<Self> {
+        Ok(Self::from_bytes(&fs::read(path)?)?)
+    }
+
+    /// Sets the number of worker threads later updates hash leaves with (`0` uses all
+    /// available cores).
+    pub fn set_threads(&mut self, threads: usize) {
+        self.threads = threads;
+    }
+
+    // Hashes the given sorted leaves of `data`, in parallel batches of about TASK_BYTES
+    fn hash_leaves(&self, data: &[u8], leaves: &[usize]) -> Vec<u128> {
+        let per_task = (TASK_BYTES / self.leaf_size).max(1);
+        let batches = parallel::map_indices(leaves.len().div_ceil(per_task), self.threads, |t| {
+            leaves[t * per_task..((t + 1) * per_task).min(leaves.len())]
+                .iter()
+                .map(|&leaf| {
+                    let start = (leaf * self.leaf_size).min(data.len());
+                    let end = (start + self.leaf_size).min(data.len());
+                    self.hash.leaf(&data[start..end])
+                })
+                .collect::<Vec<_>>()
+        });
+        batches.concat()
+    }
+
+    // Recomputes the ancestors of the given sorted, distinct leaves level by level, resizing
+    // each level to match the current leaf count
+    fn rehash_parents(&mut self, mut dirty: Vec<usize>) {
+        let mut level = 0;
+        while self.levels[level].len() > 1 {
+            let width = self.levels[level].len().div_ceil(2);
+            if self.levels.len() == level + 1 {
+                self.levels.push(Vec::new());
+            }
+            self.levels[level + 1].resize(width, 0);
+
+            dirty.iter_mut().for_each(|node| *node /= 2);
+            dirty.dedup();
+            let (children, parents) = self.levels.split_at_mut(level + 1);
+            let children = &children[level];
+            for &p in &dirty {
+                parents[0][p] = match children.get(2 * p + 1) {
+                    Some(&right) => self.hash.inner(children[2 * p], right),
+                    None => children[2 * p],
+                };
+            }
+            level += 1;
+        }
+        self.levels.truncate(level + 1);
+    }
+}
+
+fn leaf_count(len: u64, leaf_size: usize) -> usize {
+    (len.div_ceil(leaf_size as u64) as usize).max(1)
+}
+
+// Number of leaves under node `j` of `level` in a tree with `leaves` leaves
+fn covered(leaves: usize, level: usize, j: usize) -> usize {
+    let start = j << level;
+    ((j + 1) << level).min(leaves).saturating_sub(start)
+}
+
+fn get_u64(data: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(data[at..at + 8].try_into().unwrap())
+}
+
+fn put_u64(data: &mut [u8], at: usize, value: u64) {
+    data[at..at + 8].copy_from_slice(&value.to_le_bytes());
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample(len: usize, salt: u8) -> Vec<u8> {
+        (0..len)
+            .map(|i| (i as u8).wrapping_mul(31) ^ salt ^ (i >> 8) as u8)
+            .collect()
+    }
+
+    #[test]
+    fn test_small_tree_shape() {
+        let data = sample(10, 0);
+        let h = MerkleHash::City128;
+        let tree = MerkleBuilder::new().leaf_size(4).hash(h).build(&data);
+        let leaves = [
+            h.leaf(&data[0..4]),
+            h.leaf(&data[4..8]),
+            h.leaf(&data[8..10]),
+        ];
+        assert_eq!(tree.leaves(), &leaves);
+        assert_eq!(tree.height(), 3);
+        // The third leaf has no sibling and is carried up
+        assert_eq!(
+            tree.root(),
+            h.inner(h.inner(leaves[0], leaves[1]), leaves[2])
+        );
+
+        let h = MerkleHash::Murmur3_128;
+        let empty = MerkleTree::build(&[]);
+        assert_eq!(empty.leaves(), &[h.leaf(&[])]);
+        assert_eq!(empty.root(), h.leaf(&[]));
+    }
+
+    #[test]
+    fn test_update_matches_rebuild() {
+        let builder = MerkleBuilder::new()
+            .leaf_size(64)
+            .hash(MerkleHash::City128)
+            .threads(3);
+        let mut data = sample(10_000, 1);
+        let mut tree = builder.build(&data);
+
+        data[5] ^= 1;
+        data[6400..6500].fill(7);
+        tree.update(&data, &[5..6, 6400..6500, 20_000..30_000]);
+        assert_eq!(tree, builder.build(&data));
+
+        // A length change alone marks the tail dirty
+        for new_len in [10_050, 20_000, 640, 64, 63, 0, 129] {
+            data.resize(new_len, 9);
+            tree.update(&data, &[]);
+            assert_eq!(tree, builder.build(&data), "resized to {}", new_len);
+        }
+    }
+
+    #[test]
+    fn test_diff_finds_changed_ranges() {
+        let builder = MerkleBuilder::new().leaf_size(100);
+        let a = sample(100_000, 2);
+        let mut b = a.clone();
+        b[150] ^= 1;
+        b[250] ^= 1;
+        b[70_000..70_301].fill(0xff);
+        let (ta, tb) = (builder.build(&a), builder.build(&b));
+
+        assert!(ta.diff(&ta).is_empty());
+        assert_eq!(ta.diff(&tb), vec![100..300, 70_000..70_400]);
+
+        b.truncate(99_950);
+        b.extend_from_slice(&[0; 1000]);
+        let tb = builder.build(&b);
+        assert_eq!(
+            ta.diff(&tb),
+            vec![100..300, 70_000..70_400, 99_900..100_950]
+        );
+        assert_eq!(tb.diff(&ta), ta.diff(&tb));
+    }
+
+    #[test]
+    fn test_serialization_round_trip() {
+        let tree = MerkleBuilder::new().leaf_size(256).build(&sample(5000, 3));
+        let bytes = tree.to_bytes();
+        assert_eq!(MerkleTree::from_bytes(&bytes), Ok(tree));
+        assert_eq!(
+            MerkleTree::from_bytes(&bytes[..bytes.len() - 16]),
+            Err(MerkleError::InvalidData("leaf count mismatch"))
+        );
+
+        let mut huge = bytes.clone();
+        huge[16..24].copy_from_slice(&1u64.to_le_bytes());
+        huge[24..32].copy_from_slice(&u64::MAX.to_le_bytes());
+        assert_eq!(
+            MerkleTree::from_bytes(&huge),
+            Err(MerkleError::InvalidData("leaf count mismatch"))
+        );
+    }
+}
@@ -0,0 +1,254 @@
+use std::fs::File;
+use std::io;
+use std::path::Path;
+
+/// A read-only memory map of a whole file.
+///
+/// Pages are loaded lazily by the OS on first access and live in the shared page cache, so
+/// opening is O(1) regardless of file size and several processes mapping the same file share
+/// one copy in memory. On platforms without `mmap` the file is read into memory instead.
+///
+/// The file must not be truncated or modified while it is mapped.
+///
+/// # Example
+///
+/// ```no_run
+/// use simplehash::mmap::MappedFile;
+///
+/// let file = MappedFile::open("keys.idx").unwrap();
+/// println!("{} bytes mapped", file.len());
+/// ```
+pub struct MappedFile {
+    #[cfg(unix)]
+    ptr: *mut libc::c_void,
+    #[cfg(unix)]
+    len: usize,
+    #[cfg(not(unix))]
+    data: Vec<u8>,
+}
+
+// SAFETY: the mapping is read-only and owned by this value, so it can be shared like a `Vec<u8>`
+unsafe impl Send for MappedFile {}
+unsafe impl Sync for MappedFile {}
+
+impl MappedFile {
+    /// Maps the file at `path` read-only.
+    ///
+    /// # Errors
+    ///
+    /// Returns any error from opening the file or creating the mapping.
+    pub fn open<P: AsRef<Path>>(path: P) -> io::Result<Self> {
+        Self::map(&File::open(path)?)
+    }
+
+    /// Maps an already opened file read-only.
+    ///
+    /// # Errors
+    ///
+    /// Returns any error from reading the file's metadata or creating the mapping.
+    #[cfg(unix)]
+    pub fn map(file: &File) -> io::Result<Self> {
+        Self::map_with_flags(file, libc::MAP_SHARED)
+    }
+
+    #[cfg(unix)]
+    fn map_with_flags(file: &File, flags: libc::c_int) -> io::Result<Self> {
+        use std::os::unix::io::AsRawFd;
+
+        let len = usize::try_from(file.metadata()?.len())
+            .map_err(|_| io::Error::new(io::ErrorKind::InvalidInput, "file too large to map"))?;
+        if len == 0 {
+            // mmap rejects empty mappings
+            return Ok(Self {
+                ptr: std::ptr::null_mut(),
+                len: 0,
+            });
+        }
+        // SAFETY: a fresh shared read-only mapping of a valid descriptor; the kernel picks the
+        // address and the result is checked before use
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                flags,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(Self { ptr, len })
+    }
+
+    /// Reads the whole file into memory on platforms without `mmap`.
+    ///
+    /// # Errors
+    ///
+    /// Returns any error from reading the file.
+    #[cfg(not(unix))]
+    pub fn map(file: &File) -> io::Result<Self> {
+        use std::io::Read;
+
+        let mut data = Vec::new();
+        (&*file).read_to_end(&mut data)?;
+        Ok(Self { data })
+    }
+
+    /// Maps an already opened file read-only and faults every page in before returning
+    /// (`MAP_POPULATE`), so a following scan never waits on page faults. Other platforms map
+    /// normally and ask the OS to read ahead.
+    ///
+    /// # Errors
+    ///
+    /// Returns any error from reading the file's metadata or creating the mapping.
+    pub fn map_populated(file: &File) -> io::Result<Self> {
+        #[cfg(target_os = "linux")]
+        {
+            Self::map_with_flags(file, libc::MAP_SHARED | libc::MAP_POPULATE)
+        }
+        #[cfg(not(target_os = "linux"))]
+        {
+            let map = Self::map(file)?;
+            map.advise_willneed()?;
+            Ok(map)
+        }
+    }
+
+    /// Hints that the mapping will be accessed randomly, which disables read-ahead. This
+    /// suits point lookups into large index files. A no-op without `mmap`.
+    ///
+    /// # Errors
+    ///
+    /// Returns the OS error if the hint is rejected.
+    pub fn advise_random(&self) -> io::Result<()> {
+        #[cfg(unix)]
+        self.advise(libc::MADV_RANDOM)?;
+        Ok(())
+    }
+
+    /// Hints that the mapping will be read front to back, which enables aggressive read-ahead
+    /// and lets the OS drop pages behind the reader. A no-op without `mmap`.
+    ///
+    /// # Errors
+    ///
+    /// Returns the OS error if the hint is rejected.
+    pub fn advise_sequential(&self) -> io::Result<()> {
+        #[cfg(unix)]
+        self.advise(libc::MADV_SEQUENTIAL)?;
+        Ok(())
+    }
+
+    /// Hints that the whole mapping will be needed soon, so the OS starts reading it in the
+    /// background. A no-op without `mmap`.
+    ///
+    /// # Errors
+    ///
+    /// Returns the OS error if the hint is rejected.
+    pub fn advise_willneed(&self) -> io::Result<()> {
+        #[cfg(unix)]
+        self.advise(libc::MADV_WILLNEED)?;
+        Ok(())
+    }
+
+    #[cfg(unix)]
+    fn advise(&self, advice: libc::c_int) -> io::Result<()> {
+        if self.len == 0 {
+            return Ok(());
+        }
+        // SAFETY: the range is exactly the live mapping created in `map`
+        if unsafe { libc::madvise(self.ptr, self.len, advice) } != 0 {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(())
+    }
+
+    /// Returns the mapped bytes.
+    #[cfg(unix)]
+    #[inline]
+    pub fn as_slice(&self) -> &[u8] {
+        if self.len == 0 {
+            &[]
+        } else {
+            // SAFETY: the mapping covers `len` readable bytes for the lifetime of `self`
+            unsafe { std::slice::from_raw_parts(self.ptr as *const u8, self.len) }
+        }
+    }
+
+    /// Returns the mapped bytes.
+    #[cfg(not(unix))]
+    #[inline]
+    pub fn as_slice(&self) -> &[u8] {
+        &self.data
+    }
+
+    /// Returns the length of the mapping in bytes.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.as_slice().len()
+    }
+
+    /// Returns `true` if the mapped file is empty.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl AsRef<[u8]> for MappedFile {
+    #[inline]
+    fn as_ref(&self) -> &[u8] {
+        self.as_slice()
+    }
+}
+
+impl std::ops::Deref for MappedFile {
+    type Target = [u8];
+
+    #[inline]
+    fn deref(&self) -> &[u8] {
+        self.as_slice()
+    }
+}
+
+impl std::fmt::Debug for MappedFile {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("MappedFile")
+            .field("len", &self.len())
+            .finish()
+    }
+}
+
+#[cfg(unix)]
+impl Drop for MappedFile {
+    fn drop(&mut self) {
+        if self.len != 0 {
+            // SAFETY: unmapping the mapping created in `map`; no borrows of it outlive `self`
+            unsafe { libc::munmap(self.ptr, self.len) };
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Write;
+
+    #[test]
+    fn test_maps_file_contents() {
+        let path = std::env::temp_dir().join(format!("simplehash-mmap-{}", std::process::id()));
+        let contents: Vec<u8> = (0..10_000u32).flat_map(|i| i.to_le_bytes()).collect();
+        File::create(&path).unwrap().write_all(&contents).unwrap();
+
+        let mapped = MappedFile::open(&path).unwrap();
+        mapped.advise_random().unwrap();
+        assert_eq!(&*mapped, &contents[..]);
+        drop(mapped);
+
+        File::create(&path).unwrap();
+        let empty = MappedFile::open(&path).unwrap();
+        assert!(empty.is_empty());
+        std::fs::remove_file(&path).unwrap();
+    }
+}
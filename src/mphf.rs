@@ -0,0 +1,739 @@
+use crate::city::city_hash64_with_seed;
+use crate::murmur::fmix64;
+use crate::parallel;
+use std::fmt;
+
+const MAGIC: &[u8; 8] = b"SHMPHF01";
+const HEADER_LEN: usize = 64;
+const PARTITION_LEN: usize = 32;
+// Fraction of keys (as a 32-bit threshold) sent to the dense 30% of the buckets
+const DENSE_KEYS_THRESHOLD: u64 = (0.6 * (1u64 << 32) as f64) as u64;
+const MAX_PILOT: u64 = 1 << 24;
+const MAX_ATTEMPTS: u64 = 16;
+
+/// Errors returned while building or loading a [`Mphf`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum MphfError {
+    /// The key at this index appears more than once in the input.
+    DuplicateKey(usize),
+    /// No seed produced a valid function within the attempt limit.
+    ConstructionFailed,
+    /// The serialized bytes are not a valid function.
+    InvalidData(&'static str),
+}
+
+impl fmt::Display for MphfError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            MphfError::DuplicateKey(index) => write!(f, "duplicate key at index {}", index),
+            MphfError::ConstructionFailed => write!(f, "failed to build a perfect hash function"),
+            MphfError::InvalidData(reason) => write!(f, "invalid perfect hash data: {}", reason),
+        }
+    }
+}
+
+impl std::error::Error for MphfError {}
+
+/// A minimal perfect hash function (MPHF) in the style of PTHash.
+///
+/// Every key in the static set the function was built from maps to a distinct index in
+/// `0..len()`. Keys outside the set map to arbitrary indices, so callers that may look up
+/// unknown keys must store and compare the key (or a fingerprint) at the returned index.
+///
+/// Keys are hashed once with [`city_hash64_with_seed`]. The hash picks a partition, a bucket
+/// inside the partition, and, combined with the bucket's *pilot* value, a slot in the
+/// partition's table. Pilots and remap entries are bit-packed at the width of their largest
+/// value, which gives roughly 3 bits per key with the default parameters. A lookup reads the partition
+/// descriptor (small and usually cached), one packed pilot, and, for the ~1% of keys whose
+/// slot lies past the end of the partition, one remap entry.
+///
+/// The function is stored as a single little-endian byte layout. `Mphf<Vec<u8>>` owns it,
+/// while [`Mphf::from_bytes`] queries any `AsRef<[u8]>` in place, such as a memory-mapped
+/// file, without deserializing.
+#[derive(Debug, Clone)]
+pub struct Mphf<B = Vec<u8>> {
+    data: B,
+    seed: u64,
+    num_keys: u64,
+    num_partitions: u64,
+    pilot_width: u32,
+    remap_width: u32,
+    pilots_offset: usize,
+    remap_offset: usize,
+}
+
+/// Configures and builds a [`Mphf`].
+///
+/// # Example
+///
+/// ```
+/// use simplehash::mphf::MphfBuilder;
+///
+/// let keys = ["apple", "banana", "cherry", "date"];
+/// let mphf = MphfBuilder::new().build(&keys).unwrap();
+///
+/// let mut seen = vec![false; keys.len()];
+/// for key in &keys {
+///     let index = mphf.index(key.as_bytes());
+///     assert!(!seen[index]);
+///     seen[index] = true;
+/// }
+/// ```
+#[derive(Debug, Clone)]
+pub struct MphfBuilder {
+    seed: u64,
+    bucket_factor: f64,
+    load_factor: f64,
+    partition_size: usize,
+    threads: usize,
+}
+
+impl Default for MphfBuilder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl MphfBuilder {
+    /// Creates a builder with the default parameters: bucket factor 3.5, load factor 0.99
+    /// and partitions of about 100,000 keys, using all available cores.
+    pub fn new() -> Self {
+        Self {
+            seed: 0,
+            bucket_factor: 3.5,
+            load_factor: 0.99,
+            partition_size: 100_000,
+            threads: 0,
+        }
+    }
+
+    /// Sets the initial seed passed to [`city_hash64_with_seed`].
+    pub fn seed(mut self, seed: u64) -> Self {
+        self.seed = seed;
+        self
+    }
+
+    /// Sets the bucket factor `c`: each partition of `n` keys gets `c * n / log2(n)` buckets.
+    /// Larger values build faster but use more space.
+    pub fn bucket_factor(mut self, bucket_factor: f64) -> Self {
+        assert!(bucket_factor > 0.0, "bucket factor must be positive");
+        self.bucket_factor = bucket_factor;
+        self
+    }
+
+    /// Sets the fraction of each partition's table that holds keys (0 < alpha <= 1).
+    /// Lower values build faster at the cost of a larger remap table.
+    pub fn load_factor(mut self, load_factor: f64) -> Self {
+        assert!(
+            load_factor > 0.0 && load_factor <= 1.0,
+            "load factor must be in (0, 1]"
+        );
+        self.load_factor = load_factor;
+        self
+    }
+
+    /// Sets the average number of keys per independently built partition.
+    pub fn partition_size(mut self, partition_size: usize) -> Self {
+        assert!(
+            (1..=1 << 30).contains(&partition_size),
+            "partition size must be between 1 and 2^30"
+        );
+        self.partition_size = partition_size;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Builds a minimal perfect hash function over `keys`.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`MphfError::DuplicateKey`] if a key appears twice, or
+    /// [`MphfError::ConstructionFailed`] if no valid function was found after several seeds.
+    pub fn build<K>(&self, keys: &[K]) -> Result<Mphf, MphfError>
+    where
+        K: AsRef<[u8]> + Sync,
+    {
+        assert!(
+            keys.len() <= u32::MAX as usize * 64,
+            "too many keys for a single function"
+        );
+        let mut seed = self.seed;
+        for _ in 0..MAX_ATTEMPTS {
+            match self.try_build(keys, seed) {
+                Ok(mphf) => return Ok(mphf),
+                Err(Attempt::Collision(hash)) => {
+                    // Distinct keys sharing a 64-bit hash need a new seed; identical keys never work
+                    let mut matching = keys
+                        .iter()
+                        .enumerate()
+                        .filter(|(_, k)| city_hash64_with_seed(k.as_ref(), seed) == hash);
+                    let (_, first) = matching.next().expect("colliding hash comes from a key");
+                    if let Some((index, _)) = matching.find(|(_, k)| k.as_ref() == first.as_ref()) {
+                        return Err(MphfError::DuplicateKey(index));
+                    }
+                }
+                Err(Attempt::NoPilot) => {}
+            }
+            seed = fmix64(seed.wrapping_add(0x9e3779b97f4a7c15));
+        }
+        Err(MphfError::ConstructionFailed)
+    }
+
+    fn try_build<K>(&self, keys: &[K], seed: u64) -> Result<Mphf, Attempt>
+    where
+        K: AsRef<[u8]> + Sync,
+    {
+        const HASH_CHUNK: usize = 1 << 16;
+
+        let n = keys.len();
+        let num_partitions = n.div_ceil(self.partition_size).max(1);
+
+        // Hash every key once, in parallel
+        let chunks = parallel::map_indices(n.div_ceil(HASH_CHUNK), self.threads, |c| {
+            keys[c * HASH_CHUNK..((c + 1) * HASH_CHUNK).min(n)]
+                .iter()
+                .map(|k| city_hash64_with_seed(k.as_ref(), seed))
+                .collect::<Vec<u64>>()
+        });
+
+        // Counting sort of the hashes by partition
+        let mut offsets = vec![0usize; num_partitions + 1];
+        for &h in chunks.iter().flatten() {
+            offsets[fastrange64(h, num_partitions as u64) as usize + 1] += 1;
+        }
+        for p in 0..num_partitions {
+            offsets[p + 1] += offsets[p];
+        }
+        let mut hashes = vec![0u64; n];
+        let mut cursor = offsets.clone();
+        for &h in chunks.iter().flatten() {
+            let p = fastrange64(h, num_partitions as u64) as usize;
+            hashes[cursor[p]] = h;
+            cursor[p] += 1;
+        }
+        drop(chunks);
+
+        let partitions = parallel::map_indices(num_partitions, self.threads, |p| {
+            build_partition(
+                &hashes[offsets[p]..offsets[p + 1]],
+                seed,
+                self.bucket_factor,
+                self.load_factor,
+            )
+        });
+
+        let mut built = Vec::with_capacity(num_partitions);
+        for partition in partitions {
+            built.push(partition?);
+        }
+        Ok(assemble(seed, n as u64, &offsets, &built))
+    }
+}
+
+enum Attempt {
+    Collision(u64),
+    NoPilot,
+}
+
+struct Partition {
+    table_size: u64,
+    pilots: Vec<u64>,
+    remap: Vec<u32>,
+}
+
+#[inline(always)]
+fn fastrange64(hash: u64, n: u64) -> u64 {
+    ((hash as u128 * n as u128) >> 64) as u64
+}
+
+#[inline(always)]
+fn fastrange32(hash: u32, n: u32) -> u32 {
+    ((hash as u64 * n as u64) >> 32) as u32
+}
+
+#[inline(always)]
+fn bucket_count(num_keys: u64, bucket_factor: f64) -> u64 {
+    let log_n = (num_keys.max(2) as f64).log2();
+    ((bucket_factor * num_keys as f64 / log_n).ceil() as u64).max(1)
+}
+
+// Skewed bucket assignment: 60% of the keys go to the first 30% of the buckets, so the
+// large buckets are placed first while the table is still mostly empty
+#[inline(always)]
+fn bucket_of(hash: u64, num_buckets: u32) -> u32 {
+    if num_buckets < 2 {
+        return 0;
+    }
+    let g = fmix64(hash ^ 0x5bd1e9955bd1e995);
+    let dense = (num_buckets * 3 / 10).max(1);
+    if (g & 0xffff_ffff) < DENSE_KEYS_THRESHOLD {
+        fastrange32((g >> 32) as u32, dense)
+    } else {
+        dense + fastrange32((g >> 32) as u32, num_buckets - dense)
+    }
+}
+
+#[inline(always)]
+fn slot_of(hash: u64, pilot: u64, seed: u64, table_size: u64) -> u64 {
+    let pilot_hash = fmix64(pilot.wrapping_mul(0x9e3779b97f4a7c15) ^ seed);
+    fastrange64(fmix64(hash ^ pilot_hash), table_size)
+}
+
+fn build_partition(
+    hashes: &[u64],
+    seed: u64,
+    bucket_factor: f64,
+    load_factor: f64,
+) -> Result<Partition, Attempt> {
+    let n = hashes.len() as u64;
+    let table_size = ((n as f64 / load_factor).ceil() as u64).max(n).max(1);
+    let num_buckets = bucket_count(n, bucket_factor);
+    assert!(table_size <= u32::MAX as u64 && num_buckets <= u32::MAX as u64);
+
+    // Group keys by bucket
+    let mut bucket_start = vec![0u32; num_buckets as usize + 1];
+    for &h in hashes {
+        bucket_start[bucket_of(h, num_buckets as u32) as usize + 1] += 1;
+    }
+    for b in 0..num_buckets as usize {
+        bucket_start[b + 1] += bucket_start[b];
+    }
+    let mut grouped = vec![0u64; hashes.len()];
+    let mut cursor = bucket_start.clone();
+    for &h in hashes {
+        let b = bucket_of(h, num_buckets as u32) as usize;
+        grouped[cursor[b] as usize] = h;
+        cursor[b] += 1;
+    }
+
+    // Identical hashes can never be separated by any pilot
+    for b in 0..num_buckets as usize {
+        let keys = &mut grouped[bucket_start[b] as usize..bucket_start[b + 1] as usize];
+        keys.sort_unstable();
+        if let Some(pair) = keys.windows(2).find(|pair| pair[0] == pair[1]) {
+            return Err(Attempt::Collision(pair[0]));
+        }
+    }
+
+    // Place buckets from largest to smallest
+    let mut order: Vec<u32> = (0..num_buckets as u32).collect();
+    order.sort_by_key(|&b| {
+        std::cmp::Reverse(bucket_start[b as usize + 1] - bucket_start[b as usize])
+    });
+
+    let mut taken = vec![0u64; table_size.div_ceil(64) as usize];
+    let mut pilots = vec![0u64; num_buckets as usize];
+    let mut slots = Vec::new();
+    for &b in &order {
+        let keys =
+            &grouped[bucket_start[b as usize] as usize..bucket_start[b as usize + 1] as usize];
+        if keys.is_empty() {
+            break;
+        }
+        let mut pilot = 0;
+        'search: loop {
+            if pilot == MAX_PILOT {
+                return Err(Attempt::NoPilot);
+            }
+            slots.clear();
+            for &h in keys {
+                let slot = slot_of(h, pilot, seed, table_size);
+                if taken[(slot / 64) as usize] & (1 << (slot % 64)) != 0 || slots.contains(&slot) {
+                    pilot += 1;
+                    continue 'search;
+                }
+                slots.push(slot);
+            }
+            break;
+        }
+        for &slot in &slots {
+            taken[(slot / 64) as usize] |= 1 << (slot % 64);
+        }
+        pilots[b as usize] = pilot;
+    }
+
+    // Slots past `n` are remapped onto the free slots below `n`
+    let mut remap = Vec::with_capacity((table_size - n) as usize);
+    let mut free = (0..n).filter(|&s| taken[(s / 64) as usize] & (1 << (s % 64)) == 0);
+    for slot in n..table_size {
+        if taken[(slot / 64) as usize] & (1 << (slot % 64)) != 0 {
+            remap.push(free.next().expect("one free slot per remapped key") as u32);
+        } else {
+            remap.push(0);
+        }
+    }
+
+    Ok(Partition {
+        table_size,
+        pilots,
+        remap,
+    })
+}
+
+fn assemble(seed: u64, num_keys: u64, offsets: &[usize], partitions: &[Partition]) -> Mphf {
+    let max_pilot = partitions
+        .iter()
+        .flat_map(|p| p.pilots.iter())
+        .copied()
+        .max()
+        .unwrap_or(0);
+    let pilot_width = bit_width(max_pilot);
+    let max_partition_keys = offsets.windows(2).map(|w| w[1] - w[0]).max().unwrap_or(0);
+    let remap_width = bit_width(max_partition_keys as u64);
+    let total_buckets: usize = partitions.iter().map(|p| p.pilots.len()).sum();
+    let total_remap: usize = partitions.iter().map(|p| p.remap.len()).sum();
+    assert!(total_remap <= u32::MAX as usize, "remap table too large");
+
+    let pilots_offset = HEADER_LEN + partitions.len() * PARTITION_LEN;
+    let remap_offset = pilots_offset + packed_len(total_buckets, pilot_width);
+    let total_len = remap_offset + packed_len(total_remap, remap_width);
+
+    let mut data = vec![0u8; total_len];
+    data[0..8].copy_from_slice(MAGIC);
+    put_u64(&mut data, 8, seed);
+    put_u64(&mut data, 16, num_keys);
+    put_u64(&mut data, 24, partitions.len() as u64);
+    put_u64(&mut data, 32, pilot_width as u64);
+    put_u64(&mut data, 40, total_buckets as u64);
+    put_u64(&mut data, 48, total_remap as u64);
+    put_u64(&mut data, 56, remap_width as u64);
+
+    let mut bucket_offset = 0usize;
+    let mut remap_index = 0usize;
+    for (p, partition) in partitions.iter().enumerate() {
+        let at = HEADER_LEN + p * PARTITION_LEN;
+        let num_keys = offsets[p + 1] - offsets[p];
+        put_u64(&mut data, at, offsets[p] as u64);
+        put_u64(&mut data, at + 8, bucket_offset as u64);
+        put_u32(&mut data, at + 16, remap_index as u32);
+        put_u32(&mut data, at + 20, partition.pilots.len() as u32);
+        put_u32(&mut data, at + 24, num_keys as u32);
+        put_u32(&mut data, at + 28, partition.table_size as u32);
+
+        for (i, &pilot) in partition.pilots.iter().enumerate() {
+            put_packed(
+                &mut data,
+                pilots_offset,
+                bucket_offset + i,
+                pilot_width,
+                pilot,
+            );
+        }
+        for (i, &target) in partition.remap.iter().enumerate() {
+            put_packed(
+                &mut data,
+                remap_offset,
+                remap_index + i,
+                remap_width,
+                target as u64,
+            );
+        }
+
+        bucket_offset += partition.pilots.len();
+        remap_index += partition.remap.len();
+    }
+
+    Mphf::from_bytes(data).expect("freshly built data is valid")
+}
+
+#[inline(always)]
+fn bit_width(max_value: u64) -> u32 {
+    (64 - max_value.leading_zeros()).max(1)
+}
+
+// Packed arrays are read with unaligned 8-byte loads, so they are padded by one word
+#[inline(always)]
+fn packed_len(count: usize, width: u32) -> usize {
+    (count * width as usize).div_ceil(64) * 8 + 8
+}
+
+#[inline(always)]
+fn get_packed(data: &[u8], offset: usize, index: usize, width: u32) -> u64 {
+    let bit = index * width as usize;
+    (get_u64(data, offset + bit / 8) >> (bit % 8)) & ((1u64 << width) - 1)
+}
+
+fn put_packed(data: &mut [u8], offset: usize, index: usize, width: u32, value: u64) {
+    let bit = index * width as usize;
+    let at = offset + bit / 8;
+    let word = get_u64(data, at) | (value << (bit % 8));
+    put_u64(data, at, word);
+}
+
+#[inline(always)]
+fn get_u64(data: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(data[at..at + 8].try_into().unwrap())
+}
+
+#[inline(always)]
+fn get_u32(data: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes(data[at..at + 4].try_into().unwrap())
+}
+
+fn put_u64(data: &mut [u8], at: usize, value: u64) {
+    data[at..at + 8].copy_from_slice(&value.to_le_bytes());
+}
+
+fn put_u32(data: &mut [u8], at: usize, value: u32) {
+    data[at..at + 4].copy_from_slice(&value.to_le_bytes());
+}
+
+impl Mphf {
+    /// Builds a minimal perfect hash function over `keys` with the default parameters.
+    /// See [`MphfBuilder`] for tuning.
+    pub fn build<K>(keys: &[K]) -> Result<Self, MphfError>
+    where
+        K: AsRef<[u8]> + Sync,
+    {
+        MphfBuilder::new().build(keys)
+    }
+}
+
+impl<B: AsRef<[u8]>> Mphf<B> {
+    /// Wraps serialized function bytes (from [`Mphf::as_bytes`]) without copying them.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`MphfError::InvalidData`] if the header or section sizes are inconsistent, or if
+    /// a partition descriptor points outside its section. Lookups on data that loads never
+    /// panic, but corrupted data can map any key to an index outside `0..len()`.
+    pub fn from_bytes(data: B) -> Result<Self, MphfError> {
+        let bytes = data.as_ref();
+        if bytes.len() < HEADER_LEN || &bytes[0..8] != MAGIC {
+            return Err(MphfError::InvalidData("bad magic"));
+        }
+        let seed = get_u64(bytes, 8);
+        let num_keys = get_u64(bytes, 16);
+        let num_partitions = get_u64(bytes, 24);
+        let pilot_width = get_u64(bytes, 32);
+        let total_buckets = get_u64(bytes, 40);
+        let total_remap = get_u64(bytes, 48);
+        let remap_width = get_u64(bytes, 56);
+        // Sizes are bounded by the input length before any offset arithmetic
+        let limit = bytes.len() as u64;
+        if num_partitions == 0
+            || num_partitions > limit / PARTITION_LEN as u64
+            || total_buckets > limit * 8
+            || total_remap > limit * 8
+            || !(1..=32).contains(&pilot_width)
+            || !(1..=32).contains(&remap_width)
+        {
+            return Err(MphfError::InvalidData("bad header"));
+        }
+
+        let pilots_offset = HEADER_LEN + num_partitions as usize * PARTITION_LEN;
+        let remap_offset = pilots_offset + packed_len(total_buckets as usize, pilot_width as u32);
+        let expected_len = remap_offset + packed_len(total_remap as usize, remap_width as u32);
+        if bytes.len() != expected_len {
+            return Err(MphfError::InvalidData("length does not match header"));
+        }
+
+        // Lookups read the sections through the partition descriptors without bounds checks of
+        // their own, so every descriptor is checked against the section sizes here
+        for p in 0..num_partitions as usize {
+            let at = HEADER_LEN + p * PARTITION_LEN;
+            let key_offset = get_u64(bytes, at);
+            let bucket_offset = get_u64(bytes, at + 8);
+            let remap_index = get_u32(bytes, at + 16) as u64;
+            let num_buckets = get_u32(bytes, at + 20) as u64;
+            let partition_keys = get_u32(bytes, at + 24) as u64;
+            let table_size = get_u32(bytes, at + 28) as u64;
+            if key_offset > num_keys
+                || partition_keys > num_keys - key_offset
+                || bucket_offset > total_buckets
+                || num_buckets > total_buckets - bucket_offset
+                || table_size == 0
+                || table_size < partition_keys
+                || remap_index + (table_size - partition_keys) > total_remap
+            {
+                return Err(MphfError::InvalidData("bad partition descriptor"));
+            }
+        }
+
+        Ok(Self {
+            data,
+            seed,
+            num_keys,
+            num_partitions,
+            pilot_width: pilot_width as u32,
+            remap_width: remap_width as u32,
+            pilots_offset,
+            remap_offset,
+        })
+    }
+
+    /// Returns the index of `key` in `0..len()`.
+    ///
+    /// Every key of the original set gets a distinct index; any other key gets an arbitrary one.
+    #[inline]
+    pub fn index(&self, key: &[u8]) -> usize {
+        self.index_of_hash(city_hash64_with_seed(key, self.seed))
+    }
+
+    /// Returns the index for a key whose hash was already computed with
+    /// `city_hash64_with_seed(key, self.seed())`.
+    #[inline]
+    pub fn index_of_hash(&self, hash: u64) -> usize {
+        let data = self.data.as_ref();
+        let p = fastrange64(hash, self.num_partitions) as usize;
+        let at = HEADER_LEN + p * PARTITION_LEN;
+        let key_offset = get_u64(data, at);
+        let bucket_offset = get_u64(data, at + 8) as usize;
+        let num_buckets = get_u32(data, at + 20);
+        let num_keys = get_u32(data, at + 24) as u64;
+        let table_size = get_u32(data, at + 28) as u64;
+
+        let bucket = bucket_offset + bucket_of(hash, num_buckets) as usize;
+        let pilot = get_packed(data, self.pilots_offset, bucket, self.pilot_width);
+
+        let slot = slot_of(hash, pilot, self.seed, table_size);
+        if slot < num_keys {
+            return (key_offset + slot) as usize;
+        }
+        let remap_index = get_u32(data, at + 16) as usize + (slot - num_keys) as usize;
+        (key_offset + get_packed(data, self.remap_offset, remap_index, self.remap_width)) as usize
+    }
+
+    /// Returns the seed the keys are hashed with.
+    #[inline]
+    pub fn seed(&self) -> u64 {
+        self.seed
+    }
+
+    /// Returns the number of keys, which is also the size of the index range.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.num_keys as usize
+    }
+
+    /// Returns `true` if the function was built from an empty key set.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.num_keys == 0
+    }
+
+    /// Returns the serialized function. Writing these bytes to a file and passing them (or a
+    /// memory map of the file) to [`Mphf::from_bytes`] restores the function.
+    #[inline]
+    pub fn as_bytes(&self) -> &[u8] {
+        self.data.as_ref()
+    }
+
+    /// Returns the space used per key in bits, including all metadata.
+    pub fn bits_per_key(&self) -> f64 {
+        (self.data.as_ref().len() * 8) as f64 / self.num_keys.max(1) as f64
+    }
+
+    /// Returns a reference to the underlying storage.
+    pub fn get_ref(&self) -> &B {
+        &self.data
+    }
+
+    /// Consumes the function and returns the underlying storage.
+    pub fn into_inner(self) -> B {
+        self.data
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn assert_minimal_perfect<B: AsRef<[u8]>>(mphf: &Mphf<B>, keys: &[String]) {
+        let mut seen = vec![false; keys.len()];
+        for key in keys {
+            let index = mphf.index(key.as_bytes());
+            assert!(index < keys.len(), "index {} out of range", index);
+            assert!(!seen[index], "index {} assigned twice", index);
+            seen[index] = true;
+        }
+    }
+
+    #[test]
+    fn test_build_and_query() {
+        let keys: Vec<String> = (0..50_000)
+            .map(|i| format!("https://example.com/{}", i))
+            .collect();
+        let mphf = MphfBuilder::new()
+            .partition_size(10_000)
+            .threads(2)
+            .build(&keys)
+            .unwrap();
+        assert_eq!(mphf.len(), keys.len());
+        assert_minimal_perfect(&mphf, &keys);
+        assert!(
+            mphf.bits_per_key() < 4.0,
+            "{} bits/key",
+            mphf.bits_per_key()
+        );
+    }
+
+    #[test]
+    fn test_small_and_empty_sets() {
+        for count in [0, 1, 2, 3, 10, 100] {
+            let keys: Vec<String> = (0..count).map(|i| format!("key{}", i)).collect();
+            let mphf = Mphf::build(&keys).unwrap();
+            assert_eq!(mphf.is_empty(), count == 0);
+            assert_minimal_perfect(&mphf, &keys);
+        }
+    }
+
+    #[test]
+    fn test_serialization_round_trip() {
+        let keys: Vec<String> = (0..5000).map(|i| format!("id-{}", i)).collect();
+        let mphf = MphfBuilder::new().seed(7).build(&keys).unwrap();
+
+        let bytes = mphf.as_bytes().to_vec();
+        let view = Mphf::from_bytes(bytes.as_slice()).unwrap();
+        for key in &keys {
+            assert_eq!(view.index(key.as_bytes()), mphf.index(key.as_bytes()));
+        }
+
+        assert!(Mphf::from_bytes(&bytes[..bytes.len() - 8]).is_err());
+        assert_eq!(
+            Mphf::from_bytes(&b"not a function"[..]).unwrap_err(),
+            MphfError::InvalidData("bad magic")
+        );
+    }
+
+    #[test]
+    fn test_corrupt_partitions_are_rejected() {
+        let keys: Vec<String> = (0..2000).map(|i| format!("id-{}", i)).collect();
+        let mphf = MphfBuilder::new().partition_size(500).build(&keys).unwrap();
+        assert!(mphf.num_partitions > 1);
+        let descriptors = HEADER_LEN..mphf.pilots_offset;
+        let remap = mphf.remap_offset..mphf.as_bytes().len();
+        // Every single-bit error in the descriptors or remap table is rejected or still leaves
+        // lookups inside the sections
+        for bit in descriptors
+            .chain(remap)
+            .flat_map(|at| (0..8).map(move |b| (at, b)))
+        {
+            let mut bytes = mphf.as_bytes().to_vec();
+            bytes[bit.0] ^= 1 << bit.1;
+            if let Ok(view) = Mphf::from_bytes(bytes.as_slice()) {
+                for key in &keys {
+                    view.index(key.as_bytes());
+                }
+            }
+        }
+
+        let mut bytes = mphf.as_bytes().to_vec();
+        put_u64(&mut bytes, HEADER_LEN + PARTITION_LEN + 8, u64::MAX);
+        assert_eq!(
+            Mphf::from_bytes(bytes).unwrap_err(),
+            MphfError::InvalidData("bad partition descriptor")
+        );
+    }
+
+    #[test]
+    fn test_duplicate_key() {
+        let keys = ["a", "b", "c", "b"];
+        assert_eq!(Mphf::build(&keys).unwrap_err(), MphfError::DuplicateKey(3));
+    }
+}
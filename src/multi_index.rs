@@ -0,0 +1,331 @@
+use crate::parallel;
+
+/// Largest directory used per block table (2^24 `u32` offsets, 64 MiB).
+const MAX_DIRECTORY_BITS: u32 = 24;
+
+/// A multi-index hash (MIH) for Hamming-distance search over 64-bit fingerprints such as SimHash.
+///
+/// Every fingerprint is split into `m` disjoint bit blocks and each block is indexed in its own
+/// table. By the pigeonhole principle, two fingerprints within Hamming distance `r` differ in at
+/// most `r / m` bits on at least one block, so a query only has to probe the small
+/// neighbourhood of each of its blocks and verify the candidates with a popcount.
+///
+/// Tables are stored compactly as sorted arrays: the fingerprint ids ordered by block value plus
+/// a directory over the leading bits of the block. When the whole block fits in the directory a
+/// probe is two loads; otherwise the sorted block values are binary searched within the
+/// directory bucket.
+///
+/// Fingerprint ids are `u32` indices into the slice passed to [`MultiIndexHash::new`].
+#[derive(Debug, Clone)]
+pub struct MultiIndexHash {
+    fingerprints: Vec<u64>,
+    tables: Vec<BlockTable>,
+}
+
+#[derive(Debug, Clone)]
+struct BlockTable {
+    shift: u32,
+    width: u32,
+    directory_bits: u32,
+    // directory[b]..directory[b + 1] is the range of entries whose block starts with `b`
+    directory: Vec<u32>,
+    // Sorted block values, only stored when the directory does not cover the whole block
+    values: Vec<u32>,
+    ids: Vec<u32>,
+}
+
+impl BlockTable {
+    #[inline(always)]
+    fn block(&self, fingerprint: u64) -> u32 {
+        ((fingerprint >> self.shift) & ((1u64 << self.width) - 1)) as u32
+    }
+
+    fn build(fingerprints: &[u64], shift: u32, width: u32, directory_bits: u32) -> Self {
+        let mut table = BlockTable {
+            shift,
+            width,
+            directory_bits,
+            directory: vec![0; (1usize << directory_bits) + 1],
+            values: Vec::new(),
+            ids: vec![0; fingerprints.len()],
+        };
+        let low_bits = width - directory_bits;
+
+        // Counting sort on the directory prefix
+        for &fp in fingerprints {
+            let bucket = (table.block(fp) >> low_bits) as usize;
+            table.directory[bucket + 1] += 1;
+        }
+        for i in 1..table.directory.len() {
+            table.directory[i] += table.directory[i - 1];
+        }
+        let mut cursor = table.directory.clone();
+        for (id, &fp) in fingerprints.iter().enumerate() {
+            let bucket = (table.block(fp) >> low_bits) as usize;
+            table.ids[cursor[bucket] as usize] = id as u32;
+            cursor[bucket] += 1;
+        }
+
+        // Finish the sort within each directory bucket on the remaining low bits
+        if low_bits > 0 {
+            let mut values: Vec<u32> = table
+                .ids
+                .iter()
+                .map(|&id| table.block(fingerprints[id as usize]))
+                .collect();
+            for bucket in table.directory.windows(2) {
+                let (start, end) = (bucket[0] as usize, bucket[1] as usize);
+                if end - start > 1 {
+                    let mut pairs: Vec<(u32, u32)> = values[start..end]
+                        .iter()
+                        .copied()
+                        .zip(table.ids[start..end].iter().copied())
+                        .collect();
+                    pairs.sort_unstable();
+                    for (offset, (value, id)) in pairs.into_iter().enumerate() {
+                        values[start + offset] = value;
+                        table.ids[start + offset] = id;
+                    }
+                }
+            }
+            table.values = values;
+        }
+
+        table
+    }
+
+    /// Returns the ids of all fingerprints whose block equals `value`.
+    #[inline]
+    fn lookup(&self, value: u32) -> &[u32] {
+        let low_bits = self.width - self.directory_bits;
+        let bucket = (value >> low_bits) as usize;
+        let start = self.directory[bucket] as usize;
+        let end = self.directory[bucket + 1] as usize;
+        if low_bits == 0 {
+            return &self.ids[start..end];
+        }
+
+        let values = &self.values[start..end];
+        let lo = values.partition_point(|&v| v < value);
+        let hi = lo + values[lo..].partition_point(|&v| v == value);
+        &self.ids[start + lo..start + hi]
+    }
+}
+
+impl MultiIndexHash {
+    /// Builds an index over `fingerprints` split into `blocks` tables, using all available cores.
+    ///
+    /// # Parameters
+    ///
+    /// * `fingerprints` - The 64-bit fingerprints to index; their positions become their ids
+    /// * `blocks` - The number of blocks (2 to 64). [`MultiIndexHash::recommended_blocks`]
+    ///   returns a good default for a given collection size.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `blocks` is out of range or if there are more than `u32::MAX` fingerprints.
+    pub fn new(fingerprints: &[u64], blocks: usize) -> Self {
+        Self::with_threads(fingerprints, blocks, 0)
+    }
+
+    /// Builds an index like [`MultiIndexHash::new`], using at most `threads` worker threads
+    /// (`0` uses all available cores). Block tables are built independently in parallel.
+    pub fn with_threads(fingerprints: &[u64], blocks: usize, threads: usize) -> Self {
+        assert!(
+            (2..=64).contains(&blocks),
+            "blocks must be between 2 and 64, got {}",
+            blocks
+        );
+        assert!(
+            fingerprints.len() <= u32::MAX as usize,
+            "at most u32::MAX fingerprints can be indexed"
+        );
+
+        // Spread the 64 bits as evenly as possible, low blocks first
+        let mut layout = Vec::with_capacity(blocks);
+        let mut shift = 0;
+        for i in 0..blocks {
+            let width = (64 / blocks + usize::from(i < 64 % blocks)) as u32;
+            layout.push((shift, width));
+            shift += width;
+        }
+
+        let size_bits = (usize::BITS - fingerprints.len().leading_zeros()).max(8);
+        let tables = parallel::map_indices(blocks, threads, |i| {
+            let (shift, width) = layout[i];
+            let directory_bits = width.min(size_bits).min(MAX_DIRECTORY_BITS);
+            BlockTable::build(fingerprints, shift, width, directory_bits)
+        });
+
+        Self {
+            fingerprints: fingerprints.to_vec(),
+            tables,
+        }
+    }
+
+    /// Returns a block count suited to `n` fingerprints: roughly `64 / log2(n)`, so that
+    /// each block table has about one entry per distinct block value.
+    pub fn recommended_blocks(n: usize) -> usize {
+        let log_n = (usize::BITS - n.max(2).leading_zeros()) as usize;
+        (64 / log_n).clamp(2, 64)
+    }
+
+    /// Returns the ids of every indexed fingerprint within Hamming distance `max_distance`
+    /// of `query`, in ascending id order.
+    pub fn query(&self, query: u64, max_distance: u32) -> Vec<u32> {
+        let mut results = Vec::new();
+        self.query_into(query, max_distance, &mut results);
+        results
+    }
+
+    /// Appends the ids of every indexed fingerprint within Hamming distance `max_distance`
+    /// of `query` to `results`, in ascending id order. Reusing `results` across queries
+    /// avoids an allocation per query.
+    pub fn query_into(&self, query: u64, max_distance: u32, results: &mut Vec<u32>) {
+        let start = results.len();
+        let radius = max_distance / self.tables.len() as u32;
+
+        for (i, table) in self.tables.iter().enumerate() {
+            let block = table.block(query);
+            for_each_neighbor(block, table.width, radius, &mut |value| {
+                for &id in table.lookup(value) {
+                    let fp = self.fingerprints[id as usize];
+                    if (fp ^ query).count_ones() > max_distance {
+                        continue;
+                    }
+                    // Report each match only from the first block that can see it
+                    let seen_earlier = self.tables[..i]
+                        .iter()
+                        .any(|t| (t.block(fp) ^ t.block(query)).count_ones() <= radius);
+                    if !seen_earlier {
+                        results.push(id);
+                    }
+                }
+            });
+        }
+
+        results[start..].sort_unstable();
+    }
+
+    /// Returns the fingerprint stored under `id`.
+    #[inline]
+    pub fn get(&self, id: u32) -> Option<u64> {
+        self.fingerprints.get(id as usize).copied()
+    }
+
+    /// Returns the number of blocks the fingerprints are split into.
+    #[inline]
+    pub fn blocks(&self) -> usize {
+        self.tables.len()
+    }
+
+    /// Returns the number of indexed fingerprints.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.fingerprints.len()
+    }
+
+    /// Returns `true` if the index holds no fingerprints.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.fingerprints.is_empty()
+    }
+
+    /// Returns the approximate heap size of the index in bytes.
+    pub fn memory_usage(&self) -> usize {
+        self.fingerprints.len() * 8
+            + self
+                .tables
+                .iter()
+                .map(|t| (t.directory.len() + t.values.len() + t.ids.len()) * 4)
+                .sum::<usize>()
+    }
+}
+
+/// Calls `f` for every `width`-bit value within Hamming distance `radius` of `value`.
+fn for_each_neighbor<F: FnMut(u32)>(value: u32, width: u32, radius: u32, f: &mut F) {
+    fn visit<F: FnMut(u32)>(value: u32, from_bit: u32, width: u32, remaining: u32, f: &mut F) {
+        f(value);
+        if remaining == 0 {
+            return;
+        }
+        for bit in from_bit..width {
+            visit(value ^ (1 << bit), bit + 1, width, remaining - 1, f);
+        }
+    }
+    visit(value, 0, width, radius, f);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn splitmix64(state: &mut u64) -> u64 {
+        *state = state.wrapping_add(0x9e3779b97f4a7c15);
+        let mut z = *state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d049bb133111eb);
+        z ^ (z >> 31)
+    }
+
+    fn brute_force(fingerprints: &[u64], query: u64, max_distance: u32) -> Vec<u32> {
+        fingerprints
+            .iter()
+            .enumerate()
+            .filter(|(_, fp)| (*fp ^ query).count_ones() <= max_distance)
+            .map(|(id, _)| id as u32)
+            .collect()
+    }
+
+    #[test]
+    fn test_matches_brute_force() {
+        let mut state = 42;
+        let mut fingerprints: Vec<u64> = (0..5000).map(|_| splitmix64(&mut state)).collect();
+        // Plant near-duplicates of the first few fingerprints at distances 0..=4
+        for i in 0..50 {
+            let mut fp = fingerprints[i];
+            for _ in 0..(i % 5) {
+                fp ^= 1 << (splitmix64(&mut state) % 64);
+            }
+            fingerprints.push(fp);
+        }
+
+        for blocks in [2, 3, 4, 5, 8] {
+            let index = MultiIndexHash::with_threads(&fingerprints, blocks, 2);
+            for q in 0..60 {
+                let query = fingerprints[q];
+                for r in 0..=3 {
+                    assert_eq!(
+                        index.query(query, r),
+                        brute_force(&fingerprints, query, r),
+                        "blocks={} query={} r={}",
+                        blocks,
+                        q,
+                        r
+                    );
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_duplicates_and_empty() {
+        let fingerprints = vec![7u64, 7, 7, 0xffff_0000_0000_0007];
+        let index = MultiIndexHash::new(&fingerprints, 4);
+        assert_eq!(index.query(7, 0), vec![0, 1, 2]);
+        assert_eq!(index.query(7, 3), vec![0, 1, 2]);
+        assert_eq!(index.query(7, 16), vec![0, 1, 2, 3]);
+        assert_eq!(index.get(3), Some(0xffff_0000_0000_0007));
+
+        let empty = MultiIndexHash::new(&[], 2);
+        assert!(empty.is_empty());
+        assert!(empty.query(0, 3).is_empty());
+    }
+
+    #[test]
+    fn test_recommended_blocks() {
+        assert_eq!(MultiIndexHash::recommended_blocks(0), 32);
+        assert_eq!(MultiIndexHash::recommended_blocks(1 << 20), 3);
+        assert_eq!(MultiIndexHash::recommended_blocks(1_000_000_000), 2);
+    }
+}
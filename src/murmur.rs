@@ -21,6 +21,18 @@ fn fmix32(mut h: u32) -> u32 {
     h
 }
 
+// 64-bit finalization mix from MurmurHash3_x64_128, used to derive independent bits from
+// an existing 64-bit hash without touching the key again
+#[inline(always)]
+pub(crate) const fn fmix64(mut k: u64) -> u64 {
+    k ^= k >> 33;
+    k = k.wrapping_mul(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k = k.wrapping_mul(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    k
+}
+
 // MurmurHash3 32-bit hasher
 #[derive(Debug, Copy, Clone)]
 pub struct MurmurHasher32 {
@@ -170,6 +182,13 @@ impl MurmurHasher64 {
     pub fn finish_u64(&self) -> u64 {
         self.inner.finish_u64()
     }
+
+    /// Returns the full 128-bit state that `finish_u64` truncates, for callers that
+    /// need several independent hash values from a single pass over the key.
+    #[inline]
+    pub fn finish_u128(&self) -> u128 {
+        self.inner.finish_u128()
+    }
 }
 
 impl Hasher for MurmurHasher64 {
@@ -0,0 +1,184 @@
+// Small scoped-thread helpers shared by the parallel builders in this crate.
+//
+// The crate has no threading dependency, so work is spread over `std::thread::scope` workers
+// that claim indices from a shared atomic counter. Claiming one index at a time keeps the
+// workers busy even when items have very different costs (dynamic scheduling).
+
+use std::collections::VecDeque;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
+
+/// Returns the number of worker threads to use when a caller asks for `0` (automatic).
+pub(crate) fn resolve_threads(threads: usize) -> usize {
+    if threads > 0 {
+        threads
+    } else {
+        thread::available_parallelism()
+            .map(|n| n.get())
+            .unwrap_or(1)
+    }
+}
+
+/// Computes `f(i)` for every `i` in `0..n` in parallel and returns the results in index order.
+pub(crate) fn map_indices<T, F>(n: usize, threads: usize, f: F) -> Vec<T>
+where
+    T: Send,
+    F: Fn(usize) -> T + Sync,
+{
+    let workers = resolve_threads(threads).min(n);
+    if workers <= 1 {
+        return (0..n).map(f).collect();
+    }
+
+    let next = AtomicUsize::new(0);
+    let mut parts: Vec<Vec<(usize, T)>> = thread::scope(|scope| {
+        let handles: Vec<_> = (0..workers)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut local = Vec::new();
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        if i >= n {
+                            break;
+                        }
+                        local.push((i, f(i)));
+                    }
+                    local
+                })
+            })
+            .collect();
+        handles
+            .into_iter()
+            .map(|h| h.join().expect("worker thread panicked"))
+            .collect()
+    });
+
+    let mut slots: Vec<Option<T>> = (0..n).map(|_| None).collect();
+    for part in parts.iter_mut() {
+        for (i, value) in part.drain(..) {
+            slots[i] = Some(value);
+        }
+    }
+    slots
+        .into_iter()
+        .map(|slot| slot.expect("every index is computed exactly once"))
+        .collect()
+}
+
+/// Lets a running task queue more tasks for [`run_tasks`].
+pub(crate) struct Spawner<'a, T> {
+    queues: &'a [Mutex<VecDeque<T>>],
+    worker: usize,
+    pending: &'a AtomicUsize,
+}
+
+impl<T> Spawner<'_, T> {
+    /// Queues `task` on the calling worker's own deque.
+    pub(crate) fn spawn(&self, task: T) {
+        self.pending.fetch_add(1, Ordering::SeqCst);
+        self.queues[self.worker].lock().unwrap().push_back(task);
+    }
+}
+
+/// Runs `initial` and every task they spawn on a work-stealing pool, and returns each
+/// worker's final state (created by `init`).
+///
+/// Each worker pops its newest task first, which keeps a directory walk depth-first and its
+/// working set small. An idle worker steals the oldest task of another worker, which tends to
+/// be the largest remaining piece of work. The pool stops once no task is queued or running.
+pub(crate) fn run_tasks<T, S, I, F>(initial: Vec<T>, threads: usize, init: I, f: F) -> Vec<S>
+where
+    T: Send,
+    S: Send,
+    I: Fn() -> S + Sync,
+    F: Fn(T, &mut S, &Spawner<'_, T>) + Sync,
+{
+    let workers = resolve_threads(threads).max(1);
+    let pending = AtomicUsize::new(initial.len());
+    let queues: Vec<Mutex<VecDeque<T>>> =
+        (0..workers).map(|_| Mutex::new(VecDeque::new())).collect();
+    for (i, task) in initial.into_iter().enumerate() {
+        queues[i % workers].lock().unwrap().push_back(task);
+    }
+
+    let work = |worker: usize| {
+        let spawner = Spawner {
+            queues: &queues,
+            worker,
+            pending: &pending,
+        };
+        let mut state = init();
+        let mut idle = 0u32;
+        loop {
+            let own = queues[worker].lock().unwrap().pop_back();
+            let task = own.or_else(|| {
+                (1..workers)
+                    .find_map(|k| queues[(worker + k) % workers].lock().unwrap().pop_front())
+            });
+            match task {
+                Some(task) => {
+                    idle = 0;
+                    f(task, &mut state, &spawner);
+                    pending.fetch_sub(1, Ordering::SeqCst);
+                }
+                None if pending.load(Ordering::SeqCst) == 0 => return state,
+                None => {
+                    // Another worker is running a task that may still spawn more
+                    idle += 1;
+                    if idle < 64 {
+                        thread::yield_now();
+                    } else {
+                        thread::sleep(std::time::Duration::from_micros(50));
+                    }
+                }
+            }
+        }
+    };
+
+    if workers == 1 {
+        return vec![work(0)];
+    }
+    thread::scope(|scope| {
+        let work = &work;
+        let handles: Vec<_> = (0..workers).map(|w| scope.spawn(move || work(w))).collect();
+        handles
+            .into_iter()
+            .map(|h| h.join().expect("worker thread panicked"))
+            .collect()
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_map_indices_preserves_order() {
+        let squares = map_indices(257, 0, |i| i * i);
+        assert_eq!(squares.len(), 257);
+        for (i, value) in squares.iter().enumerate() {
+            assert_eq!(*value, i * i);
+        }
+        assert!(map_indices(0, 4, |i| i).is_empty());
+    }
+
+    #[test]
+    fn test_run_tasks_runs_spawned_tasks() {
+        // Each task n >= 2 spawns n - 1 and n - 2, so the total count is a Fibonacci number
+        let counts = run_tasks(
+            vec![20u32],
+            4,
+            || 0u64,
+            |n, count, spawner| {
+                *count += 1;
+                if n >= 2 {
+                    spawner.spawn(n - 1);
+                    spawner.spawn(n - 2);
+                }
+            },
+        );
+        assert_eq!(counts.len(), 4);
+        assert_eq!(counts.iter().sum::<u64>(), 21_891);
+    }
+}
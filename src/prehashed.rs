@@ -0,0 +1,334 @@
+use std::borrow::Borrow;
+use std::collections::{HashMap, HashSet};
+use std::hash::{BuildHasherDefault, Hash, Hasher as StdHasher};
+use std::ops::Deref;
+
+/// A key bundled with a precomputed 64-bit hash.
+///
+/// When the same key passes through several hashed structures (a shard router, a cache map,
+/// a filter), hashing it once up front and carrying the result avoids re-reading the key bytes
+/// at every step. `Prehashed` hashes as exactly its stored value, so in a map built with
+/// [`NoHashBuildHasher`] neither lookups nor resizes touch the key bytes; equality checks
+/// compare the stored hashes before the keys.
+///
+/// Any hash function can produce the value, but every `Prehashed` that meets in one
+/// structure must have been hashed the same way.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::city::city_hash64;
+/// use simplehash::prehashed::{Prehashed, PrehashedMap};
+///
+/// let key = Prehashed::with("user:42".to_string(), |k| city_hash64(k.as_bytes()));
+/// let shard = key.hash() % 16;
+///
+/// let mut cache: PrehashedMap<String, u32> = PrehashedMap::default();
+/// cache.insert(key.clone(), 7);
+/// assert_eq!(cache.get(&key), Some(&7));
+/// assert!(shard < 16);
+/// ```
+#[derive(Debug, Copy, Clone, PartialOrd, Ord)]
+pub struct Prehashed<K> {
+    hash: u64,
+    key: K,
+}
+
+impl<K> Prehashed<K> {
+    /// Wraps `key` with a hash the caller has already computed.
+    ///
+    /// # Parameters
+    ///
+    /// * `key` - The key to carry
+    /// * `hash` - The key's hash; must be computed the same way for every key it is compared with
+    #[inline]
+    pub fn new(key: K, hash: u64) -> Self {
+        Self { hash, key }
+    }
+
+    /// Wraps `key`, computing its hash with `hasher`.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::fnv1a_64;
+    /// use simplehash::prehashed::Prehashed;
+    ///
+    /// let key = Prehashed::with("abc", |k| fnv1a_64(k.as_bytes()));
+    /// assert_eq!(key.hash(), fnv1a_64(b"abc"));
+    /// ```
+    #[inline]
+    pub fn with<F: FnOnce(&K) -> u64>(key: K, hasher: F) -> Self {
+        let hash = hasher(&key);
+        Self { hash, key }
+    }
+
+    /// Returns the stored hash.
+    #[inline]
+    pub fn hash(&self) -> u64 {
+        self.hash
+    }
+
+    /// Returns a reference to the key.
+    #[inline]
+    pub fn key(&self) -> &K {
+        &self.key
+    }
+
+    /// Discards the hash and returns the key.
+    #[inline]
+    pub fn into_inner(self) -> K {
+        self.key
+    }
+
+    /// Returns a view of this key for lookups in a map or set keyed by another `Prehashed`
+    /// type whose keys borrow as `Q`.
+    ///
+    /// This lets a `PrehashedMap<String, V>` be queried with a `Prehashed<&str>` without
+    /// allocating a `String`.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::murmurhash3_64;
+    /// use simplehash::prehashed::{Prehashed, PrehashedMap};
+    ///
+    /// let hash = |k: &str| murmurhash3_64(k.as_bytes(), 0);
+    /// let mut map: PrehashedMap<String, u32> = PrehashedMap::default();
+    /// map.insert(Prehashed::new("a".to_string(), hash("a")), 1);
+    ///
+    /// let probe = Prehashed::new("a", hash("a"));
+    /// assert_eq!(map.get(probe.as_borrowed::<str>()), Some(&1));
+    /// ```
+    #[inline]
+    pub fn as_borrowed<Q: ?Sized>(&self) -> &(dyn PrehashedKey<Q> + '_)
+    where
+        K: Borrow<Q>,
+    {
+        self
+    }
+}
+
+impl<K> Deref for Prehashed<K> {
+    type Target = K;
+
+    #[inline]
+    fn deref(&self) -> &K {
+        &self.key
+    }
+}
+
+impl<K: PartialEq> PartialEq for Prehashed<K> {
+    #[inline]
+    fn eq(&self, other: &Self) -> bool {
+        self.hash == other.hash && self.key == other.key
+    }
+}
+
+impl<K: Eq> Eq for Prehashed<K> {}
+
+impl<K> Hash for Prehashed<K> {
+    #[inline]
+    fn hash<H: StdHasher>(&self, state: &mut H) {
+        state.write_u64(self.hash);
+    }
+}
+
+/// Object-safe view of a [`Prehashed`] key used for borrowed lookups.
+///
+/// Implemented for every `Prehashed<K>` where `K: Borrow<Q>`. It hashes and compares exactly
+/// like `Prehashed`, so it satisfies the `Borrow` contract for map lookups. See
+/// [`Prehashed::as_borrowed`].
+pub trait PrehashedKey<Q: ?Sized> {
+    /// Returns the stored hash.
+    fn prehash(&self) -> u64;
+
+    /// Returns the key in its borrowed form.
+    fn borrowed_key(&self) -> &Q;
+}
+
+impl<K: Borrow<Q>, Q: ?Sized> PrehashedKey<Q> for Prehashed<K> {
+    #[inline]
+    fn prehash(&self) -> u64 {
+        self.hash
+    }
+
+    #[inline]
+    fn borrowed_key(&self) -> &Q {
+        self.key.borrow()
+    }
+}
+
+impl<'a, K: Borrow<Q> + 'a, Q: ?Sized + 'a> Borrow<dyn PrehashedKey<Q> + 'a> for Prehashed<K> {
+    #[inline]
+    fn borrow(&self) -> &(dyn PrehashedKey<Q> + 'a) {
+        self
+    }
+}
+
+impl<Q: ?Sized + PartialEq> PartialEq for dyn PrehashedKey<Q> + '_ {
+    #[inline]
+    fn eq(&self, other: &Self) -> bool {
+        self.prehash() == other.prehash() && self.borrowed_key() == other.borrowed_key()
+    }
+}
+
+impl<Q: ?Sized + Eq> Eq for dyn PrehashedKey<Q> + '_ {}
+
+impl<Q: ?Sized> Hash for dyn PrehashedKey<Q> + '_ {
+    #[inline]
+    fn hash<H: StdHasher>(&self, state: &mut H) {
+        state.write_u64(self.prehash());
+    }
+}
+
+/// Hashes values that are already hashes, such as [`Prehashed`] keys or integer fingerprints.
+///
+/// A single integer write is returned unchanged. Byte writes are folded in 8-byte words so the
+/// hasher still works for other key types, but it does no mixing: only use it for keys whose
+/// bits are already uniformly distributed.
+#[derive(Debug, Default, Copy, Clone)]
+pub struct NoHashHasher {
+    state: u64,
+}
+
+impl NoHashHasher {
+    /// Creates a hasher with a zero state, the same as [`Default`].
+    #[inline(always)]
+    pub fn new() -> Self {
+        Self { state: 0 }
+    }
+
+    #[inline(always)]
+    fn combine(&mut self, value: u64) {
+        // A single write on a fresh hasher yields `value` itself
+        self.state = self.state.rotate_left(5) ^ value;
+    }
+}
+
+impl StdHasher for NoHashHasher {
+    #[inline(always)]
+    fn finish(&self) -> u64 {
+        self.state
+    }
+
+    #[inline(always)]
+    fn write(&mut self, bytes: &[u8]) {
+        let mut chunks = bytes.chunks_exact(8);
+        for chunk in &mut chunks {
+            self.combine(u64::from_le_bytes(chunk.try_into().unwrap()));
+        }
+        let rest = chunks.remainder();
+        if !rest.is_empty() {
+            let mut word = [0u8; 8];
+            word[..rest.len()].copy_from_slice(rest);
+            self.combine(u64::from_le_bytes(word));
+        }
+    }
+
+    #[inline(always)]
+    fn write_u8(&mut self, i: u8) {
+        self.combine(i as u64);
+    }
+
+    #[inline(always)]
+    fn write_u16(&mut self, i: u16) {
+        self.combine(i as u64);
+    }
+
+    #[inline(always)]
+    fn write_u32(&mut self, i: u32) {
+        self.combine(i as u64);
+    }
+
+    #[inline(always)]
+    fn write_u64(&mut self, i: u64) {
+        self.combine(i);
+    }
+
+    #[inline(always)]
+    fn write_usize(&mut self, i: usize) {
+        self.combine(i as u64);
+    }
+}
+
+/// `BuildHasher` for [`NoHashHasher`].
+pub type NoHashBuildHasher = BuildHasherDefault<NoHashHasher>;
+
+/// A `HashMap` keyed by [`Prehashed`] keys that reuses their stored hashes.
+pub type PrehashedMap<K, V> = HashMap<Prehashed<K>, V, NoHashBuildHasher>;
+
+/// A `HashSet` of [`Prehashed`] keys that reuses their stored hashes.
+pub type PrehashedSet<K> = HashSet<Prehashed<K>, NoHashBuildHasher>;
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::city::city_hash64;
+    use std::cell::Cell;
+    use std::hash::BuildHasher;
+
+    // A key that counts how often it is hashed
+    #[derive(PartialEq, Eq)]
+    struct Counted<'a>(u32, &'a Cell<usize>);
+
+    impl Hash for Counted<'_> {
+        fn hash<H: StdHasher>(&self, state: &mut H) {
+            self.1.set(self.1.get() + 1);
+            self.0.hash(state);
+        }
+    }
+
+    #[test]
+    fn test_no_hash_hasher_passes_hash_through() {
+        let build = NoHashBuildHasher::default();
+        assert_eq!(
+            build.hash_one(Prehashed::new("x", 0xdead_beef)),
+            0xdead_beef
+        );
+        assert_eq!(build.hash_one(42u64), 42);
+        assert_eq!(build.hash_one(7u32), 7);
+        assert_ne!(build.hash_one("ab"), build.hash_one("ba"));
+    }
+
+    #[test]
+    #[allow(clippy::mutable_key_type)] // the counter is not part of the key's identity
+    fn test_map_never_rehashes_keys() {
+        let hashes = Cell::new(0);
+        let mut map: PrehashedMap<Counted, u32> = PrehashedMap::default();
+        for i in 0..10_000 {
+            map.insert(
+                Prehashed::new(Counted(i, &hashes), city_hash64(&i.to_le_bytes())),
+                i,
+            );
+        }
+        for i in 0..10_000 {
+            let key = Prehashed::new(Counted(i, &hashes), city_hash64(&i.to_le_bytes()));
+            assert_eq!(map.get(&key), Some(&i));
+        }
+        assert_eq!(hashes.get(), 0);
+    }
+
+    #[test]
+    fn test_borrowed_lookup() {
+        let hash = |k: &str| city_hash64(k.as_bytes());
+        let mut set: PrehashedSet<String> = PrehashedSet::default();
+        for word in ["alpha", "beta", "gamma"] {
+            set.insert(Prehashed::with(word.to_string(), |k| hash(k)));
+        }
+
+        assert!(set.contains(Prehashed::new("beta", hash("beta")).as_borrowed::<str>()));
+        assert!(!set.contains(Prehashed::new("delta", hash("delta")).as_borrowed::<str>()));
+        // Same bytes under a different hash is a different key
+        assert!(!set.contains(Prehashed::new("beta", 0).as_borrowed::<str>()));
+    }
+
+    #[test]
+    fn test_equal_hash_different_keys() {
+        let mut map: PrehashedMap<&str, u32> = PrehashedMap::default();
+        map.insert(Prehashed::new("a", 1), 1);
+        map.insert(Prehashed::new("b", 1), 2);
+        assert_eq!(map.len(), 2);
+        assert_eq!(map[&Prehashed::new("b", 1)], 2);
+    }
+}
@@ -0,0 +1,262 @@
+use crate::digest::Algorithm;
+use crate::parallel;
+use crate::{
+    city_hash32, city_hash64, city_hash128, farm_fingerprint64, farm_fingerprint128, farm_hash32,
+    farm_hash64, fnv1_32, fnv1_64, fnv1a_32, fnv1a_64, murmurhash3_32, murmurhash3_128,
+};
+use std::io;
+
+// Chunks per worker in one window, so a worker that finishes early can take another
+const CHUNKS_PER_THREAD: usize = 4;
+
+/// Hashes packed fixed-width binary records, such as 8-byte IDs or 16-byte UUIDs, into a
+/// packed column of hashes in record order.
+///
+/// The column holds one little-endian hash of [`RecordHasher::hash_width`] bytes per record
+/// with no separators, so it can be loaded directly as a `u32`, `u64` or `u128` array. Common
+/// record widths (4, 8, 12, 16, 20, 24, 32 and 64 bytes) get a kernel compiled for that exact
+/// length: each record is a `[u8; W]` and each output slot a `[u8; N]`, so once the hash
+/// function is inlined its length checks and tail handling are resolved at compile time and
+/// the hash is stored without a variable-length copy. Other widths use the generic
+/// functions. Input is hashed in chunks on the workers, and the chunks of the column are
+/// passed on in input order.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::digest::Algorithm;
+/// use simplehash::records::RecordHasher;
+///
+/// let ids: Vec<u8> = (0u64..1000).flat_map(|id| id.to_le_bytes()).collect();
+/// let mut column = Vec::new();
+/// let hasher = RecordHasher::new(8).algorithm(Algorithm::City64);
+/// let records = hasher.hash_slice(&ids, |chunk| {
+///     column.extend_from_slice(chunk);
+///     Ok(())
+/// })?;
+/// assert_eq!(records, 1000);
+/// assert_eq!(column.len(), 8000);
+/// assert_eq!(column[8..16], simplehash::city_hash64(&1u64.to_le_bytes()).to_le_bytes());
+/// # Ok::<(), std::io::Error>(())
+/// ```
+#[derive(Debug, Clone)]
+pub struct RecordHasher {
+    width: usize,
+    algorithm: Algorithm,
+    threads: usize,
+    chunk_records: usize,
+}
+
+impl RecordHasher {
+    /// Creates a hasher for records of `width` bytes using [`Algorithm::Murmur3_128`], all
+    /// available cores, and chunks of about 4 MiB of input.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `width` is 0.
+    pub fn new(width: usize) -> Self {
+        assert!(width > 0, "record width must be positive");
+        Self {
+            width,
+            algorithm: Algorithm::Murmur3_128,
+            threads: 0,
+            chunk_records: ((4 << 20) / width).max(1),
+        }
+    }
+
+    /// Sets the hash function applied to each record.
+    pub fn algorithm(mut self, algorithm: Algorithm) -> Self {
+        self.algorithm = algorithm;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets how many records each parallel task hashes.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `chunk_records` is 0.
+    pub fn chunk_records(mut self, chunk_records: usize) -> Self {
+        assert!(chunk_records > 0, "chunk size must be positive");
+        self.chunk_records = chunk_records;
+        self
+    }
+
+    /// Returns the record width in bytes.
+    pub fn width(&self) -> usize {
+        self.width
+    }
+
+    /// Returns the size of one hash in the column: 4, 8 or 16 bytes.
+    pub fn hash_width(&self) -> usize {
+        self.algorithm.bits() as usize / 8
+    }
+
+    /// Hashes every record of `data` and returns the number of records.
+    ///
+    /// `sink` receives the packed column in record order, one buffer per chunk.
+    ///
+    /// # Errors
+    ///
+    /// Returns an [`io::ErrorKind::InvalidData`] error, before hashing anything, if the length
+    /// of `data` is not a multiple of the record width, and otherwise the first error from
+    /// `sink`.
+    pub fn hash_slice<S>(&self, data: &[u8], mut sink: S) -> io::Result<u64>
+    where
+        S: FnMut(&[u8]) -> io::Result<()>,
+    {
+        if !data.len().is_multiple_of(self.width) {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidData,
+                "input length is not a multiple of the record width",
+            ));
+        }
+        let records = data.len() / self.width;
+        let chunks = records.div_ceil(self.chunk_records);
+        let workers = parallel::resolve_threads(self.threads);
+        let window = workers * CHUNKS_PER_THREAD;
+        let chunk = |i: usize| {
+            let end = ((i + 1) * self.chunk_records).min(records);
+            &data[i * self.chunk_records * self.width..end * self.width]
+        };
+
+        let mut column = Vec::new();
+        for first in (0..chunks).step_by(window) {
+            let last = (first + window).min(chunks);
+            if workers <= 1 {
+                for i in first..last {
+                    self.hash_chunk(chunk(i), &mut column);
+                    sink(&column)?;
+                }
+            } else {
+                let parts = parallel::map_indices(last - first, workers, |i| {
+                    let mut column = Vec::new();
+                    self.hash_chunk(chunk(first + i), &mut column);
+                    column
+                });
+                for part in parts {
+                    sink(&part)?;
+                }
+            }
+        }
+        Ok(records as u64)
+    }
+
+    /// Returns the hash of every record of `data` in order.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the length of `data` is not a multiple of the record width.
+    pub fn hash(&self, data: &[u8]) -> Vec<u128> {
+        let hash_width = self.hash_width();
+        let mut hashes = Vec::with_capacity(data.len() / self.width);
+        self.hash_slice(data, |column| {
+            hashes.extend(column.chunks_exact(hash_width).map(|slot| {
+                let mut bytes = [0u8; 16];
+                bytes[..hash_width].copy_from_slice(slot);
+                u128::from_le_bytes(bytes)
+            }));
+            Ok(())
+        })
+        .expect("input length is not a multiple of the record width");
+        hashes
+    }
+
+    // Replaces `column` with the hashes of the records in `data`
+    fn hash_chunk(&self, data: &[u8], column: &mut Vec<u8>) {
+        column.clear();
+        column.resize(data.len() / self.width * self.hash_width(), 0);
+        match self.width {
+            4 => hash_fixed::<4>(self.algorithm, data, column),
+            8 => hash_fixed::<8>(self.algorithm, data, column),
+            12 => hash_fixed::<12>(self.algorithm, data, column),
+            16 => hash_fixed::<16>(self.algorithm, data, column),
+            20 => hash_fixed::<20>(self.algorithm, data, column),
+            24 => hash_fixed::<24>(self.algorithm, data, column),
+            32 => hash_fixed::<32>(self.algorithm, data, column),
+            64 => hash_fixed::<64>(self.algorithm, data, column),
+            width => {
+                let hash_width = self.hash_width();
+                let slots = column.chunks_exact_mut(hash_width);
+                for (record, slot) in data.chunks_exact(width).zip(slots) {
+                    slot.copy_from_slice(&self.algorithm.hash(record).to_le_bytes()[..hash_width]);
+                }
+            }
+        }
+    }
+}
+
+// Picks the kernel for one algorithm outside the record loop, so each loop calls a single
+// hash function that can be inlined for the constant width
+fn hash_fixed<const W: usize>(algorithm: Algorithm, data: &[u8], column: &mut [u8]) {
+    match algorithm {
+        Algorithm::Fnv1_32 => kernel::<W, 4>(data, column, |r| fnv1_32(r).to_le_bytes()),
+        Algorithm::Fnv1a32 => kernel::<W, 4>(data, column, |r| fnv1a_32(r).to_le_bytes()),
+        Algorithm::Fnv1_64 => kernel::<W, 8>(data, column, |r| fnv1_64(r).to_le_bytes()),
+        Algorithm::Fnv1a64 => kernel::<W, 8>(data, column, |r| fnv1a_64(r).to_le_bytes()),
+        Algorithm::Murmur3_32 => {
+            kernel::<W, 4>(data, column, |r| murmurhash3_32(r, 0).to_le_bytes())
+        }
+        Algorithm::Murmur3_128 => {
+            kernel::<W, 16>(data, column, |r| murmurhash3_128(r, 0).to_le_bytes())
+        }
+        Algorithm::City32 => kernel::<W, 4>(data, column, |r| city_hash32(r).to_le_bytes()),
+        Algorithm::City64 => kernel::<W, 8>(data, column, |r| city_hash64(r).to_le_bytes()),
+        Algorithm::City128 => kernel::<W, 16>(data, column, |r| city_hash128(r).to_le_bytes()),
+        // The FarmHash bindings are calls into C++, so only the loop is specialized
+        Algorithm::Farm32 => kernel::<W, 4>(data, column, |r| farm_hash32(r).to_le_bytes()),
+        Algorithm::Farm64 => kernel::<W, 8>(data, column, |r| farm_hash64(r).to_le_bytes()),
+        Algorithm::FarmFingerprint64 => {
+            kernel::<W, 8>(data, column, |r| farm_fingerprint64(r).to_le_bytes())
+        }
+        Algorithm::FarmFingerprint128 => {
+            kernel::<W, 16>(data, column, |r| farm_fingerprint128(r).to_le_bytes())
+        }
+    }
+}
+
+#[inline(always)]
+fn kernel<const W: usize, const N: usize>(
+    data: &[u8],
+    column: &mut [u8],
+    hash: impl Fn(&[u8]) -> [u8; N],
+) {
+    for (record, slot) in data.chunks_exact(W).zip(column.chunks_exact_mut(N)) {
+        let record: &[u8; W] = record.try_into().unwrap();
+        slot.copy_from_slice(&hash(record));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_fixed_kernels_match_generic_hashes() {
+        let data: Vec<u8> = (0..64 * 37u32).map(|i| (i * 131 % 251) as u8).collect();
+        for width in [4, 8, 12, 16, 20, 24, 32, 64, 7] {
+            let records = &data[..data.len() / width * width];
+            for &algorithm in Algorithm::ALL {
+                let expected: Vec<u128> =
+                    records.chunks(width).map(|r| algorithm.hash(r)).collect();
+                let hasher = RecordHasher::new(width)
+                    .algorithm(algorithm)
+                    .chunk_records(5)
+                    .threads(3);
+                assert_eq!(hasher.hash(records), expected, "{} x {}", algorithm, width);
+                assert_eq!(hasher.clone().threads(1).hash(records), expected);
+            }
+        }
+    }
+
+    #[test]
+    fn test_partial_record_is_rejected() {
+        let result = RecordHasher::new(8).hash_slice(&[0; 12], |_| Ok(()));
+        assert_eq!(result.unwrap_err().kind(), io::ErrorKind::InvalidData);
+    }
+}
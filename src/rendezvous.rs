@@ -118,6 +118,68 @@ where
         });
         ranked
     }
+
+    /// Selects the preferred node index like [`select_index`](Self::select_index), hashing the
+    /// key only once.
+    ///
+    /// The hasher state after writing the key is cloned for every node. For hashers whose
+    /// output depends only on the bytes written, which includes every hasher in this crate,
+    /// this gives the same scores, and so the same node, as [`select_index`](Self::select_index)
+    /// while hashing a long key once instead of once per node.
+    #[inline]
+    pub fn select_index_cloned<K, N>(&self, key: &K, nodes: &[N]) -> Option<usize>
+    where
+        K: Hash,
+        N: Hash,
+        H: Clone,
+    {
+        let mut keyed = self.build_hasher.build_hasher();
+        key.hash(&mut keyed);
+        nodes
+            .iter()
+            .enumerate()
+            .max_by_key(|(_, node)| {
+                let mut hasher = keyed.clone();
+                node.hash(&mut hasher);
+                hasher.finish()
+            })
+            .map(|(idx, _)| idx)
+    }
+}
+
+/// Maps a 64-bit key hash to one of `buckets` buckets with jump consistent hashing (Lamping
+/// and Veach, 2014).
+///
+/// Growing from `n` to `n + 1` buckets moves about `1 / (n + 1)` of the keys, all of them to
+/// the new bucket. Unlike rendezvous hashing it needs no node list and runs in `O(log n)`, but
+/// buckets can only be added or removed at the end of the range.
+///
+/// # Panics
+///
+/// Panics if `buckets` is 0.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::rendezvous::jump_hash;
+///
+/// let key = simplehash::fnv1a_64(b"user-42");
+/// let shard = jump_hash(key, 16);
+/// assert!(shard < 16);
+/// // Adding a shard either keeps the key in place or moves it to the new shard
+/// assert!(jump_hash(key, 17) == shard || jump_hash(key, 17) == 16);
+/// ```
+#[inline]
+pub fn jump_hash(mut key: u64, buckets: u32) -> u32 {
+    assert!(buckets > 0, "jump_hash needs at least one bucket");
+    let mut bucket: i64 = -1;
+    let mut next: i64 = 0;
+    while next < buckets as i64 {
+        bucket = next;
+        key = key.wrapping_mul(2862933555777941757).wrapping_add(1);
+        next = ((bucket + 1) as f64 * ((1u64 << 31) as f64 / ((key >> 33) + 1) as f64)) as i64;
+    }
+    bucket as u32
 }
 
 // Convenience constructor for using the rendezvous hasher with the standard library's default hasher
@@ -255,4 +317,42 @@ mod tests {
         assert_eq!(hasher.select_index(&"key", &empty), None);
         assert!(hasher.rank(&"key", &empty).is_empty());
     }
+
+    #[test]
+    fn test_select_index_cloned_matches_select_index() {
+        let hasher =
+            RendezvousHasher::<_, BuildHasherDefault<Fnv1aHasher64>>::new(BuildHasherDefault::<
+                Fnv1aHasher64,
+            >::default());
+        let nodes: Vec<u64> = (0..13).collect();
+        for i in 0..1000 {
+            let key = format!("key-{}", i);
+            assert_eq!(
+                hasher.select_index_cloned(&key.as_bytes(), &nodes),
+                hasher.select_index(&key.as_bytes(), &nodes)
+            );
+        }
+        assert_eq!(hasher.select_index_cloned(&"key", &[] as &[u64]), None);
+    }
+
+    #[test]
+    fn test_jump_hash_moves_keys_only_to_new_buckets() {
+        let mut moved = 0;
+        for key in 0..10_000u64 {
+            let key = crate::murmur::fmix64(key);
+            let mut previous = jump_hash(key, 1);
+            assert_eq!(previous, 0);
+            for buckets in 2..=40 {
+                let bucket = jump_hash(key, buckets);
+                assert!(bucket < buckets);
+                assert!(bucket == previous || bucket == buckets - 1);
+                if buckets == 40 && bucket != previous {
+                    moved += 1;
+                }
+                previous = bucket;
+            }
+        }
+        // About 1/40 of the keys move to the 40th bucket
+        assert!((150..350).contains(&moved), "moved {}", moved);
+    }
 }
@@ -0,0 +1,360 @@
+use crate::lines::{find_byte, for_each_block, for_each_slice_block, segments, split_lines};
+use crate::parallel;
+use crate::rendezvous::{RendezvousHasher, jump_hash};
+use std::hash::{BuildHasher, Hasher};
+use std::io::{self, Read};
+
+/// The part of a line that decides its shard.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ShardKey {
+    /// The whole line, without its `\n`.
+    Line,
+    /// The `index`-th field (1-based, like `cut -f`) between `delimiter` bytes. A line with
+    /// fewer fields has an empty key.
+    Field { index: usize, delimiter: u8 },
+}
+
+impl ShardKey {
+    /// Returns the key bytes of `line`.
+    #[inline]
+    pub fn extract<'a>(&self, line: &'a [u8]) -> &'a [u8] {
+        match *self {
+            ShardKey::Line => line,
+            ShardKey::Field { index, delimiter } => {
+                let mut rest = line;
+                for _ in 1..index {
+                    match find_byte(delimiter, rest) {
+                        Some(i) => rest = &rest[i + 1..],
+                        None => return &[],
+                    }
+                }
+                find_byte(delimiter, rest).map_or(rest, |i| &rest[..i])
+            }
+        }
+    }
+}
+
+/// How a key hash is mapped to a shard.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Routing {
+    /// [`RendezvousHasher`] over the shard numbers `0..n` as `u64` nodes. Costs one short
+    /// hash per shard per line, and removing any shard only moves the keys it held.
+    Rendezvous,
+    /// [`jump_hash`] of the key hash. Costs `O(log n)` per line, but shards can only be added
+    /// or removed at the end.
+    Jump,
+}
+
+/// Splits line-delimited records into `n` shards by a hashed key.
+///
+/// With [`Routing::Rendezvous`] a line goes to shard
+/// `RendezvousHasher::new(build_hasher).select_index(&key, &nodes)`, where `key` is the key
+/// as a `&[u8]` and `nodes` is `(0..n as u64).collect::<Vec<_>>()`, so a service that routes
+/// with the same hasher finds every record in the shard this splitter wrote it to. The key is
+/// hashed once per line and its hasher state cloned per shard, which gives the same scores.
+///
+/// Input is processed in blocks cut at newlines. With more than one thread each block is
+/// split into segments that are parsed and routed in parallel into per-shard buffers, and the
+/// buffers are passed on segment by segment, so each shard receives its lines in input order.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::fnv::Fnv1aHasher64;
+/// use simplehash::rendezvous::RendezvousHasher;
+/// use simplehash::shard::{ShardKey, Sharder};
+/// use std::hash::BuildHasherDefault;
+///
+/// let build = BuildHasherDefault::<Fnv1aHasher64>::default();
+/// let sharder = Sharder::new(build.clone(), 4).key(ShardKey::Field {
+///     index: 2,
+///     delimiter: b'\t',
+/// });
+/// let mut shards = vec![Vec::new(); 4];
+/// sharder.split_slice(b"1\talice\n2\tbob\n3\talice\n", |shard, lines| {
+///     shards[shard].extend_from_slice(lines);
+///     Ok(())
+/// })?;
+///
+/// let nodes: Vec<u64> = (0..4).collect();
+/// let alice = RendezvousHasher::new(build).select_index(&&b"alice"[..], &nodes);
+/// assert_eq!(shards[alice.unwrap()], b"1\talice\n3\talice\n");
+/// # Ok::<(), std::io::Error>(())
+/// ```
+#[derive(Debug, Clone)]
+pub struct Sharder<H, B>
+where
+    H: Hasher,
+    B: BuildHasher<Hasher = H>,
+{
+    build_hasher: B,
+    rendezvous: RendezvousHasher<H, B>,
+    nodes: Vec<u64>,
+    key: ShardKey,
+    routing: Routing,
+    threads: usize,
+    block_size: usize,
+}
+
+impl<H, B> Sharder<H, B>
+where
+    H: Hasher + Clone + Sync,
+    B: BuildHasher<Hasher = H> + Clone + Sync,
+{
+    /// Creates a splitter into `shards` shards keyed by the whole line, using rendezvous
+    /// routing, one thread and 8 MiB blocks.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `shards` is 0 or does not fit in a `u32`.
+    pub fn new(build_hasher: B, shards: usize) -> Self {
+        assert!(shards > 0, "need at least one shard");
+        assert!(u32::try_from(shards).is_ok(), "too many shards");
+        Self {
+            rendezvous: RendezvousHasher::new(build_hasher.clone()),
+            build_hasher,
+            nodes: (0..shards as u64).collect(),
+            key: ShardKey::Line,
+            routing: Routing::Rendezvous,
+            threads: 1,
+            block_size: 8 << 20,
+        }
+    }
+
+    /// Sets the part of each line that is hashed.
+    pub fn key(mut self, key: ShardKey) -> Self {
+        self.key = key;
+        self
+    }
+
+    /// Sets how key hashes are mapped to shards.
+    pub fn routing(mut self, routing: Routing) -> Self {
+        self.routing = routing;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Sets the size of the blocks read from a stream or cut from a slice.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `block_size` is 0.
+    pub fn block_size(mut self, block_size: usize) -> Self {
+        assert!(block_size > 0, "block size must be positive");
+        self.block_size = block_size;
+        self
+    }
+
+    /// Returns the number of shards.
+    pub fn shards(&self) -> usize {
+        self.nodes.len()
+    }
+
+    /// Returns the shard of one line, without its `\n`.
+    #[inline]
+    pub fn shard_of(&self, line: &[u8]) -> usize {
+        let key = self.key.extract(line);
+        match self.routing {
+            Routing::Rendezvous => self
+                .rendezvous
+                .select_index_cloned(&key, &self.nodes)
+                .unwrap(),
+            Routing::Jump => {
+                let mut hasher = self.build_hasher.build_hasher();
+                hasher.write(key);
+                jump_hash(hasher.finish(), self.nodes.len() as u32) as usize
+            }
+        }
+    }
+
+    /// Routes every line read from `reader` and returns the number of lines.
+    ///
+    /// `sink` receives a shard number and a run of whole `\n`-terminated lines for that shard;
+    /// a final line without a terminator gets one.
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error from `reader` or `sink`.
+    pub fn split_reader<R, S>(&self, reader: R, mut sink: S) -> io::Result<u64>
+    where
+        R: Read,
+        S: FnMut(usize, &[u8]) -> io::Result<()>,
+    {
+        let workers = parallel::resolve_threads(self.threads);
+        let mut lines = 0;
+        let mut buffers = vec![Vec::new(); self.shards()];
+        for_each_block(reader, self.block_size, |block| {
+            lines += self.split_block(block, workers, &mut sink, &mut buffers)?;
+            Ok(())
+        })?;
+        Ok(lines)
+    }
+
+    /// Routes every line of an in-memory buffer, such as a memory-mapped file, and returns the
+    /// number of lines.
+    ///
+    /// Works like [`Sharder::split_reader`] without copying the input into blocks first.
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error from `sink`.
+    pub fn split_slice<S>(&self, data: &[u8], mut sink: S) -> io::Result<u64>
+    where
+        S: FnMut(usize, &[u8]) -> io::Result<()>,
+    {
+        let workers = parallel::resolve_threads(self.threads);
+        let mut lines = 0;
+        let mut buffers = vec![Vec::new(); self.shards()];
+        for_each_slice_block(data, self.block_size, |block| {
+            lines += self.split_block(block, workers, &mut sink, &mut buffers)?;
+            Ok(())
+        })?;
+        Ok(lines)
+    }
+
+    // Routes the lines of one block, in segments on the workers when there are several
+    fn split_block<S>(
+        &self,
+        data: &[u8],
+        workers: usize,
+        sink: &mut S,
+        buffers: &mut [Vec<u8>],
+    ) -> io::Result<u64>
+    where
+        S: FnMut(usize, &[u8]) -> io::Result<()>,
+    {
+        if workers <= 1 {
+            let lines = self.route_lines(data, buffers);
+            return emit(buffers, sink).map(|_| lines);
+        }
+        let segments = segments(data, workers);
+        let parts = parallel::map_indices(segments.len() - 1, workers, |i| {
+            let mut buffers = vec![Vec::new(); self.shards()];
+            let lines = self.route_lines(&data[segments[i]..segments[i + 1]], &mut buffers);
+            (lines, buffers)
+        });
+        let mut lines = 0;
+        for (count, mut part) in parts {
+            lines += count;
+            emit(&mut part, sink)?;
+        }
+        Ok(lines)
+    }
+
+    // Appends each line of `data` with its terminator to the buffer of its shard
+    fn route_lines(&self, data: &[u8], buffers: &mut [Vec<u8>]) -> u64 {
+        let mut lines = 0;
+        for line in split_lines(data) {
+            let buffer = &mut buffers[self.shard_of(line)];
+            buffer.extend_from_slice(line);
+            buffer.push(b'\n');
+            lines += 1;
+        }
+        lines
+    }
+}
+
+// Passes on and clears every non-empty shard buffer
+fn emit<S>(buffers: &mut [Vec<u8>], sink: &mut S) -> io::Result<()>
+where
+    S: FnMut(usize, &[u8]) -> io::Result<()>,
+{
+    for (shard, buffer) in buffers.iter_mut().enumerate() {
+        if !buffer.is_empty() {
+            sink(shard, buffer)?;
+            buffer.clear();
+        }
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::fnv::Fnv1aHasher64;
+    use crate::murmur::MurmurHasher64;
+    use std::hash::BuildHasherDefault;
+
+    fn split<H, B>(sharder: &Sharder<H, B>, data: &[u8]) -> Vec<Vec<u8>>
+    where
+        H: Hasher + Clone + Sync,
+        B: BuildHasher<Hasher = H> + Clone + Sync,
+    {
+        let mut shards = vec![Vec::new(); sharder.shards()];
+        sharder
+            .split_slice(data, |shard, lines| {
+                shards[shard].extend_from_slice(lines);
+                Ok(())
+            })
+            .unwrap();
+        shards
+    }
+
+    #[test]
+    fn test_field_extraction() {
+        let field = |index| ShardKey::Field {
+            index,
+            delimiter: b',',
+        };
+        assert_eq!(field(1).extract(b"a,bc,d"), b"a");
+        assert_eq!(field(2).extract(b"a,bc,d"), b"bc");
+        assert_eq!(field(3).extract(b"a,bc,d"), b"d");
+        assert_eq!(field(4).extract(b"a,bc,d"), b"");
+        assert_eq!(field(2).extract(b"a,,d"), b"");
+        assert_eq!(ShardKey::Line.extract(b"a,bc"), b"a,bc");
+    }
+
+    #[test]
+    fn test_rendezvous_routing_matches_rendezvous_hasher() {
+        let build = BuildHasherDefault::<MurmurHasher64>::default();
+        let rendezvous = RendezvousHasher::new(build.clone());
+        let nodes: Vec<u64> = (0..7).collect();
+        let sharder = Sharder::new(build, 7).key(ShardKey::Field {
+            index: 2,
+            delimiter: b' ',
+        });
+        for i in 0..500 {
+            let key = format!("user-{}", i);
+            let line = format!("{} {} tail", i, key);
+            assert_eq!(
+                Some(sharder.shard_of(line.as_bytes())),
+                rendezvous.select_index(&key.as_bytes(), &nodes)
+            );
+        }
+    }
+
+    #[test]
+    fn test_split_keeps_order_across_blocks_and_threads() {
+        let data: String = (0..5000).map(|i| format!("{},{}\n", i % 97, i)).collect();
+        let data = &data.as_bytes()[..data.len() - 1];
+        for routing in [Routing::Rendezvous, Routing::Jump] {
+            let build = BuildHasherDefault::<Fnv1aHasher64>::default();
+            let sharder = Sharder::new(build, 5)
+                .routing(routing)
+                .key(ShardKey::Field {
+                    index: 1,
+                    delimiter: b',',
+                });
+            let expected = split(&sharder, data);
+            assert_eq!(expected.iter().map(Vec::len).sum::<usize>(), data.len() + 1);
+            for (shard, lines) in expected.iter().enumerate() {
+                assert!(split_lines(lines).all(|line| sharder.shard_of(line) == shard));
+            }
+            let parallel = sharder.clone().threads(3).block_size(1000);
+            assert_eq!(split(&parallel, data), expected);
+            let mut streamed = vec![Vec::new(); 5];
+            parallel
+                .split_reader(data, |shard, lines| {
+                    streamed[shard].extend_from_slice(lines);
+                    Ok(())
+                })
+                .unwrap();
+            assert_eq!(streamed, expected);
+        }
+    }
+}
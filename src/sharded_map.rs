@@ -0,0 +1,419 @@
+use crate::murmur::MurmurHasher64;
+use crate::parallel::resolve_threads;
+use crate::prehashed::{Prehashed, PrehashedMap};
+use std::borrow::Borrow;
+use std::hash::{BuildHasher, BuildHasherDefault, Hash};
+use std::sync::{RwLock, RwLockReadGuard, RwLockWriteGuard};
+
+// Odd multiplier used to remix the hash for the shard's table. Every key in a shard shares
+// its top bits, so the table must not see them unchanged.
+pub(crate) const REMIX: u64 = 0x9E37_79B9_7F4A_7C15;
+
+// Aligns each shard to its own pair of cache lines so neighbouring locks don't false-share
+#[derive(Debug, Default)]
+#[repr(align(128))]
+pub(crate) struct CachePadded<T>(pub(crate) T);
+
+type Shard<K, V> = CachePadded<RwLock<PrehashedMap<K, V>>>;
+
+/// A concurrent hash map split into independently locked shards.
+///
+/// Each key is hashed once with the map's `BuildHasher`. The top bits of that hash select a
+/// shard, and the shard's table receives the hash itself (remixed by an odd multiply) as a
+/// [`Prehashed`] key, so the key bytes are never hashed again, not even when a shard resizes.
+/// Shards are guarded by `RwLock`s and padded to separate cache lines, so readers of one shard
+/// never block each other and writers only contend with operations on the same shard.
+///
+/// Values are returned by clone because references cannot outlive a shard's lock; use
+/// [`get_with`](ShardedMap::get_with) to inspect a value in place.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::sharded_map::ShardedMap;
+/// use std::thread;
+///
+/// let map: ShardedMap<u64, u64> = ShardedMap::new();
+/// thread::scope(|s| {
+///     for t in 0..4 {
+///         let map = &map;
+///         s.spawn(move || {
+///             for i in 0..100 {
+///                 map.insert(t * 100 + i, i);
+///             }
+///         });
+///     }
+/// });
+/// assert_eq!(map.len(), 400);
+/// assert_eq!(map.get(&205), Some(5));
+/// ```
+pub struct ShardedMap<K, V, S = BuildHasherDefault<MurmurHasher64>> {
+    shards: Box<[Shard<K, V>]>,
+    shift: u32,
+    build_hasher: S,
+}
+
+impl<K: Hash + Eq, V> ShardedMap<K, V> {
+    /// Creates an empty map hashing with MurmurHash3, with a shard count based on the number
+    /// of available CPUs.
+    pub fn new() -> Self {
+        Self::with_shards_and_hasher(0, BuildHasherDefault::default())
+    }
+
+    /// Creates an empty map with at least `shards` shards (rounded up to a power of two).
+    ///
+    /// # Parameters
+    ///
+    /// * `shards` - Minimum number of shards, or `0` to size by the number of available CPUs
+    pub fn with_shards(shards: usize) -> Self {
+        Self::with_shards_and_hasher(shards, BuildHasherDefault::default())
+    }
+}
+
+impl<K: Hash + Eq, V> Default for ShardedMap<K, V> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<K: Hash + Eq, V, S: BuildHasher> ShardedMap<K, V, S> {
+    /// Creates an empty map using `build_hasher`, with a shard count based on the number of
+    /// available CPUs.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::city::CityHasher64;
+    /// use simplehash::sharded_map::ShardedMap;
+    /// use std::hash::BuildHasherDefault;
+    ///
+    /// let map = ShardedMap::with_hasher(BuildHasherDefault::<CityHasher64>::default());
+    /// map.insert("key".to_string(), 1);
+    /// assert_eq!(map.get("key"), Some(1));
+    /// ```
+    pub fn with_hasher(build_hasher: S) -> Self {
+        Self::with_shards_and_hasher(0, build_hasher)
+    }
+
+    /// Creates an empty map with at least `shards` shards using `build_hasher`.
+    ///
+    /// # Parameters
+    ///
+    /// * `shards` - Minimum number of shards (rounded up to a power of two, at most 2^16),
+    ///   or `0` for four shards per available CPU
+    /// * `build_hasher` - Hasher applied once per key
+    pub fn with_shards_and_hasher(shards: usize, build_hasher: S) -> Self {
+        let shards = if shards == 0 {
+            resolve_threads(0) * 4
+        } else {
+            shards
+        };
+        let shards = shards.clamp(1, 1 << 16).next_power_of_two();
+        Self {
+            shards: (0..shards).map(|_| CachePadded::default()).collect(),
+            shift: 64 - shards.trailing_zeros(),
+            build_hasher,
+        }
+    }
+
+    /// Returns the number of shards.
+    #[inline]
+    pub fn shard_count(&self) -> usize {
+        self.shards.len()
+    }
+
+    #[inline]
+    fn hash<Q: Hash + ?Sized>(&self, key: &Q) -> u64 {
+        self.build_hasher.hash_one(key)
+    }
+
+    #[inline]
+    fn shard_of(&self, hash: u64) -> usize {
+        // checked_shr covers the single-shard case, where the shift is 64
+        hash.checked_shr(self.shift).unwrap_or(0) as usize
+    }
+
+    #[inline]
+    fn read(&self, shard: usize) -> RwLockReadGuard<'_, PrehashedMap<K, V>> {
+        self.shards[shard].0.read().unwrap()
+    }
+
+    #[inline]
+    fn write(&self, shard: usize) -> RwLockWriteGuard<'_, PrehashedMap<K, V>> {
+        self.shards[shard].0.write().unwrap()
+    }
+
+    /// Inserts a key-value pair, returning the previous value for the key if there was one.
+    pub fn insert(&self, key: K, value: V) -> Option<V> {
+        let hash = self.hash(&key);
+        self.write(self.shard_of(hash))
+            .insert(Prehashed::new(key, hash.wrapping_mul(REMIX)), value)
+    }
+
+    /// Returns a clone of the value for `key`.
+    pub fn get<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+        V: Clone,
+    {
+        self.get_with(key, V::clone)
+    }
+
+    /// Calls `f` with the value for `key` while holding the shard's read lock.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::sharded_map::ShardedMap;
+    ///
+    /// let map = ShardedMap::new();
+    /// map.insert(1u32, vec![1, 2, 3]);
+    /// assert_eq!(map.get_with(&1, |v| v.len()), Some(3));
+    /// ```
+    pub fn get_with<Q, R, F>(&self, key: &Q, f: F) -> Option<R>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+        F: FnOnce(&V) -> R,
+    {
+        let hash = self.hash(key);
+        let probe = Prehashed::new(key, hash.wrapping_mul(REMIX));
+        self.read(self.shard_of(hash))
+            .get(probe.as_borrowed::<Q>())
+            .map(f)
+    }
+
+    /// Returns `true` if the map contains `key`.
+    pub fn contains_key<Q>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        self.get_with(key, |_| ()).is_some()
+    }
+
+    /// Removes `key` from the map, returning its value if it was present.
+    pub fn remove<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let hash = self.hash(key);
+        let probe = Prehashed::new(key, hash.wrapping_mul(REMIX));
+        self.write(self.shard_of(hash))
+            .remove(probe.as_borrowed::<Q>())
+    }
+
+    /// Applies `f` to the value for `key`, inserting `default()` first if the key is absent,
+    /// and returns `f`'s result. The shard stays locked for the whole update.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::sharded_map::ShardedMap;
+    ///
+    /// let counts = ShardedMap::new();
+    /// for word in ["a", "b", "a"] {
+    ///     counts.upsert(word, || 0, |n| *n += 1);
+    /// }
+    /// assert_eq!(counts.get("a"), Some(2));
+    /// ```
+    pub fn upsert<R, D, F>(&self, key: K, default: D, f: F) -> R
+    where
+        D: FnOnce() -> V,
+        F: FnOnce(&mut V) -> R,
+    {
+        let hash = self.hash(&key);
+        let mut shard = self.write(self.shard_of(hash));
+        f(shard
+            .entry(Prehashed::new(key, hash.wrapping_mul(REMIX)))
+            .or_insert_with(default))
+    }
+
+    /// Looks up many keys at once, taking each shard's read lock only once.
+    ///
+    /// Keys are hashed up front and grouped by shard, so a batch touching `s` shards costs
+    /// `s` lock acquisitions instead of one per key. Results are in input order.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// use simplehash::sharded_map::ShardedMap;
+    ///
+    /// let map = ShardedMap::new();
+    /// map.insert_batch((0u64..100).map(|i| (i, i * i)));
+    /// assert_eq!(map.get_batch(&[3, 200, 9]), vec![Some(9), None, Some(81)]);
+    /// ```
+    pub fn get_batch<Q>(&self, keys: &[Q]) -> Vec<Option<V>>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+        V: Clone,
+    {
+        let mut order: Vec<(u32, u64, u32)> = keys
+            .iter()
+            .enumerate()
+            .map(|(i, key)| {
+                let hash = self.hash(key);
+                (self.shard_of(hash) as u32, hash, i as u32)
+            })
+            .collect();
+        order.sort_unstable_by_key(|&(shard, _, _)| shard);
+
+        let mut results = vec![None; keys.len()];
+        for group in order.chunk_by(|a, b| a.0 == b.0) {
+            let shard = self.read(group[0].0 as usize);
+            for &(_, hash, i) in group {
+                let probe = Prehashed::new(&keys[i as usize], hash.wrapping_mul(REMIX));
+                results[i as usize] = shard.get(probe.as_borrowed::<Q>()).cloned();
+            }
+        }
+        results
+    }
+
+    /// Inserts many key-value pairs, taking each shard's write lock only once.
+    ///
+    /// Returns the number of keys that were not already present. When a key appears more
+    /// than once in the batch, the last value wins.
+    pub fn insert_batch<I>(&self, items: I) -> usize
+    where
+        I: IntoIterator<Item = (K, V)>,
+    {
+        let mut entries: Vec<(u32, Prehashed<K>, V)> = items
+            .into_iter()
+            .map(|(key, value)| {
+                let hash = self.hash(&key);
+                let key = Prehashed::new(key, hash.wrapping_mul(REMIX));
+                (self.shard_of(hash) as u32, key, value)
+            })
+            .collect();
+        // Stable, so duplicates keep their batch order and the last one is written last
+        entries.sort_by_key(|&(shard, _, _)| shard);
+
+        let mut inserted = 0;
+        let mut entries = entries.into_iter().peekable();
+        while let Some(&(shard_index, _, _)) = entries.peek() {
+            let mut shard = self.write(shard_index as usize);
+            while let Some((_, key, value)) = entries.next_if(|e| e.0 == shard_index) {
+                if shard.insert(key, value).is_none() {
+                    inserted += 1;
+                }
+            }
+        }
+        inserted
+    }
+
+    /// Returns the number of entries. Shards are counted one at a time, so the result is only
+    /// a snapshot when other threads are writing.
+    pub fn len(&self) -> usize {
+        (0..self.shards.len()).map(|s| self.read(s).len()).sum()
+    }
+
+    /// Returns `true` if no shard holds any entries.
+    pub fn is_empty(&self) -> bool {
+        (0..self.shards.len()).all(|s| self.read(s).is_empty())
+    }
+
+    /// Removes all entries.
+    pub fn clear(&self) {
+        for s in 0..self.shards.len() {
+            self.write(s).clear();
+        }
+    }
+
+    /// Consumes the map and returns all entries in unspecified order.
+    pub fn into_entries(self) -> Vec<(K, V)> {
+        self.shards
+            .into_vec()
+            .into_iter()
+            .flat_map(|shard| shard.0.into_inner().unwrap())
+            .map(|(key, value)| (key.into_inner(), value))
+            .collect()
+    }
+}
+
+impl<K, V, S> std::fmt::Debug for ShardedMap<K, V, S> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("ShardedMap")
+            .field("shards", &self.shards.len())
+            .finish_non_exhaustive()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::fnv::Fnv1aHasher64;
+    use std::collections::HashMap;
+
+    #[test]
+    fn test_matches_hashmap() {
+        let map: ShardedMap<String, usize> = ShardedMap::with_shards(8);
+        let mut reference = HashMap::new();
+        for i in 0..5000 {
+            let key = format!("key{}", i % 3000);
+            assert_eq!(map.insert(key.clone(), i), reference.insert(key, i));
+        }
+        for i in (0..3000).step_by(7) {
+            let key = format!("key{}", i);
+            assert_eq!(map.remove(key.as_str()), reference.remove(&key));
+        }
+
+        assert_eq!(map.len(), reference.len());
+        for i in 0..3500 {
+            let key = format!("key{}", i);
+            assert_eq!(map.get(key.as_str()), reference.get(&key).copied());
+        }
+        let mut entries = map.into_entries();
+        entries.sort();
+        let mut expected: Vec<_> = reference.into_iter().collect();
+        expected.sort();
+        assert_eq!(entries, expected);
+    }
+
+    #[test]
+    fn test_single_shard_and_custom_hasher() {
+        let map =
+            ShardedMap::with_shards_and_hasher(1, BuildHasherDefault::<Fnv1aHasher64>::default());
+        assert_eq!(map.shard_count(), 1);
+        for i in 0..1000u32 {
+            map.insert(i, i * 2);
+        }
+        assert_eq!(map.get(&500), Some(1000));
+        map.clear();
+        assert!(map.is_empty());
+    }
+
+    #[test]
+    fn test_batches_match_single_operations() {
+        let map = ShardedMap::with_shards(16);
+        let items: Vec<(u64, u64)> = (0..2000).map(|i| (i % 1500, i)).collect();
+        assert_eq!(map.insert_batch(items), 1500);
+        // Duplicates in a batch keep the last value
+        assert_eq!(map.get(&10), Some(1510));
+        assert_eq!(map.get(&1499), Some(1499));
+
+        let keys: Vec<u64> = (0..3000).rev().collect();
+        let batch = map.get_batch(&keys);
+        for (key, value) in keys.iter().zip(batch) {
+            assert_eq!(value, map.get(key));
+        }
+    }
+
+    #[test]
+    fn test_concurrent_upserts() {
+        let map: ShardedMap<u64, u64> = ShardedMap::with_shards(4);
+        std::thread::scope(|s| {
+            for _ in 0..4 {
+                s.spawn(|| {
+                    for i in 0..10_000 {
+                        map.upsert(i % 100, || 0, |n| *n += 1);
+                    }
+                });
+            }
+        });
+        assert_eq!(map.len(), 100);
+        assert!((0..100).all(|k| map.get(&k) == Some(400)));
+    }
+}
@@ -0,0 +1,582 @@
+use crate::city::city_hash64;
+
+const NIL: u32 = u32::MAX;
+// Hashes are computed this many keys ahead of the updates in `offer_batch`
+const BATCH_CHUNK: usize = 64;
+
+/// A key tracked by [`SpaceSaving`] with its estimated count.
+///
+/// `count` never underestimates the true count, and `count - error` never overestimates it.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HeavyHitter<K> {
+    pub key: K,
+    pub count: u64,
+    pub error: u64,
+}
+
+impl<K> HeavyHitter<K> {
+    /// Returns the count the key is guaranteed to have reached.
+    #[inline]
+    pub fn guaranteed_count(&self) -> u64 {
+        self.count - self.error
+    }
+}
+
+#[derive(Debug, Clone)]
+struct Counter<K> {
+    key: K,
+    hash: u64,
+    count: u64,
+    error: u64,
+    bucket: u32,
+    prev: u32,
+    next: u32,
+}
+
+// All counters with the same count hang off one bucket; buckets form a list in count order
+#[derive(Debug, Clone)]
+struct Bucket {
+    count: u64,
+    head: u32,
+    prev: u32,
+    next: u32,
+}
+
+/// A SpaceSaving heavy-hitters summary (Metwally et al.) for finding the most frequent keys
+/// of a stream in bounded memory.
+///
+/// At most `capacity` keys are monitored. When a new key arrives and the summary is full, the
+/// key with the smallest count is replaced and the new key inherits that count as its error
+/// bound. Any key whose true frequency exceeds `total / capacity` is guaranteed to be tracked.
+///
+/// Counters live in the stream-summary structure: buckets of equal count linked in count
+/// order, so every update is O(1). Keys are found through an open-addressing index keyed by
+/// [`city_hash64`] that stores counter indices and resolves collisions by linear probing.
+///
+/// A summary is single-threaded; for multi-threaded ingestion give each thread its own summary
+/// and periodically [`merge`](SpaceSaving::merge) them or take a [`top`](SpaceSaving::top)
+/// snapshot.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::space_saving::SpaceSaving;
+///
+/// let mut summary = SpaceSaving::new(3);
+/// for key in ["a", "b", "a", "c", "a", "b"] {
+///     summary.offer(&key);
+/// }
+/// let top = summary.top(1);
+/// assert_eq!(top[0].key, "a");
+/// assert_eq!(top[0].count, 3);
+/// ```
+#[derive(Debug, Clone)]
+pub struct SpaceSaving<K> {
+    capacity: usize,
+    total: u64,
+    counters: Vec<Counter<K>>,
+    buckets: Vec<Bucket>,
+    free_buckets: Vec<u32>,
+    min_bucket: u32,
+    index: Vec<u32>,
+}
+
+impl<K> SpaceSaving<K>
+where
+    K: AsRef<[u8]> + Clone + Eq,
+{
+    /// Creates an empty summary that monitors at most `capacity` keys.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `capacity` is zero.
+    pub fn new(capacity: usize) -> Self {
+        assert!(capacity > 0, "capacity must be positive");
+        assert!(capacity < NIL as usize, "capacity too large");
+        Self {
+            capacity,
+            total: 0,
+            counters: Vec::with_capacity(capacity),
+            buckets: Vec::new(),
+            free_buckets: Vec::new(),
+            min_bucket: NIL,
+            // At most half full, so probe sequences stay short
+            index: vec![NIL; (capacity * 2).next_power_of_two().max(8)],
+        }
+    }
+
+    /// Records one occurrence of `key`.
+    #[inline]
+    pub fn offer(&mut self, key: &K) {
+        self.offer_hashed(key, city_hash64(key.as_ref()), 1);
+    }
+
+    /// Records `weight` occurrences of `key`.
+    #[inline]
+    pub fn offer_weighted(&mut self, key: &K, weight: u64) {
+        if weight > 0 {
+            self.offer_hashed(key, city_hash64(key.as_ref()), weight);
+        }
+    }
+
+    /// Records one occurrence of every key in `keys`.
+    ///
+    /// Keys are hashed in small chunks before the counters are touched, which keeps the
+    /// hashing loop free of the data-dependent branches of the update path.
+    pub fn offer_batch(&mut self, keys: &[K]) {
+        let mut hashes = [0u64; BATCH_CHUNK];
+        for chunk in keys.chunks(BATCH_CHUNK) {
+            for (hash, key) in hashes.iter_mut().zip(chunk) {
+                *hash = city_hash64(key.as_ref());
+            }
+            for (&hash, key) in hashes.iter().zip(chunk) {
+                self.offer_hashed(key, hash, 1);
+            }
+        }
+    }
+
+    fn offer_hashed(&mut self, key: &K, hash: u64, weight: u64) {
+        self.total += weight;
+
+        let slot = self.find_slot(key, hash);
+        let idx = self.index[slot];
+        if idx != NIL {
+            self.increment(idx, weight);
+            return;
+        }
+
+        if self.counters.len() < self.capacity {
+            let idx = self.counters.len() as u32;
+            self.counters.push(Counter {
+                key: key.clone(),
+                hash,
+                count: 0,
+                error: 0,
+                bucket: NIL,
+                prev: NIL,
+                next: NIL,
+            });
+            self.index[slot] = idx;
+            self.attach_new(idx, weight);
+            return;
+        }
+
+        // Replace the key with the smallest count, which becomes the new key's error bound
+        let victim = self.buckets[self.min_bucket as usize].head;
+        let victim_hash = self.counters[victim as usize].hash;
+        self.remove_from_index(victim, victim_hash);
+        let counter = &mut self.counters[victim as usize];
+        counter.key = key.clone();
+        counter.hash = hash;
+        counter.error = counter.count;
+        let slot = self.find_slot(key, hash);
+        self.index[slot] = victim;
+        self.increment(victim, weight);
+    }
+
+    /// Returns the estimate for `key` if it is currently monitored.
+    pub fn estimate(&self, key: &K) -> Option<HeavyHitter<K>> {
+        let idx = self.index[self.find_slot(key, city_hash64(key.as_ref()))];
+        (idx != NIL).then(|| self.hitter(idx))
+    }
+
+    /// Returns the `k` keys with the highest counts, highest first.
+    pub fn top(&self, k: usize) -> Vec<HeavyHitter<K>> {
+        let mut result = Vec::with_capacity(k.min(self.counters.len()));
+        // Walk from the largest bucket down
+        let mut bucket = self.min_bucket;
+        let mut last = NIL;
+        while bucket != NIL {
+            last = bucket;
+            bucket = self.buckets[bucket as usize].next;
+        }
+        bucket = last;
+        while bucket != NIL && result.len() < k {
+            let mut idx = self.buckets[bucket as usize].head;
+            while idx != NIL && result.len() < k {
+                result.push(self.hitter(idx));
+                idx = self.counters[idx as usize].next;
+            }
+            bucket = self.buckets[bucket as usize].prev;
+        }
+        result
+    }
+
+    /// Returns every monitored key, highest count first.
+    pub fn snapshot(&self) -> Vec<HeavyHitter<K>> {
+        self.top(self.counters.len())
+    }
+
+    /// Merges `other` into this summary, as when combining per-thread summaries.
+    ///
+    /// A key missing from a full summary may still have occurred up to that summary's minimum
+    /// count times, so the minimum is added to both its count and its error. The `capacity`
+    /// largest combined counts are kept.
+    pub fn merge(&mut self, other: &SpaceSaving<K>) {
+        let self_floor = self.floor();
+        let other_floor = other.floor();
+
+        let mut merged: Vec<HeavyHitter<K>> = Vec::with_capacity(self.len() + other.len());
+        for hitter in self.snapshot() {
+            let (count, error) = match other.estimate(&hitter.key) {
+                Some(o) => (o.count, o.error),
+                None => (other_floor, other_floor),
+            };
+            merged.push(HeavyHitter {
+                count: hitter.count + count,
+                error: hitter.error + error,
+                key: hitter.key,
+            });
+        }
+        for hitter in other.snapshot() {
+            if self.estimate(&hitter.key).is_none() {
+                merged.push(HeavyHitter {
+                    count: hitter.count + self_floor,
+                    error: hitter.error + self_floor,
+                    key: hitter.key,
+                });
+            }
+        }
+        merged.sort_by(|a, b| b.count.cmp(&a.count));
+        merged.truncate(self.capacity);
+
+        let total = self.total + other.total;
+        self.clear();
+        self.total = total;
+        // Descending order makes every insertion land at the front of the bucket list
+        for hitter in merged {
+            let hash = city_hash64(hitter.key.as_ref());
+            let slot = self.find_slot(&hitter.key, hash);
+            let idx = self.counters.len() as u32;
+            self.counters.push(Counter {
+                key: hitter.key,
+                hash,
+                count: 0,
+                error: hitter.error,
+                bucket: NIL,
+                prev: NIL,
+                next: NIL,
+            });
+            self.index[slot] = idx;
+            self.attach_new(idx, hitter.count);
+        }
+    }
+
+    /// Removes all keys and resets the stream total.
+    pub fn clear(&mut self) {
+        self.total = 0;
+        self.counters.clear();
+        self.buckets.clear();
+        self.free_buckets.clear();
+        self.min_bucket = NIL;
+        self.index.fill(NIL);
+    }
+
+    /// Returns the number of monitored keys.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.counters.len()
+    }
+
+    /// Returns `true` if no key has been offered since creation or the last clear.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.counters.is_empty()
+    }
+
+    /// Returns the maximum number of monitored keys.
+    #[inline]
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// Returns the total weight offered to the summary.
+    #[inline]
+    pub fn total(&self) -> u64 {
+        self.total
+    }
+
+    // Upper bound on the count of any key that is not monitored
+    fn floor(&self) -> u64 {
+        if self.counters.len() < self.capacity {
+            0
+        } else {
+            self.buckets[self.min_bucket as usize].count
+        }
+    }
+
+    fn hitter(&self, idx: u32) -> HeavyHitter<K> {
+        let counter = &self.counters[idx as usize];
+        HeavyHitter {
+            key: counter.key.clone(),
+            count: counter.count,
+            error: counter.error,
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // Open-addressing index
+    //--------------------------------------------------------------------------
+
+    // Returns the slot holding `key`, or the empty slot where it would be inserted
+    #[inline]
+    fn find_slot(&self, key: &K, hash: u64) -> usize {
+        let mask = self.index.len() - 1;
+        let mut slot = hash as usize & mask;
+        loop {
+            let idx = self.index[slot];
+            if idx == NIL {
+                return slot;
+            }
+            let counter = &self.counters[idx as usize];
+            if counter.hash == hash && counter.key == *key {
+                return slot;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    // Backward-shift deletion keeps linear probing free of tombstones
+    fn remove_from_index(&mut self, idx: u32, hash: u64) {
+        let mask = self.index.len() - 1;
+        let mut slot = hash as usize & mask;
+        while self.index[slot] != idx {
+            slot = (slot + 1) & mask;
+        }
+        let mut hole = slot;
+        let mut next = (hole + 1) & mask;
+        while self.index[next] != NIL {
+            let home = self.counters[self.index[next] as usize].hash as usize & mask;
+            // Move the entry back if the hole lies on its probe path
+            if (next.wrapping_sub(home) & mask) >= (next.wrapping_sub(hole) & mask) {
+                self.index[hole] = self.index[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        self.index[hole] = NIL;
+    }
+
+    //--------------------------------------------------------------------------
+    // Stream-summary buckets
+    //--------------------------------------------------------------------------
+
+    fn new_bucket(&mut self, count: u64, prev: u32, next: u32) -> u32 {
+        let bucket = Bucket {
+            count,
+            head: NIL,
+            prev,
+            next,
+        };
+        let b = match self.free_buckets.pop() {
+            Some(b) => {
+                self.buckets[b as usize] = bucket;
+                b
+            }
+            None => {
+                self.buckets.push(bucket);
+                (self.buckets.len() - 1) as u32
+            }
+        };
+        if prev == NIL {
+            self.min_bucket = b;
+        } else {
+            self.buckets[prev as usize].next = b;
+        }
+        if next != NIL {
+            self.buckets[next as usize].prev = b;
+        }
+        b
+    }
+
+    fn link_counter(&mut self, idx: u32, b: u32) {
+        let head = self.buckets[b as usize].head;
+        let counter = &mut self.counters[idx as usize];
+        counter.bucket = b;
+        counter.prev = NIL;
+        counter.next = head;
+        if head != NIL {
+            self.counters[head as usize].prev = idx;
+        }
+        self.buckets[b as usize].head = idx;
+    }
+
+    fn unlink_counter(&mut self, idx: u32) {
+        let (b, prev, next) = {
+            let c = &self.counters[idx as usize];
+            (c.bucket, c.prev, c.next)
+        };
+        if prev == NIL {
+            self.buckets[b as usize].head = next;
+        } else {
+            self.counters[prev as usize].next = next;
+        }
+        if next != NIL {
+            self.counters[next as usize].prev = prev;
+        }
+    }
+
+    fn free_bucket(&mut self, b: u32) {
+        let (prev, next) = {
+            let bucket = &self.buckets[b as usize];
+            (bucket.prev, bucket.next)
+        };
+        if prev == NIL {
+            self.min_bucket = next;
+        } else {
+            self.buckets[prev as usize].next = next;
+        }
+        if next != NIL {
+            self.buckets[next as usize].prev = prev;
+        }
+        self.free_buckets.push(b);
+    }
+
+    // Places a counter that is in no bucket yet at count `count`, searching up from the minimum
+    fn attach_new(&mut self, idx: u32, count: u64) {
+        let mut prev = NIL;
+        let mut b = self.min_bucket;
+        while b != NIL && self.buckets[b as usize].count < count {
+            prev = b;
+            b = self.buckets[b as usize].next;
+        }
+        let target = if b != NIL && self.buckets[b as usize].count == count {
+            b
+        } else {
+            self.new_bucket(count, prev, b)
+        };
+        self.counters[idx as usize].count = count;
+        self.link_counter(idx, target);
+    }
+
+    // Moves a counter `weight` counts up, reusing or creating the bucket for its new count
+    fn increment(&mut self, idx: u32, weight: u64) {
+        let old = self.counters[idx as usize].bucket;
+        let count = self.counters[idx as usize].count + weight;
+
+        let mut prev = old;
+        let mut b = self.buckets[old as usize].next;
+        while b != NIL && self.buckets[b as usize].count < count {
+            prev = b;
+            b = self.buckets[b as usize].next;
+        }
+
+        self.unlink_counter(idx);
+        let target = if b != NIL && self.buckets[b as usize].count == count {
+            b
+        } else {
+            self.new_bucket(count, prev, b)
+        };
+        self.counters[idx as usize].count = count;
+        self.link_counter(idx, target);
+
+        if self.buckets[old as usize].head == NIL {
+            self.free_bucket(old);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::collections::HashMap;
+
+    // Deterministic skewed stream: key i appears n / (i + 1) times, keys interleaved by round
+    fn skewed_stream(n: usize, distinct: usize) -> Vec<String> {
+        let mut stream = Vec::new();
+        for round in 0..n {
+            for i in 0..distinct {
+                if round < (n / (i + 1)).max(1) {
+                    stream.push(format!("key{}", i));
+                }
+            }
+        }
+        stream
+    }
+
+    #[test]
+    fn test_exact_when_under_capacity() {
+        let mut summary = SpaceSaving::new(10);
+        for key in ["a", "b", "a", "c", "a", "b"] {
+            summary.offer(&key);
+        }
+        summary.offer_weighted(&"c", 5);
+        let top = summary.top(3);
+        assert_eq!(top[0].key, "c");
+        assert_eq!(top[0].count, 6);
+        assert_eq!(top[1].key, "a");
+        assert_eq!(top[1].count, 3);
+        assert_eq!(top[2].key, "b");
+        assert!(top.iter().all(|h| h.error == 0));
+        assert_eq!(summary.total(), 11);
+        assert!(summary.estimate(&"d").is_none());
+    }
+
+    #[test]
+    fn test_bounds_hold_under_eviction() {
+        let stream = skewed_stream(2000, 500);
+        let mut exact: HashMap<&str, u64> = HashMap::new();
+        for key in &stream {
+            *exact.entry(key.as_str()).or_default() += 1;
+        }
+
+        let mut summary = SpaceSaving::new(50);
+        summary.offer_batch(&stream);
+        assert_eq!(summary.len(), 50);
+
+        let snapshot = summary.snapshot();
+        for pair in snapshot.windows(2) {
+            assert!(pair[0].count >= pair[1].count);
+        }
+        for hitter in &snapshot {
+            let truth = exact[hitter.key.as_str()];
+            assert!(
+                hitter.count >= truth,
+                "{:?} underestimates {}",
+                hitter,
+                truth
+            );
+            assert!(hitter.guaranteed_count() <= truth);
+        }
+        // The heaviest keys must be monitored
+        for i in 0..10 {
+            assert!(summary.estimate(&format!("key{}", i)).is_some());
+        }
+        assert_eq!(summary.top(1)[0].key, "key0");
+    }
+
+    #[test]
+    fn test_merge() {
+        let stream = skewed_stream(1000, 300);
+        let (left, right) = stream.split_at(stream.len() / 2);
+
+        let mut a = SpaceSaving::new(40);
+        let mut b = SpaceSaving::new(40);
+        a.offer_batch(left);
+        b.offer_batch(right);
+        a.merge(&b);
+
+        assert_eq!(a.total(), stream.len() as u64);
+        assert!(a.len() <= 40);
+        let top: Vec<String> = a.top(5).into_iter().map(|h| h.key).collect();
+        for i in 0..5 {
+            assert!(top.contains(&format!("key{}", i)), "{:?}", top);
+        }
+        for hitter in a.snapshot() {
+            let truth = stream.iter().filter(|k| **k == hitter.key).count() as u64;
+            assert!(hitter.count >= truth);
+            assert!(hitter.guaranteed_count() <= truth);
+        }
+    }
+
+    #[test]
+    fn test_clear() {
+        let mut summary = SpaceSaving::new(2);
+        summary.offer_batch(&["x", "y", "z"]);
+        summary.clear();
+        assert!(summary.is_empty());
+        assert_eq!(summary.total(), 0);
+        summary.offer(&"x");
+        assert_eq!(summary.top(10).len(), 1);
+    }
+}
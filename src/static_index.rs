@@ -0,0 +1,421 @@
+use crate::farm::farm_fingerprint64;
+use crate::mmap::MappedFile;
+use crate::mphf::{Mphf, MphfBuilder, MphfError};
+use crate::parallel;
+use std::fmt;
+use std::io;
+use std::path::Path;
+
+const MAGIC: &[u8; 8] = b"SHIDX001";
+const HEADER_LEN: usize = 64;
+// Each entry is a fingerprint followed by its value, so a lookup touches one cache line
+const ENTRY_LEN: usize = 16;
+
+/// Errors returned when building or loading a [`StaticIndex`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum StaticIndexError {
+    /// The key at this position appears earlier in the input.
+    DuplicateKey(usize),
+    /// Two distinct keys at these positions share a 64-bit fingerprint.
+    FingerprintCollision(usize, usize),
+    /// The minimal perfect hash function could not be built.
+    Mphf(MphfError),
+    /// Serialized bytes are not a valid index.
+    InvalidData(&'static str),
+}
+
+impl fmt::Display for StaticIndexError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            Self::DuplicateKey(index) => write!(f, "duplicate key at position {}", index),
+            Self::FingerprintCollision(a, b) => write!(
+                f,
+                "keys at positions {} and {} have the same fingerprint",
+                a, b
+            ),
+            Self::Mphf(err) => write!(f, "building perfect hash failed: {}", err),
+            Self::InvalidData(reason) => write!(f, "invalid index data: {}", reason),
+        }
+    }
+}
+
+impl std::error::Error for StaticIndexError {}
+
+impl From<StaticIndexError> for io::Error {
+    fn from(err: StaticIndexError) -> Self {
+        io::Error::new(io::ErrorKind::InvalidData, err)
+    }
+}
+
+// Exposes a sub-range of the index bytes to the embedded `Mphf` without copying
+#[derive(Debug, Clone)]
+struct Section<B> {
+    data: B,
+    start: usize,
+    end: usize,
+}
+
+impl<B: AsRef<[u8]>> AsRef<[u8]> for Section<B> {
+    #[inline]
+    fn as_ref(&self) -> &[u8] {
+        &self.data.as_ref()[self.start..self.end]
+    }
+}
+
+/// A static key→`u64` index stored in a single byte layout that is queried in place.
+///
+/// The index is built offline from (key, value) pairs. Every key is reduced to its
+/// [`farm_fingerprint64`], a hash that is stable across platforms and versions, and a
+/// PTHash-style [`Mphf`] over the fingerprints assigns each key its own entry holding the
+/// fingerprint and the value. A lookup fingerprints the key once, evaluates the perfect hash
+/// on the 8-byte fingerprint and compares the stored fingerprint to reject keys that were not
+/// in the build set (false positives need a 64-bit collision).
+///
+/// Nothing is deserialized when loading: [`StaticIndex::open`] memory-maps the file and
+/// validates only the header, so startup cost does not depend on the index size and
+/// processes opening the same file share its pages. Space is 16 bytes per key plus about
+/// 3 bits per key for the perfect hash.
+///
+/// Layout (all integers little-endian):
+///
+/// | Offset | Contents |
+/// |--------|----------|
+/// | 0 | Header: magic `SHIDX001`, key count, MPHF offset and length, entries offset |
+/// | 64 | Serialized [`Mphf`] over the fingerprints |
+/// | entries offset (8-byte aligned) | `len()` entries of (fingerprint `u64`, value `u64`) |
+///
+/// # Example
+///
+/// ```
+/// use simplehash::static_index::StaticIndex;
+///
+/// let keys = ["alpha", "beta", "gamma"];
+/// let index = StaticIndex::build(&keys, &[10, 20, 30]).unwrap();
+/// assert_eq!(index.get(b"beta"), Some(20));
+/// assert_eq!(index.get(b"delta"), None);
+///
+/// // Any byte container can be queried in place, e.g. a memory-mapped file
+/// let loaded = StaticIndex::from_bytes(index.as_bytes()).unwrap();
+/// assert_eq!(loaded.get(b"gamma"), Some(30));
+/// ```
+#[derive(Debug, Clone)]
+pub struct StaticIndex<B = Vec<u8>> {
+    mphf: Mphf<Section<B>>,
+    num_keys: usize,
+    entries_offset: usize,
+}
+
+/// Configures and builds a [`StaticIndex`].
+#[derive(Debug, Clone, Default)]
+pub struct StaticIndexBuilder {
+    mphf: MphfBuilder,
+    threads: usize,
+}
+
+impl StaticIndexBuilder {
+    /// Creates a builder that uses the default perfect hash parameters and all available
+    /// cores.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Sets the builder for the embedded perfect hash function.
+    pub fn mphf(mut self, mphf: MphfBuilder) -> Self {
+        self.mphf = mphf;
+        self
+    }
+
+    /// Sets the number of threads used to fingerprint keys and build the perfect hash
+    /// (`0` means all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self.mphf = self.mphf.threads(threads);
+        self
+    }
+
+    /// Builds an index mapping `keys[i]` to `values[i]`.
+    ///
+    /// # Errors
+    ///
+    /// Returns [`StaticIndexError::DuplicateKey`] if a key appears twice,
+    /// [`StaticIndexError::FingerprintCollision`] if two distinct keys share a fingerprint,
+    /// or [`StaticIndexError::Mphf`] if the perfect hash could not be built.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `keys` and `values` have different lengths.
+    pub fn build<K>(&self, keys: &[K], values: &[u64]) -> Result<StaticIndex, StaticIndexError>
+    where
+        K: AsRef<[u8]> + Sync,
+    {
+        const CHUNK: usize = 1 << 16;
+
+        assert_eq!(
+            keys.len(),
+            values.len(),
+            "every key needs exactly one value"
+        );
+        let n = keys.len();
+        let fingerprints: Vec<[u8; 8]> =
+            parallel::map_indices(n.div_ceil(CHUNK), self.threads, |c| {
+                keys[c * CHUNK..((c + 1) * CHUNK).min(n)]
+                    .iter()
+                    .map(|k| farm_fingerprint64(k.as_ref()).to_le_bytes())
+                    .collect::<Vec<_>>()
+            })
+            .into_iter()
+            .flatten()
+            .collect();
+
+        let mphf = match self.mphf.build(&fingerprints) {
+            Ok(mphf) => mphf,
+            Err(MphfError::DuplicateKey(index)) => {
+                let first = fingerprints
+                    .iter()
+                    .position(|fp| *fp == fingerprints[index])
+                    .expect("duplicate fingerprint has a first occurrence");
+                return Err(if keys[first].as_ref() == keys[index].as_ref() {
+                    StaticIndexError::DuplicateKey(index)
+                } else {
+                    StaticIndexError::FingerprintCollision(first, index)
+                });
+            }
+            Err(err) => return Err(StaticIndexError::Mphf(err)),
+        };
+
+        let mphf_bytes = mphf.as_bytes();
+        let entries_offset = (HEADER_LEN + mphf_bytes.len()).next_multiple_of(8);
+        let mut data = vec![0u8; entries_offset + n * ENTRY_LEN];
+        data[0..8].copy_from_slice(MAGIC);
+        put_u64(&mut data, 8, n as u64);
+        put_u64(&mut data, 16, HEADER_LEN as u64);
+        put_u64(&mut data, 24, mphf_bytes.len() as u64);
+        put_u64(&mut data, 32, entries_offset as u64);
+        data[HEADER_LEN..HEADER_LEN + mphf_bytes.len()].copy_from_slice(mphf_bytes);
+
+        for (fp, &value) in fingerprints.iter().zip(values) {
+            let at = entries_offset + mphf.index(fp) * ENTRY_LEN;
+            data[at..at + 8].copy_from_slice(fp);
+            put_u64(&mut data, at + 8, value);
+        }
+
+        Ok(StaticIndex::from_bytes(data).expect("freshly built index is valid"))
+    }
+}
+
+impl StaticIndex {
+    /// Builds an index mapping `keys[i]` to `values[i]` with the default parameters.
+    /// See [`StaticIndexBuilder`] for details and errors.
+    pub fn build<K>(keys: &[K], values: &[u64]) -> Result<Self, StaticIndexError>
+    where
+        K: AsRef<[u8]> + Sync,
+    {
+        StaticIndexBuilder::new().build(keys, values)
+    }
+}
+
+impl StaticIndex<MappedFile> {
+    /// Memory-maps the index file at `path` and validates its header.
+    ///
+    /// The mapping is advised for random access, since lookups touch scattered pages.
+    ///
+    /// # Errors
+    ///
+    /// Returns the I/O error if the file cannot be mapped, or an `InvalidData` error wrapping
+    /// [`StaticIndexError`] if it is not a valid index.
+    pub fn open<P: AsRef<Path>>(path: P) -> io::Result<Self> {
+        let file = MappedFile::open(path)?;
+        file.advise_random()?;
+        Ok(Self::from_bytes(file)?)
+    }
+}
+
+impl<B: AsRef<[u8]>> StaticIndex<B> {
+    /// Wraps serialized index bytes (from [`StaticIndex::as_bytes`]) without copying them.
+    ///
+    /// Only the header and the perfect hash's header are checked, so this is O(1).
+    ///
+    /// # Errors
+    ///
+    /// Returns [`StaticIndexError::InvalidData`] if the layout is inconsistent.
+    pub fn from_bytes(data: B) -> Result<Self, StaticIndexError> {
+        let bytes = data.as_ref();
+        if bytes.len() < HEADER_LEN || &bytes[0..8] != MAGIC {
+            return Err(StaticIndexError::InvalidData("bad magic"));
+        }
+        let num_keys = get_u64(bytes, 8);
+        let mphf_offset = get_u64(bytes, 16);
+        let mphf_len = get_u64(bytes, 24);
+        let entries_offset = get_u64(bytes, 32);
+        let limit = bytes.len() as u64;
+        if mphf_offset != HEADER_LEN as u64
+            || mphf_len > limit
+            || entries_offset > limit
+            || entries_offset < mphf_offset + mphf_len
+            || num_keys > limit / ENTRY_LEN as u64
+            || entries_offset + num_keys * ENTRY_LEN as u64 != limit
+        {
+            return Err(StaticIndexError::InvalidData("bad header"));
+        }
+
+        let section = Section {
+            data,
+            start: mphf_offset as usize,
+            end: (mphf_offset + mphf_len) as usize,
+        };
+        let mphf = Mphf::from_bytes(section)
+            .map_err(|_| StaticIndexError::InvalidData("embedded perfect hash is invalid"))?;
+        if mphf.len() as u64 != num_keys {
+            return Err(StaticIndexError::InvalidData("key count mismatch"));
+        }
+
+        Ok(Self {
+            mphf,
+            num_keys: num_keys as usize,
+            entries_offset: entries_offset as usize,
+        })
+    }
+
+    /// Returns the value stored for `key`, or `None` if the key was not in the build set.
+    #[inline]
+    pub fn get(&self, key: &[u8]) -> Option<u64> {
+        self.get_by_fingerprint(farm_fingerprint64(key))
+    }
+
+    /// Returns the value for a key whose [`farm_fingerprint64`] was already computed.
+    #[inline]
+    pub fn get_by_fingerprint(&self, fingerprint: u64) -> Option<u64> {
+        // Checked rather than trusted: corrupted perfect hash data can point past the entries
+        let index = self.mphf.index(&fingerprint.to_le_bytes());
+        if index >= self.num_keys {
+            return None;
+        }
+        let at = self.entries_offset + index * ENTRY_LEN;
+        let data = self.as_bytes();
+        if get_u64(data, at) == fingerprint {
+            Some(get_u64(data, at + 8))
+        } else {
+            None
+        }
+    }
+
+    /// Iterates over all (fingerprint, value) entries in storage order.
+    pub fn entries(&self) -> impl Iterator<Item = (u64, u64)> + '_ {
+        self.as_bytes()[self.entries_offset..]
+            .chunks_exact(ENTRY_LEN)
+            .map(|entry| (get_u64(entry, 0), get_u64(entry, 8)))
+    }
+
+    /// Returns the number of keys.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.num_keys
+    }
+
+    /// Returns `true` if the index was built from no keys.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.num_keys == 0
+    }
+
+    /// Returns the serialized index. Writing these bytes to a file and passing that file to
+    /// [`StaticIndex::open`] restores the index.
+    #[inline]
+    pub fn as_bytes(&self) -> &[u8] {
+        self.mphf.get_ref().data.as_ref()
+    }
+
+    /// Consumes the index and returns the underlying storage.
+    pub fn into_inner(self) -> B {
+        self.mphf.into_inner().data
+    }
+}
+
+#[inline]
+fn get_u64(data: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(data[at..at + 8].try_into().unwrap())
+}
+
+fn put_u64(data: &mut [u8], at: usize, value: u64) {
+    data[at..at + 8].copy_from_slice(&value.to_le_bytes());
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Write;
+
+    #[test]
+    fn test_lookup_and_reload() {
+        let keys: Vec<String> = (0..50_000).map(|i| format!("/objects/{:08}", i)).collect();
+        let values: Vec<u64> = (0..keys.len() as u64).map(|i| i * 4096).collect();
+        let index = StaticIndexBuilder::new()
+            .threads(2)
+            .build(&keys, &values)
+            .unwrap();
+        assert_eq!(index.len(), keys.len());
+
+        let path = std::env::temp_dir().join(format!("simplehash-index-{}", std::process::id()));
+        std::fs::File::create(&path)
+            .unwrap()
+            .write_all(index.as_bytes())
+            .unwrap();
+        let mapped = StaticIndex::open(&path).unwrap();
+        for (key, &value) in keys.iter().zip(&values) {
+            assert_eq!(index.get(key.as_bytes()), Some(value));
+            assert_eq!(mapped.get(key.as_bytes()), Some(value));
+        }
+        for i in 50_000..51_000 {
+            assert_eq!(mapped.get(format!("/objects/{:08}", i).as_bytes()), None);
+        }
+        assert_eq!(
+            mapped.entries().map(|(_, v)| v).sum::<u64>(),
+            values.iter().sum::<u64>()
+        );
+        drop(mapped);
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[test]
+    fn test_empty_index() {
+        let index = StaticIndex::build::<&str>(&[], &[]).unwrap();
+        assert!(index.is_empty());
+        assert_eq!(index.get(b"anything"), None);
+        let reloaded = StaticIndex::from_bytes(index.as_bytes().to_vec()).unwrap();
+        assert_eq!(reloaded.get(b""), None);
+    }
+
+    #[test]
+    fn test_duplicate_key() {
+        let keys = ["a", "b", "c", "b"];
+        assert_eq!(
+            StaticIndex::build(&keys, &[1, 2, 3, 4]).unwrap_err(),
+            StaticIndexError::DuplicateKey(3)
+        );
+    }
+
+    #[test]
+    fn test_rejects_corrupt_data() {
+        let index = StaticIndex::build(&["x", "y"], &[1, 2]).unwrap();
+        let bytes = index.as_bytes();
+        assert!(StaticIndex::from_bytes(&bytes[..bytes.len() - 1]).is_err());
+        let mut bad_magic = bytes.to_vec();
+        bad_magic[0] ^= 1;
+        assert!(StaticIndex::from_bytes(bad_magic).is_err());
+        let mut bad_mphf = bytes.to_vec();
+        bad_mphf[HEADER_LEN] ^= 1;
+        assert!(StaticIndex::from_bytes(bad_mphf).is_err());
+
+        // No single-bit error makes a lookup panic, including ones in the perfect hash's
+        // partition descriptors
+        for bit in 0..bytes.len() * 8 {
+            let mut flipped = bytes.to_vec();
+            flipped[bit / 8] ^= 1 << (bit % 8);
+            if let Ok(index) = StaticIndex::from_bytes(flipped) {
+                for key in ["x", "y", "z"] {
+                    index.get(key.as_bytes());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,394 @@
+use crate::fnv::{FNV_64_OFFSET, FNV_64_PRIME};
+use crate::murmur::fmix64;
+
+// Marks an unused table slot
+const EMPTY: u32 = u32::MAX;
+// Seeds tried before construction gives up
+const MAX_SEEDS: u64 = 64;
+// Largest bucket worth searching a pilot for; bigger buckets retry with the next seed
+const MAX_BUCKET: usize = 16;
+const SLOT_MULTIPLIER: u64 = 0x9e3779b97f4a7c15;
+
+/// A read-only string-keyed map whose perfect hash layout is computed at compile time.
+///
+/// Build one with the [`static_map!`](crate::static_map!) macro. Every key hashes to its own
+/// slot, so a lookup costs one hash (seeded FNV-1a with a MurmurHash3 finalizer), two array
+/// reads and one string comparison, with no probing. The table lives in the binary's
+/// read-only data: there is no startup cost and nothing is allocated.
+///
+/// Entries are stored and iterated in declaration order.
+#[derive(Debug)]
+pub struct StaticMap<V: 'static> {
+    // Fields are public only so `static_map!` can build the map in a `static` initializer
+    #[doc(hidden)]
+    pub entries: &'static [(&'static str, V)],
+    #[doc(hidden)]
+    pub slots: &'static [u32],
+    #[doc(hidden)]
+    pub pilots: &'static [u16],
+    #[doc(hidden)]
+    pub seed: u64,
+}
+
+impl<V> StaticMap<V> {
+    /// Returns the value stored for `key`, if any.
+    #[inline]
+    pub fn get(&self, key: &str) -> Option<&V> {
+        self.get_key_value(key).map(|(_, value)| value)
+    }
+
+    /// Returns the stored key and value for `key`, if any.
+    #[inline]
+    pub fn get_key_value(&self, key: &str) -> Option<(&'static str, &V)> {
+        let h = hash(key.as_bytes(), self.seed);
+        let pilot = self.pilots[reduce(h, self.pilots.len())];
+        let index = self.slots[slot(h, pilot, self.slots.len())];
+        let (stored, value) = self.entries.get(index as usize)?;
+        (*stored == key).then_some((*stored, value))
+    }
+
+    /// Returns whether `key` is in the map.
+    #[inline]
+    pub fn contains_key(&self, key: &str) -> bool {
+        self.get_key_value(key).is_some()
+    }
+
+    /// Returns the number of entries.
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    /// Returns whether the map has no entries.
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Iterates the entries in declaration order.
+    pub fn iter(&self) -> impl Iterator<Item = (&'static str, &V)> + '_ {
+        self.entries.iter().map(|(key, value)| (*key, value))
+    }
+
+    /// Iterates the keys in declaration order.
+    pub fn keys(&self) -> impl Iterator<Item = &'static str> + '_ {
+        self.entries.iter().map(|(key, _)| *key)
+    }
+}
+
+/// Builds a [`StaticMap`] from `key => value` pairs at compile time.
+///
+/// Keys are string constants and values are constant expressions of one type. The
+/// perfect hash layout is searched by const evaluation, so the expansion must initialize a
+/// `static` or `const`. A duplicate key is a compile-time error.
+///
+/// # Example
+///
+/// ```
+/// use simplehash::static_map;
+/// use simplehash::static_map::StaticMap;
+///
+/// static METHODS: StaticMap<u8> = static_map! {
+///     "GET" => 1,
+///     "HEAD" => 2,
+///     "POST" => 3,
+///     "DELETE" => 4,
+/// };
+///
+/// assert_eq!(METHODS.get("POST"), Some(&3));
+/// assert_eq!(METHODS.get("PATCH"), None);
+/// ```
+///
+/// Duplicate keys are rejected:
+///
+/// ```compile_fail
+/// use simplehash::static_map;
+/// use simplehash::static_map::StaticMap;
+///
+/// static BAD: StaticMap<u8> = static_map! { "GET" => 1, "GET" => 2 };
+/// ```
+#[macro_export]
+macro_rules! static_map {
+    ($($key:expr => $value:expr),* $(,)?) => {{
+        const KEYS: &[&str] = &[$($key),*];
+        const N: usize = KEYS.len();
+        const M: usize = $crate::static_map::table_len(N);
+        const B: usize = $crate::static_map::bucket_count(N);
+        const LAYOUT: $crate::static_map::Layout<M, B> =
+            $crate::static_map::Layout::build::<N>(KEYS);
+        $crate::static_map::StaticMap {
+            entries: &[$(($key, $value)),*],
+            slots: &LAYOUT.slots,
+            pilots: &LAYOUT.pilots,
+            seed: LAYOUT.seed,
+        }
+    }};
+}
+
+/// The perfect hash layout of `M` slots and `B` buckets that [`static_map!`](crate::static_map!)
+/// computes for its keys.
+///
+/// Keys are spread over buckets by hash. Each bucket stores a *pilot*, chosen so that
+/// every key in the bucket, hashed together with the pilot, lands on a distinct free slot.
+/// Buckets are placed largest first, and if a bucket finds no pilot the whole search restarts
+/// with the next seed.
+#[doc(hidden)]
+#[derive(Debug, Clone)]
+pub struct Layout<const M: usize, const B: usize> {
+    pub slots: [u32; M],
+    pub pilots: [u16; B],
+    pub seed: u64,
+}
+
+/// Returns the number of table slots for `n` keys (a load factor of about 0.8).
+#[doc(hidden)]
+pub const fn table_len(n: usize) -> usize {
+    n + n / 4 + 1
+}
+
+/// Returns the number of buckets for `n` keys (about three keys per bucket).
+#[doc(hidden)]
+pub const fn bucket_count(n: usize) -> usize {
+    n / 3 + 1
+}
+
+impl<const M: usize, const B: usize> Layout<M, B> {
+    /// Searches seeds until one gives every key its own slot.
+    ///
+    /// # Panics
+    ///
+    /// Panics (at compile time, in a const initializer) if `keys` contains a duplicate, if
+    /// `keys.len() != N`, or if no seed works.
+    pub const fn build<const N: usize>(keys: &[&str]) -> Self {
+        assert!(keys.len() == N, "static_map!: key count mismatch");
+        assert!(
+            M == table_len(N) && B == bucket_count(N),
+            "static_map!: layout size mismatch"
+        );
+        assert!(N < EMPTY as usize, "static_map!: too many keys");
+        let mut attempt = 0;
+        while attempt < MAX_SEEDS {
+            if let Some(layout) = Self::try_seed::<N>(keys, fmix64(attempt + 1)) {
+                return layout;
+            }
+            attempt += 1;
+        }
+        panic!("static_map!: no perfect hash layout found")
+    }
+
+    const fn try_seed<const N: usize>(keys: &[&str], seed: u64) -> Option<Self> {
+        // Hash every key once and counting-sort the keys by bucket
+        let mut hashes = [0u64; N];
+        let mut counts = [0usize; B];
+        let mut i = 0;
+        while i < N {
+            hashes[i] = hash(keys[i].as_bytes(), seed);
+            counts[reduce(hashes[i], B)] += 1;
+            i += 1;
+        }
+        let mut starts = [0usize; B];
+        let mut largest = 0;
+        let mut b = 0;
+        while b < B {
+            if b > 0 {
+                starts[b] = starts[b - 1] + counts[b - 1];
+            }
+            if counts[b] > largest {
+                largest = counts[b];
+            }
+            b += 1;
+        }
+        if largest > MAX_BUCKET {
+            return None;
+        }
+        let mut order = [0usize; N];
+        let mut cursor = starts;
+        i = 0;
+        while i < N {
+            let b = reduce(hashes[i], B);
+            order[cursor[b]] = i;
+            cursor[b] += 1;
+            i += 1;
+        }
+
+        let mut slots = [EMPTY; M];
+        let mut pilots = [0u16; B];
+        let mut size = largest;
+        while size > 0 {
+            let mut b = 0;
+            while b < B {
+                if counts[b] == size {
+                    let members = split(&order, starts[b], size);
+                    match find_pilot(keys, &hashes, members, &slots) {
+                        Some(pilot) => {
+                            pilots[b] = pilot;
+                            let mut k = 0;
+                            while k < size {
+                                let key = members[k];
+                                slots[slot(hashes[key], pilot, M)] = key as u32;
+                                k += 1;
+                            }
+                        }
+                        None => return None,
+                    }
+                }
+                b += 1;
+            }
+            size -= 1;
+        }
+        Some(Self {
+            slots,
+            pilots,
+            seed,
+        })
+    }
+}
+
+// Returns `order[start..start + len]` (range indexing is not const)
+const fn split(order: &[usize], start: usize, len: usize) -> &[usize] {
+    let (_, tail) = order.split_at(start);
+    tail.split_at(len).0
+}
+
+// Finds the smallest pilot that sends every key of a bucket to a distinct free slot
+const fn find_pilot(
+    keys: &[&str],
+    hashes: &[u64],
+    members: &[usize],
+    slots: &[u32],
+) -> Option<u16> {
+    // Keys with equal full hashes collide under every pilot
+    let mut j = 0;
+    while j < members.len() {
+        let mut k = 0;
+        while k < j {
+            if hashes[members[j]] == hashes[members[k]] {
+                if str_eq(keys[members[j]], keys[members[k]]) {
+                    panic!("static_map!: duplicate key");
+                }
+                return None;
+            }
+            k += 1;
+        }
+        j += 1;
+    }
+
+    let mut pilot = 0u32;
+    'search: while pilot <= u16::MAX as u32 {
+        let mut j = 0;
+        while j < members.len() {
+            let s = slot(hashes[members[j]], pilot as u16, slots.len());
+            if slots[s] != EMPTY {
+                pilot += 1;
+                continue 'search;
+            }
+            let mut k = 0;
+            while k < j {
+                if slot(hashes[members[k]], pilot as u16, slots.len()) == s {
+                    pilot += 1;
+                    continue 'search;
+                }
+                k += 1;
+            }
+            j += 1;
+        }
+        return Some(pilot as u16);
+    }
+    None
+}
+
+const fn str_eq(a: &str, b: &str) -> bool {
+    let (a, b) = (a.as_bytes(), b.as_bytes());
+    if a.len() != b.len() {
+        return false;
+    }
+    let mut i = 0;
+    while i < a.len() {
+        if a[i] != b[i] {
+            return false;
+        }
+        i += 1;
+    }
+    true
+}
+
+// Seeded FNV-1a, finalized with fmix64 so that every output bit depends on every input bit
+#[inline]
+const fn hash(data: &[u8], seed: u64) -> u64 {
+    let mut h = FNV_64_OFFSET ^ seed;
+    let mut i = 0;
+    while i < data.len() {
+        h ^= data[i] as u64;
+        h = h.wrapping_mul(FNV_64_PRIME);
+        i += 1;
+    }
+    fmix64(h)
+}
+
+// Maps the low 32 bits of `h` onto `0..n` without division
+#[inline(always)]
+const fn reduce(h: u64, n: usize) -> usize {
+    (((h & 0xffff_ffff) * n as u64) >> 32) as usize
+}
+
+// Maps a key hash and its bucket's pilot onto `0..n`. The multiply carries every bit of
+// `h ^ pilot` into the high half, so different pilots reshuffle keys within a bucket.
+#[inline(always)]
+const fn slot(h: u64, pilot: u16, n: usize) -> usize {
+    let mixed =
+        (h ^ (pilot as u64 + 1).wrapping_mul(SLOT_MULTIPLIER)).wrapping_mul(SLOT_MULTIPLIER);
+    (((mixed >> 32) * n as u64) >> 32) as usize
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    static COMMANDS: StaticMap<fn(i64) -> i64> = static_map! {
+        "incr" => |x| x + 1,
+        "decr" => |x| x - 1,
+        "double" => |x| x * 2,
+        "negate" => |x| -x,
+        "" => |x| x,
+    };
+
+    static EMPTY_MAP: StaticMap<u8> = static_map! {};
+
+    #[test]
+    fn test_static_map_lookup() {
+        assert_eq!(COMMANDS.len(), 5);
+        assert_eq!(COMMANDS.get("double").map(|f| f(21)), Some(42));
+        assert_eq!(COMMANDS.get("").map(|f| f(7)), Some(7));
+        assert!(COMMANDS.get("incr ").is_none());
+        assert!(!COMMANDS.contains_key("DOUBLE"));
+        assert_eq!(
+            COMMANDS.keys().collect::<Vec<_>>(),
+            ["incr", "decr", "double", "negate", ""]
+        );
+
+        assert!(EMPTY_MAP.is_empty());
+        assert_eq!(EMPTY_MAP.get("anything"), None);
+    }
+
+    #[test]
+    fn test_layout_is_perfect_for_many_keys() {
+        const N: usize = 2000;
+        let owned: Vec<String> = (0..N).map(|i| format!("key-{}", i)).collect();
+        let keys: Vec<&str> = owned.iter().map(String::as_str).collect();
+        let layout = Layout::<{ table_len(N) }, { bucket_count(N) }>::build::<N>(&keys);
+
+        let mut seen = vec![false; N];
+        for key in &keys {
+            let h = hash(key.as_bytes(), layout.seed);
+            let pilot = layout.pilots[reduce(h, layout.pilots.len())];
+            let index = layout.slots[slot(h, pilot, layout.slots.len())] as usize;
+            assert_eq!(keys[index], *key);
+            assert!(!seen[index]);
+            seen[index] = true;
+        }
+    }
+
+    #[test]
+    #[should_panic(expected = "duplicate key")]
+    fn test_duplicate_keys_rejected() {
+        Layout::<{ table_len(3) }, { bucket_count(3) }>::build::<3>(&["a", "b", "a"]);
+    }
+}
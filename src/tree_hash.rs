@@ -0,0 +1,406 @@
+use crate::digest::{Algorithm, MultiHasher};
+use crate::mmap::MappedFile;
+use crate::parallel::{self, Spawner};
+use std::fs::{self, File};
+use std::io::{self, Read};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+
+// Small files are hashed in batches of up to this many files or bytes
+const BATCH_FILES: usize = 64;
+const BATCH_BYTES: u64 = 4 << 20;
+
+/// One regular file in a [`TreeManifest`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct FileEntry {
+    /// The path relative to the hashed root.
+    pub path: PathBuf,
+    /// The file size in bytes.
+    pub size: u64,
+    /// The file digest: the hash of the contents, or for files larger than the chunk size,
+    /// the hash of the concatenated little-endian chunk hashes.
+    pub hash: u128,
+}
+
+/// The digests of every regular file under a directory, sorted by path.
+#[derive(Debug)]
+pub struct TreeManifest {
+    /// The files, sorted by path bytes.
+    pub entries: Vec<FileEntry>,
+    /// A digest of the whole tree: the hash of every entry's path, a NUL byte, the size and the
+    /// digest (both little-endian) in path order.
+    pub root: u128,
+    /// Entries that could not be read, with their errors.
+    pub errors: Vec<(PathBuf, io::Error)>,
+}
+
+impl TreeManifest {
+    /// Returns the total size of all entries in bytes.
+    pub fn total_bytes(&self) -> u64 {
+        self.entries.iter().map(|e| e.size).sum()
+    }
+}
+
+/// Hashes every regular file below a directory in parallel.
+///
+/// Directories are listed, and files hashed, as tasks on a work-stealing pool. Small files are
+/// batched so each task amortizes its scheduling cost. Files larger than the chunk size are
+/// memory-mapped and split into chunk tasks, so one huge file is spread over all workers
+/// instead of stalling one of them (tree-hash mode). Symbolic links are not followed.
+///
+/// # Example
+///
+/// ```no_run
+/// use simplehash::digest::Algorithm;
+/// use simplehash::tree_hash::TreeHasher;
+///
+/// let manifest = TreeHasher::new().algorithm(Algorithm::City128).hash("target/release")?;
+/// for entry in &manifest.entries {
+///     println!("{:032x}  {}", entry.hash, entry.path.display());
+/// }
+/// println!("root {:032x}", manifest.root);
+/// # Ok::<(), std::io::Error>(())
+/// ```
+#[derive(Debug, Clone)]
+pub struct TreeHasher {
+    algorithm: Algorithm,
+    chunk_size: u64,
+    threads: usize,
+}
+
+impl Default for TreeHasher {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+enum Task {
+    Dir(PathBuf),
+    Files(Vec<PathBuf>),
+    Chunk(Arc<LargeFile>, usize),
+}
+
+struct LargeFile {
+    path: PathBuf,
+    map: MappedFile,
+    hashes: Mutex<Vec<u128>>,
+    remaining: AtomicUsize,
+}
+
+#[derive(Default)]
+struct Worker {
+    entries: Vec<FileEntry>,
+    errors: Vec<(PathBuf, io::Error)>,
+    buf: Vec<u8>,
+}
+
+impl TreeHasher {
+    /// Creates a hasher using [`Algorithm::FarmFingerprint128`], 16 MiB chunks, and all
+    /// available cores.
+    pub fn new() -> Self {
+        Self {
+            algorithm: Algorithm::FarmFingerprint128,
+            chunk_size: 16 << 20,
+            threads: 0,
+        }
+    }
+
+    /// Sets the hash function for file contents and the root.
+    pub fn algorithm(mut self, algorithm: Algorithm) -> Self {
+        self.algorithm = algorithm;
+        self
+    }
+
+    /// Sets the chunk size of tree-hash mode. Files up to this size are hashed whole.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `chunk_size` is 0.
+    pub fn chunk_size(mut self, chunk_size: u64) -> Self {
+        assert!(chunk_size > 0, "chunk size must be positive");
+        self.chunk_size = chunk_size;
+        self
+    }
+
+    /// Sets the number of worker threads (`0` uses all available cores).
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Hashes every regular file below `root` and returns the sorted manifest.
+    ///
+    /// Files that fail to open or read are reported in [`TreeManifest::errors`] instead of
+    /// aborting the walk.
+    ///
+    /// # Errors
+    ///
+    /// Returns the error if `root` itself cannot be read as a directory.
+    pub fn hash<P: AsRef<Path>>(&self, root: P) -> io::Result<TreeManifest> {
+        let root = root.as_ref();
+        fs::read_dir(root)?;
+
+        let workers = parallel::run_tasks(
+            vec![Task::Dir(PathBuf::new())],
+            self.threads,
+            Worker::default,
+            |task, worker, spawner| match task {
+                Task::Dir(dir) => self.list(root, dir, worker, spawner),
+                Task::Files(files) => {
+                    for path in files {
+                        match self.hash_small(&root.join(&path), &mut worker.buf) {
+                            Ok(hash) => {
+                                let size = worker.buf.len() as u64;
+                                worker.entries.push(FileEntry { path, size, hash })
+                            }
+                            Err(err) => worker.errors.push((path, err)),
+                        }
+                    }
+                }
+                Task::Chunk(file, index) => self.hash_chunk(&file, index, worker),
+            },
+        );
+
+        let mut entries = Vec::new();
+        let mut errors = Vec::new();
+        for worker in workers {
+            entries.extend(worker.entries);
+            errors.extend(worker.errors);
+        }
+        entries.sort_unstable_by(|a, b| {
+            a.path
+                .as_os_str()
+                .as_encoded_bytes()
+                .cmp(b.path.as_os_str().as_encoded_bytes())
+        });
+        errors.sort_unstable_by(|a, b| a.0.cmp(&b.0));
+        let root = self.root_digest(&entries);
+        Ok(TreeManifest {
+            entries,
+            root,
+            errors,
+        })
+    }
+
+    // Lists one directory, queueing subdirectories, batches of small files, and the chunks of
+    // large files
+    fn list(&self, root: &Path, dir: PathBuf, worker: &mut Worker, spawner: &Spawner<'_, Task>) {
+        let listing = match fs::read_dir(root.join(&dir)) {
+            Ok(listing) => listing,
+            Err(err) => return worker.errors.push((dir, err)),
+        };
+        let mut batch = Vec::new();
+        let mut batch_bytes = 0;
+        for entry in listing {
+            let entry = match entry {
+                Ok(entry) => entry,
+                Err(err) => {
+                    worker.errors.push((dir.clone(), err));
+                    continue;
+                }
+            };
+            let path = dir.join(entry.file_name());
+            let file_type = match entry.file_type() {
+                Ok(file_type) => file_type,
+                Err(err) => {
+                    worker.errors.push((path, err));
+                    continue;
+                }
+            };
+            if file_type.is_dir() {
+                spawner.spawn(Task::Dir(path));
+            } else if file_type.is_file() {
+                let size = match entry.metadata() {
+                    Ok(meta) => meta.len(),
+                    Err(err) => {
+                        worker.errors.push((path, err));
+                        continue;
+                    }
+                };
+                if size > self.chunk_size {
+                    self.split_large(root, path, worker, spawner);
+                    continue;
+                }
+                batch.push(path);
+                batch_bytes += size;
+                if batch.len() >= BATCH_FILES || batch_bytes >= BATCH_BYTES {
+                    spawner.spawn(Task::Files(std::mem::take(&mut batch)));
+                    batch_bytes = 0;
+                }
+            }
+        }
+        if !batch.is_empty() {
+            spawner.spawn(Task::Files(batch));
+        }
+    }
+
+    fn split_large(
+        &self,
+        root: &Path,
+        path: PathBuf,
+        worker: &mut Worker,
+        spawner: &Spawner<'_, Task>,
+    ) {
+        let map = match MappedFile::open(root.join(&path)) {
+            Ok(map) => map,
+            Err(err) => return worker.errors.push((path, err)),
+        };
+        let _ = map.advise_sequential();
+        let chunks = (map.len() as u64).div_ceil(self.chunk_size).max(1) as usize;
+        let file = Arc::new(LargeFile {
+            path,
+            map,
+            hashes: Mutex::new(vec![0; chunks]),
+            remaining: AtomicUsize::new(chunks),
+        });
+        for index in 0..chunks {
+            spawner.spawn(Task::Chunk(Arc::clone(&file), index));
+        }
+    }
+
+    fn hash_chunk(&self, file: &LargeFile, index: usize, worker: &mut Worker) {
+        let data = file.map.as_slice();
+        let start = (index as u64 * self.chunk_size) as usize;
+        let end = (start + self.chunk_size as usize).min(data.len());
+        let hash = self.algorithm.hash(&data[start..end]);
+        file.hashes.lock().unwrap()[index] = hash;
+
+        // The worker finishing the last chunk combines the chunk hashes
+        if file.remaining.fetch_sub(1, Ordering::AcqRel) == 1 {
+            let hashes = file.hashes.lock().unwrap();
+            let bytes: Vec<u8> = hashes.iter().flat_map(|h| h.to_le_bytes()).collect();
+            worker.entries.push(FileEntry {
+                path: file.path.clone(),
+                size: data.len() as u64,
+                hash: self.algorithm.hash(&bytes),
+            });
+        }
+    }
+
+    // Reads a small file into the worker's reusable buffer, avoiding a mapping per file
+    fn hash_small(&self, path: &Path, buf: &mut Vec<u8>) -> io::Result<u128> {
+        buf.clear();
+        File::open(path)?.read_to_end(buf)?;
+        Ok(self.algorithm.hash(buf))
+    }
+
+    fn root_digest(&self, entries: &[FileEntry]) -> u128 {
+        let mut hasher = MultiHasher::new(&[self.algorithm]);
+        for entry in entries {
+            hasher.update(entry.path.as_os_str().as_encoded_bytes());
+            hasher.update(&[0]);
+            hasher.update(&entry.size.to_le_bytes());
+            hasher.update(&entry.hash.to_le_bytes());
+        }
+        hasher.finish()[0]
+    }
+}
+
+/// Regular files with their metadata, and the paths that could not be read.
+pub(crate) type Listing = (Vec<(PathBuf, fs::Metadata)>, Vec<(PathBuf, io::Error)>);
+
+/// Lists every regular file below `root` in parallel, with paths relative to `root` and the
+/// metadata from the directory listing. Symbolic links are not followed, and entries that
+/// cannot be read are returned as errors. The files come out in no particular order.
+pub(crate) fn walk(root: &Path, threads: usize) -> Listing {
+    let workers = parallel::run_tasks(
+        vec![PathBuf::new()],
+        threads,
+        Listing::default,
+        |dir, (files, errors), spawner| {
+            let listing = match fs::read_dir(root.join(&dir)) {
+                Ok(listing) => listing,
+                Err(err) => return errors.push((dir, err)),
+            };
+            for entry in listing {
+                let entry = match entry {
+                    Ok(entry) => entry,
+                    Err(err) => {
+                        errors.push((dir.clone(), err));
+                        continue;
+                    }
+                };
+                let path = dir.join(entry.file_name());
+                match entry.file_type() {
+                    Ok(file_type) if file_type.is_dir() => spawner.spawn(path),
+                    Ok(file_type) if file_type.is_file() => match entry.metadata() {
+                        Ok(meta) => files.push((path, meta)),
+                        Err(err) => errors.push((path, err)),
+                    },
+                    Ok(_) => {}
+                    Err(err) => errors.push((path, err)),
+                }
+            }
+        },
+    );
+    let mut files = Vec::new();
+    let mut errors = Vec::new();
+    for (worker_files, worker_errors) in workers {
+        files.extend(worker_files);
+        errors.extend(worker_errors);
+    }
+    (files, errors)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_tree_hash_matches_direct_hashes() {
+        let root = std::env::temp_dir().join(format!("simplehash-tree-{}", std::process::id()));
+        let _ = fs::remove_dir_all(&root);
+        fs::create_dir_all(root.join("a/b")).unwrap();
+        fs::create_dir_all(root.join("empty")).unwrap();
+        let large: Vec<u8> = (0..10_000u32).map(|i| (i % 251) as u8).collect();
+        let files: Vec<(&str, Vec<u8>)> = vec![
+            ("top.txt", b"top".to_vec()),
+            ("a/one", b"one".to_vec()),
+            ("a/b/two", Vec::new()),
+            ("a/b/large.bin", large.clone()),
+        ];
+        for (path, data) in &files {
+            fs::write(root.join(path), data).unwrap();
+        }
+        for i in 0..200 {
+            fs::write(root.join(format!("a/small-{:03}", i)), i.to_string()).unwrap();
+        }
+
+        let hasher = TreeHasher::new().chunk_size(4096).threads(3);
+        let manifest = hasher.hash(&root).unwrap();
+        let serial = hasher.clone().threads(1).hash(&root).unwrap();
+        fs::remove_dir_all(&root).unwrap();
+
+        assert!(manifest.errors.is_empty());
+        assert_eq!(manifest.entries.len(), 204);
+        let paths: Vec<_> = manifest.entries.iter().map(|e| e.path.clone()).collect();
+        let mut sorted = paths.clone();
+        sorted.sort();
+        assert_eq!(paths, sorted);
+
+        let find = |p: &str| {
+            manifest
+                .entries
+                .iter()
+                .find(|e| e.path == Path::new(p))
+                .unwrap()
+        };
+        let fp = Algorithm::FarmFingerprint128;
+        assert_eq!(find("top.txt").hash, fp.hash(b"top"));
+        assert_eq!(find("a/b/two").hash, fp.hash(b""));
+        let chunks: Vec<u8> = large
+            .chunks(4096)
+            .flat_map(|c| fp.hash(c).to_le_bytes())
+            .collect();
+        assert_eq!(find("a/b/large.bin").hash, fp.hash(&chunks));
+        assert_eq!(find("a/b/large.bin").size, 10_000);
+
+        // The root depends on every entry but not on the thread count
+        assert_eq!(serial.entries, manifest.entries);
+        assert_eq!(serial.root, manifest.root);
+        let mut changed = manifest.entries.clone();
+        changed[0].hash ^= 1;
+        assert_ne!(hasher.root_digest(&changed), manifest.root);
+    }
+}